@@ -58,6 +58,13 @@
  * Larger values result in less frequent active slots: reduces capacity and saves energy. */
 #define TSCH_SCHEDULE_CONF_DEFAULT_LENGTH 3
 
+#if BUILD_WITH_MSF
+/* A parent negotiates with its children while asking its own parent */
+#define SIXTOP_CONF_MAX_TRANSACTIONS 2
+/* Room for the cells of several children */
+#define MSF_CONF_SLOTFRAME_LENGTH 11
+#endif /* BUILD_WITH_MSF */
+
 #if WITH_SECURITY
 
 /* Enable security */
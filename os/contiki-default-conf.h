@@ -118,6 +118,21 @@
 #ifndef RPL_NBR_POLICY_CONF_MAX_NEXTHOP_NEIGHBORS
 #define RPL_NBR_POLICY_CONF_MAX_NEXTHOP_NEIGHBORS  MAX(NBR_TABLE_CONF_MAX_NEIGHBORS - 3, 0)
 #endif /* RPL_NBR_POLICY_CONF_MAX_NEXTHOP_NEIGHBORS */
+/* BRPL measures the neighbor churn of the IPv6 neighbor cache. Same
+   condition as BRPL_CONF_ENABLE in net/routing/brpl-conf.h, whose code
+   point is needed before the RPL headers are included */
+#ifndef RPL_OCP_BRPL
+#define RPL_OCP_BRPL 2
+#endif /* RPL_OCP_BRPL */
+#ifndef NBR_TABLE_CONF_WITH_CHURN
+#if defined(BRPL_CONF_ENABLE)
+#define NBR_TABLE_CONF_WITH_CHURN              BRPL_CONF_ENABLE
+#elif defined(RPL_CONF_OF_OCP) && (RPL_CONF_OF_OCP == RPL_OCP_BRPL)
+#define NBR_TABLE_CONF_WITH_CHURN              1
+#else
+#define NBR_TABLE_CONF_WITH_CHURN              0
+#endif
+#endif /* NBR_TABLE_CONF_WITH_CHURN */
 #endif /* ROUTING_CONF_RPL_CLASSIC */
 #endif /* UIP_CONF_IPV6_RPL */
 
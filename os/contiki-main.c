@@ -56,6 +56,7 @@
 #include "net/mac/framer/frame802154.h"
 #include "services/rpl-border-router/rpl-border-router.h"
 #include "services/orchestra/orchestra.h"
+#include "services/msf/msf.h"
 #include "services/shell/serial-shell.h"
 #include "services/simple-energest/simple-energest.h"
 #include "services/tsch-cs/tsch-cs.h"
@@ -275,6 +276,11 @@ main(void)
   LOG_DBG("With Orchestra\n");
 #endif /* BUILD_WITH_ORCHESTRA */
 
+#if BUILD_WITH_MSF
+  msf_init();
+  LOG_DBG("With MSF\n");
+#endif /* BUILD_WITH_MSF */
+
 #if BUILD_WITH_SHELL
   serial_shell_init();
   LOG_DBG("With Shell\n");
@@ -0,0 +1,206 @@
+/**
+ * \addtogroup fixmath
+ * @{
+ */
+
+/**
+ * \file
+ *         Fixed-point math library implementation
+ *
+ *         exp2 and log2 work internally in Q2.30. The top four bits of the
+ *         fraction of the argument index a table, and the remaining part
+ *         is below 1/16, where a short series is accurate to well below
+ *         2^-16.
+ */
+
+#include "fixmath.h"
+/*---------------------------------------------------------------------------*/
+#define Q30_ONE   ((uint32_t)1 << 30)
+#define LN2_Q30   0x2c5c85feUL /* ln(2) */
+#define LOG2E_Q30 0x5c551d95UL /* log2(e) */
+
+/* 2^(i/16) */
+static const uint32_t exp2_table[16] = {
+  0x40000000, 0x42d561b4, 0x45cae0f2, 0x48e1e9ba,
+  0x4c1bf829, 0x4f7a9930, 0x52ff6b55, 0x56ac1f75,
+  0x5a82799a, 0x5e8451d0, 0x62b39509, 0x6712460b,
+  0x6ba27e65, 0x70666f76, 0x75606374, 0x7a92be8b
+};
+
+/* log2(1 + i/16) */
+static const uint32_t log2_table[16] = {
+  0x00000000, 0x0598fdbf, 0x0ae00d1d, 0x0fde0b5d,
+  0x149a784c, 0x191bba89, 0x1d6753e0, 0x21820a02,
+  0x2570068e, 0x2934f098, 0x2cd4011d, 0x305013ab,
+  0x33abb3fb, 0x36e9291f, 0x3a0a7eda, 0x3d118d67
+};
+
+/* 1 / (1 + i/16) */
+static const uint32_t recip_table[16] = {
+  0x40000000, 0x3c3c3c3c, 0x38e38e39, 0x35e50d79,
+  0x33333333, 0x30c30c31, 0x2e8ba2e9, 0x2c8590b2,
+  0x2aaaaaab, 0x28f5c28f, 0x27627627, 0x25ed097b,
+  0x24924925, 0x234f72c2, 0x22222222, 0x21084211
+};
+/*---------------------------------------------------------------------------*/
+static uint32_t
+mul_q30(uint32_t a, uint32_t b)
+{
+  return (uint32_t)(((uint64_t)a * b) >> 30);
+}
+/*---------------------------------------------------------------------------*/
+/* Position of the most significant bit set, v > 0 */
+static int
+msb(uint32_t v)
+{
+  int p = 0;
+
+  if(v >= (uint32_t)1 << 16) {
+    v >>= 16;
+    p += 16;
+  }
+  if(v >= (uint32_t)1 << 8) {
+    v >>= 8;
+    p += 8;
+  }
+  if(v >= (uint32_t)1 << 4) {
+    v >>= 4;
+    p += 4;
+  }
+  if(v >= (uint32_t)1 << 2) {
+    v >>= 2;
+    p += 2;
+  }
+  if(v >= (uint32_t)1 << 1) {
+    p += 1;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* log2(x) in Q8.24, x > 0 */
+static int32_t
+log2_q24(fix_t x)
+{
+  int p = msb((uint32_t)x);
+  uint32_t m = (uint32_t)x << (30 - p); /* x / 2^(p - 16), in [1, 2) */
+  int i = (m >> 26) & 0xf;
+  uint32_t r = mul_q30(m, recip_table[i]);
+  /* The table is rounded, r may fall just below 1 */
+  uint32_t t = r > Q30_ONE ? r - Q30_ONE : 0; /* below 1/16 */
+  uint32_t t2 = mul_q30(t, t);
+  uint32_t t3 = mul_q30(t2, t);
+  uint32_t t4 = mul_q30(t3, t);
+  /* ln(1 + t) */
+  uint32_t ln = t - t2 / 2 + t3 / 3 - t4 / 4;
+  uint32_t frac = log2_table[i] + mul_q30(ln, LOG2E_Q30);
+
+  return ((int32_t)(p - FIX_FRAC_BITS) << 24) + (int32_t)((frac + 32) >> 6);
+}
+/*---------------------------------------------------------------------------*/
+fix_t
+fix_exp2(fix_t x)
+{
+  int32_t k;
+  uint32_t f;
+  uint32_t t;
+  uint32_t t2;
+  uint32_t m;
+  int shift;
+
+  if(x >= 15 * FIX_ONE) {
+    return FIX_MAX;
+  }
+  /* 2^x = 2^k * 2^(i/16) * 2^d, d below 1/16 */
+  k = x >> FIX_FRAC_BITS;
+  if(k < -FIX_FRAC_BITS) {
+    return 0;
+  }
+  f = (uint32_t)x & (FIX_ONE - 1);
+  t = mul_q30((f & 0xfff) << 14, LN2_Q30);
+  t2 = mul_q30(t, t);
+  /* e^t */
+  m = mul_q30(exp2_table[f >> 12],
+              Q30_ONE + t + t2 / 2 + mul_q30(t2, t) / 6);
+
+  shift = 30 - FIX_FRAC_BITS - k;
+  if(shift == 0) {
+    return (fix_t)m;
+  }
+  return (fix_t)((m + ((uint32_t)1 << (shift - 1))) >> shift);
+}
+/*---------------------------------------------------------------------------*/
+fix_t
+fix_exp(fix_t x)
+{
+  int64_t y = ((int64_t)x * (int64_t)LOG2E_Q30) >> 30;
+
+  if(y >= 15 * FIX_ONE) {
+    return FIX_MAX;
+  }
+  if(y < -17 * FIX_ONE) {
+    return 0;
+  }
+  return fix_exp2((fix_t)y);
+}
+/*---------------------------------------------------------------------------*/
+fix_t
+fix_log2(fix_t x)
+{
+  if(x <= 0) {
+    return INT32_MIN;
+  }
+  return (log2_q24(x) + 128) >> 8;
+}
+/*---------------------------------------------------------------------------*/
+fix_t
+fix_pow(fix_t x, fix_t y)
+{
+  int64_t e;
+
+  if(x <= 0) {
+    if(x < 0 || y > 0) {
+      return 0;
+    }
+    return y == 0 ? FIX_ONE : FIX_MAX;
+  }
+  if(y == FIX_ONE) {
+    return x;
+  }
+  /* 2^(y * log2(x)), with the logarithm kept at full precision */
+  e = ((int64_t)y * log2_q24(x) + ((int64_t)1 << 23)) >> 24;
+  if(e >= 15 * FIX_ONE) {
+    return FIX_MAX;
+  }
+  if(e < -17 * FIX_ONE) {
+    return 0;
+  }
+  return fix_exp2((fix_t)e);
+}
+/*---------------------------------------------------------------------------*/
+fix_t
+fix_sqrt(fix_t x)
+{
+  /* Digit by digit, on x * 2^16 so that the root is in Q16.16 */
+  uint64_t v;
+  uint64_t bit;
+  uint64_t root = 0;
+
+  if(x <= 0) {
+    return 0;
+  }
+  v = (uint64_t)x << FIX_FRAC_BITS;
+  /* Highest power of four not above v */
+  bit = (uint64_t)1 << ((msb((uint32_t)x) + FIX_FRAC_BITS) & ~1);
+  while(bit != 0) {
+    if(v >= root + bit) {
+      v -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (fix_t)root;
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
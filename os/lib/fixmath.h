@@ -0,0 +1,86 @@
+/**
+ * \addtogroup lib
+ * @{
+ *
+ * \defgroup fixmath Fixed-point math library
+ *
+ * Exponential, logarithm, power and square root in signed Q16.16 fixed
+ * point, for platforms without an FPU. No libm is needed: exp2 and log2
+ * reduce their argument to a 16-entry table and a short series, and the
+ * other functions are built on top of them.
+ *
+ * Over their domain, the results are within about one unit in the last
+ * place (2^-16) of the exact values, or one part in 2^16 for results
+ * above 1. Out-of-range results saturate.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Fixed-point math library header
+ */
+
+#ifndef FIXMATH_H_
+#define FIXMATH_H_
+
+#include "contiki.h"
+
+/** Signed Q16.16 fixed-point number */
+typedef int32_t fix_t;
+
+#define FIX_FRAC_BITS 16
+#define FIX_ONE       ((fix_t)1 << FIX_FRAC_BITS)
+#define FIX_MAX       ((fix_t)INT32_MAX)
+
+/** Converts a value scaled by \a scale (e.g. 1000 for 1.0) to Q16.16 */
+#define FIX_FROM_SCALED(v, scale) \
+  ((fix_t)(((int64_t)(v) << FIX_FRAC_BITS) / (scale)))
+
+/** Converts a Q16.16 value to an integer scaled by \a scale, rounded */
+#define FIX_TO_SCALED(x, scale) \
+  ((int32_t)(((int64_t)(x) * (scale) + (FIX_ONE / 2)) >> FIX_FRAC_BITS))
+
+/**
+ * \brief Multiplies two Q16.16 numbers
+ */
+static inline fix_t
+fix_mul(fix_t a, fix_t b)
+{
+  return (fix_t)(((int64_t)a * b) >> FIX_FRAC_BITS);
+}
+
+/**
+ * \brief Computes 2^x
+ * \return FIX_MAX for x >= 15, 0 for results below 2^-16
+ */
+fix_t fix_exp2(fix_t x);
+
+/**
+ * \brief Computes e^x
+ * \return FIX_MAX for x >= 10.39, 0 for results below 2^-16
+ */
+fix_t fix_exp(fix_t x);
+
+/**
+ * \brief Computes the base-2 logarithm of x
+ * \return INT32_MIN for x <= 0
+ */
+fix_t fix_log2(fix_t x);
+
+/**
+ * \brief Computes x^y for x >= 0 and any y, including fractional ones
+ * \return 0 for x < 0, 0^y is 0 for y > 0, 1 for y = 0 and FIX_MAX for y < 0
+ */
+fix_t fix_pow(fix_t x, fix_t y);
+
+/**
+ * \brief Computes the square root of x, exactly rounded down
+ * \return 0 for x <= 0
+ */
+fix_t fix_sqrt(fix_t x);
+
+#endif /* FIXMATH_H_ */
+
+/** @} */
+/** @} */
@@ -0,0 +1,116 @@
+/**
+ * \addtogroup hash-index
+ * @{
+ *
+ * \file
+ *         Open-addressing hash index
+ */
+
+#include "lib/hash-index.h"
+
+#include <string.h>
+
+/*---------------------------------------------------------------------------*/
+uint32_t
+hash_index_fnv1a(uint32_t h, const void *data, unsigned len)
+{
+  const uint8_t *p = data;
+
+  while(len-- > 0) {
+    h ^= *p++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+static unsigned
+home(const struct hash_index *index, uint32_t hash)
+{
+  /* Fold the upper bits in, small indexes only use the lower ones */
+  return (hash ^ (hash >> 16)) & index->mask;
+}
+/*---------------------------------------------------------------------------*/
+/* Slots hold the index of the item in the pool plus one, 0 is empty */
+static uint16_t
+slot_of(const struct hash_index *index, const void *item)
+{
+  return ((const char *)item - (const char *)index->pool->mem) /
+         index->pool->size + 1;
+}
+/*---------------------------------------------------------------------------*/
+static void *
+item_at(const struct hash_index *index, uint16_t slot)
+{
+  return (char *)index->pool->mem + (slot - 1) * index->pool->size;
+}
+/*---------------------------------------------------------------------------*/
+void
+hash_index_clear(struct hash_index *index)
+{
+  memset(index->slots, 0, (index->mask + 1) * sizeof(uint16_t));
+}
+/*---------------------------------------------------------------------------*/
+int
+hash_index_add(struct hash_index *index, void *item)
+{
+  unsigned i = home(index, index->hash(item));
+  unsigned n;
+
+  for(n = 0; n <= index->mask; n++) {
+    if(index->slots[i] == 0) {
+      index->slots[i] = slot_of(index, item);
+      return 1;
+    }
+    i = (i + 1) & index->mask;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+hash_index_remove(struct hash_index *index, void *item)
+{
+  uint16_t slot = slot_of(index, item);
+  unsigned i;
+  unsigned j;
+
+  for(i = home(index, index->hash(item)); index->slots[i] != slot;
+      i = (i + 1) & index->mask) {
+    if(index->slots[i] == 0) {
+      return 0;
+    }
+  }
+  /* Backward-shift deletion, so that no probe sequence is cut short */
+  index->slots[i] = 0;
+  for(j = (i + 1) & index->mask; index->slots[j] != 0;
+      j = (j + 1) & index->mask) {
+    unsigned h = home(index, index->hash(item_at(index, index->slots[j])));
+    /* Keep the entry where it is if its home is cyclically in (i, j] */
+    if(i <= j ? (i < h && h <= j) : (i < h || h <= j)) {
+      continue;
+    }
+    index->slots[i] = index->slots[j];
+    index->slots[j] = 0;
+    i = j;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+unsigned
+hash_index_first(const struct hash_index *index, uint32_t hash)
+{
+  return home(index, hash);
+}
+/*---------------------------------------------------------------------------*/
+void *
+hash_index_next(const struct hash_index *index, unsigned *pos)
+{
+  uint16_t slot = index->slots[*pos];
+
+  if(slot == 0) {
+    return NULL;
+  }
+  *pos = (*pos + 1) & index->mask;
+  return item_at(index, slot);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
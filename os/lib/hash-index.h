@@ -0,0 +1,104 @@
+/**
+ * \addtogroup lib
+ * @{
+ *
+ * \defgroup hash-index Open-addressing hash index
+ *
+ * An index over items allocated from a memb pool, for lookups in O(1)
+ * instead of walking them. Slots hold the 16-bit index of the item in its
+ * pool plus one, 0 for an empty slot, with linear probing on collisions
+ * and backward-shift deletion, so that there are no tombstones and probe
+ * sequences stay short. The number of slots is a power of two, larger
+ * than the number of items indexed.
+ *
+ * The hash of an item comes from a callback, typically built on
+ * hash_index_fnv1a(). Lookups walk the probe sequence of a hash and
+ * compare the items they find with the key themselves.
+ *
+ * @{
+ */
+
+/**
+ * \file
+ *         Open-addressing hash index header
+ */
+
+#ifndef HASH_INDEX_H_
+#define HASH_INDEX_H_
+
+#include "contiki.h"
+#include "lib/memb.h"
+
+/** Initial value of a FNV-1a hash */
+#define HASH_INDEX_FNV1A_INIT 2166136261UL
+
+/** Hash of an item in the index */
+typedef uint32_t (*hash_index_hash_t)(const void *item);
+
+struct hash_index {
+  uint16_t *slots;
+  uint16_t mask;
+  hash_index_hash_t hash;
+  struct memb *pool;
+};
+
+/**
+ * \brief Declare a hash index
+ * \param name The name of the index
+ * \param size The number of slots, a power of two
+ * \param hash The hash of an item, a hash_index_hash_t
+ * \param pool The memb pool of the items, declared with MEMB()
+ */
+#define HASH_INDEX(name, size, hash, pool) \
+  static uint16_t CC_CONCAT(name,_hash_index_slots)[size]; \
+  static struct hash_index name = { CC_CONCAT(name,_hash_index_slots), \
+                                    (size) - 1, hash, &(pool) }
+
+/**
+ * \brief Add bytes to a FNV-1a hash
+ * \param h The hash so far, HASH_INDEX_FNV1A_INIT to start one
+ * \param data The bytes
+ * \param len The number of bytes
+ * \return The hash
+ */
+uint32_t hash_index_fnv1a(uint32_t h, const void *data, unsigned len);
+
+/**
+ * \brief Remove all items
+ */
+void hash_index_clear(struct hash_index *index);
+
+/**
+ * \brief Add an item, allocated from the pool of the index
+ * \retval 0 Failure; the index is full
+ * \retval 1 Success
+ */
+int hash_index_add(struct hash_index *index, void *item);
+
+/**
+ * \brief Remove an item
+ * \retval 0 The item was not in the index
+ * \retval 1 Success
+ */
+int hash_index_remove(struct hash_index *index, void *item);
+
+/**
+ * \brief The first slot of the probe sequence of a hash
+ * \param index The index
+ * \param hash The hash of the key looked up
+ * \return A position, for hash_index_next()
+ */
+unsigned hash_index_first(const struct hash_index *index, uint32_t hash);
+
+/**
+ * \brief The next item of a probe sequence. All items with the hash of the
+ * key are on it, along with items with other hashes.
+ * \param index The index
+ * \param pos The position, from hash_index_first(), advanced past the item
+ * \return The item, NULL at the end of the sequence
+ */
+void *hash_index_next(const struct hash_index *index, unsigned *pos);
+
+#endif /* HASH_INDEX_H_ */
+/** @} */
+/** @} */
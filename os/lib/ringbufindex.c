@@ -123,3 +123,34 @@ ringbufindex_peek_get(const struct ringbufindex *r)
     return -1;
   }
 }
+/* Put one element before the first one, it will be the next one removed */
+int
+ringbufindex_put_front(struct ringbufindex *r)
+{
+  if(((r->put_ptr - r->get_ptr) & r->mask) == r->mask) {
+    return -1;
+  }
+  r->get_ptr = (r->get_ptr - 1) & r->mask;
+  return r->get_ptr;
+}
+/* Return the index of the last element */
+int
+ringbufindex_peek_last(const struct ringbufindex *r)
+{
+  if(((r->put_ptr - r->get_ptr) & r->mask) != 0) {
+    return (r->put_ptr - 1) & r->mask;
+  } else {
+    return -1;
+  }
+}
+/* Remove the last element and return its index */
+int
+ringbufindex_unput(struct ringbufindex *r)
+{
+  if(((r->put_ptr - r->get_ptr) & r->mask) != 0) {
+    r->put_ptr = (r->put_ptr - 1) & r->mask;
+    return r->put_ptr;
+  } else {
+    return -1;
+  }
+}
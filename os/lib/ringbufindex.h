@@ -88,6 +88,34 @@ int ringbufindex_get(struct ringbufindex *r);
  */
 int ringbufindex_peek_get(const struct ringbufindex *r);
 
+/**
+ * \brief Put one element at the head of the ring buffer, so that it is the
+ *        next one returned by ringbufindex_get. Unlike ringbufindex_put,
+ *        this is not safe against a concurrent ringbufindex_get.
+ * \param r Pointer to ringbufindex
+ * \retval >= 0 The index of the new first element
+ * \retval -1 Failure; the ring buffer is full
+ */
+int ringbufindex_put_front(struct ringbufindex *r);
+
+/**
+ * \brief Return the index of the last element, the one most recently put
+ * \param r Pinter to ringbufindex
+ * \retval >= 0 The index of the last element
+ * \retval -1 No element in the ring buffer
+ */
+int ringbufindex_peek_last(const struct ringbufindex *r);
+
+/**
+ * \brief Remove the last element and return its index. Unlike
+ *        ringbufindex_get, this is not safe against a concurrent
+ *        ringbufindex_put.
+ * \param r Pinter to ringbufindex
+ * \retval >= 0 The index of the removed element
+ * \retval -1 No element in the ring buffer
+ */
+int ringbufindex_unput(struct ringbufindex *r);
+
 /**
  * \brief Return the ring buffer size
  * \param r Pinter to ringbufindex
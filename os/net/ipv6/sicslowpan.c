@@ -68,6 +68,7 @@
 #include "net/ipv6/tcpip.h"
 #include "net/ipv6/uip.h"
 #include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
 #include "net/ipv6/uipbuf.h"
 #include "net/ipv6/sicslowpan.h"
 #include "net/mac/framer/frame802154.h"
@@ -1610,6 +1611,28 @@ fragment_copy_payload_and_send(uint16_t uip_offset)
 }
 #endif /* SICSLOWPAN_CONF_FRAG */
 /*--------------------------------------------------------------------*/
+/** \brief The MAC transmit class of the packet in uip_buf: the one set
+ *  by the upper layer if any, else the control class for ICMPv6
+ *  messages other than echo (RPL, ND, errors).
+ */
+static uint16_t
+tx_class(void)
+{
+  uint16_t attr = uipbuf_get_attr(UIPBUF_ATTR_MAC_TX_CLASS);
+  uint8_t proto;
+  struct uip_icmp_hdr *icmp;
+
+  if(attr != MAC_TX_CLASS_UNSET) {
+    return attr;
+  }
+  icmp = (struct uip_icmp_hdr *)uipbuf_get_last_header(uip_buf, uip_len, &proto);
+  if(icmp != NULL && proto == UIP_PROTO_ICMP6 &&
+     icmp->type != ICMP6_ECHO_REQUEST && icmp->type != ICMP6_ECHO_REPLY) {
+    return MAC_TX_CLASS_CONTROL;
+  }
+  return MAC_TX_CLASS_UNSET;
+}
+/*--------------------------------------------------------------------*/
 /** \brief Take an IP packet and format it to be sent on an 802.15.4
  *  network using 6lowpan.
  *  \param localdest The MAC address of the destination
@@ -1644,6 +1667,15 @@ output(const linkaddr_t *localdest)
   packetbuf_set_attr(PACKETBUF_ATTR_MAX_MAC_TRANSMISSIONS,
                      uipbuf_get_attr(UIPBUF_ATTR_MAX_MAC_TRANSMISSIONS));
 
+  /* Transmit class and queue lifetime, for MACs with per-class queues */
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TX_CLASS, tx_class());
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TX_LIFETIME,
+                     uipbuf_get_attr(UIPBUF_ATTR_MAC_TX_LIFETIME));
+
+  /* Tag of the packet, for the sent callbacks: the frame in packetbuf by
+     then may be encrypted */
+  packetbuf_set_attr(PACKETBUF_ATTR_TX_TAG, uipbuf_get_attr(UIPBUF_ATTR_TX_TAG));
+
   /* Copy destination address to packetbuf */
   packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER,
       localdest ? localdest : &linkaddr_null);
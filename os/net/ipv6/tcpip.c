@@ -510,6 +510,12 @@ get_nexthop(uip_ipaddr_t *addr)
 
   /* No route was found - we send to the default route instead. */
   if(route == NULL) {
+    if(NETSTACK_ROUTING.default_route_get_next_hop(addr)) {
+      LOG_INFO("output: no route found, using next hop from routing: ");
+      LOG_INFO_6ADDR(addr);
+      LOG_INFO_("\n");
+      return addr;
+    }
     nexthop = uip_ds6_defrt_choose();
     if(nexthop == NULL) {
       output_fallback();
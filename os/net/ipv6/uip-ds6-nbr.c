@@ -122,8 +122,14 @@ uip_ds6_neighbors_init(void)
   memb_init(&uip_ds6_nbr_memb);
   nbr_table_register(uip_ds6_nbr_entries,
                      (nbr_table_callback *)callback_nbr_entry_removal);
+#if NBR_TABLE_WITH_CHURN
+  nbr_table_churn_track(uip_ds6_nbr_entries);
+#endif /* NBR_TABLE_WITH_CHURN */
 #else
   nbr_table_register(ds6_neighbors, (nbr_table_callback *)uip_ds6_nbr_rm);
+#if NBR_TABLE_WITH_CHURN
+  nbr_table_churn_track(ds6_neighbors);
+#endif /* NBR_TABLE_WITH_CHURN */
 #endif /* UIP_DS6_NBR_MULTI_IPV6_ADDRS */
 }
 /*---------------------------------------------------------------------------*/
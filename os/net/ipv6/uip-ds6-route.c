@@ -44,6 +44,7 @@
 
 #include "lib/list.h"
 #include "lib/memb.h"
+#include "lib/hash-index.h"
 #include "net/nbr-table.h"
 
 /* Log configuration */
@@ -85,6 +86,22 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_LPM_INDEX
+#if (UIP_DS6_ROUTE_INDEX_SIZE & (UIP_DS6_ROUTE_INDEX_SIZE - 1)) != 0
+#error "UIP_DS6_ROUTE_INDEX_SIZE must be a power of two"
+#endif
+#if UIP_DS6_ROUTE_INDEX_SIZE <= UIP_DS6_ROUTE_NB
+#error "UIP_DS6_ROUTE_INDEX_SIZE must be larger than UIP_DS6_ROUTE_NB"
+#endif
+static uint32_t route_hash(const void *item);
+/* Index holding every route of routelist, keyed on the prefix length and
+   on the bytes of the prefix that uip_ipaddr_prefixcmp() compares. */
+HASH_INDEX(route_index, UIP_DS6_ROUTE_INDEX_SIZE, route_hash, routememb);
+/* Number of routes per prefix length, so that lookups only probe the
+   lengths in use */
+static uint16_t length_count[129];
+#endif /* UIP_DS6_ROUTE_LPM_INDEX */
+
 #endif /* (UIP_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -168,6 +185,10 @@ uip_ds6_route_init(void)
 #if (UIP_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_LPM_INDEX
+  hash_index_clear(&route_index);
+  memset(length_count, 0, sizeof(length_count));
+#endif /* UIP_DS6_ROUTE_LPM_INDEX */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -270,14 +291,131 @@ uip_ds6_route_num_routes(void)
   return 0;
 #endif /* (UIP_MAX_ROUTES != 0) */
 }
+#if (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_LPM_INDEX
+/*---------------------------------------------------------------------------*/
+/* list_push() and list_remove() walk the list, which would make every
+   lookup O(n) again because of the move-to-front. With the index, routes
+   also link back to their predecessor so that both are O(1). */
+static void
+routelist_push(uip_ds6_route_t *r)
+{
+  r->next = list_head(routelist);
+  r->previous = NULL;
+  if(r->next != NULL) {
+    r->next->previous = r;
+  }
+  *routelist = r;
+}
+/*---------------------------------------------------------------------------*/
+static void
+routelist_remove(uip_ds6_route_t *r)
+{
+  if(r->previous != NULL) {
+    r->previous->next = r->next;
+  } else {
+    *routelist = r->next;
+  }
+  if(r->next != NULL) {
+    r->next->previous = r->previous;
+  }
+  r->next = NULL;
+  r->previous = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+prefix_hash(const uip_ipaddr_t *addr, uint8_t length)
+{
+  /* Over the length and the compared bytes of the prefix */
+  return hash_index_fnv1a(hash_index_fnv1a(HASH_INDEX_FNV1A_INIT, &length, 1),
+                          addr, length >> 3);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+route_hash(const void *item)
+{
+  const uip_ds6_route_t *r = item;
+
+  return prefix_hash(&r->ipaddr, r->length);
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_insert(uip_ds6_route_t *r)
+{
+  if(hash_index_add(&route_index, r)) {
+    length_count[r->length]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+index_remove(uip_ds6_route_t *r)
+{
+  if(hash_index_remove(&route_index, r)) {
+    length_count[r->length]--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Several routes of the same length match: pick the one the linear scan
+   would, i.e. the first one in the list for host routes, the last one
+   otherwise */
+static uip_ds6_route_t *
+index_tie_break(const uip_ipaddr_t *addr, uint8_t length)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *found_route = NULL;
+
+  for(r = list_head(routelist); r != NULL; r = list_item_next(r)) {
+    if(r->length == length && uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+      found_route = r;
+      if(length == 128) {
+        break;
+      }
+    }
+  }
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+index_lookup(const uip_ipaddr_t *addr)
+{
+  int length;
+
+  for(length = 128; length >= 0; length--) {
+    uip_ds6_route_t *found_route = NULL;
+    uip_ds6_route_t *r;
+    unsigned pos;
+
+    if(length_count[length] == 0) {
+      continue;
+    }
+    pos = hash_index_first(&route_index, prefix_hash(addr, length));
+    while((r = hash_index_next(&route_index, &pos)) != NULL) {
+      if(r->length == length && uip_ipaddr_prefixcmp(addr, &r->ipaddr, length)) {
+        if(found_route != NULL) {
+          return index_tie_break(addr, length);
+        }
+        found_route = r;
+      }
+    }
+    if(found_route != NULL) {
+      return found_route;
+    }
+  }
+  return NULL;
+}
+#else /* (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_LPM_INDEX */
+#define routelist_push(r) list_push(routelist, r)
+#define routelist_remove(r) list_remove(routelist, r)
+#endif /* (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_LPM_INDEX */
 /*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
 uip_ds6_route_lookup(const uip_ipaddr_t *addr)
 {
 #if (UIP_MAX_ROUTES != 0)
-  uip_ds6_route_t *r;
   uip_ds6_route_t *found_route;
+#if !UIP_DS6_ROUTE_LPM_INDEX
+  uip_ds6_route_t *r;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_LPM_INDEX */
 
   LOG_INFO("Looking up route for ");
   LOG_INFO_6ADDR(addr);
@@ -287,6 +425,9 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     return NULL;
   }
 
+#if UIP_DS6_ROUTE_LPM_INDEX
+  found_route = index_lookup(addr);
+#else /* UIP_DS6_ROUTE_LPM_INDEX */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -302,6 +443,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_LPM_INDEX */
 
   if(found_route != NULL) {
     LOG_INFO("Found route: ");
@@ -319,8 +461,8 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
        the least recently used route will be at the end of the
        list - for fast lookups (assuming multiple packets to the same node). */
 
-    list_remove(routelist, found_route);
-    list_push(routelist, found_route);
+    routelist_remove(found_route);
+    routelist_push(found_route);
   }
 
   return found_route;
@@ -345,6 +487,12 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
     return NULL;
   }
 
+  if(length > 128) {
+    /* uip_ipaddr_prefixcmp() would compare past the end of the address */
+    LOG_WARN("Add: invalid prefix length %u\n", length);
+    return NULL;
+  }
+
   /* Get link-layer address of next hop, make sure it is in neighbor table */
   const uip_lladdr_t *nexthop_lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
   if(nexthop_lladdr == NULL) {
@@ -439,13 +587,14 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
     /* add new routes first - assuming that there is a reason to add this
        and that there is a packet coming soon. */
-    list_push(routelist, r);
+    routelist_push(r);
 
     nbrr = memb_alloc(&neighborroutememb);
     if(nbrr == NULL) {
       /* This should not happen, as we explicitly deallocated one
          route table entry above. */
       LOG_ERR("Add: could not allocate neighbor route list entry\n");
+      routelist_remove(r);
       memb_free(&routememb, r);
       return NULL;
     }
@@ -464,6 +613,9 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_LPM_INDEX
+  index_insert(r);
+#endif /* UIP_DS6_ROUTE_LPM_INDEX */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -508,7 +660,10 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
     LOG_INFO_("\n");
 
     /* Remove the route from the route list */
-    list_remove(routelist, route);
+    routelist_remove(route);
+#if UIP_DS6_ROUTE_LPM_INDEX
+    index_remove(route);
+#endif /* UIP_DS6_ROUTE_LPM_INDEX */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -111,6 +111,32 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_MAX_ROUTES */
 
+/* Look routes up through a longest-prefix-match index kept next to the
+ * route list: a hash table keyed on (prefix length, prefix), probed once
+ * per prefix length in use, longest first. Host routes are found with a
+ * single probe. Costs UIP_DS6_ROUTE_INDEX_SIZE 16-bit words plus a
+ * count per prefix length. */
+#ifdef UIP_DS6_ROUTE_CONF_LPM_INDEX
+#define UIP_DS6_ROUTE_LPM_INDEX UIP_DS6_ROUTE_CONF_LPM_INDEX
+#else /* UIP_DS6_ROUTE_CONF_LPM_INDEX */
+#define UIP_DS6_ROUTE_LPM_INDEX 0
+#endif /* UIP_DS6_ROUTE_CONF_LPM_INDEX */
+
+/* Number of index slots, a power of two larger than UIP_DS6_ROUTE_NB */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX_SIZE
+#define UIP_DS6_ROUTE_INDEX_SIZE UIP_DS6_ROUTE_CONF_INDEX_SIZE
+#else /* UIP_DS6_ROUTE_CONF_INDEX_SIZE */
+#define UIP_DS6_ROUTE_INDEX_SIZE \
+  (UIP_DS6_ROUTE_NB <= 8 ? 16 : \
+   UIP_DS6_ROUTE_NB <= 16 ? 32 : \
+   UIP_DS6_ROUTE_NB <= 32 ? 64 : \
+   UIP_DS6_ROUTE_NB <= 64 ? 128 : \
+   UIP_DS6_ROUTE_NB <= 128 ? 256 : \
+   UIP_DS6_ROUTE_NB <= 256 ? 512 : \
+   UIP_DS6_ROUTE_NB <= 512 ? 1024 : \
+   UIP_DS6_ROUTE_NB <= 1024 ? 2048 : 4096)
+#endif /* UIP_DS6_ROUTE_CONF_INDEX_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -170,6 +196,10 @@ struct uip_ds6_route_neighbor_routes {
 /** \brief An entry in the routing table */
 typedef struct uip_ds6_route {
   struct uip_ds6_route *next;
+#if UIP_DS6_ROUTE_LPM_INDEX
+  /* Back link on the route list, for O(1) removal */
+  struct uip_ds6_route *previous;
+#endif /* UIP_DS6_ROUTE_LPM_INDEX */
   /* Each route entry belongs to a specific neighbor. That neighbor
      holds a list of all routing entries that go through it. The
      routes field point to the uip_ds6_route_neighbor_routes that
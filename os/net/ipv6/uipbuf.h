@@ -210,6 +210,9 @@ enum {
   UIPBUF_ATTR_FLAGS,   /**< Flags that can control lower layers.  see above. */
   UIPBUF_ATTR_RSSI, /**< Last packet's RSSI */
   UIPBUF_ATTR_LINK_QUALITY, /**< Last packet's LQI */
+  UIPBUF_ATTR_MAC_TX_CLASS, /**< MAC transmit class, see MAC_TX_CLASS_* */
+  UIPBUF_ATTR_MAC_TX_LIFETIME, /**< Max time in the MAC queue (ms), 0 for the MAC default */
+  UIPBUF_ATTR_TX_TAG, /**< Tag handed back with the packet to the MAC sent callback, 0 for none */
   UIPBUF_ATTR_MAX
 };
 
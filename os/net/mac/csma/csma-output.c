@@ -43,6 +43,7 @@
 #include "net/mac/csma/csma-security.h"
 #include "net/mac/framer/frame802154.h"
 #include "net/mac/mac-sequence.h"
+#include "net/mac/mac-backlog.h"
 #include "net/packetbuf.h"
 #include "net/queuebuf.h"
 #include "dev/watchdog.h"
@@ -52,8 +53,11 @@
 #include "net/netstack.h"
 #include "lib/list.h"
 #include "lib/memb.h"
+#include "lib/hash-index.h"
 #include "lib/assert.h"
 
+#include <string.h>
+
 /* Log configuration */
 #include "sys/log.h"
 #define LOG_MODULE "CSMA"
@@ -89,11 +93,62 @@
 #define CSMA_MAX_FRAME_RETRIES 7
 #endif
 
+/* Each neighbor queue holds packets of several transmit classes
+ * (PACKETBUF_ATTR_MAC_TX_CLASS). Control packets are served first. The
+ * data classes share the link by deficit round robin with these weights. */
+#ifdef CSMA_CONF_EXPEDITED_WEIGHT
+#define CSMA_EXPEDITED_WEIGHT CSMA_CONF_EXPEDITED_WEIGHT
+#else
+#define CSMA_EXPEDITED_WEIGHT 3
+#endif
+
+#ifdef CSMA_CONF_BEST_EFFORT_WEIGHT
+#define CSMA_BEST_EFFORT_WEIGHT CSMA_CONF_BEST_EFFORT_WEIGHT
+#else
+#define CSMA_BEST_EFFORT_WEIGHT 1
+#endif
+
+#if CSMA_EXPEDITED_WEIGHT <= 0 || CSMA_BEST_EFFORT_WEIGHT <= 0
+#error "CSMA_EXPEDITED_WEIGHT and CSMA_BEST_EFFORT_WEIGHT must be positive"
+#endif
+
+/* Bytes credited to a data class per unit of weight and round. Larger
+ * than a frame, so that a class sends at least one frame per round. */
+#define CSMA_DRR_QUANTUM 128
+
+#define NUM_DATA_CLASSES 2
+#define DATA_CLASS_INDEX(c) ((c) - MAC_TX_CLASS_EXPEDITED)
+
+/* Default time (ms) a packet of each class may wait in its neighbor
+ * queue before it is dropped rather than sent, 0 for no limit. The
+ * PACKETBUF_ATTR_MAC_TX_LIFETIME of a packet overrides it. */
+#ifdef CSMA_CONF_CONTROL_LIFETIME
+#define CSMA_CONTROL_LIFETIME CSMA_CONF_CONTROL_LIFETIME
+#else
+#define CSMA_CONTROL_LIFETIME 0
+#endif
+
+#ifdef CSMA_CONF_EXPEDITED_LIFETIME
+#define CSMA_EXPEDITED_LIFETIME CSMA_CONF_EXPEDITED_LIFETIME
+#else
+#define CSMA_EXPEDITED_LIFETIME 0
+#endif
+
+#ifdef CSMA_CONF_BEST_EFFORT_LIFETIME
+#define CSMA_BEST_EFFORT_LIFETIME CSMA_CONF_BEST_EFFORT_LIFETIME
+#else
+#define CSMA_BEST_EFFORT_LIFETIME 0
+#endif
+
 /* Packet metadata */
 struct qbuf_metadata {
   mac_callback_t sent;
   void *cptr;
+  clock_time_t enqueued_at;
+  clock_time_t lifetime; /* 0 for no limit */
+  uint16_t len;
   uint8_t max_transmissions;
+  uint8_t tx_class;
 };
 
 /* Every neighbor has its own packet queue */
@@ -101,6 +156,10 @@ struct neighbor_queue {
   struct neighbor_queue *next;
   linkaddr_t addr;
   struct ctimer transmit_timer;
+  /* The packet being transmitted, NULL until the next one is picked */
+  struct packet_queue *current;
+  int16_t deficit[NUM_DATA_CLASSES];
+  uint8_t drr_class;
   uint8_t transmissions;
   uint8_t collisions;
   LIST_STRUCT(packet_queue);
@@ -113,6 +172,23 @@ struct neighbor_queue {
 #define CSMA_MAX_NEIGHBOR_QUEUES 2
 #endif /* CSMA_CONF_MAX_NEIGHBOR_QUEUES */
 
+/* Look neighbor queues up through a hash index on the receiver address
+ * instead of walking neighbor_list. Worth it for larger neighbor pools. */
+#ifdef CSMA_CONF_WITH_NEIGHBOR_HASH
+#define CSMA_WITH_NEIGHBOR_HASH CSMA_CONF_WITH_NEIGHBOR_HASH
+#else /* CSMA_CONF_WITH_NEIGHBOR_HASH */
+#define CSMA_WITH_NEIGHBOR_HASH (CSMA_MAX_NEIGHBOR_QUEUES > 4)
+#endif /* CSMA_CONF_WITH_NEIGHBOR_HASH */
+
+/* Number of hash index slots: a power of two, at least twice the number
+ * of neighbor queues to keep open-addressing probes short */
+#define NEIGHBOR_HASH_SIZE \
+  (CSMA_MAX_NEIGHBOR_QUEUES <= 4 ? 8 : \
+   CSMA_MAX_NEIGHBOR_QUEUES <= 8 ? 16 : \
+   CSMA_MAX_NEIGHBOR_QUEUES <= 16 ? 32 : \
+   CSMA_MAX_NEIGHBOR_QUEUES <= 32 ? 64 : \
+   CSMA_MAX_NEIGHBOR_QUEUES <= 64 ? 128 : 256)
+
 /* The maximum number of pending packet per neighbor */
 #ifdef CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
 #define CSMA_MAX_PACKET_PER_NEIGHBOR CSMA_CONF_MAX_PACKET_PER_NEIGHBOR
@@ -133,16 +209,54 @@ MEMB(neighbor_memb, struct neighbor_queue, CSMA_MAX_NEIGHBOR_QUEUES);
 MEMB(packet_memb, struct packet_queue, MAX_QUEUED_PACKETS);
 MEMB(metadata_memb, struct qbuf_metadata, MAX_QUEUED_PACKETS);
 LIST(neighbor_list);
+#if CSMA_WITH_NEIGHBOR_HASH
+#if CSMA_MAX_NEIGHBOR_QUEUES > 128
+#error "CSMA_WITH_NEIGHBOR_HASH supports up to 128 neighbor queues"
+#endif
+static uint32_t neighbor_queue_hash(const void *item);
+/* Index over the queues of neighbor_list, by receiver address */
+HASH_INDEX(neighbor_hash, NEIGHBOR_HASH_SIZE, neighbor_queue_hash, neighbor_memb);
+#endif /* CSMA_WITH_NEIGHBOR_HASH */
 
 static void packet_sent(struct neighbor_queue *n,
     struct packet_queue *q,
     int status,
     int num_transmissions);
 static void transmit_from_queue(void *ptr);
+
+static const int16_t drr_quantum[NUM_DATA_CLASSES] = {
+  CSMA_EXPEDITED_WEIGHT * CSMA_DRR_QUANTUM,
+  CSMA_BEST_EFFORT_WEIGHT * CSMA_DRR_QUANTUM,
+};
+#if CSMA_WITH_NEIGHBOR_HASH
+/*---------------------------------------------------------------------------*/
+static uint32_t
+addr_hash(const linkaddr_t *addr)
+{
+  return hash_index_fnv1a(HASH_INDEX_FNV1A_INIT, addr, LINKADDR_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+neighbor_queue_hash(const void *item)
+{
+  return addr_hash(&((const struct neighbor_queue *)item)->addr);
+}
+#endif /* CSMA_WITH_NEIGHBOR_HASH */
 /*---------------------------------------------------------------------------*/
 static struct neighbor_queue *
 neighbor_queue_from_addr(const linkaddr_t *addr)
 {
+#if CSMA_WITH_NEIGHBOR_HASH
+  unsigned pos = hash_index_first(&neighbor_hash, addr_hash(addr));
+  struct neighbor_queue *n;
+
+  while((n = hash_index_next(&neighbor_hash, &pos)) != NULL) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+  }
+  return NULL;
+#else /* CSMA_WITH_NEIGHBOR_HASH */
   struct neighbor_queue *n = list_head(neighbor_list);
   while(n != NULL) {
     if(linkaddr_cmp(&n->addr, addr)) {
@@ -151,6 +265,42 @@ neighbor_queue_from_addr(const linkaddr_t *addr)
     n = list_item_next(n);
   }
   return NULL;
+#endif /* CSMA_WITH_NEIGHBOR_HASH */
+}
+/*---------------------------------------------------------------------------*/
+static struct neighbor_queue *
+neighbor_queue_alloc(const linkaddr_t *addr)
+{
+  struct neighbor_queue *n = memb_alloc(&neighbor_memb);
+  if(n != NULL) {
+    /* Init neighbor entry */
+    linkaddr_copy(&n->addr, addr);
+    n->transmissions = 0;
+    n->collisions = 0;
+    n->current = NULL;
+    n->drr_class = 0;
+    n->deficit[0] = drr_quantum[0];
+    n->deficit[1] = 0;
+    /* Init packet queue for this neighbor */
+    LIST_STRUCT_INIT(n, packet_queue);
+    /* Add neighbor to the neighbor list */
+    list_add(neighbor_list, n);
+#if CSMA_WITH_NEIGHBOR_HASH
+    hash_index_add(&neighbor_hash, n);
+#endif /* CSMA_WITH_NEIGHBOR_HASH */
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+neighbor_queue_free(struct neighbor_queue *n)
+{
+  ctimer_stop(&n->transmit_timer);
+  list_remove(neighbor_list, n);
+#if CSMA_WITH_NEIGHBOR_HASH
+  hash_index_remove(&neighbor_hash, n);
+#endif /* CSMA_WITH_NEIGHBOR_HASH */
+  memb_free(&neighbor_memb, n);
 }
 /*---------------------------------------------------------------------------*/
 static clock_time_t
@@ -255,19 +405,250 @@ send_one_packet(struct neighbor_queue *n, struct packet_queue *q)
   return last_sent_ok;
 }
 /*---------------------------------------------------------------------------*/
+static uint8_t
+packet_class(const struct packet_queue *q)
+{
+  return ((const struct qbuf_metadata *)q->ptr)->tx_class;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_lifo(const struct neighbor_queue *n)
+{
+  return mac_backlog_lifo() && !linkaddr_cmp(&n->addr, &linkaddr_null);
+}
+/*---------------------------------------------------------------------------*/
+/* The packet of a class to serve next: the oldest one, or the newest one
+ * under LIFO service */
+static struct packet_queue *
+first_of_class(struct neighbor_queue *n, uint8_t tx_class)
+{
+  struct packet_queue *q;
+  struct packet_queue *found = NULL;
+  int lifo = is_lifo(n);
+
+  for(q = list_head(n->packet_queue); q != NULL; q = list_item_next(q)) {
+    if(packet_class(q) == tx_class) {
+      found = q;
+      if(!lifo) {
+        break;
+      }
+    }
+  }
+  return found;
+}
+/*---------------------------------------------------------------------------*/
+/* Pick the next packet to transmit: control packets first, then the data
+ * classes in deficit round robin, FIFO (or LIFO) within a class */
+static struct packet_queue *
+select_packet(struct neighbor_queue *n)
+{
+  struct packet_queue *q;
+
+  q = first_of_class(n, MAC_TX_CLASS_CONTROL);
+  if(q != NULL || list_head(n->packet_queue) == NULL) {
+    return q;
+  }
+  /* Some data class has a packet, and every round credits each class
+   * with more than a frame, so this terminates */
+  for(;;) {
+    uint8_t c = n->drr_class;
+    q = first_of_class(n, MAC_TX_CLASS_EXPEDITED + c);
+    if(q == NULL) {
+      /* An idle class does not save up credit */
+      n->deficit[c] = 0;
+    } else if(n->deficit[c] >= ((struct qbuf_metadata *)q->ptr)->len) {
+      n->deficit[c] -= ((struct qbuf_metadata *)q->ptr)->len;
+      return q;
+    }
+    n->drr_class = (c + 1) % NUM_DATA_CLASSES;
+    n->deficit[n->drr_class] += drr_quantum[n->drr_class];
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
+{
+  struct qbuf_metadata *metadata = (struct qbuf_metadata *)p->ptr;
+
+  list_remove(n->packet_queue, p);
+  if(metadata != NULL) {
+    mac_backlog_dequeued(&n->addr, metadata->len, metadata->enqueued_at,
+                         status);
+  }
+  queuebuf_free(p->buf);
+  memb_free(&metadata_memb, p->ptr);
+  memb_free(&packet_memb, p);
+}
+/*---------------------------------------------------------------------------*/
+/* Drop a queued packet that is not being transmitted. Leaves the
+ * neighbor queue in place even if it becomes empty. */
+static void
+discard_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
+{
+  struct qbuf_metadata *metadata = (struct qbuf_metadata *)p->ptr;
+  mac_callback_t sent = metadata->sent;
+  void *cptr = metadata->cptr;
+
+  remove_packet(n, p, status);
+  mac_call_sent_callback(sent, cptr, status, 0);
+}
+/*---------------------------------------------------------------------------*/
+/* Packets outlive their lifetime, or under LIFO service the maximum
+ * age that keeps old packets from starving behind new ones */
+static struct packet_queue *
+first_expired(struct neighbor_queue *n)
+{
+  struct packet_queue *q;
+  clock_time_t now = clock_time();
+  clock_time_t max_age = is_lifo(n) ? mac_backlog_lifo_max_age() : 0;
+
+  for(q = list_head(n->packet_queue); q != NULL; q = list_item_next(q)) {
+    struct qbuf_metadata *metadata = (struct qbuf_metadata *)q->ptr;
+    clock_time_t lifetime = metadata->lifetime;
+    if(max_age != 0 && (lifetime == 0 || max_age < lifetime)) {
+      lifetime = max_age;
+    }
+    if(q != n->current && lifetime != 0 &&
+       now - metadata->enqueued_at > lifetime) {
+      return q;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop the packets that outlived their lifetime before they reach the
+ * radio. The scan restarts after each drop, as the sent callback may
+ * queue new packets. */
+static void
+expire_packets(struct neighbor_queue *n)
+{
+  struct packet_queue *q;
+
+  while((q = first_expired(n)) != NULL) {
+    LOG_WARN("dropping packet to ");
+    LOG_WARN_LLADDR(&n->addr);
+    LOG_WARN_(", class %u, lifetime expired\n", packet_class(q));
+    mac_backlog_expired(&n->addr);
+    /* The sent callback reads the packet attributes from packetbuf */
+    queuebuf_to_packetbuf(q->buf);
+    discard_packet(n, q, MAC_TX_ERR);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The data packet of a class that a queue would serve last: the youngest
+ * one, or the oldest one under LIFO service */
+static struct packet_queue *
+last_served(struct neighbor_queue *n, uint8_t tx_class)
+{
+  struct packet_queue *q;
+  struct packet_queue *victim = NULL;
+
+  for(q = list_head(n->packet_queue); q != NULL; q = list_item_next(q)) {
+    if(q != n->current && packet_class(q) == tx_class) {
+      victim = q;
+      if(is_lifo(n)) {
+        break;
+      }
+    }
+  }
+  return victim;
+}
+/*---------------------------------------------------------------------------*/
+/* Drop a packet to make room for the control packet in packetbuf. The
+ * sent callback of the dropped packet reads its attributes from
+ * packetbuf, so the control packet is set aside in a queuebuf meanwhile.
+ * With none left, the callback gets the control packet, addressed to the
+ * receiver of the dropped one and with its tag. */
+static void
+drop_for_control(struct neighbor_queue *n, struct packet_queue *victim)
+{
+  struct queuebuf *control;
+  linkaddr_t receiver;
+  packetbuf_attr_t tag;
+
+  LOG_WARN("dropping packet to ");
+  LOG_WARN_LLADDR(&n->addr);
+  LOG_WARN_(", class %u, to queue a control packet\n", packet_class(victim));
+  mac_backlog_dropped(&n->addr);
+
+  control = queuebuf_new_from_packetbuf();
+  if(control != NULL) {
+    queuebuf_to_packetbuf(victim->buf);
+    discard_packet(n, victim, MAC_TX_QUEUE_FULL);
+    queuebuf_to_packetbuf(control);
+    queuebuf_free(control);
+    return;
+  }
+
+  linkaddr_copy(&receiver, packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+  tag = packetbuf_attr(PACKETBUF_ATTR_TX_TAG);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &n->addr);
+  packetbuf_set_attr(PACKETBUF_ATTR_TX_TAG,
+                     queuebuf_attr(victim->buf, PACKETBUF_ATTR_TX_TAG));
+  discard_packet(n, victim, MAC_TX_QUEUE_FULL);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &receiver);
+  packetbuf_set_attr(PACKETBUF_ATTR_TX_TAG, tag);
+}
+/*---------------------------------------------------------------------------*/
+/* Make room for a control packet by dropping a queued packet of the
+ * lowest-priority data class, the one that would be served last. With
+ * a neighbor queue, it comes from that queue. Without, the shared
+ * packet pool is exhausted and it comes from the longest queue. */
+static int
+make_room(struct neighbor_queue *n)
+{
+  static const uint8_t victim_classes[] = {
+    MAC_TX_CLASS_BEST_EFFORT, MAC_TX_CLASS_EXPEDITED
+  };
+  struct neighbor_queue *m;
+  struct neighbor_queue *victim_nbr;
+  struct packet_queue *victim;
+  int i;
+
+  for(i = 0; i < sizeof(victim_classes); i++) {
+    victim = NULL;
+    victim_nbr = NULL;
+    for(m = n != NULL ? n : list_head(neighbor_list); m != NULL;
+        m = n != NULL ? NULL : list_item_next(m)) {
+      struct packet_queue *q = last_served(m, victim_classes[i]);
+      if(q != NULL && (victim_nbr == NULL ||
+                       list_length(m->packet_queue) >
+                       list_length(victim_nbr->packet_queue))) {
+        victim = q;
+        victim_nbr = m;
+      }
+    }
+    if(victim != NULL) {
+      drop_for_control(victim_nbr, victim);
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 transmit_from_queue(void *ptr)
 {
   struct neighbor_queue *n = ptr;
   if(n) {
-    struct packet_queue *q = list_head(n->packet_queue);
+    struct packet_queue *q;
+    if(n->current == NULL) {
+      /* Starting a new packet (not a retransmission) */
+      expire_packets(n);
+      if(list_head(n->packet_queue) == NULL) {
+        neighbor_queue_free(n);
+        return;
+      }
+      n->current = select_packet(n);
+    }
+    q = n->current;
     if(q != NULL) {
       LOG_INFO("preparing packet for ");
       LOG_INFO_LLADDR(&n->addr);
       LOG_INFO_(", seqno %u, tx %u, queue %d\n",
         queuebuf_attr(q->buf, PACKETBUF_ATTR_MAC_SEQNO),
         n->transmissions, list_length(n->packet_queue));
-      /* Send first packet in the neighbor queue */
+      /* Send the selected packet */
       queuebuf_to_packetbuf(q->buf);
       send_one_packet(n, q);
     }
@@ -299,11 +680,10 @@ free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
 {
   if(p != NULL) {
     /* Remove packet from queue and deallocate */
-    list_remove(n->packet_queue, p);
-
-    queuebuf_free(p->buf);
-    memb_free(&metadata_memb, p->ptr);
-    memb_free(&packet_memb, p);
+    remove_packet(n, p, status);
+    if(n->current == p) {
+      n->current = NULL;
+    }
     LOG_DBG("free_queued_packet, queue length %d, free packets %zu\n",
            list_length(n->packet_queue), memb_numfree(&packet_memb));
     if(list_head(n->packet_queue) != NULL) {
@@ -314,9 +694,7 @@ free_packet(struct neighbor_queue *n, struct packet_queue *p, int status)
       schedule_transmission(n);
     } else {
       /* This was the last packet in the queue, we free the neighbor */
-      ctimer_stop(&n->transmit_timer);
-      list_remove(neighbor_list, n);
-      memb_free(&neighbor_memb, n);
+      neighbor_queue_free(n);
     }
   }
 }
@@ -439,31 +817,61 @@ packet_sent(struct neighbor_queue *n,
   }
 }
 /*---------------------------------------------------------------------------*/
+static uint8_t
+tx_class_from_packetbuf(void)
+{
+  uint8_t tx_class = packetbuf_attr(PACKETBUF_ATTR_MAC_TX_CLASS);
+  if(tx_class == MAC_TX_CLASS_CONTROL || tx_class == MAC_TX_CLASS_EXPEDITED) {
+    return tx_class;
+  }
+  return MAC_TX_CLASS_BEST_EFFORT;
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+lifetime_from_packetbuf(uint8_t tx_class)
+{
+  uint32_t lifetime_ms = packetbuf_attr(PACKETBUF_ATTR_MAC_TX_LIFETIME);
+
+  if(lifetime_ms == 0) {
+    lifetime_ms = tx_class == MAC_TX_CLASS_CONTROL ? CSMA_CONTROL_LIFETIME :
+      tx_class == MAC_TX_CLASS_EXPEDITED ? CSMA_EXPEDITED_LIFETIME :
+      CSMA_BEST_EFFORT_LIFETIME;
+    if(lifetime_ms == 0) {
+      return 0;
+    }
+  }
+  return MAX(lifetime_ms * CLOCK_SECOND / 1000, 1);
+}
+/*---------------------------------------------------------------------------*/
 void
 csma_output_packet(mac_callback_t sent, void *ptr)
 {
   struct packet_queue *q;
   struct neighbor_queue *n;
   const linkaddr_t *addr = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+  uint8_t tx_class = tx_class_from_packetbuf();
 
   mac_sequence_set_dsn();
   packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
 
   /* Look for the neighbor entry */
   n = neighbor_queue_from_addr(addr);
+  if(tx_class == MAC_TX_CLASS_CONTROL) {
+    /* Control packets push data packets out of a full neighbor queue,
+     * or out of any queue if the shared pools are exhausted */
+    if(n != NULL && list_length(n->packet_queue) >= CSMA_MAX_PACKET_PER_NEIGHBOR) {
+      make_room(n);
+    }
+    if(memb_numfree(&packet_memb) == 0 || queuebuf_numfree() == 0) {
+      make_room(NULL);
+    }
+    /* The sent callbacks of the dropped packets may have queued or freed
+     * packets of this neighbor */
+    n = neighbor_queue_from_addr(addr);
+  }
   if(n == NULL) {
     /* Allocate a new neighbor entry */
-    n = memb_alloc(&neighbor_memb);
-    if(n != NULL) {
-      /* Init neighbor entry */
-      linkaddr_copy(&n->addr, addr);
-      n->transmissions = 0;
-      n->collisions = 0;
-      /* Init packet queue for this neighbor */
-      LIST_STRUCT_INIT(n, packet_queue);
-      /* Add neighbor to the neighbor list */
-      list_add(neighbor_list, n);
-    }
+    n = neighbor_queue_alloc(addr);
   }
 
   if(n != NULL) {
@@ -484,7 +892,12 @@ csma_output_packet(mac_callback_t sent, void *ptr)
             }
             metadata->sent = sent;
             metadata->cptr = ptr;
+            metadata->enqueued_at = clock_time();
+            metadata->lifetime = lifetime_from_packetbuf(tx_class);
+            metadata->len = packetbuf_totlen();
+            metadata->tx_class = tx_class;
             list_add(n->packet_queue, q);
+            mac_backlog_enqueued(addr, metadata->len);
 
             LOG_INFO("sending to ");
             LOG_INFO_LLADDR(addr);
@@ -492,8 +905,8 @@ csma_output_packet(mac_callback_t sent, void *ptr)
                     packetbuf_datalen(),
                     packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO),
                     list_length(n->packet_queue), memb_numfree(&packet_memb));
-            /* If q is the first packet in the neighbor's queue, send asap */
-            if(list_head(n->packet_queue) == q) {
+            /* If q is the only packet in the neighbor's queue, send asap */
+            if(list_length(n->packet_queue) == 1) {
               schedule_transmission(n);
             }
             return;
@@ -506,8 +919,7 @@ csma_output_packet(mac_callback_t sent, void *ptr)
       }
       /* The packet allocation failed. Remove and free neighbor entry if empty. */
       if(list_length(n->packet_queue) == 0) {
-        list_remove(neighbor_list, n);
-        memb_free(&neighbor_memb, n);
+        neighbor_queue_free(n);
       }
     } else {
       LOG_WARN("Neighbor queue full\n");
@@ -516,6 +928,7 @@ csma_output_packet(mac_callback_t sent, void *ptr)
   } else {
     LOG_WARN("could not allocate neighbor, dropping packet\n");
   }
+  mac_backlog_dropped(addr);
   mac_call_sent_callback(sent, ptr, MAC_TX_QUEUE_FULL, 1);
 }
 /*---------------------------------------------------------------------------*/
@@ -525,4 +938,8 @@ csma_output_init(void)
   memb_init(&packet_memb);
   memb_init(&metadata_memb);
   memb_init(&neighbor_memb);
+#if CSMA_WITH_NEIGHBOR_HASH
+  hash_index_clear(&neighbor_hash);
+#endif /* CSMA_WITH_NEIGHBOR_HASH */
+  mac_backlog_init(MAX_QUEUED_PACKETS);
 }
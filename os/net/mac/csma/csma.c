@@ -41,6 +41,7 @@
 #include "net/mac/csma/csma.h"
 #include "net/mac/csma/csma-output.h"
 #include "net/mac/framer/frame802154.h"
+#include "net/mac/mac-overhear.h"
 #include "net/mac/mac-sequence.h"
 #include "net/packetbuf.h"
 #include "net/netstack.h"
@@ -88,6 +89,7 @@ input_packet(void)
                                          &linkaddr_node_addr) &&
             !packetbuf_holds_broadcast()) {
     LOG_WARN("not for us\n");
+    mac_overhear_input();
   } else if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER), &linkaddr_node_addr)) {
     LOG_WARN("frame from ourselves\n");
   } else {
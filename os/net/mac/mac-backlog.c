@@ -0,0 +1,240 @@
+/**
+ * \addtogroup link-layer
+ * @{
+ *
+ * \file
+ *         MAC-agnostic transmit backlog accounting.
+ */
+
+#include "contiki.h"
+#include "net/mac/mac-backlog.h"
+#include "net/mac/mac.h"
+#include "lib/list.h"
+#include "lib/memb.h"
+
+#include <string.h>
+
+/* Per-neighbor backlog, only allocated while packets are queued */
+struct backlog_nbr {
+  struct backlog_nbr *next;
+  linkaddr_t addr;
+  struct mac_backlog backlog;
+};
+
+MEMB(backlog_nbr_memb, struct backlog_nbr, MAC_BACKLOG_MAX_NEIGHBORS);
+LIST(backlog_nbr_list);
+
+static struct mac_backlog total;
+static uint16_t capacity;
+static uint32_t enqueued_count;
+static uint32_t dropped_count;
+static uint32_t expired_count;
+static uint32_t delay_histogram[MAC_BACKLOG_DELAY_BUCKETS];
+/* Not reset by mac_backlog_init(): the routing layer may select the
+ * service order before the MAC initializes */
+static uint8_t lifo;
+/*---------------------------------------------------------------------------*/
+static int
+is_broadcast(const linkaddr_t *addr)
+{
+  return addr == NULL || linkaddr_cmp(addr, &linkaddr_null);
+}
+/*---------------------------------------------------------------------------*/
+static struct backlog_nbr *
+nbr_lookup(const linkaddr_t *addr)
+{
+  struct backlog_nbr *n;
+  for(n = list_head(backlog_nbr_list); n != NULL; n = list_item_next(n)) {
+    if(linkaddr_cmp(&n->addr, addr)) {
+      return n;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_sojourn(struct mac_backlog *b, clock_time_t sojourn)
+{
+  if(b->sojourn_avg == 0) {
+    b->sojourn_avg = sojourn;
+  } else {
+    b->sojourn_avg = ((uint32_t)b->sojourn_avg *
+                      (MAC_BACKLOG_EWMA_SCALE - MAC_BACKLOG_EWMA_ALPHA) +
+                      (uint32_t)sojourn * MAC_BACKLOG_EWMA_ALPHA) /
+      MAC_BACKLOG_EWMA_SCALE;
+  }
+  if(sojourn > b->sojourn_max) {
+    b->sojourn_max = sojourn;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+record_delay(clock_time_t sojourn)
+{
+  uint32_t delay_ms = (uint32_t)sojourn * 1000 / CLOCK_SECOND;
+  uint32_t limit = MAC_BACKLOG_DELAY_BUCKET_MS;
+  uint8_t i;
+
+  for(i = 0; i < MAC_BACKLOG_DELAY_BUCKETS - 1 && delay_ms >= limit; i++) {
+    limit <<= 1;
+  }
+  delay_histogram[i]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_packet(struct mac_backlog *b, uint16_t len, clock_time_t sojourn)
+{
+  if(b->packets > 0) {
+    b->packets--;
+  }
+  b->bytes = b->bytes > len ? b->bytes - len : 0;
+  update_sojourn(b, sojourn);
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_init(uint16_t cap)
+{
+  memb_init(&backlog_nbr_memb);
+  list_init(backlog_nbr_list);
+  memset(&total, 0, sizeof(total));
+  capacity = cap;
+  enqueued_count = 0;
+  dropped_count = 0;
+  expired_count = 0;
+  memset(delay_histogram, 0, sizeof(delay_histogram));
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_enqueued(const linkaddr_t *addr, uint16_t len)
+{
+  total.packets++;
+  total.bytes += len;
+  enqueued_count++;
+
+  if(!is_broadcast(addr)) {
+    struct backlog_nbr *n = nbr_lookup(addr);
+    if(n == NULL) {
+      n = memb_alloc(&backlog_nbr_memb);
+      if(n == NULL) {
+        /* Aggregate accounting is still correct, only the
+         * per-neighbor view of this neighbor is lost */
+        return;
+      }
+      memset(&n->backlog, 0, sizeof(n->backlog));
+      linkaddr_copy(&n->addr, addr);
+      list_add(backlog_nbr_list, n);
+    }
+    n->backlog.packets++;
+    n->backlog.bytes += len;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_dequeued(const linkaddr_t *addr, uint16_t len,
+                     clock_time_t enqueued_at, int status)
+{
+  clock_time_t sojourn = clock_time() - enqueued_at;
+
+  remove_packet(&total, len, sojourn);
+  if(status == MAC_TX_OK) {
+    record_delay(sojourn);
+  }
+
+  if(!is_broadcast(addr)) {
+    struct backlog_nbr *n = nbr_lookup(addr);
+    if(n != NULL) {
+      remove_packet(&n->backlog, len, sojourn);
+      if(n->backlog.packets == 0) {
+        list_remove(backlog_nbr_list, n);
+        memb_free(&backlog_nbr_memb, n);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_dropped(const linkaddr_t *addr)
+{
+  (void)addr;
+  dropped_count++;
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_expired(const linkaddr_t *addr)
+{
+  (void)addr;
+  expired_count++;
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_set_lifo(uint8_t enable)
+{
+  lifo = enable ? 1 : 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+mac_backlog_lifo(void)
+{
+  return lifo;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+mac_backlog_lifo_max_age(void)
+{
+  return (clock_time_t)((uint32_t)MAC_BACKLOG_LIFO_MAX_AGE * CLOCK_SECOND / 1000);
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_backlog *
+mac_backlog_total(void)
+{
+  return &total;
+}
+/*---------------------------------------------------------------------------*/
+const struct mac_backlog *
+mac_backlog_nbr(const linkaddr_t *addr)
+{
+  struct backlog_nbr *n;
+  if(is_broadcast(addr)) {
+    return NULL;
+  }
+  n = nbr_lookup(addr);
+  return n != NULL ? &n->backlog : NULL;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+mac_backlog_capacity(void)
+{
+  return capacity;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+mac_backlog_enqueued_count(void)
+{
+  return enqueued_count;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+mac_backlog_dropped_count(void)
+{
+  return dropped_count;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+mac_backlog_expired_count(void)
+{
+  return expired_count;
+}
+/*---------------------------------------------------------------------------*/
+const uint32_t *
+mac_backlog_delay_histogram(void)
+{
+  return delay_histogram;
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_backlog_delay_reset(void)
+{
+  memset(delay_histogram, 0, sizeof(delay_histogram));
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
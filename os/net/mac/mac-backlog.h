@@ -0,0 +1,163 @@
+/**
+ * \addtogroup link-layer
+ * @{
+ *
+ * \file
+ *         MAC-agnostic transmit backlog accounting.
+ *
+ *         MAC layers that keep per-neighbor transmit queues (CSMA, TSCH)
+ *         report every packet entering and leaving their queues here.
+ *         Upper layers (e.g. BRPL backpressure) read the resulting queue
+ *         occupancy, byte count and sojourn time, in aggregate or for a
+ *         given neighbor, without knowing which MAC is in use.
+ */
+
+#ifndef MAC_BACKLOG_H_
+#define MAC_BACKLOG_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "net/queuebuf.h"
+
+/* Sojourn time EWMA, scaled by MAC_BACKLOG_EWMA_SCALE */
+#define MAC_BACKLOG_EWMA_SCALE 100
+#ifdef MAC_BACKLOG_CONF_EWMA_ALPHA
+#define MAC_BACKLOG_EWMA_ALPHA MAC_BACKLOG_CONF_EWMA_ALPHA
+#else /* MAC_BACKLOG_CONF_EWMA_ALPHA */
+#define MAC_BACKLOG_EWMA_ALPHA 15
+#endif /* MAC_BACKLOG_CONF_EWMA_ALPHA */
+
+/* Number of neighbors tracked concurrently. Entries only exist while a
+ * neighbor has packets queued, so QUEUEBUF_NUM entries are always enough. */
+#ifdef MAC_BACKLOG_CONF_MAX_NEIGHBORS
+#define MAC_BACKLOG_MAX_NEIGHBORS MAC_BACKLOG_CONF_MAX_NEIGHBORS
+#else /* MAC_BACKLOG_CONF_MAX_NEIGHBORS */
+#define MAC_BACKLOG_MAX_NEIGHBORS QUEUEBUF_NUM
+#endif /* MAC_BACKLOG_CONF_MAX_NEIGHBORS */
+
+/* Longest time (ms) a packet may wait in LIFO service order before the
+ * MAC drops it. Newer packets are served first under LIFO, so without
+ * this bound an old packet can starve forever under sustained load. */
+#ifdef MAC_BACKLOG_CONF_LIFO_MAX_AGE
+#define MAC_BACKLOG_LIFO_MAX_AGE MAC_BACKLOG_CONF_LIFO_MAX_AGE
+#else /* MAC_BACKLOG_CONF_LIFO_MAX_AGE */
+#define MAC_BACKLOG_LIFO_MAX_AGE 4000
+#endif /* MAC_BACKLOG_CONF_LIFO_MAX_AGE */
+
+/* Queueing delay histogram of delivered packets: bucket 0 counts delays
+ * below MAC_BACKLOG_DELAY_BUCKET_MS, each next bucket covers twice the
+ * range of the previous one, and the last one everything above. */
+#define MAC_BACKLOG_DELAY_BUCKETS   12
+#define MAC_BACKLOG_DELAY_BUCKET_MS 16
+
+/** \brief Backlog of a transmit queue (aggregate or per neighbor) */
+struct mac_backlog {
+  uint16_t packets;          /* Packets currently queued */
+  uint32_t bytes;            /* Bytes currently queued */
+  clock_time_t sojourn_avg;  /* EWMA of the time dequeued packets spent queued */
+  clock_time_t sojourn_max;  /* Longest time a dequeued packet spent queued */
+};
+
+/**
+ * \brief Initialize the backlog accounting, called by the MAC at init
+ * \param capacity The total number of packets the MAC can queue
+ */
+void mac_backlog_init(uint16_t capacity);
+
+/**
+ * \brief Report a packet added to a MAC transmit queue
+ * \param addr The receiver, NULL or linkaddr_null for broadcast
+ * \param len The length of the queued frame in bytes
+ */
+void mac_backlog_enqueued(const linkaddr_t *addr, uint16_t len);
+
+/**
+ * \brief Report a packet leaving a MAC transmit queue (sent or given up)
+ * \param addr The receiver, NULL or linkaddr_null for broadcast
+ * \param len The length of the frame in bytes, as reported at enqueue time
+ * \param enqueued_at The clock_time() at which the packet was enqueued
+ * \param status The MAC_TX_* outcome, only MAC_TX_OK packets enter the
+ *        delay histogram
+ */
+void mac_backlog_dequeued(const linkaddr_t *addr, uint16_t len,
+                          clock_time_t enqueued_at, int status);
+
+/**
+ * \brief Report a packet rejected by the MAC because its queues were full
+ * \param addr The receiver, NULL or linkaddr_null for broadcast
+ */
+void mac_backlog_dropped(const linkaddr_t *addr);
+
+/**
+ * \brief Report a queued packet given up because it waited too long
+ * \param addr The receiver, NULL or linkaddr_null for broadcast
+ *
+ * The packet must still be reported through mac_backlog_dequeued().
+ */
+void mac_backlog_expired(const linkaddr_t *addr);
+
+/**
+ * \brief Select the service order of the per-neighbor MAC queues
+ * \param lifo Nonzero to serve the newest packet first, 0 for FIFO
+ *
+ * Under LIFO, packets older than MAC_BACKLOG_LIFO_MAX_AGE are dropped.
+ * Broadcast queues are always served in FIFO order.
+ */
+void mac_backlog_set_lifo(uint8_t lifo);
+
+/**
+ * \brief Whether the MAC queues are served newest packet first
+ */
+uint8_t mac_backlog_lifo(void);
+
+/**
+ * \brief Maximum queueing time under LIFO, in clock ticks
+ */
+clock_time_t mac_backlog_lifo_max_age(void);
+
+/**
+ * \brief Get the aggregate backlog over all MAC queues
+ * \return A pointer to the aggregate backlog, never NULL
+ */
+const struct mac_backlog *mac_backlog_total(void);
+
+/**
+ * \brief Get the backlog towards a given neighbor
+ * \param addr The link-layer address of the neighbor
+ * \return A pointer to the neighbor backlog, NULL if nothing is queued for it
+ */
+const struct mac_backlog *mac_backlog_nbr(const linkaddr_t *addr);
+
+/**
+ * \brief Total number of packets the MAC can queue (0 if no MAC reports)
+ */
+uint16_t mac_backlog_capacity(void);
+
+/**
+ * \brief Number of packets accepted into MAC queues since init
+ */
+uint32_t mac_backlog_enqueued_count(void);
+
+/**
+ * \brief Number of packets rejected by full MAC queues since init
+ */
+uint32_t mac_backlog_dropped_count(void);
+
+/**
+ * \brief Number of queued packets given up for their age since init
+ */
+uint32_t mac_backlog_expired_count(void);
+
+/**
+ * \brief Get the queueing delay histogram of delivered packets
+ * \return MAC_BACKLOG_DELAY_BUCKETS counters, see MAC_BACKLOG_DELAY_BUCKET_MS
+ */
+const uint32_t *mac_backlog_delay_histogram(void);
+
+/**
+ * \brief Clear the delay histogram, e.g. between two measurement runs
+ */
+void mac_backlog_delay_reset(void);
+
+#endif /* MAC_BACKLOG_H_ */
+/** @} */
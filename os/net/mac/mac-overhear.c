@@ -0,0 +1,28 @@
+/**
+ * \addtogroup link-layer
+ * @{
+ *
+ * \file
+ *         MAC-agnostic delivery of overheard frames.
+ */
+
+#include "contiki.h"
+#include "net/mac/mac-overhear.h"
+
+static mac_overhear_callback_t overhear_callback;
+/*---------------------------------------------------------------------------*/
+void
+mac_overhear_set_callback(mac_overhear_callback_t callback)
+{
+  overhear_callback = callback;
+}
+/*---------------------------------------------------------------------------*/
+void
+mac_overhear_input(void)
+{
+  if(overhear_callback != NULL) {
+    overhear_callback();
+  }
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
@@ -0,0 +1,35 @@
+/**
+ * \addtogroup link-layer
+ * @{
+ *
+ * \file
+ *         MAC-agnostic delivery of overheard frames.
+ *
+ *         MAC layers that receive unicast frames addressed to other nodes
+ *         (e.g. CSMA on a radio without address filtering) report them
+ *         here, parsed, right before dropping them. An upper layer (e.g.
+ *         the trust engine watchdog) registers a callback to inspect them
+ *         in the packetbuf, without knowing which MAC is in use.
+ */
+
+#ifndef MAC_OVERHEAR_H_
+#define MAC_OVERHEAR_H_
+
+#include "contiki.h"
+
+typedef void (* mac_overhear_callback_t)(void);
+
+/**
+ * \brief Sets the function called for every overheard frame
+ * \param callback The function, NULL to stop overhearing
+ */
+void mac_overhear_set_callback(mac_overhear_callback_t callback);
+
+/**
+ * \brief Called by the MAC with an overheard unicast frame in the packetbuf,
+ *        after the framer has parsed it
+ */
+void mac_overhear_input(void);
+
+#endif /* MAC_OVERHEAR_H_ */
+/** @} */
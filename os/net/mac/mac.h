@@ -87,6 +87,25 @@ struct mac_driver {
   int (* max_payload)(void);
 };
 
+/**
+ * Transmit classes, set in PACKETBUF_ATTR_MAC_TX_CLASS. MACs with
+ * per-class queues serve control traffic first and share the rest of the
+ * link between the data classes.
+ */
+enum {
+  /**< Not set by the upper layer, served as best effort. */
+  MAC_TX_CLASS_UNSET,
+
+  /**< Routing and neighbor discovery control traffic. */
+  MAC_TX_CLASS_CONTROL,
+
+  /**< Latency-sensitive data, e.g. CoAP confirmable messages. */
+  MAC_TX_CLASS_EXPEDITED,
+
+  /**< Bulk data, e.g. periodic telemetry. */
+  MAC_TX_CLASS_BEST_EFFORT,
+};
+
 /* Generic MAC return values. */
 enum {
   /**< The MAC layer transmission was OK. */
@@ -314,6 +314,37 @@
 #define TSCH_QUEUE_MAX_NEIGHBOR_QUEUES ((NBR_TABLE_CONF_MAX_NEIGHBORS) + 2)
 #endif
 
+/* How a shared link to the broadcast address picks the unicast queue it
+ * serves among the neighbors without a dedicated Tx link:
+ * TSCH_QUEUE_SELECT_FIRST takes the first one in neighbor table order,
+ * TSCH_QUEUE_SELECT_OLDEST the one whose oldest packet waited longest,
+ * TSCH_QUEUE_SELECT_LONGEST the one with the most packets queued.
+ * Control packets at the head of a queue always go first; otherwise the
+ * age or length is weighed by the transmit class of the head packet. */
+#define TSCH_QUEUE_SELECT_FIRST   0
+#define TSCH_QUEUE_SELECT_OLDEST  1
+#define TSCH_QUEUE_SELECT_LONGEST 2
+
+#ifdef TSCH_QUEUE_CONF_SELECT
+#define TSCH_QUEUE_SELECT TSCH_QUEUE_CONF_SELECT
+#else
+#define TSCH_QUEUE_SELECT TSCH_QUEUE_SELECT_OLDEST
+#endif
+
+/* Weights of the expedited and best effort transmit classes in the queue
+ * selection, as the CSMA class weights */
+#ifdef TSCH_QUEUE_CONF_EXPEDITED_WEIGHT
+#define TSCH_QUEUE_EXPEDITED_WEIGHT TSCH_QUEUE_CONF_EXPEDITED_WEIGHT
+#else
+#define TSCH_QUEUE_EXPEDITED_WEIGHT 3
+#endif
+
+#ifdef TSCH_QUEUE_CONF_BEST_EFFORT_WEIGHT
+#define TSCH_QUEUE_BEST_EFFORT_WEIGHT TSCH_QUEUE_CONF_BEST_EFFORT_WEIGHT
+#else
+#define TSCH_QUEUE_BEST_EFFORT_WEIGHT 1
+#endif
+
 /******** Configuration: scheduling  *******/
 
 /* Initializes TSCH with a 6TiSCH minimal schedule */
@@ -332,6 +363,20 @@
 #define TSCH_BURST_MAX_LEN 0
 #endif
 
+/* A burst continues into the next timeslot only if that timeslot is idle,
+ * or only has dedicated links to the peer of the burst, e.g. an Rx-only
+ * cell from it, so that no other traffic loses its slot. The sender checks
+ * its own schedule before setting the frame pending bit. With
+ * TSCH_BURST_CONFIRM, the receiver checks its schedule too and accepts
+ * the burst by setting the frame pending bit of the EACK; the sender only
+ * carries on when it is set. This is not part of IEEE 802.15.4, so all
+ * nodes of the network must enable it, or none */
+#ifdef TSCH_CONF_BURST_CONFIRM
+#define TSCH_BURST_CONFIRM TSCH_CONF_BURST_CONFIRM
+#else
+#define TSCH_BURST_CONFIRM 0
+#endif
+
 /* 6TiSCH Minimal schedule slotframe length */
 #ifdef TSCH_SCHEDULE_CONF_DEFAULT_LENGTH
 #define TSCH_SCHEDULE_DEFAULT_LENGTH TSCH_SCHEDULE_CONF_DEFAULT_LENGTH
@@ -353,6 +398,15 @@
 #define TSCH_SCHEDULE_MAX_LINKS 32
 #endif
 
+/* Keep the links of each slotframe sorted by timeslot, so that looking up
+ * the next active link takes a binary search per slotframe rather than a
+ * scan of every link */
+#ifdef TSCH_SCHEDULE_CONF_TIMELINE
+#define TSCH_SCHEDULE_TIMELINE TSCH_SCHEDULE_CONF_TIMELINE
+#else
+#define TSCH_SCHEDULE_TIMELINE 1
+#endif
+
 /* To include Sixtop Implementation */
 #ifdef TSCH_CONF_WITH_SIXTOP
 #define TSCH_WITH_SIXTOP TSCH_CONF_WITH_SIXTOP
@@ -393,6 +447,16 @@
 #define TSCH_MAC_MAX_BE 5
 #endif
 
+/* Shorten the backoff window after a failure on a shared link for the
+ * neighbors with a long queue: halved from half of
+ * TSCH_QUEUE_NUM_PER_NEIGHBOR packets, quartered when full. The exponent
+ * still grows as usual */
+#ifdef TSCH_CONF_MAC_BACKOFF_QUEUE_AWARE
+#define TSCH_MAC_BACKOFF_QUEUE_AWARE TSCH_CONF_MAC_BACKOFF_QUEUE_AWARE
+#else
+#define TSCH_MAC_BACKOFF_QUEUE_AWARE 0
+#endif
+
 /* Avoid potential 16-bit integer overflow */
 #if TSCH_MAC_MAX_BE > 16
 #error TSCH_MAC_MAX_BE must be 16 or lower to avoid uint16_t overflows
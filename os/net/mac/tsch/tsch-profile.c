@@ -0,0 +1,234 @@
+/**
+ * \addtogroup tsch
+ * @{
+ *
+ * \file
+ *         Slot timing profiler for TSCH
+ */
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+
+#include <string.h>
+
+#if TSCH_PROFILE_ON
+
+/* The slot being profiled, written from slot operation only */
+static struct tsch_profile_slot current;
+static rtimer_clock_t current_start;
+
+/* The last slots, ring_next is where the next one goes */
+static struct tsch_profile_slot ring[TSCH_PROFILE_RING_LEN];
+static uint8_t ring_next;
+static uint8_t ring_count;
+
+static struct tsch_profile_stats stats[TSCH_PROFILE_NUM_PHASES];
+
+static const char *const phase_names[TSCH_PROFILE_NUM_PHASES] = {
+  "wakeup", "tx-secured", "tx-prepared", "cca", "tx-start", "ack-wait",
+  "ack-parsed", "rx-start", "rx-end", "rx-parsed", "ack-ready", "ack-tx",
+  "slot-end"
+};
+/*---------------------------------------------------------------------------*/
+static int16_t
+clamp_offset(int32_t offset)
+{
+  if(offset > INT16_MAX - 1) {
+    return INT16_MAX - 1;
+  }
+  if(offset < INT16_MIN) {
+    return INT16_MIN;
+  }
+  return (int16_t)offset;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_profile_reset(void)
+{
+  int i;
+
+  if(tsch_get_lock()) {
+    memset(stats, 0, sizeof(stats));
+    for(i = 0; i < TSCH_PROFILE_NUM_PHASES; i++) {
+      stats[i].min = INT16_MAX;
+      stats[i].max = INT16_MIN;
+    }
+    ring_next = 0;
+    ring_count = 0;
+    tsch_release_lock();
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_profile_slot_start(const struct tsch_asn_t *asn, rtimer_clock_t slot_start)
+{
+  current.asn = asn->ls4b;
+  current.reached = 0;
+  current_start = slot_start;
+  tsch_profile_mark(TSCH_PROFILE_WAKEUP);
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_profile_mark(enum tsch_profile_phase phase)
+{
+  current.offset[phase] = clamp_offset(RTIMER_CLOCK_DIFF(RTIMER_NOW(), current_start));
+  current.reached |= 1 << phase;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_profile_slot_end(uint8_t is_tx, uint8_t channel)
+{
+  int i;
+
+  tsch_profile_mark(TSCH_PROFILE_SLOT_END);
+  current.is_tx = is_tx;
+  current.channel = channel;
+
+  for(i = 0; i < TSCH_PROFILE_NUM_PHASES; i++) {
+    if(current.reached & (1 << i)) {
+      int16_t offset = current.offset[i];
+      stats[i].min = MIN(stats[i].min, offset);
+      stats[i].max = MAX(stats[i].max, offset);
+      stats[i].sum += offset;
+      stats[i].count++;
+      if(offset > tsch_profile_deadline(&current, i)) {
+        stats[i].overruns++;
+      }
+    }
+  }
+
+  ring[ring_next] = current;
+  ring_next = (ring_next + 1) % TSCH_PROFILE_RING_LEN;
+  if(ring_count < TSCH_PROFILE_RING_LEN) {
+    ring_count++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The latest offset at which each phase still fits the timeslot template.
+ * The waits of slot operation are scheduled RADIO_DELAY_BEFORE_* ahead of
+ * these, so a phase past its deadline delays the radio operation after it. */
+int16_t
+tsch_profile_deadline(const struct tsch_profile_slot *slot,
+                      enum tsch_profile_phase phase)
+{
+  int32_t deadline;
+
+  switch(phase) {
+  case TSCH_PROFILE_WAKEUP:
+    /* The first radio operation of the slot */
+    deadline = MIN(tsch_timing[tsch_ts_cca_offset], tsch_timing[tsch_ts_rx_offset]);
+    break;
+  case TSCH_PROFILE_TX_SECURED:
+  case TSCH_PROFILE_TX_PREPARED:
+#if TSCH_CCA_ENABLED
+    deadline = tsch_timing[tsch_ts_cca_offset];
+#else
+    deadline = tsch_timing[tsch_ts_tx_offset];
+#endif
+    break;
+  case TSCH_PROFILE_CCA:
+    deadline = tsch_timing[tsch_ts_cca_offset] + tsch_timing[tsch_ts_cca];
+    break;
+  case TSCH_PROFILE_TX_START:
+    deadline = tsch_timing[tsch_ts_tx_offset];
+    break;
+  case TSCH_PROFILE_ACK_WAIT:
+    deadline = tsch_timing[tsch_ts_tx_offset] + tsch_timing[tsch_ts_max_tx]
+      + tsch_timing[tsch_ts_rx_ack_delay] + tsch_timing[tsch_ts_ack_wait]
+      + tsch_timing[tsch_ts_max_ack];
+    break;
+  case TSCH_PROFILE_RX_START:
+    deadline = tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait];
+    break;
+  case TSCH_PROFILE_RX_END:
+    deadline = tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait]
+      + tsch_timing[tsch_ts_max_tx];
+    break;
+  case TSCH_PROFILE_RX_PARSED:
+  case TSCH_PROFILE_ACK_READY:
+  case TSCH_PROFILE_ACK_TX:
+    /* The ACK goes out TsTxAckDelay after the end of the frame */
+    if(slot == NULL || !(slot->reached & (1 << TSCH_PROFILE_RX_END))) {
+      return TSCH_PROFILE_NO_DEADLINE;
+    }
+    deadline = slot->offset[TSCH_PROFILE_RX_END] + tsch_timing[tsch_ts_tx_ack_delay];
+    break;
+  case TSCH_PROFILE_ACK_PARSED:
+  case TSCH_PROFILE_SLOT_END:
+    deadline = tsch_timing[tsch_ts_timeslot_length];
+    break;
+  default:
+    return TSCH_PROFILE_NO_DEADLINE;
+  }
+  return clamp_offset(deadline);
+}
+/*---------------------------------------------------------------------------*/
+const char *
+tsch_profile_phase_name(enum tsch_profile_phase phase)
+{
+  return phase < TSCH_PROFILE_NUM_PHASES ? phase_names[phase] : "?";
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_profile_get_stats(enum tsch_profile_phase phase,
+                       struct tsch_profile_stats *s)
+{
+  if(phase >= TSCH_PROFILE_NUM_PHASES || !tsch_get_lock()) {
+    return 0;
+  }
+  *s = stats[phase];
+  tsch_release_lock();
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_profile_get_slots(struct tsch_profile_slot *slots, int max)
+{
+  int n = 0;
+
+  if(tsch_get_lock()) {
+    int first = (ring_next + TSCH_PROFILE_RING_LEN - ring_count) % TSCH_PROFILE_RING_LEN;
+    while(n < ring_count && n < max) {
+      slots[n] = ring[(first + n) % TSCH_PROFILE_RING_LEN];
+      n++;
+    }
+    tsch_release_lock();
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t *
+put_le(uint8_t *p, uint32_t v, int len)
+{
+  while(len-- > 0) {
+    *p++ = v & 0xff;
+    v >>= 8;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_profile_dump(uint8_t *buf, int len)
+{
+  struct tsch_profile_slot slots[TSCH_PROFILE_RING_LEN];
+  uint8_t *p = buf;
+  int n;
+  int i;
+  int j;
+
+  n = tsch_profile_get_slots(slots, MIN(len / TSCH_PROFILE_RECORD_LEN,
+                                        TSCH_PROFILE_RING_LEN));
+  for(i = 0; i < n; i++) {
+    p = put_le(p, slots[i].asn, 4);
+    p = put_le(p, slots[i].reached, 2);
+    *p++ = slots[i].is_tx;
+    *p++ = slots[i].channel;
+    for(j = 0; j < TSCH_PROFILE_NUM_PHASES; j++) {
+      p = put_le(p, (uint16_t)slots[i].offset[j], 2);
+    }
+  }
+  return p - buf;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TSCH_PROFILE_ON */
+/** @} */
@@ -0,0 +1,156 @@
+/**
+ * \addtogroup tsch
+ * @{
+ *
+ * \file
+ *         Slot timing profiler for TSCH. Slot operation marks each phase
+ *         of a timeslot with its offset from the start of the slot, in
+ *         rtimer ticks. The last slots are kept in a ring, and every phase
+ *         has min/avg/max offsets and a count of overruns of the deadline
+ *         derived from the timeslot template (tsch_timing).
+ */
+
+#ifndef TSCH_PROFILE_H_
+#define TSCH_PROFILE_H_
+
+#include "contiki.h"
+#include "net/mac/tsch/tsch-asn.h"
+
+/* Enable the slot profiler? */
+#ifdef TSCH_PROFILE_CONF_ON
+#define TSCH_PROFILE_ON TSCH_PROFILE_CONF_ON
+#else
+#define TSCH_PROFILE_ON 0
+#endif
+
+/* The number of last active slots kept */
+#ifdef TSCH_PROFILE_CONF_RING_LEN
+#define TSCH_PROFILE_RING_LEN TSCH_PROFILE_CONF_RING_LEN
+#else
+#define TSCH_PROFILE_RING_LEN 8
+#endif
+
+/* The phases of a slot, in the order slot operation goes through them */
+enum tsch_profile_phase {
+  TSCH_PROFILE_WAKEUP,      /* Slot operation started */
+  TSCH_PROFILE_TX_SECURED,  /* Tx frame secured, with link-layer security */
+  TSCH_PROFILE_TX_PREPARED, /* Tx frame copied to the radio */
+  TSCH_PROFILE_CCA,         /* CCA done */
+  TSCH_PROFILE_TX_START,    /* Transmission started */
+  TSCH_PROFILE_ACK_WAIT,    /* ACK received, or waiting for it timed out */
+  TSCH_PROFILE_ACK_PARSED,  /* ACK parsed and authenticated */
+  TSCH_PROFILE_RX_START,    /* Frame detected, or guard time over */
+  TSCH_PROFILE_RX_END,      /* Frame received */
+  TSCH_PROFILE_RX_PARSED,   /* Frame parsed and authenticated */
+  TSCH_PROFILE_ACK_READY,   /* ACK built, secured and copied to the radio */
+  TSCH_PROFILE_ACK_TX,      /* ACK transmission started */
+  TSCH_PROFILE_SLOT_END,    /* Slot operation done */
+  TSCH_PROFILE_NUM_PHASES
+};
+
+/* One profiled slot */
+struct tsch_profile_slot {
+  uint32_t asn;                /* The 4 least significant bytes of the ASN */
+  uint16_t reached;            /* Bit i is set if phase i was reached */
+  uint8_t is_tx;
+  uint8_t channel;
+  int16_t offset[TSCH_PROFILE_NUM_PHASES]; /* Ticks since the slot start */
+};
+
+/* Offsets of one phase over all profiled slots */
+struct tsch_profile_stats {
+  int16_t min;
+  int16_t max;
+  int64_t sum;                /* Does not overflow within the life of a node */
+  uint32_t count;
+  uint32_t overruns;          /* How often the phase was past its deadline */
+};
+
+/* Length of a slot in the binary dump: ASN, reached bits, Tx flag and
+ * channel, then the offsets, little-endian */
+#define TSCH_PROFILE_RECORD_LEN (8 + 2 * TSCH_PROFILE_NUM_PHASES)
+
+/* No deadline for a phase */
+#define TSCH_PROFILE_NO_DEADLINE INT16_MAX
+
+#if TSCH_PROFILE_ON
+
+/**
+ * \brief Clear the ring and the statistics
+ */
+void tsch_profile_reset(void);
+
+/**
+ * \brief Start profiling a slot and mark its wakeup. Called from slot
+ * operation, in interrupt context
+ * \param asn The ASN of the slot
+ * \param slot_start The start of the slot
+ */
+void tsch_profile_slot_start(const struct tsch_asn_t *asn, rtimer_clock_t slot_start);
+
+/**
+ * \brief Mark the current time as the offset of a phase of the slot.
+ * Called from slot operation, in interrupt context
+ * \param phase The phase reached
+ */
+void tsch_profile_mark(enum tsch_profile_phase phase);
+
+/**
+ * \brief Mark the end of the slot, and add it to the ring and the statistics.
+ * Called from slot operation, in interrupt context
+ * \param is_tx Whether a frame was sent in the slot
+ * \param channel The channel of the slot
+ */
+void tsch_profile_slot_end(uint8_t is_tx, uint8_t channel);
+
+/**
+ * \brief The deadline of a phase in a slot, from the timeslot template
+ * \param slot The slot, as some deadlines depend on earlier phases
+ * \param phase The phase
+ * \return The offset in ticks, TSCH_PROFILE_NO_DEADLINE if there is none
+ */
+int16_t tsch_profile_deadline(const struct tsch_profile_slot *slot,
+                              enum tsch_profile_phase phase);
+
+/**
+ * \brief The name of a phase, for printing
+ */
+const char *tsch_profile_phase_name(enum tsch_profile_phase phase);
+
+/**
+ * \brief Copy the statistics of a phase. Takes the TSCH lock.
+ * \param phase The phase
+ * \param stats Where to copy them
+ * \return 1 on success, 0 if the TSCH lock could not be taken
+ */
+int tsch_profile_get_stats(enum tsch_profile_phase phase,
+                           struct tsch_profile_stats *stats);
+
+/**
+ * \brief Copy the profiled slots, oldest first. Takes the TSCH lock.
+ * \param slots Where to copy them
+ * \param max The number of slots that fit there
+ * \return The number of slots copied
+ */
+int tsch_profile_get_slots(struct tsch_profile_slot *slots, int max);
+
+/**
+ * \brief Write the profiled slots, oldest first, in binary: one record of
+ * TSCH_PROFILE_RECORD_LEN bytes per slot. Takes the TSCH lock.
+ * \param buf The buffer to write to
+ * \param len The length of the buffer
+ * \return The number of bytes written
+ */
+int tsch_profile_dump(uint8_t *buf, int len);
+
+#else /* TSCH_PROFILE_ON */
+
+#define tsch_profile_reset()
+#define tsch_profile_slot_start(asn, slot_start)
+#define tsch_profile_mark(phase)
+#define tsch_profile_slot_end(is_tx, channel)
+
+#endif /* TSCH_PROFILE_ON */
+
+#endif /* TSCH_PROFILE_H_ */
+/** @} */
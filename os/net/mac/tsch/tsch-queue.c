@@ -54,6 +54,8 @@
 #include "lib/random.h"
 #include "net/queuebuf.h"
 #include "net/mac/tsch/tsch.h"
+#include "net/mac/mac-backlog.h"
+#include "net/mac/framer/frame802154.h"
 #include "net/nbr-table.h"
 #include <string.h>
 
@@ -71,6 +73,10 @@
 MEMB(packet_memb, struct tsch_packet, QUEUEBUF_NUM);
 NBR_TABLE(struct tsch_neighbor, tsch_neighbors);
 
+/* EBs are refreshed in place and never leave the queue for long, they are
+ * not part of the transmit backlog */
+#define IS_BACKLOG_FRAME(frame_type) ((frame_type) != FRAME802154_BEACONFRAME)
+
 /* Broadcast and EB virtual neighbors */
 struct tsch_neighbor *n_broadcast;
 struct tsch_neighbor *n_eb;
@@ -224,6 +230,25 @@ tsch_queue_remove_nbr(struct tsch_neighbor *n)
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Under LIFO service, put a packet at the head of a unicast neighbor queue,
+ * where tsch_queue_get_packet_for_nbr() picks it next. Unlike the FIFO
+ * put, this moves the get index, which slot operation also updates, so it
+ * is done under the TSCH lock. Returns 0 if the packet was not queued. */
+static int
+put_packet_lifo(struct tsch_neighbor *n, struct tsch_packet *p)
+{
+  int16_t get_index = -1;
+
+  if(mac_backlog_lifo() && !n->is_broadcast && tsch_get_lock()) {
+    get_index = ringbufindex_put_front(&n->tx_ringbuf);
+    if(get_index != -1) {
+      n->tx_array[get_index] = p;
+    }
+    tsch_release_lock();
+  }
+  return get_index != -1;
+}
+/*---------------------------------------------------------------------------*/
 /* Add packet to neighbor queue. Use same lockfree implementation as ringbuf.c (put is atomic) */
 struct tsch_packet *
 tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
@@ -257,9 +282,16 @@ tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
             p->ret = MAC_TX_DEFERRED;
             p->transmissions = 0;
             p->max_transmissions = max_transmissions;
-            /* Add to ringbuf (actual add committed through atomic operation) */
-            n->tx_array[put_index] = p;
-            ringbufindex_put(&n->tx_ringbuf);
+            p->enqueued_at = clock_time();
+            if(!put_packet_lifo(n, p)) {
+              /* Add to ringbuf (actual add committed through atomic operation) */
+              n->tx_array[put_index] = p;
+              ringbufindex_put(&n->tx_ringbuf);
+            }
+            if(IS_BACKLOG_FRAME(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE))) {
+              mac_backlog_enqueued(n->is_broadcast ? NULL : addr,
+                                   queuebuf_datalen(p->qb));
+            }
             LOG_DBG("packet is added put_index %u, packet %p\n",
                    put_index, p);
             return p;
@@ -271,6 +303,9 @@ tsch_queue_add_packet(const linkaddr_t *addr, uint8_t max_transmissions,
     }
   }
   LOG_ERR("! add packet failed: %u %p %d %p %p\n", tsch_is_locked(), n, put_index, p, p ? p->qb : NULL);
+  if(IS_BACKLOG_FRAME(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE))) {
+    mac_backlog_dropped(addr);
+  }
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -314,11 +349,63 @@ void
 tsch_queue_free_packet(struct tsch_packet *p)
 {
   if(p != NULL) {
+    if(IS_BACKLOG_FRAME(queuebuf_attr(p->qb, PACKETBUF_ATTR_FRAME_TYPE))) {
+      mac_backlog_dequeued(queuebuf_addr(p->qb, PACKETBUF_ADDR_RECEIVER),
+                           queuebuf_datalen(p->qb), p->enqueued_at, p->ret);
+    }
     queuebuf_free(p->qb);
     memb_free(&packet_memb, p);
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Drop the packets that waited longer than the LIFO maximum age. Under
+ * LIFO service the oldest packet of a queue is its last one. */
+void
+tsch_queue_drop_aged_packets(void)
+{
+  struct tsch_neighbor *n;
+  clock_time_t max_age;
+
+  if(!mac_backlog_lifo() || tsch_is_locked()) {
+    return;
+  }
+  max_age = mac_backlog_lifo_max_age();
+  for(n = nbr_table_head(tsch_neighbors); n != NULL;
+      n = nbr_table_next(tsch_neighbors, n)) {
+    while(!n->is_broadcast) {
+      struct tsch_packet *p = NULL;
+      int16_t last_index;
+
+      if(!tsch_get_lock()) {
+        return;
+      }
+      last_index = ringbufindex_peek_last(&n->tx_ringbuf);
+      if(last_index != -1 &&
+         clock_time() - n->tx_array[last_index]->enqueued_at > max_age) {
+        ringbufindex_unput(&n->tx_ringbuf);
+        p = n->tx_array[last_index];
+        if(tsch_queue_is_empty(n)) {
+          tsch_queue_backoff_reset(n);
+        }
+      }
+      tsch_release_lock();
+
+      if(p == NULL) {
+        break;
+      }
+      p->ret = MAC_TX_ERR;
+      LOG_WARN("! dropping aged packet to ");
+      LOG_WARN_LLADDR(tsch_queue_get_nbr_address(n));
+      LOG_WARN_("\n");
+      mac_backlog_expired(tsch_queue_get_nbr_address(n));
+      /* The sent callback reads the packet attributes from packetbuf */
+      queuebuf_to_packetbuf(p->qb);
+      mac_call_sent_callback(p->sent, p->ptr, p->ret, p->transmissions);
+      tsch_queue_free_packet(p);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
 /* Free all packets to a neighbor */
 void
 tsch_queue_free_packets_to(const linkaddr_t *addr)
@@ -458,27 +545,88 @@ tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *li
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
-/* Returns the head packet of any neighbor queue with zero backoff counter.
- * Writes pointer to the neighbor in *n */
+/* Age of the oldest packet of a neighbor queue. That is the head of the
+ * queue, or its last packet under LIFO service. */
+clock_time_t
+tsch_queue_nbr_head_age(const struct tsch_neighbor *n)
+{
+  if(!tsch_is_locked() && n != NULL) {
+    int16_t index = mac_backlog_lifo() && !n->is_broadcast
+      ? ringbufindex_peek_last(&n->tx_ringbuf)
+      : ringbufindex_peek_get(&n->tx_ringbuf);
+    if(index != -1) {
+      return clock_time() - n->tx_array[index]->enqueued_at;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+#if TSCH_QUEUE_SELECT != TSCH_QUEUE_SELECT_FIRST
+/* Rank of a neighbor queue whose head packet p may be sent on a shared
+ * link: control packets first, then the oldest or longest queue, the age
+ * or length being weighed by the class of p. */
+static uint32_t
+select_rank(const struct tsch_neighbor *n, const struct tsch_packet *p)
+{
+  uint32_t metric;
+
+  if(queuebuf_attr(p->qb, PACKETBUF_ATTR_MAC_TX_CLASS) == MAC_TX_CLASS_CONTROL) {
+    return UINT32_MAX;
+  }
+#if TSCH_QUEUE_SELECT == TSCH_QUEUE_SELECT_LONGEST
+  /* The age breaks ties between queues of the same length */
+  metric = ((uint32_t)tsch_queue_nbr_packet_count(n) << 16)
+    | MIN(tsch_queue_nbr_head_age(n), UINT16_MAX);
+#else
+  metric = MIN(tsch_queue_nbr_head_age(n), UINT32_MAX / 2) + 1;
+#endif
+  if(queuebuf_attr(p->qb, PACKETBUF_ATTR_MAC_TX_CLASS) == MAC_TX_CLASS_EXPEDITED) {
+    return MIN(metric, (UINT32_MAX - 1) / TSCH_QUEUE_EXPEDITED_WEIGHT)
+      * TSCH_QUEUE_EXPEDITED_WEIGHT;
+  }
+  return MIN(metric, (UINT32_MAX - 1) / TSCH_QUEUE_BEST_EFFORT_WEIGHT)
+    * TSCH_QUEUE_BEST_EFFORT_WEIGHT;
+}
+#endif /* TSCH_QUEUE_SELECT != TSCH_QUEUE_SELECT_FIRST */
+/*---------------------------------------------------------------------------*/
+/* Returns the head packet of a neighbor queue with zero backoff counter,
+ * chosen as per TSCH_QUEUE_SELECT. Writes pointer to the neighbor in *n */
 struct tsch_packet *
 tsch_queue_get_unicast_packet_for_any(struct tsch_neighbor **n, struct tsch_link *link)
 {
   if(!tsch_is_locked()) {
     struct tsch_neighbor *curr_nbr = (struct tsch_neighbor *)nbr_table_head(tsch_neighbors);
-    struct tsch_packet *p = NULL;
+    struct tsch_neighbor *best_nbr = NULL;
+    struct tsch_packet *best_p = NULL;
+#if TSCH_QUEUE_SELECT != TSCH_QUEUE_SELECT_FIRST
+    uint32_t best_rank = 0;
+#endif
     while(curr_nbr != NULL) {
       if(!curr_nbr->is_broadcast && curr_nbr->tx_links_count == 0) {
         /* Only look up for non-broadcast neighbors we do not have a tx link to */
-        p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
+        struct tsch_packet *p = tsch_queue_get_packet_for_nbr(curr_nbr, link);
         if(p != NULL) {
-          if(n != NULL) {
-            *n = curr_nbr;
+#if TSCH_QUEUE_SELECT == TSCH_QUEUE_SELECT_FIRST
+          best_nbr = curr_nbr;
+          best_p = p;
+          break;
+#else
+          uint32_t rank = select_rank(curr_nbr, p);
+          /* On equal rank, keep the neighbor table order */
+          if(best_p == NULL || rank > best_rank) {
+            best_nbr = curr_nbr;
+            best_p = p;
+            best_rank = rank;
           }
-          return p;
+#endif
         }
       }
       curr_nbr = (struct tsch_neighbor *)nbr_table_next(tsch_neighbors, curr_nbr);
     }
+    if(best_p != NULL && n != NULL) {
+      *n = best_nbr;
+    }
+    return best_p;
   }
   return NULL;
 }
@@ -508,6 +656,15 @@ tsch_queue_backoff_inc(struct tsch_neighbor *n)
    * few bits, which, on some embedded implementations of rand (e.g. msp430-libc),
    * are known to have poor pseudo-random properties. */
   n->backoff_window = (random_rand() >> 6) % (1ul << n->backoff_exponent);
+#if TSCH_MAC_BACKOFF_QUEUE_AWARE
+  /* A neighbor with a long queue waits less, so that it does not fall
+   * further behind the others on the shared links */
+  if(ringbufindex_full(&n->tx_ringbuf)) {
+    n->backoff_window >>= 2;
+  } else if(ringbufindex_elements(&n->tx_ringbuf) >= TSCH_QUEUE_NUM_PER_NEIGHBOR / 2) {
+    n->backoff_window >>= 1;
+  }
+#endif /* TSCH_MAC_BACKOFF_QUEUE_AWARE */
   /* Add one to the window as we will decrement it at the end of the current slot
    * through tsch_queue_update_all_backoff_windows */
   if(n->backoff_window < UINT16_MAX) {
@@ -539,6 +696,7 @@ tsch_queue_init(void)
 {
   nbr_table_register(tsch_neighbors, NULL);
   memb_init(&packet_memb);
+  mac_backlog_init(QUEUEBUF_NUM);
   /* Add virtual EB and the broadcast neighbors */
   n_eb = tsch_queue_add_nbr(&tsch_eb_address);
   n_broadcast = tsch_queue_add_nbr(&tsch_broadcast_address);
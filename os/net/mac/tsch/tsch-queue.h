@@ -114,6 +114,12 @@ struct tsch_packet *tsch_queue_remove_packet_from_queue(struct tsch_neighbor *n)
  * \param p The packet to be freed
  */
 void tsch_queue_free_packet(struct tsch_packet *p);
+/**
+ * \brief Under LIFO service (see mac_backlog_set_lifo), drop the unicast
+ * packets queued for longer than the maximum age, calling their sent
+ * callback with MAC_TX_ERR. Uses packetbuf.
+ */
+void tsch_queue_drop_aged_packets(void);
 /**
  * \brief Flush packets to a specific address
  * \param addr The address of the neighbor whose packets to free
@@ -157,7 +163,17 @@ struct tsch_packet *tsch_queue_get_packet_for_nbr(const struct tsch_neighbor *n,
  */
 struct tsch_packet *tsch_queue_get_packet_for_dest_addr(const linkaddr_t *addr, struct tsch_link *link);
 /**
- * \brief Gets the head packet of any neighbor queue with zero backoff counter.
+ * \brief Returns how long the oldest packet of a neighbor queue has been
+ * queued: the head of line, or the last packet under LIFO service
+ * \param n The neighbor queue
+ * \return The age in clock ticks, 0 if the queue is empty
+ */
+clock_time_t tsch_queue_nbr_head_age(const struct tsch_neighbor *n);
+/**
+ * \brief Gets the head packet of a neighbor queue with zero backoff counter,
+ * among the neighbors without a Tx link. The queue is chosen as per
+ * TSCH_QUEUE_SELECT: oldest head of line or longest queue, weighed by
+ * the transmit class of the head packet, by default.
  * \param n A pointer where to store the neighbor queue to be used for Tx
  * \param link The link to be used for Tx
  * \return The packet if any, else NULL
@@ -68,6 +68,76 @@ MEMB(slotframe_memb, struct tsch_slotframe, TSCH_SCHEDULE_MAX_SLOTFRAMES);
 /* List of slotframes (each slotframe holds its own list of links) */
 LIST(slotframe_list);
 
+#if TSCH_SCHEDULE_TIMELINE
+/* The links of all slotframes, by slotframe in the order of slotframe_list,
+ * then by timeslot, then in the order of the links_list of their
+ * slotframe. Each slotframe holds the range of its own links. */
+static struct tsch_link *timeline[TSCH_SCHEDULE_MAX_LINKS];
+static uint16_t timeline_len;
+/*---------------------------------------------------------------------------*/
+/* Inserts a link that was just added at the tail of its slotframe */
+static void
+timeline_insert(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos = sf->timeline_start + sf->timeline_len;
+
+  /* Last among the links of its timeslot, as in links_list */
+  while(pos > sf->timeline_start && timeline[pos - 1]->timeslot > l->timeslot) {
+    pos--;
+  }
+  memmove(&timeline[pos + 1], &timeline[pos],
+          (timeline_len - pos) * sizeof(timeline[0]));
+  timeline[pos] = l;
+  timeline_len++;
+  sf->timeline_len++;
+  /* The ranges of the following slotframes move up */
+  for(sf = list_item_next(sf); sf != NULL; sf = list_item_next(sf)) {
+    sf->timeline_start++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+timeline_remove(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint16_t pos = sf->timeline_start;
+  uint16_t end = sf->timeline_start + sf->timeline_len;
+
+  while(pos < end && timeline[pos] != l) {
+    pos++;
+  }
+  if(pos == end) {
+    return;
+  }
+  memmove(&timeline[pos], &timeline[pos + 1],
+          (timeline_len - pos - 1) * sizeof(timeline[0]));
+  timeline_len--;
+  sf->timeline_len--;
+  for(sf = list_item_next(sf); sf != NULL; sf = list_item_next(sf)) {
+    sf->timeline_start--;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Position in the timeline of the first link of a non-empty slotframe after
+ * a timeslot, wrapping around to the first one */
+static uint16_t
+timeline_next(const struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  uint16_t lo = sf->timeline_start;
+  uint16_t hi = sf->timeline_start + sf->timeline_len;
+  uint16_t mid;
+
+  while(lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if(timeline[mid]->timeslot > timeslot) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo == sf->timeline_start + sf->timeline_len ? sf->timeline_start : lo;
+}
+#endif /* TSCH_SCHEDULE_TIMELINE */
+
 /* Adds and returns a slotframe (NULL if failure) */
 struct tsch_slotframe *
 tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
@@ -88,6 +158,11 @@ tsch_schedule_add_slotframe(uint16_t handle, uint16_t size)
       sf->handle = handle;
       TSCH_ASN_DIVISOR_INIT(sf->size, size);
       LIST_STRUCT_INIT(sf, links_list);
+#if TSCH_SCHEDULE_TIMELINE
+      /* Slotframes are added last, so are their links in the timeline */
+      sf->timeline_start = timeline_len;
+      sf->timeline_len = 0;
+#endif /* TSCH_SCHEDULE_TIMELINE */
       /* Add the slotframe to the global list */
       list_add(slotframe_list, sf);
     }
@@ -262,6 +337,9 @@ tsch_schedule_add_link(struct tsch_slotframe *slotframe,
           address = &linkaddr_null;
         }
         linkaddr_copy(&l->addr, address);
+#if TSCH_SCHEDULE_TIMELINE
+        timeline_insert(slotframe, l);
+#endif /* TSCH_SCHEDULE_TIMELINE */
 
         LOG_INFO("add_link sf=%u opt=%s type=%s ts=%u ch=%u addr=",
                  slotframe->handle,
@@ -314,6 +392,9 @@ tsch_schedule_remove_link(struct tsch_slotframe *slotframe, struct tsch_link *l)
       LOG_INFO_LLADDR(&l->addr);
       LOG_INFO_("\n");
 
+#if TSCH_SCHEDULE_TIMELINE
+      timeline_remove(slotframe, l);
+#endif /* TSCH_SCHEDULE_TIMELINE */
       list_remove(slotframe->links_list, l);
       memb_free(&link_memb, l);
 
@@ -430,11 +511,57 @@ default_tsch_link_comparator(struct tsch_link *a, struct tsch_link *b)
   return a;
 }
 
+/*---------------------------------------------------------------------------*/
+/* Selects one of two links occurring at the same time, curr_best and l, l
+ * coming later in the schedule, and maintains the backup link */
+static void
+select_overlapping_link(struct tsch_link **curr_best, struct tsch_link **curr_backup,
+                        struct tsch_link *l)
+{
+  struct tsch_link *new_best = NULL;
+  /* Two links are overlapping, we need to select one of them.
+   * By standard: prioritize Tx links first, second by lowest handle */
+  if(((*curr_best)->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
+    /* Both or neither links have Tx, select the one with lowest handle */
+    if(l->slotframe_handle != (*curr_best)->slotframe_handle) {
+      if(l->slotframe_handle < (*curr_best)->slotframe_handle) {
+        new_best = l;
+      }
+    } else {
+      /* compare the link against the current best link and return the newly selected one */
+      new_best = TSCH_LINK_COMPARATOR(*curr_best, l);
+    }
+  } else {
+    /* Select the link that has the Tx option */
+    if(l->link_options & LINK_OPTION_TX) {
+      new_best = l;
+    }
+  }
+
+  /* Maintain backup_link */
+  /* Check if 'l' best can be used as backup */
+  if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
+    if(*curr_backup == NULL || l->slotframe_handle < (*curr_backup)->slotframe_handle) {
+      *curr_backup = l;
+    }
+  }
+  /* Check if curr_best can be used as backup */
+  if(new_best != *curr_best && ((*curr_best)->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
+    if(*curr_backup == NULL || (*curr_best)->slotframe_handle < (*curr_backup)->slotframe_handle) {
+      *curr_backup = *curr_best;
+    }
+  }
+
+  /* Maintain curr_best */
+  if(new_best != NULL) {
+    *curr_best = new_best;
+  }
+}
 /*---------------------------------------------------------------------------*/
 /* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
 struct tsch_link *
-tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
-    struct tsch_link **backup_link)
+tsch_schedule_scan_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
+                                    struct tsch_link **backup_link)
 {
   uint16_t time_to_curr_best = 0;
   struct tsch_link *curr_best = NULL;
@@ -459,44 +586,7 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
           curr_best = l;
           curr_backup = NULL;
         } else if(time_to_timeslot == time_to_curr_best) {
-          struct tsch_link *new_best = NULL;
-          /* Two links are overlapping, we need to select one of them.
-           * By standard: prioritize Tx links first, second by lowest handle */
-          if((curr_best->link_options & LINK_OPTION_TX) == (l->link_options & LINK_OPTION_TX)) {
-            /* Both or neither links have Tx, select the one with lowest handle */
-            if(l->slotframe_handle != curr_best->slotframe_handle) {
-              if(l->slotframe_handle < curr_best->slotframe_handle) {
-                new_best = l;
-              }
-            } else {
-              /* compare the link against the current best link and return the newly selected one */
-              new_best = TSCH_LINK_COMPARATOR(curr_best, l);
-            }
-          } else {
-            /* Select the link that has the Tx option */
-            if(l->link_options & LINK_OPTION_TX) {
-              new_best = l;
-            }
-          }
-
-          /* Maintain backup_link */
-          /* Check if 'l' best can be used as backup */
-          if(new_best != l && (l->link_options & LINK_OPTION_RX)) { /* Does 'l' have Rx flag? */
-            if(curr_backup == NULL || l->slotframe_handle < curr_backup->slotframe_handle) {
-              curr_backup = l;
-            }
-          }
-          /* Check if curr_best can be used as backup */
-          if(new_best != curr_best && (curr_best->link_options & LINK_OPTION_RX)) { /* Does curr_best have Rx flag? */
-            if(curr_backup == NULL || curr_best->slotframe_handle < curr_backup->slotframe_handle) {
-              curr_backup = curr_best;
-            }
-          }
-
-          /* Maintain curr_best */
-          if(new_best != NULL) {
-            curr_best = new_best;
-          }
+          select_overlapping_link(&curr_best, &curr_backup, l);
         }
 
         l = list_item_next(l);
@@ -513,6 +603,71 @@ tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset
   return curr_best;
 }
 /*---------------------------------------------------------------------------*/
+/* Returns the next active link after a given ASN, and a backup link (for the same ASN, with Rx flag) */
+struct tsch_link *
+tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
+    struct tsch_link **backup_link)
+{
+#if TSCH_SCHEDULE_TIMELINE
+  uint16_t time_to_curr_best = 0;
+  struct tsch_link *curr_best = NULL;
+  struct tsch_link *curr_backup = NULL;
+  if(!tsch_is_locked()) {
+    /* Position of the earliest link of each slotframe, and its time offset */
+    uint16_t next[TSCH_SCHEDULE_MAX_SLOTFRAMES];
+    uint16_t time_to[TSCH_SCHEDULE_MAX_SLOTFRAMES];
+    struct tsch_slotframe *sf;
+    uint8_t found = 0;
+    uint16_t i;
+    uint16_t j;
+
+    for(sf = list_head(slotframe_list), i = 0; sf != NULL; sf = list_item_next(sf), i++) {
+      uint16_t timeslot;
+      uint16_t link_timeslot;
+
+      if(sf->timeline_len == 0) {
+        continue;
+      }
+      timeslot = TSCH_ASN_MOD(*asn, sf->size);
+      next[i] = timeline_next(sf, timeslot);
+      link_timeslot = timeline[next[i]]->timeslot;
+      time_to[i] = link_timeslot > timeslot ?
+        link_timeslot - timeslot :
+        sf->size.val + link_timeslot - timeslot;
+      if(!found || time_to[i] < time_to_curr_best) {
+        time_to_curr_best = time_to[i];
+        found = 1;
+      }
+    }
+
+    /* Select among the links at that time in the order of the schedule,
+     * exactly as tsch_schedule_scan_next_active_link() does */
+    for(sf = list_head(slotframe_list), i = 0; sf != NULL; sf = list_item_next(sf), i++) {
+      if(sf->timeline_len == 0 || time_to[i] != time_to_curr_best) {
+        continue;
+      }
+      for(j = next[i]; j < sf->timeline_start + sf->timeline_len
+          && timeline[j]->timeslot == timeline[next[i]]->timeslot; j++) {
+        if(curr_best == NULL) {
+          curr_best = timeline[j];
+        } else {
+          select_overlapping_link(&curr_best, &curr_backup, timeline[j]);
+        }
+      }
+    }
+    if(time_offset != NULL) {
+      *time_offset = time_to_curr_best;
+    }
+  }
+  if(backup_link != NULL) {
+    *backup_link = curr_backup;
+  }
+  return curr_best;
+#else /* TSCH_SCHEDULE_TIMELINE */
+  return tsch_schedule_scan_next_active_link(asn, time_offset, backup_link);
+#endif /* TSCH_SCHEDULE_TIMELINE */
+}
+/*---------------------------------------------------------------------------*/
 /* Module initialization, call only once at startup. Returns 1 is success, 0 if failure. */
 int
 tsch_schedule_init(void)
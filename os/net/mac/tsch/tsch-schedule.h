@@ -158,6 +158,18 @@ int tsch_schedule_remove_link_by_offsets(struct tsch_slotframe *slotframe,
 struct tsch_link * tsch_schedule_get_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
     struct tsch_link **backup_link);
 
+/**
+ * \brief Same as tsch_schedule_get_next_active_link(), scanning every link of
+ * every slotframe. This is how the next active link is found when
+ * TSCH_SCHEDULE_TIMELINE is disabled, and the reference for the timeline.
+ * \param asn The base ASN, from which we look for the next active link
+ * \param time_offset A pointer to uint16_t where to store the time offset between base ASN and link found
+ * \param backup_link A pointer where to write the address of a backup link, to be executed should the original be no longer active at wakeup
+ * \return The next active link if any, NULL otherwise
+ */
+struct tsch_link *tsch_schedule_scan_next_active_link(struct tsch_asn_t *asn, uint16_t *time_offset,
+                                                      struct tsch_link **backup_link);
+
 /**
  * \brief Access the first item in the list of slotframes
  * \return The first slotframe in the schedule if any, NULL otherwise
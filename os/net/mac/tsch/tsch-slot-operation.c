@@ -362,6 +362,36 @@ is_current_channel_in_join_sequence(struct tsch_link *link)
 #endif
 }
 /*---------------------------------------------------------------------------*/
+/* May a burst with a peer borrow this link of the next timeslot? */
+static int
+burst_can_borrow_link(const struct tsch_link *link, const linkaddr_t *peer)
+{
+  return link == NULL
+    || (link->link_type == LINK_TYPE_NORMAL
+        && !(link->link_options & LINK_OPTION_SHARED)
+        && linkaddr_cmp(&link->addr, peer));
+}
+/*---------------------------------------------------------------------------*/
+/* Is the timeslot after the current one idle, or only used for links to the
+ * peer of the burst, so that the burst can go on there? */
+static int
+burst_can_borrow_next_slot(const linkaddr_t *peer)
+{
+  uint16_t timeslot_diff = 0;
+  struct tsch_link *next_backup = NULL;
+  struct tsch_link *next;
+
+  if(peer == NULL) {
+    return 0;
+  }
+  next = tsch_schedule_get_next_active_link(&tsch_current_asn, &timeslot_diff, &next_backup);
+  if(next == NULL || timeslot_diff > 1) {
+    /* Nothing scheduled there */
+    return 1;
+  }
+  return burst_can_borrow_link(next, peer) && burst_can_borrow_link(next_backup, peer);
+}
+/*---------------------------------------------------------------------------*/
 /* Get EB, broadcast or unicast packet to be sent, and target neighbor. */
 static struct tsch_packet *
 get_packet_and_neighbor_for_link(struct tsch_link *link, struct tsch_neighbor **target_neighbor)
@@ -558,11 +588,13 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       packet_len = queuebuf_datalen(current_packet->qb);
       /* if is this a broadcast packet, don't wait for ack */
       do_wait_for_ack = !current_neighbor->is_broadcast;
-      /* Unicast. More packets in queue for the neighbor? */
+      /* Unicast. More packets in queue for the neighbor, and a next
+       * timeslot to borrow for them? */
       burst_link_requested = 0;
       if(do_wait_for_ack
              && tsch_current_burst_count + 1 < TSCH_BURST_MAX_LEN
-             && tsch_queue_nbr_packet_count(current_neighbor) > 1) {
+             && tsch_queue_nbr_packet_count(current_neighbor) > 1
+             && burst_can_borrow_next_slot(tsch_queue_get_nbr_address(current_neighbor))) {
         burst_link_requested = 1;
         tsch_packet_set_frame_pending(packet, packet_len);
       }
@@ -585,6 +617,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
         if(with_encryption) {
           packet = encrypted_packet;
         }
+        tsch_profile_mark(TSCH_PROFILE_TX_SECURED);
       }
 #endif /* LLSEC802154_ENABLED */
 
@@ -592,6 +625,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
       if(packet_ready && NETSTACK_RADIO.prepare(packet, packet_len) == 0) { /* 0 means success */
         static rtimer_clock_t tx_duration;
 
+        tsch_profile_mark(TSCH_PROFILE_TX_PREPARED);
 #if TSCH_CCA_ENABLED
         cca_status = 1;
         /* delay before CCA */
@@ -602,6 +636,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
         RTIMER_BUSYWAIT_UNTIL_ABS(!(cca_status &= NETSTACK_RADIO.channel_clear()),
                            current_slot_start, tsch_timing[tsch_ts_cca_offset] + tsch_timing[tsch_ts_cca]);
         TSCH_DEBUG_TX_EVENT();
+        tsch_profile_mark(TSCH_PROFILE_CCA);
         /* there is not enough time to turn radio off */
         /*  NETSTACK_RADIO.off(); */
         if(cca_status == 0) {
@@ -612,6 +647,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
           /* delay before TX */
           TSCH_SCHEDULE_AND_YIELD(pt, t, current_slot_start, tsch_timing[tsch_ts_tx_offset] - RADIO_DELAY_BEFORE_TX, "TxBeforeTx");
           TSCH_DEBUG_TX_EVENT();
+          tsch_profile_mark(TSCH_PROFILE_TX_START);
           /* send packet already in radio tx buffer */
           mac_tx_status = NETSTACK_RADIO.transmit(packet_len);
           tx_count++;
@@ -656,6 +692,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
               RTIMER_BUSYWAIT_UNTIL_ABS(!NETSTACK_RADIO.receiving_packet(),
                                  ack_start_time, tsch_timing[tsch_ts_max_ack]);
               TSCH_DEBUG_TX_EVENT();
+              tsch_profile_mark(TSCH_PROFILE_ACK_WAIT);
               tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
 
 #if TSCH_HW_FRAME_FILTERING
@@ -691,6 +728,7 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
                       "!failed to parse ACK"));
                 }
 #endif /* LLSEC802154_ENABLED */
+                tsch_profile_mark(TSCH_PROFILE_ACK_PARSED);
               }
 
               if(ack_len != 0) {
@@ -722,7 +760,12 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
 
                 /* We requested an extra slot and got an ack. This means
                 the extra slot will be scheduled at the received */
-                if(burst_link_requested) {
+                if(burst_link_requested
+#if TSCH_BURST_CONFIRM
+                   /* The receiver accepted the burst */
+                   && frame.fcf.frame_pending
+#endif /* TSCH_BURST_CONFIRM */
+                  ) {
                   burst_link_scheduled = 1;
                 }
               } else {
@@ -748,6 +791,10 @@ PT_THREAD(tsch_tx_slot(struct pt *pt, struct rtimer *t))
     /* Post TX: Update neighbor queue state */
     in_queue = tsch_queue_packet_sent(current_neighbor, current_packet, current_link, mac_tx_status);
 
+#ifdef TSCH_CALLBACK_TX_DONE
+    TSCH_CALLBACK_TX_DONE(current_link, mac_tx_status);
+#endif
+
     /* The packet was dequeued, add it to dequeued_ringbuf for later processing */
     if(in_queue == 0) {
       dequeued_array[dequeued_index] = current_packet;
@@ -838,6 +885,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
       RTIMER_BUSYWAIT_UNTIL_ABS((packet_seen = (NETSTACK_RADIO.receiving_packet() || NETSTACK_RADIO.pending_packet())),
           current_slot_start, tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait] + RADIO_DELAY_BEFORE_DETECT);
     }
+    tsch_profile_mark(TSCH_PROFILE_RX_START);
     if(!packet_seen) {
       /* no packets on air */
       tsch_radio_off(TSCH_RADIO_CMD_OFF_FORCE);
@@ -850,6 +898,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
       RTIMER_BUSYWAIT_UNTIL_ABS(!NETSTACK_RADIO.receiving_packet(),
           current_slot_start, tsch_timing[tsch_ts_rx_offset] + tsch_timing[tsch_ts_rx_wait] + tsch_timing[tsch_ts_max_tx]);
       TSCH_DEBUG_RX_EVENT();
+      tsch_profile_mark(TSCH_PROFILE_RX_END);
       tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
 
       if(NETSTACK_RADIO.pending_packet()) {
@@ -910,6 +959,7 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
           }
         }
 #endif /* LLSEC802154_ENABLED */
+        tsch_profile_mark(TSCH_PROFILE_RX_PARSED);
 
         if(frame_valid) {
           /* Check that frome is for us or broadcast, AND that it is not from
@@ -944,12 +994,27 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
             if(frame.fcf.ack_required) {
               static uint8_t ack_buf[TSCH_PACKET_MAX_LEN];
               static int ack_len;
+              /* Will we listen to the sender in the next timeslot? */
+              static int burst_accepted;
+
+              /* Follow a burst iff the frame pending bit was set */
+              burst_accepted = frame.fcf.frame_pending
+#if TSCH_BURST_CONFIRM
+                && burst_can_borrow_next_slot(&source_address)
+#endif /* TSCH_BURST_CONFIRM */
+                ;
 
               /* Build ACK frame */
               ack_len = tsch_packet_create_eack(ack_buf, sizeof(ack_buf),
                   &source_address, frame.seq, (int16_t)RTIMERTICKS_TO_US(estimated_drift), do_nack);
 
               if(ack_len > 0) {
+#if TSCH_BURST_CONFIRM
+                if(burst_accepted) {
+                  /* Tell the sender to go on */
+                  tsch_packet_set_frame_pending(ack_buf, ack_len);
+                }
+#endif /* TSCH_BURST_CONFIRM */
 #if LLSEC802154_ENABLED
                 if(tsch_is_pan_secured) {
                   /* Secure ACK frame. There is only header and header IEs, therefore data len == 0. */
@@ -959,16 +1024,18 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 
                 /* Copy to radio buffer */
                 NETSTACK_RADIO.prepare((const void *)ack_buf, ack_len);
+                tsch_profile_mark(TSCH_PROFILE_ACK_READY);
 
                 /* Wait for time to ACK and transmit ACK */
                 TSCH_SCHEDULE_AND_YIELD(pt, t, rx_start_time,
                                         packet_duration + tsch_timing[tsch_ts_tx_ack_delay] - RADIO_DELAY_BEFORE_TX, "RxBeforeAck");
                 TSCH_DEBUG_RX_EVENT();
+                tsch_profile_mark(TSCH_PROFILE_ACK_TX);
                 NETSTACK_RADIO.transmit(ack_len);
                 tsch_radio_off(TSCH_RADIO_CMD_OFF_WITHIN_TIMESLOT);
 
-                /* Schedule a burst link iff the frame pending bit was set */
-                burst_link_scheduled = tsch_packet_get_frame_pending(current_input->payload, current_input->len);
+                /* Schedule a burst link if we follow the burst */
+                burst_link_scheduled = burst_accepted;
               }
             }
 
@@ -1058,6 +1125,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
       int is_active_slot;
       TSCH_DEBUG_SLOT_START();
       tsch_in_slot_operation = 1;
+      tsch_profile_slot_start(&tsch_current_asn, current_slot_start);
       /* Measure on-air noise level while TSCH is idle */
       tsch_stats_sample_rssi();
       /* Reset drift correction */
@@ -1113,6 +1181,7 @@ PT_THREAD(tsch_slot_operation(struct rtimer *t, void *ptr))
           static struct pt slot_rx_pt;
           PT_SPAWN(&slot_operation_pt, &slot_rx_pt, tsch_rx_slot(&slot_rx_pt, t));
         }
+        tsch_profile_slot_end(current_packet != NULL, tsch_current_channel);
       } else {
         /* Make sure to end the burst in cast, for some reason, we were
          * in a burst but now without any more packet to send. */
@@ -91,6 +91,10 @@ struct tsch_slotframe {
   struct tsch_asn_divisor_t size;
   /* List of links belonging to this slotframe */
   LIST_STRUCT(links_list);
+  /* Range of the links of this slotframe in the schedule timeline,
+   * used with TSCH_SCHEDULE_TIMELINE */
+  uint16_t timeline_start;
+  uint16_t timeline_len;
 };
 
 /** \brief TSCH packet information */
@@ -103,6 +107,7 @@ struct tsch_packet {
   uint8_t ret; /* status -- MAC return code */
   uint8_t header_len; /* length of header and header IEs (needed for link-layer security) */
   uint8_t tsch_sync_ie_offset; /* Offset within the frame used for quick update of EB ASN and join priority */
+  clock_time_t enqueued_at; /* clock_time() when the packet was queued, for backlog sojourn time */
 };
 
 /** \brief TSCH neighbor information */
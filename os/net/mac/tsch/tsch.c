@@ -553,6 +553,9 @@ tsch_tx_process_pending(void)
     num_packets_freed++;
   }
 
+  /* Keep old packets from starving under LIFO service */
+  tsch_queue_drop_aged_packets();
+
   if(num_packets_freed > 0) {
     /* Free all unused neighbors */
     tsch_queue_free_unused_neighbors();
@@ -1082,6 +1085,7 @@ tsch_init(void)
 #endif
 
   tsch_stats_init();
+  tsch_profile_reset();
   tsch_roots_init();
 }
 /*---------------------------------------------------------------------------*/
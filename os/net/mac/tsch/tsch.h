@@ -61,6 +61,7 @@ frequency hopping for enhanced reliability.
 #include "net/mac/tsch/tsch-security.h"
 #include "net/mac/tsch/tsch-schedule.h"
 #include "net/mac/tsch/tsch-stats.h"
+#include "net/mac/tsch/tsch-profile.h"
 #include "net/mac/tsch/tsch-roots.h"
 #if UIP_CONF_IPV6_RPL
 #include "net/mac/tsch/tsch-rpl.h"
@@ -111,6 +112,14 @@ frequency hopping for enhanced reliability.
 
 #endif /* BUILD_WITH_ORCHESTRA */
 
+#if BUILD_WITH_MSF
+
+#ifndef TSCH_CALLBACK_TX_DONE
+#define TSCH_CALLBACK_TX_DONE msf_callback_tx_done
+#endif /* TSCH_CALLBACK_TX_DONE */
+
+#endif /* BUILD_WITH_MSF */
+
 /* Called by TSCH when joining a network */
 #ifdef TSCH_CALLBACK_JOINING_NETWORK
 void TSCH_CALLBACK_JOINING_NETWORK(void);
@@ -143,6 +152,11 @@ struct tsch_neighbor;
 void TSCH_CALLBACK_NEW_TIME_SOURCE(const struct tsch_neighbor *old, const struct tsch_neighbor *new);
 #endif
 
+/* Called by TSCH from interrupt after each transmission attempt in a link */
+#ifdef TSCH_CALLBACK_TX_DONE
+void TSCH_CALLBACK_TX_DONE(const struct tsch_link *link, uint8_t mac_tx_status);
+#endif
+
 /* Called by TSCH every time a packet is ready to be added to the send queue */
 #ifdef TSCH_CALLBACK_PACKET_READY
 int TSCH_CALLBACK_PACKET_READY(void);
@@ -38,6 +38,7 @@
 #include <string.h>
 #include "lib/memb.h"
 #include "lib/list.h"
+#include "lib/hash-index.h"
 #include "net/nbr-table.h"
 
 #define DEBUG DEBUG_NONE
@@ -70,6 +71,44 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_HASH_INDEX
+#if (NBR_TABLE_HASH_SIZE & (NBR_TABLE_HASH_SIZE - 1)) != 0
+#error "NBR_TABLE_HASH_SIZE must be a power of two"
+#endif
+#if NBR_TABLE_HASH_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error "NBR_TABLE_HASH_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS"
+#endif
+static uint32_t key_hash(const void *item);
+/* Index from link-layer address to the keys of nbr_table_keys. Holds one
+ * entry per key: its index in neighbor_addr_mem, in 16 bits */
+HASH_INDEX(key_index, NBR_TABLE_HASH_SIZE, key_hash, neighbor_addr_mem);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
+
+#if NBR_TABLE_WITH_CHURN
+/* Churn of the tracked table over a window: the neighbors in the table at
+ * the start of the window are compared with those in it now. Each slot
+ * records, at its first add or remove of the window, whether it was in the
+ * table when the window started and which address it held then. The
+ * address is identified by a per-slot generation, bumped whenever the slot
+ * is given to a new link-layer address. */
+struct churn_slot {
+  uint16_t epoch;
+  uint8_t generation;
+  uint8_t in_start;
+};
+static const nbr_table_t *churn_table;
+static struct churn_slot churn_slots[NBR_TABLE_MAX_NEIGHBORS];
+static uint8_t key_generation[NBR_TABLE_MAX_NEIGHBORS];
+/* Slot epochs are 0 until first used, so the window epoch is never 0 */
+static uint16_t churn_epoch = 1;
+/* The current window started from an empty set */
+static uint8_t churn_start_empty;
+/* Neighbors in the table at the start of the window, now, and in both */
+static uint16_t churn_start_count;
+static uint16_t churn_count;
+static uint16_t churn_kept;
+#endif /* NBR_TABLE_WITH_CHURN */
+
 /*---------------------------------------------------------------------------*/
 static void remove_key(nbr_table_key_t *key, bool do_free);
 /*---------------------------------------------------------------------------*/
@@ -115,16 +154,49 @@ key_from_item(const nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_WITH_HASH_INDEX
+static uint32_t
+lladdr_hash(const linkaddr_t *lladdr)
+{
+  return hash_index_fnv1a(HASH_INDEX_FNV1A_INIT, lladdr, LINKADDR_SIZE);
+}
+/*---------------------------------------------------------------------------*/
+static uint32_t
+key_hash(const void *item)
+{
+  return lladdr_hash(&((const nbr_table_key_t *)item)->lladdr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+hash_lookup(const linkaddr_t *lladdr)
+{
+  unsigned pos = hash_index_first(&key_index, lladdr_hash(lladdr));
+  nbr_table_key_t *key;
+
+  while((key = hash_index_next(&key_index, &pos)) != NULL) {
+    if(linkaddr_cmp(lladdr, &key->lladdr)) {
+      return index_from_key(key);
+    }
+  }
+  return -1;
+}
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if !NBR_TABLE_WITH_HASH_INDEX
   nbr_table_key_t *key;
+#endif /* !NBR_TABLE_WITH_HASH_INDEX */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_WITH_HASH_INDEX
+  return hash_lookup(lladdr);
+#else /* NBR_TABLE_WITH_HASH_INDEX */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -133,6 +205,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     key = list_item_next(key);
   }
   return -1;
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 /* Get bit from "used" or "locked" bitmap */
@@ -164,6 +237,63 @@ nbr_set_bit(uint8_t *bitmap, const nbr_table_t *table,
   }
   return 0;
 }
+#if NBR_TABLE_WITH_CHURN
+/*---------------------------------------------------------------------------*/
+static int
+churn_is_tracked(const nbr_table_t *table, int index)
+{
+  return churn_table != NULL && table == churn_table && index != -1;
+}
+/*---------------------------------------------------------------------------*/
+/* The slot state at the start of the window, recorded on its first event */
+static struct churn_slot *
+churn_slot(int index, int was_present)
+{
+  struct churn_slot *slot = &churn_slots[index];
+  if(slot->epoch != churn_epoch) {
+    slot->epoch = churn_epoch;
+    slot->generation = key_generation[index];
+    slot->in_start = was_present && !churn_start_empty;
+  }
+  return slot;
+}
+/*---------------------------------------------------------------------------*/
+/* Whether the slot holds an address that was in the table at the start of
+ * the window */
+static int
+churn_in_start(const struct churn_slot *slot, int index)
+{
+  return slot->in_start && slot->generation == key_generation[index];
+}
+/*---------------------------------------------------------------------------*/
+static void
+churn_added(int index)
+{
+  if(churn_in_start(churn_slot(index, 0), index)) {
+    churn_kept++;
+  }
+  churn_count++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+churn_removed(int index)
+{
+  if(churn_in_start(churn_slot(index, 1), index)) {
+    churn_kept--;
+  }
+  churn_count--;
+}
+/*---------------------------------------------------------------------------*/
+static void
+churn_next_epoch(void)
+{
+  if(++churn_epoch == 0) {
+    /* Forget the stamps of the previous round of epochs */
+    memset(churn_slots, 0, sizeof(churn_slots));
+    churn_epoch = 1;
+  }
+}
+#endif /* NBR_TABLE_WITH_CHURN */
 /*---------------------------------------------------------------------------*/
 static void
 remove_key(nbr_table_key_t *key, bool do_free)
@@ -178,9 +308,18 @@ remove_key(nbr_table_key_t *key, bool do_free)
       }
     }
   }
+#if NBR_TABLE_WITH_CHURN
+  if(churn_table != NULL
+     && (used_map[index_from_key(key)] & (1 << churn_table->index)) != 0) {
+    churn_removed(index_from_key(key));
+  }
+#endif /* NBR_TABLE_WITH_CHURN */
   /* Empty used and locked map */
   used_map[index_from_key(key)] = 0;
   locked_map[index_from_key(key)] = 0;
+#if NBR_TABLE_WITH_HASH_INDEX
+  hash_index_remove(&key_index, key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, key);
   if(do_free) {
@@ -430,11 +569,23 @@ nbr_table_add_lladdr(const nbr_table_t *table, const linkaddr_t *lladdr,
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_WITH_HASH_INDEX
+    hash_index_add(&key_index, key);
+#endif /* NBR_TABLE_WITH_HASH_INDEX */
+#if NBR_TABLE_WITH_CHURN
+    key_generation[index]++;
+#endif /* NBR_TABLE_WITH_CHURN */
   }
 
   /* Get item in the current table */
   item = item_from_index(table, index);
 
+#if NBR_TABLE_WITH_CHURN
+  if(churn_is_tracked(table, index) && !nbr_get_bit(used_map, table, item)) {
+    churn_added(index);
+  }
+#endif /* NBR_TABLE_WITH_CHURN */
+
   /* Initialize item data and set "used" bit */
   memset(item, 0, table->item_size);
   nbr_set_bit(used_map, table, item, 1);
@@ -457,7 +608,14 @@ nbr_table_get_from_lladdr(const nbr_table_t *table, const linkaddr_t *lladdr)
 int
 nbr_table_remove(const nbr_table_t *table, const void *item)
 {
-  int ret = nbr_set_bit(used_map, table, item, 0);
+  int ret;
+#if NBR_TABLE_WITH_CHURN
+  if(churn_is_tracked(table, index_from_item(table, item))
+     && nbr_get_bit(used_map, table, item)) {
+    churn_removed(index_from_item(table, item));
+  }
+#endif /* NBR_TABLE_WITH_CHURN */
+  ret = nbr_set_bit(used_map, table, item, 0);
   nbr_set_bit(locked_map, table, item, 0);
   return ret;
 }
@@ -514,6 +672,49 @@ nbr_table_key_next(const nbr_table_key_t *key)
   return list_item_next(key);
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_WITH_CHURN
+/* Track the churn of a table. The first window starts from an empty set. */
+void
+nbr_table_churn_track(const nbr_table_t *table)
+{
+  int i;
+
+  churn_table = table;
+  churn_count = 0;
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    if((used_map[i] & (1 << table->index)) != 0) {
+      churn_count++;
+    }
+  }
+  nbr_table_churn_reset();
+}
+/*---------------------------------------------------------------------------*/
+/* Start a new window as if the table had been empty at its start */
+void
+nbr_table_churn_reset(void)
+{
+  churn_next_epoch();
+  churn_start_empty = 1;
+  churn_start_count = 0;
+  churn_kept = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* End the current window and start the next one. Returns the size of the
+ * symmetric difference and of the union between the neighbors in the table
+ * at the start of the window and now. */
+void
+nbr_table_churn_next_window(uint16_t *changed, uint16_t *total)
+{
+  *changed = churn_start_count + churn_count - 2 * churn_kept;
+  *total = churn_start_count + churn_count - churn_kept;
+
+  churn_next_epoch();
+  churn_start_empty = 0;
+  churn_start_count = churn_count;
+  churn_kept = churn_count;
+}
+#endif /* NBR_TABLE_WITH_CHURN */
+/*---------------------------------------------------------------------------*/
 #if DEBUG
 static void
 print_table()
@@ -51,6 +51,7 @@ typedef enum {
   NBR_TABLE_REASON_LINK_STATS,
   NBR_TABLE_REASON_IPV6_ND_AUTOFILL,
   NBR_TABLE_REASON_SIXTOP,
+  NBR_TABLE_REASON_TRUST,
 } nbr_table_reason_t;
 
 #define NBR_TABLE_MAX_NEIGHBORS NBR_TABLE_CONF_MAX_NEIGHBORS
@@ -67,6 +68,38 @@ typedef enum {
 #define NBR_TABLE_CAN_ACCEPT_NEW nbr_table_can_accept_new
 #endif /* NBR_TABLE_CONF_CAN_ACCEPT_NEW */
 
+/* Look neighbors up by link-layer address through a hash index instead of
+ * a linear scan of the key list (a lib/hash-index over the keys). Costs
+ * NBR_TABLE_HASH_SIZE 16-bit words. */
+#ifdef NBR_TABLE_CONF_WITH_HASH_INDEX
+#define NBR_TABLE_WITH_HASH_INDEX NBR_TABLE_CONF_WITH_HASH_INDEX
+#else /* NBR_TABLE_CONF_WITH_HASH_INDEX */
+#define NBR_TABLE_WITH_HASH_INDEX 0
+#endif /* NBR_TABLE_CONF_WITH_HASH_INDEX */
+
+/* Number of hash index slots, a power of two. Defaults to at least twice
+ * the number of neighbors to keep open-addressing probes short. */
+#ifdef NBR_TABLE_CONF_HASH_SIZE
+#define NBR_TABLE_HASH_SIZE NBR_TABLE_CONF_HASH_SIZE
+#else /* NBR_TABLE_CONF_HASH_SIZE */
+#define NBR_TABLE_HASH_SIZE \
+  (NBR_TABLE_MAX_NEIGHBORS <= 8 ? 16 : \
+   NBR_TABLE_MAX_NEIGHBORS <= 16 ? 32 : \
+   NBR_TABLE_MAX_NEIGHBORS <= 32 ? 64 : \
+   NBR_TABLE_MAX_NEIGHBORS <= 64 ? 128 : \
+   NBR_TABLE_MAX_NEIGHBORS <= 128 ? 256 : \
+   NBR_TABLE_MAX_NEIGHBORS <= 256 ? 512 : \
+   NBR_TABLE_MAX_NEIGHBORS <= 512 ? 1024 : 2048)
+#endif /* NBR_TABLE_CONF_HASH_SIZE */
+
+/* Count the churn of one table (see nbr_table_churn_track()) from its add
+ * and remove events. Costs four bytes per neighbor. */
+#ifdef NBR_TABLE_CONF_WITH_CHURN
+#define NBR_TABLE_WITH_CHURN NBR_TABLE_CONF_WITH_CHURN
+#else /* NBR_TABLE_CONF_WITH_CHURN */
+#define NBR_TABLE_WITH_CHURN 0
+#endif /* NBR_TABLE_CONF_WITH_CHURN */
+
 const linkaddr_t *NBR_TABLE_GC_GET_WORST(const linkaddr_t *lladdr1,
                                          const linkaddr_t *lladdr2);
 bool NBR_TABLE_CAN_ACCEPT_NEW(const linkaddr_t *new_linkaddr,
@@ -151,4 +184,14 @@ nbr_table_key_t *nbr_table_key_next(const nbr_table_key_t *key);
 int nbr_table_count_entries(void);
 
 /** @} */
+
+#if NBR_TABLE_WITH_CHURN
+/** \name Neighbor churn: neighbors that joined or left a table per window */
+/** @{ */
+void nbr_table_churn_track(const nbr_table_t *table);
+void nbr_table_churn_reset(void);
+void nbr_table_churn_next_window(uint16_t *changed, uint16_t *total);
+/** @} */
+#endif /* NBR_TABLE_WITH_CHURN */
+
 #endif /* NBR_TABLE_H_ */
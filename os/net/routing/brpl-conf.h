@@ -0,0 +1,242 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         Configuration of the BRPL objective function, common to
+ *         rpl-classic and rpl-lite.
+ */
+
+#ifndef BRPL_CONF_H_
+#define BRPL_CONF_H_
+
+#include "contiki.h"
+
+/* Objective code point of BRPL. It is defined here rather than with the
+ * other code points, as the test below may run before those are. */
+#ifndef RPL_OCP_BRPL
+#define RPL_OCP_BRPL 2
+#endif
+
+/* BRPL is enabled by selecting it as the OF of either RPL implementation */
+#ifndef BRPL_CONF_ENABLE
+#if (ROUTING_CONF_RPL_CLASSIC || ROUTING_CONF_RPL_LITE) && \
+  defined(RPL_CONF_OF_OCP) && (RPL_CONF_OF_OCP == RPL_OCP_BRPL)
+#define BRPL_CONF_ENABLE 1
+#else
+#define BRPL_CONF_ENABLE 0
+#endif
+#endif
+
+#ifndef BRPL_CONF_QUEUE_MAX
+#define BRPL_CONF_QUEUE_MAX 200
+#endif
+
+#ifndef BRPL_CONF_QUEUE_EWMA_ALPHA
+#define BRPL_CONF_QUEUE_EWMA_ALPHA 125 /* scale 0-1000 */
+#endif
+
+#ifndef BRPL_CONF_BETA_WINDOW_SECONDS
+#define BRPL_CONF_BETA_WINDOW_SECONDS 60
+#endif
+
+#ifndef BRPL_CONF_LIFO_QUEUE
+#define BRPL_CONF_LIFO_QUEUE 1
+#endif
+
+#ifndef BRPL_CONF_QUEUE_OPTION_CODE
+#define BRPL_CONF_QUEUE_OPTION_CODE 0xCE
+#endif
+
+/* Piggyback the local queue length on data packets, in a record that
+ * follows the RPL option in the hop-by-hop header, so that children do
+ * not have to wait for the next DIO. Only packets going down carry it,
+ * so this needs storing mode (rpl-classic only) */
+#ifndef BRPL_CONF_QUEUE_PIGGYBACK
+#define BRPL_CONF_QUEUE_PIGGYBACK 1
+#endif
+
+/* Hop-by-hop option type of the queue record: skipped by nodes that do
+ * not know it, may change en route (RFC 4727 experimental value) */
+#ifndef BRPL_CONF_QUEUE_HBH_OPTION
+#define BRPL_CONF_QUEUE_HBH_OPTION 0x3E
+#endif
+
+/* A child is sent a new queue record when the queue length moved by
+ * this many packets since the last record it was sent... */
+#ifndef BRPL_CONF_QUEUE_ADV_DELTA
+#define BRPL_CONF_QUEUE_ADV_DELTA 2
+#endif
+
+/* ...or when that record is older than this many seconds */
+#ifndef BRPL_CONF_QUEUE_ADV_REFRESH
+#define BRPL_CONF_QUEUE_ADV_REFRESH 10
+#endif
+
+/* A DIO is sent out of the Trickle schedule when the queue occupancy moves
+ * to another of this many levels, at most once per
+ * BRPL_CONF_QUEUE_ADV_MIN_INTERVAL seconds. 0 disables these DIOs.
+ * rpl-classic only. */
+#ifndef BRPL_CONF_QUEUE_ADV_LEVELS
+#define BRPL_CONF_QUEUE_ADV_LEVELS 4
+#endif
+
+#ifndef BRPL_CONF_QUEUE_ADV_MIN_INTERVAL
+#define BRPL_CONF_QUEUE_ADV_MIN_INTERVAL 5
+#endif
+
+/* Reset Trickle when the queue EWMA moves between the idle and the
+ * congested regime: theta (scaled by 1000) enters the congested regime at
+ * BRPL_CONF_TRICKLE_THETA_HIGH and leaves it at BRPL_CONF_TRICKLE_THETA_LOW.
+ * rpl-classic only. */
+#ifndef BRPL_CONF_TRICKLE_QUEUE_RESET
+#define BRPL_CONF_TRICKLE_QUEUE_RESET 1
+#endif
+
+#ifndef BRPL_CONF_TRICKLE_THETA_HIGH
+#define BRPL_CONF_TRICKLE_THETA_HIGH 600
+#endif
+
+#ifndef BRPL_CONF_TRICKLE_THETA_LOW
+#define BRPL_CONF_TRICKLE_THETA_LOW 200
+#endif
+
+/* Advertised neighbor queue lengths are blended into the rank-based
+ * estimate as they age, and ignored after this many seconds. 0 keeps them
+ * until the next advertisement. */
+#ifndef BRPL_CONF_QUEUE_MAX_AGE
+#define BRPL_CONF_QUEUE_MAX_AGE 120
+#endif
+
+/* Energy term of the weight: the radio duty cycle measured by energest is
+ * advertised in a DIO option next to the queue option, and parents whose
+ * duty cycle is above BRPL_CONF_ENERGY_THRESHOLD times the median of the
+ * candidates (scaled by 1000) see their weight raised by up to
+ * BRPL_CONF_ENERGY_WEIGHT. Needs ENERGEST_CONF_ON. */
+#ifndef BRPL_CONF_ENERGY
+#define BRPL_CONF_ENERGY 0
+#endif
+
+#ifndef BRPL_CONF_ENERGY_WEIGHT
+#define BRPL_CONF_ENERGY_WEIGHT 250
+#endif
+
+#ifndef BRPL_CONF_ENERGY_THRESHOLD
+#define BRPL_CONF_ENERGY_THRESHOLD 1500
+#endif
+
+/* The duty cycle is measured over windows of this many seconds */
+#ifndef BRPL_CONF_ENERGY_WINDOW
+#define BRPL_CONF_ENERGY_WINDOW 30
+#endif
+
+#ifndef BRPL_CONF_ENERGY_OPTION_CODE
+#define BRPL_CONF_ENERGY_OPTION_CODE 0xCF
+#endif
+
+/* Per-packet backpressure forwarding of upward traffic: each packet that
+ * follows the default route goes to the eligible parent with the best
+ * weight, instead of always to the preferred parent (rpl-classic only) */
+#ifndef BRPL_CONF_PER_PACKET_NEXT_HOP
+#define BRPL_CONF_PER_PACKET_NEXT_HOP 0
+#endif
+
+/* Only parents whose path cost is at most this much above the cost
+ * through the preferred parent are eligible as per-packet next hops */
+#ifndef BRPL_CONF_NEXT_HOP_RANK_SLACK
+#define BRPL_CONF_NEXT_HOP_RANK_SLACK 256
+#endif
+
+/* Trust-aware routing parameters */
+#ifndef BRPL_CONF_TRUST_ENABLE
+#define BRPL_CONF_TRUST_ENABLE 1
+#endif
+
+/* The trust engine (net/routing/trust-engine.h) feeds the BRPL parent
+ * selection. Its parameters are TRUST_ENGINE_CONF_* */
+#ifndef TRUST_ENGINE_CONF_ENABLED
+#define TRUST_ENGINE_CONF_ENABLED (BRPL_CONF_ENABLE && BRPL_CONF_TRUST_ENABLE)
+#endif
+
+#ifndef BRPL_CONF_TRUST_GAMMA
+#define BRPL_CONF_TRUST_GAMMA 2000 /* Penalty exponent (scaled by 1000, default 2.0) */
+#endif
+
+#ifndef BRPL_CONF_TRUST_LAMBDA_PENALTY
+#define BRPL_CONF_TRUST_LAMBDA_PENALTY 1000 /* Penalty weight in final metric (scaled by 1000) */
+#endif
+
+/* A challenger replaces the preferred parent only if its weight is lower
+ * by BRPL_CONF_SWITCH_MARGIN_ABS, or by BRPL_CONF_SWITCH_MARGIN_PPM per
+ * thousand of the weight of the preferred parent... */
+#ifndef BRPL_CONF_SWITCH_MARGIN_PPM
+#define BRPL_CONF_SWITCH_MARGIN_PPM 120
+#endif
+
+#ifndef BRPL_CONF_SWITCH_MARGIN_ABS
+#define BRPL_CONF_SWITCH_MARGIN_ABS 50
+#endif
+
+/* ...and at least this many seconds after the last parent switch */
+#ifndef BRPL_CONF_PARENT_DWELL_SECONDS
+#define BRPL_CONF_PARENT_DWELL_SECONDS 120
+#endif
+
+/* Parent switch cost model. A switch costs the DAO transmissions it
+ * triggers: ours and, in storing mode, those of our descendants, each
+ * over as many links as our hop count. Each DAO transmission takes
+ * BRPL_CONF_SWITCH_COST_MARGIN off the weight gain of a switch, up to
+ * BRPL_CONF_SWITCH_COST_MAX_MARGIN, before either switch margin applies,
+ * and raises the dwell by
+ * BRPL_CONF_SWITCH_COST_DWELL seconds, up to
+ * BRPL_CONF_PARENT_MAX_DWELL_SECONDS. 0 keeps the gates static. */
+#ifndef BRPL_CONF_SWITCH_COST
+#define BRPL_CONF_SWITCH_COST 1
+#endif
+
+#ifndef BRPL_CONF_SWITCH_COST_MARGIN
+#define BRPL_CONF_SWITCH_COST_MARGIN 2
+#endif
+
+#ifndef BRPL_CONF_SWITCH_COST_MAX_MARGIN
+#define BRPL_CONF_SWITCH_COST_MAX_MARGIN 250
+#endif
+
+#ifndef BRPL_CONF_SWITCH_COST_DWELL
+#define BRPL_CONF_SWITCH_COST_DWELL 1
+#endif
+
+#ifndef BRPL_CONF_PARENT_MAX_DWELL_SECONDS
+#define BRPL_CONF_PARENT_MAX_DWELL_SECONDS 600
+#endif
+
+/* Switch and DAO rates are averaged over windows of this many seconds */
+#ifndef BRPL_CONF_SWITCH_RATE_WINDOW
+#define BRPL_CONF_SWITCH_RATE_WINDOW 60
+#endif
+
+/* Coalesce the DAOs of quick parent switches: while the DAO of a switch
+ * is pending, a new switch postpones it to BRPL_CONF_DAO_BATCH_DELAY
+ * seconds later, but no more than BRPL_CONF_DAO_BATCH_MAX seconds after
+ * the first switch, and neither sends a No-Path DAO to the parent that
+ * never got the pending DAO nor bumps the DTSN again (rpl-classic only) */
+#ifndef BRPL_CONF_DAO_BATCH
+#define BRPL_CONF_DAO_BATCH 1
+#endif
+
+#ifndef BRPL_CONF_DAO_BATCH_DELAY
+#define BRPL_CONF_DAO_BATCH_DELAY 8
+#endif
+
+#ifndef BRPL_CONF_DAO_BATCH_MAX
+#define BRPL_CONF_DAO_BATCH_MAX 30
+#endif
+
+/* Scale of the weight of the preferred parent (1000 leaves it as is) */
+#ifndef BRPL_CONF_CURRENT_PARENT_PENALTY_SCALE
+#define BRPL_CONF_CURRENT_PARENT_PENALTY_SCALE 1000
+#endif
+
+#endif /* BRPL_CONF_H_ */
+
+/** @} */
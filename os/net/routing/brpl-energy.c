@@ -0,0 +1,92 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         Radio duty cycle of BRPL nodes, for the energy term of the weight.
+ */
+
+#include "contiki.h"
+#include "net/routing/brpl-energy.h"
+#include "sys/energest.h"
+
+#if BRPL_CONF_ENABLE && BRPL_CONF_ENERGY
+
+static uint16_t duty;
+#if ENERGEST_CONF_ON
+static uint16_t window_seconds;
+static uint64_t window_radio;
+static uint64_t window_total;
+#endif /* ENERGEST_CONF_ON */
+/*---------------------------------------------------------------------------*/
+void
+brpl_energy_tick(void)
+{
+#if ENERGEST_CONF_ON
+  uint64_t radio;
+  uint64_t total;
+  uint64_t sample;
+
+  if(++window_seconds < BRPL_CONF_ENERGY_WINDOW) {
+    return;
+  }
+  window_seconds = 0;
+
+  energest_flush();
+  radio = energest_type_time(ENERGEST_TYPE_TRANSMIT) +
+    energest_type_time(ENERGEST_TYPE_LISTEN);
+  total = ENERGEST_GET_TOTAL_TIME();
+  if(window_total != 0 && total > window_total) {
+    sample = ((radio - window_radio) * 1000) / (total - window_total);
+    if(sample > 1000) {
+      sample = 1000;
+    } else if(sample == 0) {
+      /* 0 stands for unknown */
+      sample = 1;
+    }
+    /* Average over windows, as the switch rates */
+    duty = duty == 0 ? (uint16_t)sample : (uint16_t)((3 * (uint32_t)duty + sample) / 4);
+  }
+  window_radio = radio;
+  window_total = total;
+#endif /* ENERGEST_CONF_ON */
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+brpl_energy_duty(void)
+{
+  return duty;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+brpl_energy_median(uint16_t *samples, uint8_t n)
+{
+  uint16_t v;
+  uint8_t known = 0;
+  uint8_t i;
+  uint8_t j;
+
+  /* Insertion sort of the known samples to the front */
+  for(i = 0; i < n; i++) {
+    if(samples[i] == 0) {
+      continue;
+    }
+    v = samples[i];
+    for(j = known; j > 0 && samples[j - 1] > v; j--) {
+      samples[j] = samples[j - 1];
+    }
+    samples[j] = v;
+    known++;
+  }
+  if(known == 0) {
+    return 0;
+  }
+  if(known & 1) {
+    return samples[known / 2];
+  }
+  return (uint16_t)(((uint32_t)samples[known / 2 - 1] + samples[known / 2]) / 2);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_ENERGY */
+
+/** @} */
@@ -0,0 +1,42 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         Radio duty cycle of BRPL nodes, for the energy term of the
+ *         weight. The local duty cycle is the share of time the radio
+ *         spent transmitting or listening, from the energest counters.
+ */
+
+#ifndef BRPL_ENERGY_H_
+#define BRPL_ENERGY_H_
+
+#include "contiki.h"
+#include "net/routing/brpl-conf.h"
+
+/* Largest number of duty cycles brpl_energy_median() looks at */
+#define BRPL_ENERGY_MAX_SAMPLES 16
+
+/**
+ * \brief Measures the duty cycle, called once per second
+ */
+void brpl_energy_tick(void);
+
+/**
+ * \brief The local radio duty cycle
+ * \return The duty cycle in per mille, at least 1, or 0 until the first
+ *         window is over or when energest is off
+ */
+uint16_t brpl_energy_duty(void);
+
+/**
+ * \brief Median of the known duty cycles among samples
+ * \param samples The duty cycles, 0 for unknown ones. Sorted in place.
+ * \param n The number of samples, at most BRPL_ENERGY_MAX_SAMPLES
+ * \return The median, 0 if none is known
+ */
+uint16_t brpl_energy_median(uint16_t *samples, uint8_t n);
+
+#endif /* BRPL_ENERGY_H_ */
+
+/** @} */
@@ -0,0 +1,107 @@
+#include "net/routing/brpl-queue.h"
+#include "net/mac/mac-backlog.h"
+
+static uint16_t queue_max = 0;
+
+void
+brpl_queue_init(uint16_t max_len)
+{
+  queue_max = max_len;
+  mac_backlog_set_lifo(BRPL_CONF_LIFO_QUEUE);
+}
+
+uint16_t
+brpl_queue_length(void)
+{
+  return mac_backlog_total()->packets;
+}
+
+uint16_t
+brpl_queue_max(void)
+{
+  /* The MAC cannot hold more than its own capacity, so normalize against
+   * that when it is smaller than the configured maximum. */
+  uint16_t capacity = mac_backlog_capacity();
+  if(capacity > 0 && (queue_max == 0 || capacity < queue_max)) {
+    return capacity;
+  }
+  return queue_max;
+}
+
+uint32_t
+brpl_queue_bytes(void)
+{
+  return mac_backlog_total()->bytes;
+}
+
+clock_time_t
+brpl_queue_sojourn(void)
+{
+  return mac_backlog_total()->sojourn_avg;
+}
+
+uint16_t
+brpl_queue_nbr_length(const linkaddr_t *addr)
+{
+  const struct mac_backlog *b = mac_backlog_nbr(addr);
+  return b != NULL ? b->packets : 0;
+}
+
+uint32_t
+brpl_queue_enqueued(void)
+{
+  return mac_backlog_enqueued_count();
+}
+
+uint32_t
+brpl_queue_dropped(void)
+{
+  return mac_backlog_dropped_count();
+}
+
+uint32_t
+brpl_queue_expired(void)
+{
+  return mac_backlog_expired_count();
+}
+
+void
+brpl_queue_record_write(uint8_t *buf)
+{
+  uint16_t queue = brpl_queue_length();
+  uint16_t queue_max = brpl_queue_max();
+  uint32_t age = ((uint32_t)brpl_queue_sojourn() * 1000) / CLOCK_SECOND;
+
+  if(age > 0xffff) {
+    age = 0xffff;
+  }
+  buf[0] = age >> 8;
+  buf[1] = age & 0xff;
+  buf[2] = queue >> 8;
+  buf[3] = queue & 0xff;
+  buf[4] = queue_max >> 8;
+  buf[5] = queue_max & 0xff;
+}
+
+void
+brpl_queue_record_read(const uint8_t *buf, struct brpl_queue_record *record)
+{
+  uint32_t age = ((uint16_t)buf[0] << 8) | buf[1];
+
+  record->age = (clock_time_t)((age * CLOCK_SECOND) / 1000);
+  record->queue = ((uint16_t)buf[2] << 8) | buf[3];
+  record->queue_max = ((uint16_t)buf[4] << 8) | buf[5];
+}
+
+uint8_t
+brpl_queue_level(void)
+{
+  uint16_t queue_max = brpl_queue_max();
+  uint32_t level;
+
+  if(queue_max == 0) {
+    return 0;
+  }
+  level = ((uint32_t)brpl_queue_length() * BRPL_CONF_QUEUE_ADV_LEVELS) / queue_max;
+  return level > BRPL_CONF_QUEUE_ADV_LEVELS ? BRPL_CONF_QUEUE_ADV_LEVELS : level;
+}
@@ -0,0 +1,60 @@
+#ifndef BRPL_QUEUE_H
+#define BRPL_QUEUE_H
+
+#include "net/routing/brpl-conf.h"
+#include "net/linkaddr.h"
+#include <stdint.h>
+
+/*
+ * BRPL view of the local transmit backlog. The packet counts are read
+ * from the MAC backlog accounting (net/mac/mac-backlog.h), which CSMA and
+ * TSCH feed from their per-neighbor queues, so that theta and the DIO
+ * queue option reflect what is really waiting for the radio.
+ *
+ * brpl_queue_init() also selects the MAC service order: newest packet
+ * first when BRPL_CONF_LIFO_QUEUE is set, with packets older than
+ * MAC_BACKLOG_CONF_LIFO_MAX_AGE dropped so that none starves.
+ */
+void brpl_queue_init(uint16_t max_len);
+
+uint16_t brpl_queue_length(void);
+uint16_t brpl_queue_max(void);
+uint32_t brpl_queue_bytes(void);
+clock_time_t brpl_queue_sojourn(void);
+uint16_t brpl_queue_nbr_length(const linkaddr_t *addr);
+uint32_t brpl_queue_enqueued(void);
+uint32_t brpl_queue_dropped(void);
+uint32_t brpl_queue_expired(void);
+
+/*
+ * Queue record carried in the BRPL_CONF_QUEUE_HBH_OPTION hop-by-hop option
+ * of data packets: the queue length and capacity of the node that
+ * transmits the packet, and the age of that sample when the packet reaches
+ * the next hop, estimated from the local queueing delay. Fields are in
+ * network byte order, the age is in milliseconds.
+ */
+#define BRPL_QUEUE_RECORD_LEN 6
+
+struct brpl_queue_record {
+  uint16_t queue;
+  uint16_t queue_max;
+  clock_time_t age;
+};
+
+void brpl_queue_record_write(uint8_t *buf);
+void brpl_queue_record_read(const uint8_t *buf,
+                            struct brpl_queue_record *record);
+
+/* Queue length last advertised by a neighbor, in a DIO or a record */
+struct brpl_nbr_queue {
+  uint16_t queue;
+  uint16_t queue_max;
+  uint8_t valid;
+  clock_time_t at;  /* When queue was sampled */
+  uint16_t duty;    /* Radio duty cycle (per mille), 0 if not advertised */
+};
+
+/* Occupancy level of the queue, from 0 to BRPL_CONF_QUEUE_ADV_LEVELS */
+uint8_t brpl_queue_level(void);
+
+#endif /* BRPL_QUEUE_H */
@@ -0,0 +1,315 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         BRPL weight computation, common to the rpl-classic and rpl-lite
+ *         objective functions.
+ */
+
+#include "contiki.h"
+#include "net/routing/brpl-weight.h"
+#include "lib/fixmath.h"
+
+#if BRPL_CONF_ENABLE
+
+struct brpl_switch_stats brpl_switch_stats;
+
+static linkaddr_t last_preferred_addr;
+static clock_time_t last_preferred_switch_at;
+
+/* Counters at the start of the current rate window */
+static uint32_t window_switches;
+static uint32_t window_daos;
+static uint16_t window_seconds;
+/*---------------------------------------------------------------------------*/
+uint16_t
+brpl_scale_ratio(uint32_t num, uint32_t den)
+{
+  uint32_t val;
+
+  if(den == 0) {
+    return 0;
+  }
+  val = (num * BRPL_SCALE) / den;
+  if(val > BRPL_SCALE) {
+    val = BRPL_SCALE;
+  }
+  return (uint16_t)val;
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+brpl_weight(int32_t theta, uint16_t p_norm, int32_t dq_norm)
+{
+  return (theta * (int32_t)p_norm - (BRPL_SCALE - theta) * dq_norm) / BRPL_SCALE;
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+brpl_energy_term(uint16_t duty, uint16_t median)
+{
+  uint32_t ratio;
+  uint32_t excess;
+
+  if(duty == 0 || median == 0) {
+    return 0;
+  }
+  ratio = ((uint32_t)duty * 1000) / median;
+  if(ratio <= BRPL_CONF_ENERGY_THRESHOLD) {
+    return 0;
+  }
+  excess = ratio - BRPL_CONF_ENERGY_THRESHOLD;
+  if(excess > BRPL_SCALE) {
+    excess = BRPL_SCALE;
+  }
+  return (int32_t)((BRPL_CONF_ENERGY_WEIGHT * excess) / BRPL_SCALE);
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+brpl_dq_norm(uint16_t qx, int32_t qy, uint16_t qmax)
+{
+  if(qmax == 0) {
+    return 0;
+  }
+  return (((int32_t)qx - qy) * BRPL_SCALE) / (int32_t)qmax;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+brpl_queue_ewma(uint16_t q_avg, uint16_t qx)
+{
+  uint16_t lambda = BRPL_CONF_QUEUE_EWMA_ALPHA;
+
+  return (uint16_t)(((BRPL_SCALE - lambda) * q_avg + lambda * qx) / BRPL_SCALE);
+}
+/*---------------------------------------------------------------------------*/
+/* Queue length of a neighbor guessed from the local one, scaled by rank */
+static uint16_t
+nbr_queue_estimate(uint16_t rank, uint16_t own_rank, uint16_t qx, uint16_t qmax)
+{
+  uint32_t est;
+
+  if(own_rank == 0) {
+    return qx;
+  }
+  est = ((uint32_t)qx * rank) / own_rank;
+  if(est > qmax) {
+    est = qmax;
+  }
+  return (uint16_t)est;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+brpl_nbr_queue_length(const struct brpl_nbr_queue *q, uint16_t rank,
+                      uint16_t own_rank, uint16_t qx, uint16_t qmax)
+{
+  clock_time_t max_age = (clock_time_t)BRPL_CONF_QUEUE_MAX_AGE * CLOCK_SECOND;
+  clock_time_t age;
+  uint32_t staleness;
+
+  if(!q->valid || q->queue_max == 0) {
+    return nbr_queue_estimate(rank, own_rank, qx, qmax);
+  }
+  if(max_age == 0) {
+    return q->queue;
+  }
+  age = clock_time() - q->at;
+  if(age >= max_age) {
+    return nbr_queue_estimate(rank, own_rank, qx, qmax);
+  }
+  staleness = brpl_scale_ratio(age, max_age);
+  return (uint16_t)(((BRPL_SCALE - staleness) * q->queue +
+                     staleness * nbr_queue_estimate(rank, own_rank, qx, qmax)) /
+                    BRPL_SCALE);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+brpl_trust_clamped(const struct trust_decision *d)
+{
+  return d->trust < TRUST_MIN ? TRUST_MIN : d->trust;
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+brpl_trust_penalty(int32_t weight, const struct trust_decision *d,
+                   uint16_t trust, int preferred)
+{
+  /* weight * T^gamma / (1 + lambda * (1 - T)^gamma): a trusted parent
+   * (T=1) keeps its weight. gamma may be fractional, so the powers use
+   * the fixed-point kernels. */
+  const fix_t gamma = FIX_FROM_SCALED(TRUST_PENALTY_GAMMA, 1000);
+  const fix_t lambda = FIX_FROM_SCALED(BRPL_CONF_TRUST_LAMBDA_PENALTY, 1000);
+  fix_t num = fix_pow(FIX_FROM_SCALED(trust, TRUST_SCALE), gamma);
+  fix_t den = FIX_ONE +
+    fix_mul(lambda, fix_pow(FIX_FROM_SCALED(TRUST_SCALE - trust, TRUST_SCALE),
+                            gamma));
+  int32_t base_weight = weight;
+  int32_t merged_weight;
+  uint16_t vscale;
+  uint16_t pscale;
+
+  if(den > 0) {
+    base_weight = (int32_t)(((int64_t)weight * num) / den);
+  }
+
+  /* Apply extra cost boost only when validation model marks a parent
+   * as suspect/penalized. Default scale=1000 keeps legacy behavior. */
+  vscale = d->validation_scale;
+  if(vscale == 0) {
+    vscale = 1000;
+  }
+  merged_weight = (int32_t)(((int64_t)base_weight * vscale) / 1000);
+
+  pscale = d->penalty_scale;
+  if(pscale == 0) {
+    pscale = BRPL_SCALE;
+  }
+  merged_weight = (int32_t)(((int64_t)merged_weight * pscale) / BRPL_SCALE);
+
+  /* Keep current parent slightly sticky unless trust engine enables escape. */
+  if(preferred && !(d->flags & TRUST_DECISION_ESCAPE)) {
+    merged_weight = (int32_t)(((int64_t)merged_weight *
+                               BRPL_CONF_CURRENT_PARENT_PENALTY_SCALE) / BRPL_SCALE);
+  }
+  return merged_weight;
+}
+/*---------------------------------------------------------------------------*/
+void
+brpl_track_preferred(const linkaddr_t *addr)
+{
+  clock_time_t now = clock_time();
+
+  if(addr == NULL) {
+    addr = &linkaddr_null;
+  }
+
+  if(last_preferred_switch_at == 0) {
+    last_preferred_switch_at = now;
+    linkaddr_copy(&last_preferred_addr, addr);
+    return;
+  }
+
+  if(!linkaddr_cmp(addr, &last_preferred_addr)) {
+    linkaddr_copy(&last_preferred_addr, addr);
+    last_preferred_switch_at = now;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+brpl_switch_context(uint16_t descendants, uint16_t hops)
+{
+  brpl_switch_stats.cost = ((uint32_t)descendants + 1) * (hops > 0 ? hops : 1);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+rate_average(uint16_t rate, uint32_t count)
+{
+  uint32_t sample = count * 3600 / BRPL_CONF_SWITCH_RATE_WINDOW;
+
+  if(sample > 0xffff) {
+    sample = 0xffff;
+  }
+  return (uint16_t)((3 * (uint32_t)rate + sample) / 4);
+}
+/*---------------------------------------------------------------------------*/
+void
+brpl_switch_stats_tick(void)
+{
+  if(++window_seconds < BRPL_CONF_SWITCH_RATE_WINDOW) {
+    return;
+  }
+  brpl_switch_stats.switch_rate = rate_average(brpl_switch_stats.switch_rate,
+                                               brpl_switch_stats.switches - window_switches);
+  brpl_switch_stats.dao_rate = rate_average(brpl_switch_stats.dao_rate,
+                                            brpl_switch_stats.daos - window_daos);
+  window_switches = brpl_switch_stats.switches;
+  window_daos = brpl_switch_stats.daos;
+  window_seconds = 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Extra margin and dwell that the DAO cost of a switch calls for */
+static uint32_t
+cost_margin(void)
+{
+#if BRPL_CONF_SWITCH_COST
+  uint32_t margin = brpl_switch_stats.cost * BRPL_CONF_SWITCH_COST_MARGIN;
+
+  return margin < BRPL_CONF_SWITCH_COST_MAX_MARGIN ?
+         margin : BRPL_CONF_SWITCH_COST_MAX_MARGIN;
+#else /* BRPL_CONF_SWITCH_COST */
+  return 0;
+#endif /* BRPL_CONF_SWITCH_COST */
+}
+/*---------------------------------------------------------------------------*/
+static clock_time_t
+dwell_time(void)
+{
+  uint32_t seconds = BRPL_CONF_PARENT_DWELL_SECONDS;
+
+#if BRPL_CONF_SWITCH_COST
+  if(seconds > 0) {
+    seconds += brpl_switch_stats.cost * BRPL_CONF_SWITCH_COST_DWELL;
+    if(seconds > BRPL_CONF_PARENT_MAX_DWELL_SECONDS) {
+      seconds = MAX(BRPL_CONF_PARENT_DWELL_SECONDS,
+                    BRPL_CONF_PARENT_MAX_DWELL_SECONDS);
+    }
+  }
+#endif /* BRPL_CONF_SWITCH_COST */
+  return (clock_time_t)seconds * CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static int
+dwell_blocks_switch(int preferred_allowed)
+{
+  clock_time_t dwell = dwell_time();
+
+  if(dwell == 0 || !preferred_allowed || last_preferred_switch_at == 0) {
+    return 0;
+  }
+  return (clock_time() - last_preferred_switch_at) < dwell;
+}
+/*---------------------------------------------------------------------------*/
+static int
+switch_margin_allows(int32_t preferred_w, int32_t challenger_w,
+                     uint16_t extra_margin_abs)
+{
+  int32_t gain;
+  int32_t base;
+
+  if(challenger_w >= preferred_w) {
+    return 0;
+  }
+
+  /* What the switch costs comes off the gain, against both margins */
+  gain = preferred_w - challenger_w - (int32_t)cost_margin();
+  if(gain <= 0) {
+    return 0;
+  }
+  if(gain >= BRPL_CONF_SWITCH_MARGIN_ABS + (int32_t)extra_margin_abs) {
+    return 1;
+  }
+
+  base = preferred_w > 0 ? preferred_w : 1;
+  return (int64_t)gain * BRPL_SCALE >= (int64_t)base * BRPL_CONF_SWITCH_MARGIN_PPM;
+}
+/*---------------------------------------------------------------------------*/
+int
+brpl_switch_allowed(int32_t pref_weight, uint8_t pref_flags,
+                    int pref_allowed, int32_t weight, uint8_t flags,
+                    uint16_t margin, struct brpl_switch_gate *gate)
+{
+  /* Switch policy of the trust engine: the challenger may require an
+   * extra margin or be barred, and leaving the preferred parent may
+   * bypass the dwell timer */
+  struct brpl_switch_gate g;
+
+  g.block_switch = (flags & TRUST_DECISION_NO_SWITCH_TO) ? 1 : 0;
+  g.bypass_dwell = (pref_flags & TRUST_DECISION_BYPASS_DWELL) ? 1 : 0;
+  g.dwell_blocked = g.bypass_dwell ? 0 : dwell_blocks_switch(pref_allowed);
+  g.margin_ok = switch_margin_allows(pref_weight, weight, margin);
+  if(gate != NULL) {
+    *gate = g;
+  }
+  return !g.block_switch && !g.dwell_blocked && g.margin_ok;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* BRPL_CONF_ENABLE */
+
+/** @} */
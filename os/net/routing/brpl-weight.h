@@ -0,0 +1,176 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         BRPL weight computation, common to the rpl-classic and rpl-lite
+ *         objective functions.
+ *
+ *         The weight of a candidate parent blends its normalized path cost
+ *         and the normalized queue differential towards it, with theta, the
+ *         local backlog, as the blending factor:
+ *
+ *         weight = theta * p_norm - (1 - theta) * dq_norm
+ *
+ *         Lower is better. With BRPL_CONF_ENERGY, parents whose radio duty
+ *         cycle is well above the median of the candidates pay an energy
+ *         term on top of it. The trust engine then scales the weight of the
+ *         parents it distrusts, and a switch away from the preferred parent
+ *         must pass the hysteresis gate of brpl_switch_allowed(), whose
+ *         margin and dwell grow with the DAO cost of the switch.
+ */
+
+#ifndef BRPL_WEIGHT_H_
+#define BRPL_WEIGHT_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "net/routing/brpl-conf.h"
+#include "net/routing/brpl-queue.h"
+#include "net/routing/trust-engine.h"
+
+#define BRPL_SCALE 1000
+
+#ifndef TRUST_SCALE
+#define TRUST_SCALE 1000
+#endif
+#ifndef TRUST_MIN
+#define TRUST_MIN 300
+#endif
+/* Penalty exponent, scaled by 1000 */
+#ifndef TRUST_PENALTY_GAMMA
+#define TRUST_PENALTY_GAMMA BRPL_CONF_TRUST_GAMMA
+#endif
+#ifndef TRUST_LAMBDA
+#define TRUST_LAMBDA 0
+#endif
+#ifdef TRUST_LAMBDA_CONF
+#undef TRUST_LAMBDA
+#define TRUST_LAMBDA TRUST_LAMBDA_CONF
+#endif
+#ifdef TRUST_PENALTY_GAMMA_CONF
+/* Legacy integer exponent */
+#undef TRUST_PENALTY_GAMMA
+#define TRUST_PENALTY_GAMMA (TRUST_PENALTY_GAMMA_CONF * 1000)
+#endif
+
+/* Outcome of the hysteresis gate, for telemetry */
+struct brpl_switch_gate {
+  uint8_t dwell_blocked;
+  uint8_t margin_ok;
+  uint8_t block_switch;
+  uint8_t bypass_dwell;
+};
+
+/* Parent switch and DAO counters, rates are per hour */
+struct brpl_switch_stats {
+  uint32_t switches;      /* Preferred parent changes */
+  uint32_t daos;          /* DAOs sent, No-Path DAOs included */
+  uint32_t daos_batched;  /* DAOs saved by batching */
+  uint32_t cost;          /* DAO transmissions a switch would cause now */
+  uint16_t switch_rate;
+  uint16_t dao_rate;
+};
+
+extern struct brpl_switch_stats brpl_switch_stats;
+
+/**
+ * \brief Ratio num / den scaled by BRPL_SCALE, capped at BRPL_SCALE
+ */
+uint16_t brpl_scale_ratio(uint32_t num, uint32_t den);
+
+/**
+ * \brief Backpressure weight, lower is better
+ * \param theta The local backlog, scaled by BRPL_SCALE
+ * \param p_norm The path cost, normalized by the largest among candidates
+ * \param dq_norm The queue differential, normalized by the queue capacity
+ */
+int32_t brpl_weight(int32_t theta, uint16_t p_norm, int32_t dq_norm);
+
+/**
+ * \brief Energy term added to the weight of a parent
+ * \param duty The radio duty cycle the parent advertised, 0 if unknown
+ * \param median The median duty cycle of the candidates, 0 if unknown
+ *
+ * Zero up to BRPL_CONF_ENERGY_THRESHOLD times the median, then growing
+ * with the excess ratio up to BRPL_CONF_ENERGY_WEIGHT.
+ */
+int32_t brpl_energy_term(uint16_t duty, uint16_t median);
+
+/**
+ * \brief Queue differential qx - qy, scaled by BRPL_SCALE / qmax
+ */
+int32_t brpl_dq_norm(uint16_t qx, int32_t qy, uint16_t qmax);
+
+/**
+ * \brief Advances the queue EWMA of theta by one sample
+ */
+uint16_t brpl_queue_ewma(uint16_t q_avg, uint16_t qx);
+
+/**
+ * \brief Queue length of a neighbor
+ * \param q What the neighbor advertised
+ * \param rank The rank of the neighbor
+ * \param own_rank Our own rank
+ * \param qx The local queue length
+ * \param qmax The local queue capacity
+ *
+ * The advertised queue length is used while it is fresh, moving to an
+ * estimate scaled from the local one by rank as it ages.
+ */
+uint16_t brpl_nbr_queue_length(const struct brpl_nbr_queue *q, uint16_t rank,
+                               uint16_t own_rank, uint16_t qx, uint16_t qmax);
+
+/**
+ * \brief Trust of a decision, raised to TRUST_MIN
+ */
+uint16_t brpl_trust_clamped(const struct trust_decision *d);
+
+/**
+ * \brief Applies the trust penalty of the trust engine to a weight
+ * \param weight The weight before penalty
+ * \param d The decision of the trust engine on the parent
+ * \param trust The trust of the parent, from brpl_trust_clamped()
+ * \param preferred Whether the parent is the preferred parent
+ */
+int32_t brpl_trust_penalty(int32_t weight, const struct trust_decision *d,
+                           uint16_t trust, int preferred);
+
+/**
+ * \brief Records the preferred parent, to time the dwell since the last
+ *        switch. Called at the start of each selection round.
+ * \param addr The link-layer address of the preferred parent, NULL if none
+ */
+void brpl_track_preferred(const linkaddr_t *addr);
+
+/**
+ * \brief Updates the cost of a parent switch. Called at the start of each
+ *        selection round.
+ * \param descendants The nodes that re-send their DAO after we switch
+ * \param hops Our hop count to the root
+ */
+void brpl_switch_context(uint16_t descendants, uint16_t hops);
+
+/**
+ * \brief Averages the switch and DAO rates, called once per second
+ */
+void brpl_switch_stats_tick(void);
+
+/**
+ * \brief Hysteresis gate for leaving the preferred parent for a challenger
+ * \param pref_weight The weight of the preferred parent
+ * \param pref_flags The TRUST_DECISION_* flags of the preferred parent
+ * \param pref_allowed Whether the preferred parent is allowed by trust
+ * \param weight The weight of the challenger
+ * \param flags The TRUST_DECISION_* flags of the challenger
+ * \param margin The extra margin the trust engine requires of the challenger
+ * \param gate Filled with the details of the decision, may be NULL
+ * \return 1 if the switch is allowed, 0 if the preferred parent is kept
+ */
+int brpl_switch_allowed(int32_t pref_weight, uint8_t pref_flags,
+                        int pref_allowed, int32_t weight, uint8_t flags,
+                        uint16_t margin, struct brpl_switch_gate *gate);
+
+#endif /* BRPL_WEIGHT_H_ */
+
+/** @} */
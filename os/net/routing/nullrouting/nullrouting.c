@@ -137,6 +137,12 @@ ext_header_srh_get_next_hop(uip_ipaddr_t *ipaddr)
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+static int
+default_route_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 static void
 link_callback(const linkaddr_t *addr, int status, int numtx)
 {
@@ -176,6 +182,7 @@ const struct routing_driver nullrouting_driver = {
   ext_header_hbh_update,
   ext_header_srh_update,
   ext_header_srh_get_next_hop,
+  default_route_get_next_hop,
   link_callback,
   neighbor_state_changed,
   drop_route,
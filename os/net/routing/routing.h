@@ -160,6 +160,15 @@ struct routing_driver {
    * \return 1 if a next hop was found, 0 otherwise
   */
   int (* ext_header_srh_get_next_hop)(uip_ipaddr_t *ipaddr);
+  /**
+   * Select the next hop of the current uIP packet when it has no route
+   * and would follow the default route. Lets the routing protocol spread
+   * upward traffic over several parents on a per-packet basis.
+   *
+   * \param ipaddr A pointer to the address where to store the next hop.
+   * \return 1 if a next hop was selected, 0 to use the default route
+  */
+  int (* default_route_get_next_hop)(uip_ipaddr_t *ipaddr);
   /**
    * Called by lower layers after every packet transmission
    *
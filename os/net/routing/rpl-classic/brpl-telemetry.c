@@ -0,0 +1,139 @@
+#include "contiki.h"
+#include "net/linkaddr.h"
+#include "net/routing/rpl-classic/brpl-telemetry.h"
+#include "lib/ringbufindex.h"
+
+#include <stdio.h>
+
+#if BRPL_TELEMETRY_ENABLED
+
+#if (BRPL_TELEMETRY_RING_SIZE & (BRPL_TELEMETRY_RING_SIZE - 1)) != 0 || \
+  BRPL_TELEMETRY_RING_SIZE > 128
+#error "BRPL_TELEMETRY_RING_SIZE must be a power of two of at most 128"
+#endif
+
+struct telemetry_record {
+  clock_time_t timestamp;
+  uint8_t type;
+  uint8_t nfields;
+  int32_t fields[BRPL_TELEMETRY_MAX_FIELDS];
+};
+
+/* Header (type, nfields, timestamp) and fields, in hex, plus the
+ * terminating NUL */
+#define RECORD_HEX_MAX (2 * (6 + 4 * BRPL_TELEMETRY_MAX_FIELDS) + 1)
+
+static struct telemetry_record ring[BRPL_TELEMETRY_RING_SIZE];
+static struct ringbufindex ring_index;
+static int16_t reserved = -1;
+static uint32_t dropped;
+
+PROCESS(brpl_telemetry_process, "BRPL telemetry");
+/*---------------------------------------------------------------------------*/
+void
+brpl_telemetry_init(void)
+{
+  ringbufindex_init(&ring_index, BRPL_TELEMETRY_RING_SIZE);
+  reserved = -1;
+  dropped = 0;
+  process_start(&brpl_telemetry_process, NULL);
+}
+/*---------------------------------------------------------------------------*/
+int32_t *
+brpl_telemetry_begin(uint8_t type, uint8_t nfields)
+{
+  struct telemetry_record *r;
+
+  reserved = ringbufindex_peek_put(&ring_index);
+  if(reserved < 0) {
+    dropped++;
+    return NULL;
+  }
+  r = &ring[reserved];
+  r->timestamp = clock_time();
+  r->type = type;
+  r->nfields = nfields;
+  return r->fields;
+}
+/*---------------------------------------------------------------------------*/
+void
+brpl_telemetry_commit(void)
+{
+  if(reserved >= 0) {
+    ringbufindex_put(&ring_index);
+    reserved = -1;
+    process_poll(&brpl_telemetry_process);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static char *
+put_hex(char *p, uint32_t value, uint8_t bytes)
+{
+  static const char digits[] = "0123456789abcdef";
+
+  while(bytes-- > 0) {
+    *p++ = digits[(value >> 4) & 0xf];
+    *p++ = digits[value & 0xf];
+    value >>= 8;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_record(uint8_t type, uint8_t nfields, uint32_t timestamp,
+             const int32_t *fields)
+{
+  char line[RECORD_HEX_MAX];
+  char *p = line;
+  uint8_t i;
+
+  p = put_hex(p, type, 1);
+  p = put_hex(p, nfields, 1);
+  p = put_hex(p, timestamp, 4);
+  for(i = 0; i < nfields; i++) {
+    p = put_hex(p, (uint32_t)fields[i], 4);
+  }
+  *p = '\0';
+  printf("TLM,%u,%s\n",
+         (unsigned)linkaddr_node_addr.u8[LINKADDR_SIZE - 1], line);
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(brpl_telemetry_process, ev, data)
+{
+  static uint8_t count;
+  int16_t index;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_POLL);
+
+    while(!ringbufindex_empty(&ring_index)) {
+      /* A poll runs ahead of all queued events: go behind them with an
+       * event of our own before each batch. If the event queue is full,
+       * the next commit polls us again. */
+      process_post(PROCESS_CURRENT(), PROCESS_EVENT_CONTINUE, NULL);
+      PROCESS_YIELD_UNTIL(ev == PROCESS_EVENT_CONTINUE ||
+                          ev == PROCESS_EVENT_POLL);
+
+      for(count = 0; count < BRPL_TELEMETRY_DRAIN_BATCH &&
+          (index = ringbufindex_peek_get(&ring_index)) >= 0; count++) {
+        struct telemetry_record *r = &ring[index];
+        write_record(r->type, r->nfields > BRPL_TELEMETRY_MAX_FIELDS ?
+                     BRPL_TELEMETRY_MAX_FIELDS : r->nfields,
+                     (uint32_t)r->timestamp, r->fields);
+        ringbufindex_get(&ring_index);
+      }
+    }
+
+    if(dropped > 0) {
+      int32_t count_field = (int32_t)dropped;
+      dropped = 0;
+      write_record(BRPL_TLM_DROPPED, 1, (uint32_t)clock_time(), &count_field);
+    }
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#endif /* BRPL_TELEMETRY_ENABLED */
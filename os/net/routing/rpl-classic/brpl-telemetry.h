@@ -0,0 +1,99 @@
+#ifndef BRPL_TELEMETRY_H
+#define BRPL_TELEMETRY_H
+
+#include "contiki.h"
+#include <stdint.h>
+
+/*
+ * Binary event telemetry for the RPL/BRPL CSV traces.
+ *
+ * Enabled with CSV_VERBOSE_LOGGING. The parent-selection hot path only
+ * stores a timestamp, an event type and a few 32-bit fields into a
+ * fixed-size ring, so that tracing does not distort the timing it
+ * measures. A low-priority process drains the ring and writes each
+ * record on its own line as
+ *
+ *   TLM,<node id>,<record in hex>
+ *
+ * where a record is the event type (1 byte), the number of fields
+ * (1 byte), clock_time() (4 bytes) and the fields (4 bytes each), all
+ * little-endian. tools/brpl-telemetry/brpl-telemetry-decode.py turns
+ * these lines back into the CSV,... lines the nodes used to print.
+ *
+ * Producers and the drain process run in process context: the ring is
+ * single-producer, single-consumer and needs no locking. When it is
+ * full, new events are dropped and a BRPL_TLM_DROPPED record reports
+ * how many.
+ */
+
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+#define BRPL_TELEMETRY_ENABLED 1
+#else
+#define BRPL_TELEMETRY_ENABLED 0
+#endif
+
+/* Number of records in the ring, a power of two of at most 128 */
+#ifdef BRPL_TELEMETRY_CONF_RING_SIZE
+#define BRPL_TELEMETRY_RING_SIZE BRPL_TELEMETRY_CONF_RING_SIZE
+#else
+#define BRPL_TELEMETRY_RING_SIZE 32
+#endif
+
+/* Records written per drain process iteration, before yielding */
+#ifdef BRPL_TELEMETRY_CONF_DRAIN_BATCH
+#define BRPL_TELEMETRY_DRAIN_BATCH BRPL_TELEMETRY_CONF_DRAIN_BATCH
+#else
+#define BRPL_TELEMETRY_DRAIN_BATCH 4
+#endif
+
+#define BRPL_TELEMETRY_MAX_FIELDS 16
+
+/* Event types. The decoder relies on these values, only append. */
+enum {
+  BRPL_TLM_DROPPED = 0,   /* count */
+  BRPL_TLM_PARAMS,        /* lambda, gamma (x1000), trust_min */
+  BRPL_TLM_STATE,         /* qx, qmax, q_avg, rho, theta, pmax */
+  BRPL_TLM_METRIC,        /* parent, link_metric, rank, p_tilde */
+  BRPL_TLM_WEIGHT,        /* parent, qx, qy, qmax, p_tilde, p_norm, dq_norm,
+                             theta, weight */
+  BRPL_TLM_TRUST,         /* id, trust, trust_min, gamma (x1000), lambda,
+                             raw_weight, weight */
+  BRPL_TLM_SWITCH_GATE,   /* pref_id, pref_weight, best_id, best_weight,
+                             extra_margin, dwell_blocked, margin_ok,
+                             block_switch, bypass_dwell, reason */
+  BRPL_TLM_BEST,          /* id1, weight1, id2, weight2, best_id */
+  BRPL_TLM_DWELL_GATE,    /* pref_id */
+  BRPL_TLM_DELAY,         /* lifo, expired, delay histogram buckets */
+  BRPL_TLM_RPL_PARENT,    /* new_id, old_id, new_rank */
+  BRPL_TLM_DIO,           /* parent, rank, queue, queue_max, queue_valid */
+  BRPL_TLM_TRICKLE,       /* congested, theta, dio_intcurrent, sent,
+                             suppressed, unsolicited, queue_resets */
+  BRPL_TLM_SWITCH,        /* switches, daos, daos_batched, switch_rate,
+                             dao_rate, cost */
+  BRPL_TLM_ENERGY,        /* parent, duty, duty_median, energy_term */
+};
+
+#if BRPL_TELEMETRY_ENABLED
+/**
+ * \brief Start the drain process, called once at RPL init
+ */
+void brpl_telemetry_init(void);
+
+/**
+ * \brief Reserve the next record of the ring
+ * \param type The event type
+ * \param nfields The number of fields, at most BRPL_TELEMETRY_MAX_FIELDS
+ * \return The fields of the record to fill in, NULL if the ring is full
+ *
+ * The record is published by brpl_telemetry_commit(), which must follow
+ * before any other event is recorded.
+ */
+int32_t *brpl_telemetry_begin(uint8_t type, uint8_t nfields);
+
+/**
+ * \brief Publish the record reserved by brpl_telemetry_begin()
+ */
+void brpl_telemetry_commit(void);
+#endif /* BRPL_TELEMETRY_ENABLED */
+
+#endif /* BRPL_TELEMETRY_H */
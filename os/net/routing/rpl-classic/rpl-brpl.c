@@ -2,8 +2,12 @@
 #include "net/routing/rpl-classic/rpl.h"
 #include "net/routing/rpl-classic/rpl-conf.h"
 #include "net/routing/rpl-classic/rpl-private.h"
-#include "net/routing/rpl-classic/brpl-queue.h"
-#include "net/routing/rpl-classic/brpl-switch-policy.h"
+#include "net/routing/brpl-queue.h"
+#include "net/routing/brpl-weight.h"
+#include "net/routing/brpl-energy.h"
+#include "net/mac/mac-backlog.h"
+#include "net/routing/rpl-classic/brpl-telemetry.h"
+#include "net/routing/trust-engine.h"
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-ds6-nbr.h"
 #include "net/nbr-table.h"
@@ -12,746 +16,783 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdint.h>
-#include <math.h>
-
-#define BRPL_SCALE 1000
 
 #if BRPL_CONF_ENABLE
 
+#if !NBR_TABLE_WITH_CHURN
+#error "BRPL needs NBR_TABLE_CONF_WITH_CHURN to measure beta"
+#endif
+
 extern rpl_of_t rpl_mrhof;
+extern rpl_of_t rpl_brpl;
 NBR_TABLE_DECLARE(rpl_parents);
 
-/* Forward declarations */
-static uint16_t brpl_parent_id(rpl_parent_t *p);
-static uint16_t brpl_self_id(void);
-
-#ifndef BRPL_CONF_SWITCH_MARGIN_PPM
-#define BRPL_CONF_SWITCH_MARGIN_PPM 120
-#endif
-#ifndef BRPL_CONF_SWITCH_MARGIN_ABS
-#define BRPL_CONF_SWITCH_MARGIN_ABS 50
-#endif
-#ifndef BRPL_CONF_PARENT_DWELL_SECONDS
-#define BRPL_CONF_PARENT_DWELL_SECONDS 120
-#endif
-
-#ifndef TRUST_SCALE
-#define TRUST_SCALE 1000
-#endif
-#ifndef TRUST_MIN
-#define TRUST_MIN 300
-#endif
-#ifndef TRUST_PENALTY_GAMMA
-#define TRUST_PENALTY_GAMMA 1
-#endif
-#ifndef TRUST_LAMBDA
-#define TRUST_LAMBDA 0
-#endif
-#ifndef BRPL_CONF_CURRENT_PARENT_PENALTY_SCALE
-#define BRPL_CONF_CURRENT_PARENT_PENALTY_SCALE 1000
-#endif
-#ifdef TRUST_LAMBDA_CONF
-#undef TRUST_LAMBDA
-#define TRUST_LAMBDA TRUST_LAMBDA_CONF
-#endif
-#ifdef TRUST_PENALTY_GAMMA_CONF
-#undef TRUST_PENALTY_GAMMA
-#define TRUST_PENALTY_GAMMA TRUST_PENALTY_GAMMA_CONF
-#endif
+/* Legacy key: last byte of a link-layer address, 0xFFFF for NULL */
+static uint16_t
+brpl_lladdr_id(const linkaddr_t *addr)
+{
+  if(addr == NULL) {
+    return 0xFFFF;
+  }
+  return (uint16_t)addr->u8[LINKADDR_SIZE - 1];
+}
 
-/*---------------------------------------------------------------------------*/
-/* Trust computation functions */
-/*---------------------------------------------------------------------------*/
-
-/* Compute Sinkhole Advertisement Trust (based on rank plausibility) */
-__attribute__((unused)) static uint16_t
-brpl_compute_trust_sink_adv(rpl_parent_t *p, rpl_dag_t *dag)
-{
-#if BRPL_CONF_TRUST_ENABLE
-  if(p == NULL || dag == NULL) {
-    return TRUST_SCALE;
-  }
-  
-  /* Compute rank delta: R_j + MIN_HOPRANKINC - R_i */
-  int32_t rank_delta = (int32_t)p->rank + RPL_MIN_HOPRANKINC - (int32_t)dag->rank;
-  
-  /* Compute anomaly score: max(0, -rank_delta - tau) */
-  int32_t anomaly = rank_delta < -BRPL_CONF_TAU_RANK ? 
-                    (-rank_delta - BRPL_CONF_TAU_RANK) : 0;
-  
-  /* Trust = exp(-lambda * anomaly) 
-   * Approximation: exp(-x) ≈ 1 / (1 + x) for small x */
-  uint32_t penalty = ((uint32_t)anomaly * BRPL_CONF_LAMBDA_SH_ADV) / 1000;
-  uint16_t trust = (TRUST_SCALE * TRUST_SCALE) / (TRUST_SCALE + penalty);
-  
-  return trust;
-#else
-  return TRUST_SCALE;
-#endif
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+static uint16_t
+brpl_parent_id(rpl_parent_t *p)
+{
+  return brpl_lladdr_id(rpl_get_parent_lladdr(p));
 }
 
-/* Compute Sinkhole Stability Trust (based on rank stability after parent selection) */
-__attribute__((unused)) static uint16_t
-brpl_compute_trust_sink_stab(rpl_parent_t *p, rpl_dag_t *dag)
-{
-#if BRPL_CONF_TRUST_ENABLE
-  if(p == NULL || dag == NULL) {
-    return TRUST_SCALE;
-  }
-  
-  /* Check if we have history */
-  clock_time_t now = clock_seconds();
-  if(p->last_rank_update == 0 || 
-     (now - p->last_rank_update) < BRPL_CONF_STABILITY_WINDOW) {
-    /* Not enough history yet */
-    return TRUST_SCALE;
-  }
-  
-  /* Compute rank increase */
-  int32_t rank_increase = (int32_t)dag->rank - (int32_t)p->last_rank;
-  
-  /* Compute instability penalty: max(0, rank_increase - kappa) */
-  int32_t instability = rank_increase > BRPL_CONF_KAPPA_RANK ?
-                        (rank_increase - BRPL_CONF_KAPPA_RANK) : 0;
-  
-  /* Trust = exp(-lambda * instability) */
-  uint32_t penalty = ((uint32_t)instability * BRPL_CONF_LAMBDA_SH_STAB) / 1000;
-  uint16_t trust = (TRUST_SCALE * TRUST_SCALE) / (TRUST_SCALE + penalty);
-  
-  return trust;
+#if defined(CSV_LOG_SAMPLE_RATE)
+#define BRPL_LOG_SAMPLE_RATE CSV_LOG_SAMPLE_RATE
 #else
-  return TRUST_SCALE;
+#define BRPL_LOG_SAMPLE_RATE 1
 #endif
-}
 
-/* Compute Grayhole Trust (data-plane, from external source) */
-__attribute__((weak)) uint16_t brpl_trust_get(uint16_t node_id)
-{
-  (void)node_id;
-  return TRUST_SCALE;
-}
+static uint32_t brpl_log_counter;
 
-__attribute__((weak)) uint16_t brpl_penalty_scale_get(uint16_t node_id)
+static int
+brpl_should_log(void)
 {
-  (void)node_id;
-  return BRPL_SCALE;
+  brpl_log_counter++;
+  if(BRPL_LOG_SAMPLE_RATE == 0) {
+    return 0;
+  }
+  return (brpl_log_counter % BRPL_LOG_SAMPLE_RATE) == 0;
 }
+#endif
 
-__attribute__((weak)) int brpl_escape_mode_get(uint16_t node_id)
+/*
+ * BRPL state engine. The per-DAG state read by the OF (queue EWMA, theta,
+ * beta, pmax and the local queue snapshot) is only written here:
+ * - brpl_state_tick() advances the time-based state, once per RPL periodic
+ *   timer tick for every joined DAG (brpl_periodic_tick()), so the EWMA does
+ *   not depend on how often parents are compared. Beta comes from a window
+ *   per node, advanced once per tick before the DAGs;
+ * - brpl_state_update() opens a parent selection round and snapshots the
+ *   local queue, so all candidates of a round are scored against the same state;
+ * - brpl_parent_updated()/brpl_parent_removed() keep pmax incrementally. A
+ *   full rescan is only done, once per round, when the maximum may have
+ *   decreased.
+ */
+static int
+brpl_is_active(rpl_dag_t *dag)
 {
-  (void)node_id;
-  return 0;
+  return dag != NULL && dag->instance != NULL && dag->instance->of == &rpl_brpl;
 }
 
-/* Optional quality gate for switch challenger.
- * Default: allow all candidates. */
-__attribute__((weak)) int brpl_switch_candidate_quality_ok(uint16_t node_id)
+static uint32_t
+brpl_parent_p_tilde(rpl_parent_t *p)
 {
-  (void)node_id;
-  return 1;
+  if(p->rank == RPL_INFINITE_RANK) {
+    return 0;
+  }
+  return (uint32_t)rpl_get_parent_link_metric(p) + (uint32_t)p->rank;
 }
 
-/* Optional loss-adaptive extra margin for switching.
- * Default: no extra margin. */
-__attribute__((weak)) uint16_t brpl_switch_extra_margin_get(uint16_t preferred_id,
-                                                            uint16_t challenger_id)
+static void
+brpl_rescan_pmax(rpl_dag_t *dag)
 {
-  (void)preferred_id;
-  (void)challenger_id;
-  return 0;
+  dag->brpl_pmax = 1;
+  for(rpl_parent_t *p = nbr_table_head(rpl_parents); p != NULL; p = nbr_table_next(rpl_parents, p)) {
+    if(p->dag == dag) {
+      p->brpl_p_tilde = brpl_parent_p_tilde(p);
+      if(p->brpl_p_tilde > dag->brpl_pmax) {
+        dag->brpl_pmax = p->brpl_p_tilde;
+      }
+    }
+  }
+  dag->brpl_pmax_dirty = 0;
 }
 
-/* Unified switch policy hook.
- * Default behavior composes legacy quality/margin hooks to preserve
- * backward compatibility with existing trust engines. */
-__attribute__((weak)) int brpl_switch_policy_get(uint16_t preferred_id,
-                                                 uint16_t challenger_id,
-                                                 int32_t preferred_weight,
-                                                 int32_t challenger_weight,
-                                                 uint8_t preferred_allowed,
-                                                 brpl_switch_policy_decision_t *out)
+#if BRPL_CONF_ENERGY
+/* Median duty cycle of the parents, which the energy term compares each
+ * parent to */
+static void
+brpl_update_duty_median(rpl_dag_t *dag)
 {
-  (void)preferred_weight;
-  (void)challenger_weight;
-  (void)preferred_allowed;
+  uint16_t duty[BRPL_ENERGY_MAX_SAMPLES];
+  uint8_t n = 0;
 
-  if(out == NULL) {
-    return 0;
+  for(rpl_parent_t *p = nbr_table_head(rpl_parents);
+      p != NULL && n < BRPL_ENERGY_MAX_SAMPLES;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(p->dag == dag) {
+      duty[n++] = p->brpl_queue.duty;
+    }
   }
-
-  out->extra_margin_abs = brpl_switch_extra_margin_get(preferred_id, challenger_id);
-  out->block_switch = brpl_switch_candidate_quality_ok(challenger_id) ? 0 : 1;
-  out->bypass_dwell = 0;
-  out->reason_code = out->block_switch ? 1 : 0;
-  return 1;
+  dag->brpl_duty_median = brpl_energy_median(duty, n);
 }
+#endif /* BRPL_CONF_ENERGY */
 
-/* Optional hard-exclude hook from external trust engine.
- * Default allows all parents. */
-__attribute__((weak)) int brpl_trust_parent_allowed(uint16_t node_id)
-{
-  (void)node_id;
-  return 1;
-}
+/* Beta is the share of the neighbor cache that changed over the last
+ * window: the symmetric difference over the union of the neighbor sets at
+ * the start and at the end of the window. The neighbor table counts it
+ * from its add and remove events. The neighbor cache is shared by all
+ * DAGs, so the window is per node and each DAG reads its beta from here. */
+static uint16_t brpl_beta = BRPL_SCALE;
+static clock_time_t brpl_beta_window_start;
 
-/* Optional validation-gated penalty scale from external trust engine.
- * 1000 means neutral (no extra boost). */
-__attribute__((weak)) uint16_t brpl_validation_penalty_scale_get(uint16_t node_id)
+static void
+brpl_update_beta(void)
 {
-  (void)node_id;
-  return 1000;
-}
+  clock_time_t now = clock_time();
+  uint16_t changed;
+  uint16_t total;
 
-/* Update trust values for a parent with EWMA smoothing */
-__attribute__((unused)) static void
-brpl_update_trust(rpl_parent_t *p, rpl_dag_t *dag)
-{
-#if BRPL_CONF_TRUST_ENABLE
-  if(p == NULL || dag == NULL) {
-    return;
+  if(brpl_beta_window_start == 0) {
+    brpl_beta_window_start = now;
+    nbr_table_churn_reset();
   }
-  
-  uint16_t beta = BRPL_CONF_TRUST_BETA; /* 0-1000 scale */
-  
-  /* Compute new trust values */
-  uint16_t new_sink_adv = brpl_compute_trust_sink_adv(p, dag);
-  uint16_t new_sink_stab = brpl_compute_trust_sink_stab(p, dag);
-  uint16_t new_gray = brpl_trust_get(brpl_parent_id(p));
-  
-  /* EWMA smoothing */
-  p->trust_sink_adv = ((TRUST_SCALE - beta) * p->trust_sink_adv + 
-                       beta * new_sink_adv) / TRUST_SCALE;
-  p->trust_sink_stab = ((TRUST_SCALE - beta) * p->trust_sink_stab + 
-                        beta * new_sink_stab) / TRUST_SCALE;
-  p->trust_gray = ((TRUST_SCALE - beta) * p->trust_gray + 
-                   beta * new_gray) / TRUST_SCALE;
-  
-  /* Combine sinkhole trust components: T_sink = (T_adv^0.5) * (T_stab^0.5) 
-   * Approximation: geometric mean */
-  uint32_t sink_combined = ((uint32_t)p->trust_sink_adv * p->trust_sink_stab) / TRUST_SCALE;
-  uint16_t trust_sink = (uint16_t)sink_combined;
-  
-  /* Combine gray and sink: T_total = (T_gray^alpha) * (T_sink^(1-alpha))
-   * Using alpha = 0.5 for equal weighting */
-  uint16_t alpha = BRPL_CONF_TRUST_ALPHA; /* 0-1000 scale */
-  p->trust_total = ((alpha * p->trust_gray + (TRUST_SCALE - alpha) * trust_sink)) / TRUST_SCALE;
-  
-  /* Clamp to minimum */
-  if(p->trust_total < TRUST_MIN) {
-    p->trust_total = TRUST_MIN;
+
+  if(now - brpl_beta_window_start >= (clock_time_t)(BRPL_CONF_BETA_WINDOW_SECONDS * CLOCK_SECOND)) {
+    nbr_table_churn_next_window(&changed, &total);
+    brpl_beta = total == 0 ? 0 : brpl_scale_ratio(changed, total);
+    brpl_beta_window_start = now;
   }
-#endif
 }
 
-/* Initialize trust values for a new parent */
-__attribute__((unused))
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+/* Queueing delay distribution of delivered packets, to compare the FIFO
+ * and LIFO service orders */
 static void
-brpl_init_trust(rpl_parent_t *p)
+brpl_log_delay(void)
 {
-#if BRPL_CONF_TRUST_ENABLE
-  if(p == NULL) {
-    return;
+  const uint32_t *histogram = mac_backlog_delay_histogram();
+  int32_t *f = brpl_telemetry_begin(BRPL_TLM_DELAY, 2 + MAC_BACKLOG_DELAY_BUCKETS);
+  uint8_t i;
+
+  if(f != NULL) {
+    f[0] = mac_backlog_lifo();
+    f[1] = brpl_queue_expired();
+    for(i = 0; i < MAC_BACKLOG_DELAY_BUCKETS; i++) {
+      f[2 + i] = histogram[i];
+    }
+    brpl_telemetry_commit();
   }
-  
-  p->trust_gray = TRUST_SCALE;
-  p->trust_sink_adv = TRUST_SCALE;
-  p->trust_sink_stab = TRUST_SCALE;
-  p->trust_total = TRUST_SCALE;
-  p->last_rank = 0;
-  p->last_rank_update = 0;
-  p->packets_sent = 0;
-  p->packets_dropped = 0;
-#endif
 }
+#endif
 
-/* Helper functions */
-static uint16_t
-brpl_parent_id(rpl_parent_t *p)
+/* DIO overhead of the queue-aware advertisements */
+struct brpl_dio_stats brpl_dio_stats;
+
+#if BRPL_CONF_QUEUE_ADV_LEVELS > 0
+static uint8_t brpl_dio_queue_level;
+static clock_time_t brpl_dio_at;
+
+/* Called when a multicast DIO advertises the local queue */
+void
+brpl_queue_dio_sent(void)
 {
-  const linkaddr_t *lladdr = rpl_get_parent_lladdr(p);
-  if(lladdr == NULL) {
-    return 0xFFFF;
-  }
-  return (uint16_t)lladdr->u8[LINKADDR_SIZE - 1];
+  brpl_dio_queue_level = brpl_queue_level();
+  brpl_dio_at = clock_time();
 }
 
-static uint16_t
-brpl_self_id(void)
+/* Send a DIO outside of the Trickle schedule when the queue moved to
+ * another occupancy level since the last one, rate-limited */
+static void
+brpl_queue_adv_check(rpl_dag_t *dag)
 {
-  return (uint16_t)linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
+  if(!dag->joined || brpl_queue_level() == brpl_dio_queue_level
+     || (brpl_dio_at != 0 && clock_time() - brpl_dio_at <
+         (clock_time_t)BRPL_CONF_QUEUE_ADV_MIN_INTERVAL * CLOCK_SECOND)) {
+    return;
+  }
+  brpl_dio_stats.unsolicited++;
+  dio_output(dag->instance, NULL);
 }
+#endif /* BRPL_CONF_QUEUE_ADV_LEVELS > 0 */
 
 #if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
-#if defined(CSV_LOG_SAMPLE_RATE)
-#define BRPL_LOG_SAMPLE_RATE CSV_LOG_SAMPLE_RATE
-#else
-#define BRPL_LOG_SAMPLE_RATE 1
-#endif
+static uint32_t brpl_dio_logged;
 
-static uint32_t brpl_log_counter;
+static void
+brpl_log_trickle(rpl_dag_t *dag)
+{
+  int32_t *f = brpl_telemetry_begin(BRPL_TLM_TRICKLE, 7);
 
-static int
-brpl_should_log(void)
+  if(f != NULL) {
+    f[0] = dag->brpl_congested;
+    f[1] = dag->brpl_theta;
+    f[2] = dag->instance->dio_intcurrent;
+    f[3] = brpl_dio_stats.sent;
+    f[4] = brpl_dio_stats.suppressed;
+    f[5] = brpl_dio_stats.unsolicited;
+    f[6] = brpl_dio_stats.queue_resets;
+    brpl_telemetry_commit();
+  }
+  brpl_dio_logged = brpl_dio_stats.sent + brpl_dio_stats.suppressed +
+    brpl_dio_stats.unsolicited;
+}
+
+static uint32_t brpl_switch_logged;
+
+static void
+brpl_log_switch(void)
 {
-  brpl_log_counter++;
-  if(BRPL_LOG_SAMPLE_RATE == 0) {
-    return 0;
+  int32_t *f = brpl_telemetry_begin(BRPL_TLM_SWITCH, 6);
+
+  if(f != NULL) {
+    f[0] = brpl_switch_stats.switches;
+    f[1] = brpl_switch_stats.daos;
+    f[2] = brpl_switch_stats.daos_batched;
+    f[3] = brpl_switch_stats.switch_rate;
+    f[4] = brpl_switch_stats.dao_rate;
+    f[5] = brpl_switch_stats.cost;
+    brpl_telemetry_commit();
   }
-  return (brpl_log_counter % BRPL_LOG_SAMPLE_RATE) == 0;
+  brpl_switch_logged = brpl_switch_stats.switches + brpl_switch_stats.daos;
 }
 #endif
 
-static uint16_t
-brpl_trust_clamped(rpl_parent_t *p)
+#if BRPL_CONF_TRICKLE_QUEUE_RESET
+/* Reset Trickle when the backlog moves between the idle and the congested
+ * regime, so that neighbors learn of it within Imin. Theta must cross
+ * BRPL_CONF_TRICKLE_THETA_HIGH to enter the congested regime and fall
+ * back to BRPL_CONF_TRICKLE_THETA_LOW to leave it, so that a backlog
+ * hovering around one threshold does not keep Trickle at Imin. */
+static void
+brpl_trickle_check(rpl_dag_t *dag)
 {
-#if BRPL_CONF_TRUST_ENABLE
-  if(p == NULL) {
-    return TRUST_SCALE;
+  uint8_t congested = dag->brpl_congested;
+
+  if(!congested && dag->brpl_theta >= BRPL_CONF_TRICKLE_THETA_HIGH) {
+    congested = 1;
+  } else if(congested && dag->brpl_theta <= BRPL_CONF_TRICKLE_THETA_LOW) {
+    congested = 0;
   }
-  /* Use TA trust (gray) directly as the routing trust signal.
-   * ta_trust_get() returns 0 when blacklisted, raw EWMA trust otherwise.
-   * This ensures the trust penalty refcontiki-ng-brpllects actual TA assessment, not
-   * the BRPL sinkhole trust which stays ~1000 for grayhole attackers. */
-  uint16_t trust = brpl_trust_get(brpl_parent_id(p));
-  if(trust < TRUST_MIN) {
-    trust = TRUST_MIN;
+  if(congested == dag->brpl_congested) {
+    return;
   }
-  return trust;
-#else
-  uint16_t trust = brpl_trust_get(brpl_parent_id(p));
-  if(trust < TRUST_MIN) {
-    trust = TRUST_MIN;
+  dag->brpl_congested = congested;
+  brpl_dio_stats.queue_resets++;
+  rpl_reset_dio_timer(dag->instance);
+#if BRPL_CONF_QUEUE_ADV_LEVELS > 0
+  /* The DIO that Trickle sends within Imin stands for the one of the
+   * occupancy level change */
+  brpl_dio_at = clock_time();
+#endif
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+  if(brpl_should_log()) {
+    brpl_log_trickle(dag);
   }
-  return trust;
 #endif
 }
+#endif /* BRPL_CONF_TRICKLE_QUEUE_RESET */
 
-static int32_t
-brpl_apply_trust_penalty(int32_t weight, rpl_parent_t *p)
-{
-  uint16_t node_id = brpl_parent_id(p);
-  uint16_t trust = brpl_trust_clamped(p);
-  uint16_t distrust = TRUST_SCALE - trust;
-  
-  /* Additive penalty: increase weight (cost) for distrusted nodes.
-   * In BRPL, lower weight = better parent, so we ADD a positive penalty
-   * for low-trust nodes to make them less attractive.
-   * penalty = lambda * distrust / TRUST_SCALE
-   * trusted  (distrust=0)              -> penalty=0 (no change)
-   * blacklisted (distrust=TRUST_SCALE-TRUST_MIN) -> large positive addend */
-  uint16_t lambda = BRPL_CONF_TRUST_LAMBDA_PENALTY; /* scaled by 1000 */
-#if TRUST_PENALTY_GAMMA >= 2
-  /* For gamma = 2: T^2 and (1-T)^2 */
-  int64_t num = (int64_t)trust * trust;
-  int64_t distrust_sq = (int64_t)distrust * distrust;
-  int64_t den = (int64_t)TRUST_SCALE * TRUST_SCALE
-                + ((int64_t)lambda * distrust_sq) / TRUST_SCALE;
-#else
-  /* For gamma = 1: linear */
-  int64_t num = (int64_t)trust;
-  int64_t den = (int64_t)TRUST_SCALE
-                + ((int64_t)lambda * distrust) / TRUST_SCALE;
-#endif
-  
-  int32_t base_weight = weight;
-  if(den > 0) {
-    base_weight = (int32_t)(((int64_t)weight * num) / den);
+void
+brpl_state_tick(rpl_dag_t *dag)
+{
+  if(!brpl_is_active(dag)) {
+    return;
   }
 
-  /* Apply extra cost boost only when validation model marks a parent
-   * as suspect/penalized. Default scale=1000 keeps legacy behavior. */
-  uint16_t vscale = brpl_validation_penalty_scale_get(node_id);
-  if(vscale == 0) {
-    vscale = 1000;
-  }
+  uint16_t qx = brpl_queue_length();
+  uint16_t qmax = brpl_queue_max();
+
+  dag->brpl_q_avg = brpl_queue_ewma(dag->brpl_q_avg, qx);
+
+  uint16_t rho = brpl_scale_ratio(dag->brpl_q_avg, qmax);
+
+  dag->brpl_beta = brpl_beta;
+
+  /*
+   * QuickTheta: increase BP weight as local backlog grows.
+   * theta = Qx / Qmax, scaled by BRPL_SCALE.
+   */
+  dag->brpl_theta = rho;
+  dag->brpl_epoch++;
+
+#if BRPL_CONF_TRICKLE_QUEUE_RESET
+  brpl_trickle_check(dag);
+#endif
+#if BRPL_CONF_QUEUE_ADV_LEVELS > 0
+  brpl_queue_adv_check(dag);
+#endif
 
-  int32_t merged_weight = (int32_t)(((int64_t)base_weight * vscale) / 1000);
-  uint16_t pscale = brpl_penalty_scale_get(node_id);
-  if(pscale == 0) {
-    pscale = BRPL_SCALE;
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+  if(brpl_should_log()) {
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_STATE, 6);
+    if(f != NULL) {
+      f[0] = qx;
+      f[1] = qmax;
+      f[2] = dag->brpl_q_avg;
+      f[3] = rho;
+      f[4] = dag->brpl_theta;
+      f[5] = dag->brpl_pmax;
+      brpl_telemetry_commit();
+    }
+    brpl_log_delay();
+    if(brpl_dio_stats.sent + brpl_dio_stats.suppressed +
+       brpl_dio_stats.unsolicited != brpl_dio_logged) {
+      brpl_log_trickle(dag);
+    }
+    if(brpl_switch_stats.switches + brpl_switch_stats.daos != brpl_switch_logged) {
+      brpl_log_switch();
+    }
   }
-  merged_weight = (int32_t)(((int64_t)merged_weight * pscale) / BRPL_SCALE);
+#endif
+}
 
-  /* Keep current parent slightly sticky unless trust engine enables escape. */
-  if(p != NULL && p->dag != NULL && p->dag->preferred_parent == p
-     && !brpl_escape_mode_get(node_id)) {
-    merged_weight = (int32_t)(((int64_t)merged_weight * BRPL_CONF_CURRENT_PARENT_PENALTY_SCALE)
-                              / BRPL_SCALE);
+void
+brpl_periodic_tick(void)
+{
+  int active = 0;
+
+  /* Before the DAGs, so that they all get the beta of this tick */
+  brpl_update_beta();
+  for(int i = 0; i < RPL_MAX_INSTANCES; ++i) {
+    if(instance_table[i].used) {
+      for(int j = 0; j < RPL_MAX_DAG_PER_INSTANCE; ++j) {
+        rpl_dag_t *dag = &instance_table[i].dag_table[j];
+        if(dag->used && dag->joined && brpl_is_active(dag)) {
+          brpl_state_tick(dag);
+          active = 1;
+        }
+      }
+    }
+  }
+  /* The switch rate and duty cycle windows are per node, not per DAG */
+  if(active) {
+    brpl_switch_stats_tick();
+#if BRPL_CONF_ENERGY
+    brpl_energy_tick();
+#endif
   }
-  return merged_weight;
 }
 
-static int
-brpl_switch_margin_allows(int32_t preferred_w, int32_t challenger_w, uint16_t extra_margin_abs)
+void
+brpl_state_update(rpl_dag_t *dag)
 {
-  if(challenger_w >= preferred_w) {
-    return 0;
+  if(!brpl_is_active(dag)) {
+    return;
   }
-
-  int32_t gain = preferred_w - challenger_w;
-  int32_t required_abs = BRPL_CONF_SWITCH_MARGIN_ABS + (int32_t)extra_margin_abs;
-  if(gain >= required_abs) {
-    return 1;
+  if(dag->brpl_epoch == 0) {
+    /* First round before any timer tick */
+    brpl_state_tick(dag);
   }
-
-  int32_t base = preferred_w > 0 ? preferred_w : 1;
-  int64_t lhs = (int64_t)gain * BRPL_SCALE;
-  int64_t rhs = (int64_t)base * BRPL_CONF_SWITCH_MARGIN_PPM;
-
-  return lhs >= rhs;
+  if(dag->brpl_pmax_dirty) {
+    brpl_rescan_pmax(dag);
+  }
+  dag->brpl_qx = brpl_queue_length();
+  dag->brpl_qmax = brpl_queue_max();
+#if BRPL_CONF_ENERGY
+  brpl_update_duty_median(dag);
+#endif
+  /* In storing mode, our descendants re-send their DAOs when we switch */
+  brpl_switch_context(RPL_IS_STORING(dag->instance) ? uip_ds6_route_num_routes() : 0,
+                      DAG_RANK(dag->rank, dag->instance));
 }
 
-static uint16_t
-brpl_scale_ratio(uint32_t num, uint32_t den)
+void
+brpl_parent_updated(rpl_parent_t *p)
 {
-  if(den == 0) {
-    return 0;
+  rpl_dag_t *dag = p->dag;
+  uint32_t old_p_tilde = p->brpl_p_tilde;
+
+  if(!brpl_is_active(dag)) {
+    return;
   }
-  uint32_t val = (num * BRPL_SCALE) / den;
-  if(val > BRPL_SCALE) {
-    val = BRPL_SCALE;
+  p->brpl_p_tilde = brpl_parent_p_tilde(p);
+  if(p->brpl_p_tilde >= dag->brpl_pmax) {
+    dag->brpl_pmax = p->brpl_p_tilde;
+  } else if(old_p_tilde >= dag->brpl_pmax) {
+    /* The maximum went down, find the new one at the next round */
+    dag->brpl_pmax_dirty = 1;
   }
-  return (uint16_t)val;
 }
 
-static uint16_t brpl_last_preferred_id = 0xFFFF;
-static clock_time_t brpl_last_preferred_switch_at;
-
-static void
-brpl_track_preferred_parent(rpl_dag_t *dag)
+void
+brpl_parent_removed(rpl_parent_t *p)
 {
-  uint16_t current_pref_id = 0xFFFF;
-  clock_time_t now = clock_time();
+  rpl_dag_t *dag = p->dag;
 
-  if(dag != NULL && dag->preferred_parent != NULL) {
-    current_pref_id = brpl_parent_id(dag->preferred_parent);
+  if(brpl_is_active(dag) && p->brpl_p_tilde >= dag->brpl_pmax) {
+    dag->brpl_pmax_dirty = 1;
   }
+  p->brpl_p_tilde = 0;
+}
 
-  if(brpl_last_preferred_switch_at == 0) {
-    brpl_last_preferred_switch_at = now;
-    brpl_last_preferred_id = current_pref_id;
+void
+brpl_preferred_parent_changed(rpl_dag_t *dag, rpl_parent_t *from,
+                              rpl_parent_t *to)
+{
+  if(!brpl_is_active(dag) || from == NULL || to == NULL) {
     return;
   }
+  /* Only moves between parents count, not joining or leaving the DAG */
+  brpl_switch_stats.switches++;
+}
 
-  if(current_pref_id != brpl_last_preferred_id) {
-    brpl_last_preferred_id = current_pref_id;
-    brpl_last_preferred_switch_at = now;
-  }
+/* Queue length of p, advertised or estimated */
+static uint16_t
+brpl_neighbor_queue(rpl_parent_t *p, rpl_dag_t *dag, uint16_t qx, uint16_t qmax)
+{
+  return brpl_nbr_queue_length(&p->brpl_queue, p->rank, dag->rank, qx, qmax);
 }
 
 static int
-brpl_dwell_blocks_switch(int preferred_allowed)
+brpl_is_preferred(rpl_parent_t *p)
 {
-  clock_time_t dwell = (clock_time_t)BRPL_CONF_PARENT_DWELL_SECONDS * CLOCK_SECOND;
-
-  if(dwell == 0 || !preferred_allowed || brpl_last_preferred_switch_at == 0) {
-    return 0;
-  }
-  return (clock_time() - brpl_last_preferred_switch_at) < dwell;
+  return p->dag != NULL && p->dag->preferred_parent == p;
 }
 
+static void
+brpl_track_preferred_parent(rpl_dag_t *dag)
+{
+  brpl_track_preferred(dag != NULL && dag->preferred_parent != NULL ?
+                       rpl_get_parent_lladdr(dag->preferred_parent) : NULL);
+}
 
-
-static uint16_t
-brpl_symmetric_diff(const linkaddr_t *prev, uint16_t prev_count,
-                    const linkaddr_t *curr, uint16_t curr_count)
+#if BRPL_CONF_QUEUE_PIGGYBACK
+/* Whether a packet going down to child p should carry a queue record,
+ * which is the case when the record p was last sent is off by
+ * BRPL_CONF_QUEUE_ADV_DELTA packets or getting old. A child that is not in
+ * the parent table is always sent one. */
+int
+brpl_queue_record_due(rpl_dag_t *dag, rpl_parent_t *p)
 {
-  uint16_t diff = 0;
-  uint16_t intersection = 0;
+  clock_time_t now = clock_time();
+  uint16_t qx = brpl_queue_length();
+  uint16_t delta;
 
-  for(uint16_t i = 0; i < prev_count; i++) {
-    for(uint16_t j = 0; j < curr_count; j++) {
-      if(linkaddr_cmp(&prev[i], &curr[j])) {
-        intersection++;
-        break;
-      }
-    }
+  if(!brpl_is_active(dag)) {
+    return 0;
   }
-  diff = prev_count + curr_count - 2 * intersection;
-  uint16_t uni = prev_count + curr_count - intersection;
-  if(uni == 0) {
+  if(p == NULL) {
+    return 1;
+  }
+  delta = qx > p->brpl_adv_queue ? qx - p->brpl_adv_queue : p->brpl_adv_queue - qx;
+  if(p->brpl_adv_at != 0 && delta < BRPL_CONF_QUEUE_ADV_DELTA
+     && now - p->brpl_adv_at < (clock_time_t)BRPL_CONF_QUEUE_ADV_REFRESH * CLOCK_SECOND) {
     return 0;
   }
-  return brpl_scale_ratio(diff, uni);
+  p->brpl_adv_queue = qx;
+  p->brpl_adv_at = now;
+  return 1;
 }
 
-static void
-brpl_update_state(rpl_dag_t *dag)
+/* A queue record from parent p, received on a data packet going down */
+void
+brpl_queue_record_input(rpl_parent_t *p, const struct brpl_queue_record *record)
 {
-  uint16_t qx = brpl_queue_length();
-  uint16_t qmax = brpl_queue_max();
-  uint16_t lambda = BRPL_CONF_QUEUE_EWMA_ALPHA;
+  clock_time_t now = clock_time();
 
-  dag->brpl_q_avg = (uint16_t)(((BRPL_SCALE - lambda) * dag->brpl_q_avg +
-                               lambda * qx) / BRPL_SCALE);
+  p->brpl_queue.queue = record->queue;
+  p->brpl_queue.queue_max = record->queue_max;
+  p->brpl_queue.valid = 1;
+  p->brpl_queue.at = record->age < now ? now - record->age : 0;
+}
+#endif /* BRPL_CONF_QUEUE_PIGGYBACK */
 
-  uint16_t rho = brpl_scale_ratio(dag->brpl_q_avg, qmax);
+static int32_t
+brpl_weight_base(rpl_parent_t *p)
+{
+  rpl_dag_t *dag = p->dag;
+  uint16_t qx = dag->brpl_qx;
+  uint16_t qmax = dag->brpl_qmax;
+  uint16_t qy = brpl_neighbor_queue(p, dag, qx, qmax);
 
-  static linkaddr_t prev_neighbors[NBR_TABLE_MAX_NEIGHBORS];
-  static linkaddr_t curr_neighbors[NBR_TABLE_MAX_NEIGHBORS];
-  uint16_t prev_count = dag->brpl_last_nbr_count;
-  uint16_t curr_count = 0;
+  /* Path cost through p, normalized by the largest one among candidates */
+  uint32_t p_tilde = brpl_parent_p_tilde(p);
+  uint16_t p_norm = brpl_scale_ratio(p_tilde, dag->brpl_pmax);
+  /* Queue differential, normalized by the queue capacity */
+  int32_t dq_norm = brpl_dq_norm(qx, qy, qmax);
+  int32_t theta = dag->brpl_theta;
+  int32_t weight = brpl_weight(theta, p_norm, dq_norm);
+#if BRPL_CONF_ENERGY
+  int32_t energy = brpl_energy_term(p->brpl_queue.duty, dag->brpl_duty_median);
 
-  clock_time_t now = clock_time();
-  if(dag->brpl_last_beta_update == 0) {
-    dag->brpl_last_beta_update = now;
-    dag->brpl_last_nbr_count = 0;
-    dag->brpl_beta = BRPL_SCALE;
-  }
+  weight += energy;
+#endif
 
-  if(now - dag->brpl_last_beta_update >= (clock_time_t)(BRPL_CONF_BETA_WINDOW_SECONDS * CLOCK_SECOND)) {
-    for(uip_ds6_nbr_t *n = uip_ds6_nbr_head(); n != NULL && curr_count < NBR_TABLE_MAX_NEIGHBORS; n = uip_ds6_nbr_next(n)) {
-      linkaddr_copy(&curr_neighbors[curr_count], (const linkaddr_t *)uip_ds6_nbr_get_ll(n));
-      curr_count++;
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+  if(brpl_should_log()) {
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_METRIC, 4);
+    if(f != NULL) {
+      f[0] = brpl_parent_id(p);
+      f[1] = rpl_get_parent_link_metric(p);
+      f[2] = p->rank;
+      f[3] = p_tilde;
+      brpl_telemetry_commit();
     }
-    if(prev_count > NBR_TABLE_MAX_NEIGHBORS) {
-      prev_count = NBR_TABLE_MAX_NEIGHBORS;
+    f = brpl_telemetry_begin(BRPL_TLM_WEIGHT, 9);
+    if(f != NULL) {
+      f[0] = brpl_parent_id(p);
+      f[1] = qx;
+      f[2] = qy;
+      f[3] = qmax;
+      f[4] = p_tilde;
+      f[5] = p_norm;
+      f[6] = dq_norm;
+      f[7] = theta;
+      f[8] = weight;
+      brpl_telemetry_commit();
     }
-
-    uint16_t beta = brpl_symmetric_diff(prev_neighbors, prev_count, curr_neighbors, curr_count);
-    dag->brpl_beta = beta;
-
-    memcpy(prev_neighbors, curr_neighbors, curr_count * sizeof(linkaddr_t));
-    dag->brpl_last_nbr_count = curr_count;
-    dag->brpl_last_beta_update = now;
+#if BRPL_CONF_ENERGY
+    f = brpl_telemetry_begin(BRPL_TLM_ENERGY, 4);
+    if(f != NULL) {
+      f[0] = brpl_parent_id(p);
+      f[1] = p->brpl_queue.duty;
+      f[2] = dag->brpl_duty_median;
+      f[3] = energy;
+      brpl_telemetry_commit();
+    }
+#endif
   }
+#endif
+  return weight;
+}
 
-  /*
-   * QuickTheta: increase BP weight as local backlog grows.
-   * theta = Qx / Qmax, scaled by BRPL_SCALE.
-   */
-  dag->brpl_theta = rho;
+/* Score a candidate parent: everything the comparisons below need is
+ * computed here, once per parent and selection round. */
+static void
+brpl_score_parent(rpl_parent_t *p, rpl_parent_score_t *s)
+{
+  const linkaddr_t *addr = rpl_get_parent_lladdr(p);
+  const struct trust_decision *d = trust_engine_decision(addr);
 
-  dag->brpl_pmax = 1;
-  for(rpl_parent_t *p = nbr_table_head(rpl_parents); p != NULL; p = nbr_table_next(rpl_parents, p)) {
-    if(p->dag == dag && p->rank != RPL_INFINITE_RANK) {
-      uint32_t p_tilde = (uint32_t)rpl_get_parent_link_metric(p) + (uint32_t)p->rank;
-      if(p_tilde > dag->brpl_pmax) {
-        dag->brpl_pmax = p_tilde;
-      }
-    }
-  }
+  s->parent = p;
+  s->id = brpl_lladdr_id(addr);
+  s->allowed = (d->flags & TRUST_DECISION_ALLOWED) ? 1 : 0;
+  s->trust_flags = d->flags;
+  s->switch_margin = d->switch_margin;
+  s->raw_weight = brpl_weight_base(p);
+  s->trust = brpl_trust_clamped(d);
+  s->weight = brpl_trust_penalty(s->raw_weight, d, s->trust,
+                                 brpl_is_preferred(p));
 
 #if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
   if(brpl_should_log()) {
-    printf("CSV,BRPL_STATE,%u,%u,%u,%u,%u,%u,%lu\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)qx,
-           (unsigned)qmax,
-           (unsigned)dag->brpl_q_avg,
-           (unsigned)rho,
-           (unsigned)dag->brpl_theta,
-           (unsigned long)dag->brpl_pmax);
+    /* Also decoded as the PARENT_CANDIDATE line */
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_TRUST, 7);
+    if(f != NULL) {
+      f[0] = s->id;
+      f[1] = s->trust;
+      f[2] = TRUST_MIN;
+      f[3] = TRUST_PENALTY_GAMMA;
+      f[4] = TRUST_LAMBDA;
+      f[5] = s->raw_weight;
+      f[6] = s->weight;
+      brpl_telemetry_commit();
+    }
   }
 #endif
 }
 
-static uint16_t
-brpl_neighbor_queue(rpl_parent_t *p, rpl_dag_t *dag, uint16_t qx, uint16_t qmax)
+/* Compare two scored parents, applying the hysteresis gate when one of
+ * them is the currently preferred parent. */
+static const rpl_parent_score_t *
+brpl_compare(const rpl_parent_score_t *s1, const rpl_parent_score_t *s2,
+             rpl_parent_t *preferred)
 {
-  if(p->brpl_queue_valid && p->brpl_queue_max > 0) {
-    return p->brpl_queue;
+  if(s1->allowed && !s2->allowed) {
+    return s1;
   }
-  if(dag == NULL || dag->rank == 0) {
-    return qx;
+  if(!s1->allowed && s2->allowed) {
+    return s2;
   }
-  uint32_t est = ((uint32_t)qx * p->rank) / dag->rank;
-  if(est > qmax) {
-    est = qmax;
+
+  /* Fallback policy: if both are hard-excluded, keep one lowest-cost
+   * candidate to avoid dead-end routing. */
+  if(!s1->allowed && !s2->allowed) {
+    return (s2->raw_weight < s1->raw_weight) ? s2 : s1;
   }
-  return (uint16_t)est;
-}
 
-static int32_t
-brpl_weight_base(rpl_parent_t *p)
-{
-  rpl_dag_t *dag = p->dag;
-  brpl_update_state(dag);
+  const rpl_parent_score_t *best = (s2->weight < s1->weight) ? s2 : s1;
+  const rpl_parent_score_t *pref = NULL;
+  struct brpl_switch_gate gate = { 0 };
 
-  uint16_t qx = brpl_queue_length();
-  uint16_t qmax = brpl_queue_max();
-  uint16_t qy = brpl_neighbor_queue(p, dag, qx, qmax);
-  int32_t delta_q = (int32_t)qx - (int32_t)qy;
+  if(preferred == s1->parent) {
+    pref = s1;
+  } else if(preferred == s2->parent) {
+    pref = s2;
+  }
 
-  int32_t etx = (int32_t)rpl_get_parent_link_metric(p);
-  int32_t theta = dag->brpl_theta;
-  int32_t weight = (theta * (int32_t)p_norm - (BRPL_SCALE - theta) * dq_norm) / BRPL_SCALE;
+  /* Hysteresis gate: if we are about to switch away from the currently
+   * preferred parent, require a meaningful score improvement. */
+  if(pref != NULL && best != pref) {
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+    const rpl_parent_score_t *challenger = best;
+#endif
 
+    if(!brpl_switch_allowed(pref->weight, pref->trust_flags, pref->allowed,
+                            best->weight, best->trust_flags,
+                            best->switch_margin, &gate)) {
+      best = pref;
+    }
+#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
+    if(brpl_should_log()) {
+      int32_t *f = brpl_telemetry_begin(BRPL_TLM_SWITCH_GATE, 10);
+      if(f != NULL) {
+        f[0] = pref->id;
+        f[1] = pref->weight;
+        f[2] = challenger->id;
+        f[3] = challenger->weight;
+        f[4] = challenger->switch_margin;
+        f[5] = gate.dwell_blocked;
+        f[6] = gate.margin_ok;
+        f[7] = gate.block_switch;
+        f[8] = gate.bypass_dwell;
+        f[9] = gate.block_switch; /* reason code */
+        brpl_telemetry_commit();
+      }
+    }
+#endif
+  }
 #if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
   if(brpl_should_log()) {
-    uint16_t link_metric = rpl_get_parent_link_metric(p);
-    printf("CSV,BRPL_METRIC,%u,%u,%u,%u,%lu\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p),
-           (unsigned)link_metric,
-           (unsigned)p->rank,
-           (unsigned long)p_tilde);
-    printf("CSV,BRPL_WEIGHT,%u,%u,%u,%u,%u,%lu,%u,%ld,%ld,%ld\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p),
-           (unsigned)qx,
-           (unsigned)qy,
-           (unsigned)qmax,
-           (unsigned long)p_tilde,
-           (unsigned)p_norm,
-           (long)dq_norm,
-           (long)theta,
-           (long)weight);
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_BEST, 5);
+    if(f != NULL) {
+      f[0] = s1->id;
+      f[1] = s1->weight;
+      f[2] = s2->id;
+      f[3] = s2->weight;
+      f[4] = best->id;
+      brpl_telemetry_commit();
+    }
+    if(best == pref && gate.dwell_blocked) {
+      f = brpl_telemetry_begin(BRPL_TLM_DWELL_GATE, 1);
+      if(f != NULL) {
+        f[0] = pref->id;
+        brpl_telemetry_commit();
+      }
+    }
   }
 #endif
-  return weight;
+  return best;
 }
 
 static rpl_parent_t *
 brpl_best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
 {
+  rpl_parent_score_t s1, s2;
+
   if(p1 == NULL) {
     return p2;
   }
   if(p2 == NULL) {
     return p1;
   }
-  uint16_t id1 = brpl_parent_id(p1);
-  uint16_t id2 = brpl_parent_id(p2);
-  int allow1 = brpl_trust_parent_allowed(id1);
-  int allow2 = brpl_trust_parent_allowed(id2);
 
-  if(allow1 && !allow2) {
-    return p1;
-  }
-  if(!allow1 && allow2) {
-    return p2;
-  }
+  brpl_track_preferred_parent(p1->dag);
+  brpl_score_parent(p1, &s1);
+  brpl_score_parent(p2, &s2);
+  return brpl_compare(&s1, &s2, p1->dag->preferred_parent)->parent;
+}
 
-  int32_t w1_base = brpl_weight_base(p1);
-  int32_t w2_base = brpl_weight_base(p2);
+/* Same selection as folding brpl_best_parent() over the candidates, but
+ * every candidate is scored only once. */
+static rpl_parent_t *
+brpl_best_parent_batch(rpl_dag_t *dag, rpl_parent_score_t *scores, uint16_t count)
+{
+  const rpl_parent_score_t *best;
+  uint16_t i;
 
-  /* Fallback policy: if both are hard-excluded, keep one lowest-cost
-   * candidate to avoid dead-end routing. */
-  if(!allow1 && !allow2) {
-    return (w2_base < w1_base) ? p2 : p1;
+  if(count == 0) {
+    return NULL;
   }
 
-  int32_t w1 = brpl_apply_trust_penalty(w1_base, p1);
-  int32_t w2 = brpl_apply_trust_penalty(w2_base, p2);
-  rpl_parent_t *best = (w2 < w1) ? p2 : p1;
-  rpl_dag_t *dag = p1->dag;
-  rpl_parent_t *preferred = dag != NULL ? dag->preferred_parent : NULL;
-  int preferred_allowed = 0;
-  int dwell_blocked = 0;
-
   brpl_track_preferred_parent(dag);
-  if(preferred == p1) {
-    preferred_allowed = allow1;
-  } else if(preferred == p2) {
-    preferred_allowed = allow2;
+  for(i = 0; i < count; i++) {
+    brpl_score_parent(scores[i].parent, &scores[i]);
   }
 
-  /* Hysteresis gate: if we are about to switch away from the currently
-   * preferred parent, require a meaningful score improvement. */
-  if(preferred != NULL && best != preferred &&
-     (preferred == p1 || preferred == p2)) {
-    int32_t preferred_w = (preferred == p1) ? w1 : w2;
-    int32_t challenger_w = (best == p1) ? w1 : w2;
-    uint16_t preferred_id = brpl_parent_id(preferred);
-    uint16_t challenger_id = brpl_parent_id(best);
-    brpl_switch_policy_decision_t policy = {0, 0, 0, 0};
-    int quality_ok;
-    int margin_ok;
-
-    if(!brpl_switch_policy_get(preferred_id, challenger_id,
-                               preferred_w, challenger_w,
-                               (uint8_t)preferred_allowed, &policy)) {
-      policy.extra_margin_abs = brpl_switch_extra_margin_get(preferred_id, challenger_id);
-      policy.block_switch = brpl_switch_candidate_quality_ok(challenger_id) ? 0 : 1;
-      policy.bypass_dwell = 0;
-      policy.reason_code = policy.block_switch ? 1 : 0;
-    }
+  best = &scores[0];
+  for(i = 1; i < count; i++) {
+    best = brpl_compare(best, &scores[i], dag->preferred_parent);
+  }
+  return best->parent;
+}
+
+#if BRPL_CONF_PER_PACKET_NEXT_HOP
+/*
+ * Per-packet backpressure forwarding. The preferred parent still defines
+ * our rank, receives the DAOs and backs the default route, but each
+ * upward packet goes to the eligible parent with the best weight at the
+ * time it is sent. A parent is eligible if it belongs to the current
+ * DAG, has a lower rank than ours (so that the RPL rank checks on the
+ * data path hold and no loop forms), a usable link, is not excluded by
+ * trust, and its path cost is within BRPL_CONF_NEXT_HOP_RANK_SLACK of
+ * the path through the preferred parent.
+ */
+static int
+brpl_next_hop_eligible(rpl_parent_t *p, rpl_dag_t *dag, uint32_t max_cost)
+{
+  rpl_instance_t *instance = dag->instance;
+
+  return p->dag == dag &&
+         p->rank != RPL_INFINITE_RANK &&
+         DAG_RANK(p->rank, instance) < DAG_RANK(dag->rank, instance) &&
+         instance->of->parent_has_usable_link(p) &&
+         instance->of->rank_via_parent(p) <= max_cost &&
+         rpl_parent_get_ipaddr(p) != NULL &&
+         (trust_engine_decision(rpl_get_parent_lladdr(p))->flags &
+          TRUST_DECISION_ALLOWED);
+}
+
+static int32_t
+brpl_packet_weight(rpl_parent_t *p, rpl_dag_t *dag, uint16_t qx, uint16_t qmax)
+{
+  const linkaddr_t *addr = rpl_get_parent_lladdr(p);
+  const struct trust_decision *d = trust_engine_decision(addr);
+  /* The packets we already queued for p are on their way to its queue:
+   * counting them spreads a burst over the eligible parents */
+  int32_t qy = brpl_neighbor_queue(p, dag, qx, qmax) +
+    brpl_queue_nbr_length(addr);
+  int32_t dq_norm = brpl_dq_norm(qx, qy, qmax);
+  uint16_t p_norm = brpl_scale_ratio(brpl_parent_p_tilde(p), dag->brpl_pmax);
+  int32_t weight = brpl_weight(dag->brpl_theta, p_norm, dq_norm);
+
+  return brpl_trust_penalty(weight, d, brpl_trust_clamped(d),
+                            brpl_is_preferred(p));
+}
+
+int
+brpl_upward_next_hop(uip_ipaddr_t *ipaddr)
+{
+  rpl_instance_t *instance = rpl_get_default_instance();
+  rpl_dag_t *dag;
+  rpl_parent_t *preferred;
+  rpl_parent_t *best;
+  rpl_parent_t *p;
+  int32_t best_weight;
+  uint32_t max_cost;
+  uint16_t qx;
+  uint16_t qmax;
+
+  if(instance == NULL || (dag = instance->current_dag) == NULL ||
+     !brpl_is_active(dag) || (preferred = dag->preferred_parent) == NULL) {
+    return 0;
+  }
 
-    quality_ok = policy.block_switch ? 0 : 1;
-    dwell_blocked = policy.bypass_dwell ? 0 : brpl_dwell_blocks_switch(preferred_allowed);
-    margin_ok = brpl_switch_margin_allows(preferred_w, challenger_w, policy.extra_margin_abs);
-
-    if(policy.block_switch) {
-      best = preferred;
-    } else if(dwell_blocked) {
-      best = preferred;
-    } else {
-      if(!margin_ok) {
-        best = preferred;
+  qx = brpl_queue_length();
+  qmax = brpl_queue_max();
+  max_cost = (uint32_t)instance->of->rank_via_parent(preferred) +
+    BRPL_CONF_NEXT_HOP_RANK_SLACK;
+
+  best = preferred;
+  best_weight = brpl_packet_weight(preferred, dag, qx, qmax);
+  for(p = nbr_table_head(rpl_parents); p != NULL;
+      p = nbr_table_next(rpl_parents, p)) {
+    if(p != preferred && brpl_next_hop_eligible(p, dag, max_cost)) {
+      int32_t weight = brpl_packet_weight(p, dag, qx, qmax);
+      if(weight < best_weight) {
+        best = p;
+        best_weight = weight;
       }
     }
-#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
-    if(brpl_should_log()) {
-      printf("CSV,BRPL_SWITCH_GATE,%u,%u,%ld,%u,%ld,%u,%u,%u,%lu,%u,%u,%u,%u\n",
-             (unsigned)brpl_self_id(),
-             (unsigned)preferred_id,
-             (long)preferred_w,
-             (unsigned)challenger_id,
-             (long)challenger_w,
-             (unsigned)policy.extra_margin_abs,
-             (unsigned)quality_ok,
-             (unsigned)dwell_blocked,
-             (unsigned long)clock_time(),
-             (unsigned)margin_ok,
-             (unsigned)policy.block_switch,
-             (unsigned)policy.bypass_dwell,
-             (unsigned)policy.reason_code);
-    }
-#endif
   }
-#if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
-  if(brpl_should_log()) {
-    uint16_t t1 = brpl_trust_clamped(p1);
-    uint16_t t2 = brpl_trust_clamped(p2);
-    printf("CSV,BRPL_TRUST,%u,%u,%u,%u,%u,%ld\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p1),
-           (unsigned)t1,
-           (unsigned)TRUST_MIN,
-           (unsigned)TRUST_PENALTY_GAMMA,
-           (long)w1);
-    printf("CSV,BRPL_TRUST,%u,%u,%u,%u,%u,%ld\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p2),
-           (unsigned)t2,
-           (unsigned)TRUST_MIN,
-           (unsigned)TRUST_PENALTY_GAMMA,
-           (long)w2);
-    printf("PARENT_CANDIDATE: self=%u id=%u BP=%ld T=%.3f gamma=%u lambda=%u score=%ld\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p1),
-           (long)w1_base,
-           (double)t1 / (double)TRUST_SCALE,
-           (unsigned)TRUST_PENALTY_GAMMA,
-           (unsigned)TRUST_LAMBDA,
-           (long)w1);
-    printf("PARENT_CANDIDATE: self=%u id=%u BP=%ld T=%.3f gamma=%u lambda=%u score=%ld\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p2),
-           (long)w2_base,
-           (double)t2 / (double)TRUST_SCALE,
-           (unsigned)TRUST_PENALTY_GAMMA,
-           (unsigned)TRUST_LAMBDA,
-           (long)w2);
-    printf("CSV,BRPL_BEST,%u,%u,%ld,%u,%ld,%u\n",
-           (unsigned)brpl_self_id(),
-           (unsigned)brpl_parent_id(p1),
-           (long)w1,
-           (unsigned)brpl_parent_id(p2),
-           (long)w2,
-           (unsigned)brpl_parent_id(best));
-    if(preferred != NULL && best == preferred && (preferred == p1 || preferred == p2) &&
-       dwell_blocked) {
-      printf("CSV,BRPL_DWELL_GATE,%u,%u,%lu\n",
-             (unsigned)brpl_self_id(),
-             (unsigned)brpl_parent_id(preferred),
-             (unsigned long)clock_time());
-    }
+
+  if(best == preferred) {
+    /* The default route points to the preferred parent */
+    return 0;
   }
-#endif
-  return best;
+  uip_ipaddr_copy(ipaddr, rpl_parent_get_ipaddr(best));
+  return 1;
 }
+#endif /* BRPL_CONF_PER_PACKET_NEXT_HOP */
 
 static void
 brpl_reset(rpl_dag_t *dag)
@@ -759,10 +800,13 @@ brpl_reset(rpl_dag_t *dag)
 #if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
   static uint8_t brpl_params_logged = 0;
   if(!brpl_params_logged) {
-    printf("BRPL_PARAMS: lambda=%u gamma=%u trust_min=%u\n",
-           (unsigned)TRUST_LAMBDA,
-           (unsigned)TRUST_PENALTY_GAMMA,
-           (unsigned)TRUST_MIN);
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_PARAMS, 3);
+    if(f != NULL) {
+      f[0] = TRUST_LAMBDA;
+      f[1] = TRUST_PENALTY_GAMMA;
+      f[2] = TRUST_MIN;
+      brpl_telemetry_commit();
+    }
     brpl_params_logged = 1;
   }
 #endif
@@ -770,11 +814,14 @@ brpl_reset(rpl_dag_t *dag)
     return;
   }
   dag->brpl_theta = BRPL_SCALE;
-  dag->brpl_beta = BRPL_SCALE;
+  dag->brpl_beta = brpl_beta;
   dag->brpl_q_avg = 0;
   dag->brpl_pmax = 1;
-  dag->brpl_last_beta_update = 0;
-  dag->brpl_last_nbr_count = 0;
+  dag->brpl_congested = 0;
+  dag->brpl_qx = 0;
+  dag->brpl_qmax = 0;
+  dag->brpl_epoch = 0;
+  dag->brpl_pmax_dirty = 1;
 }
 
 static uint16_t
@@ -801,15 +848,6 @@ brpl_rank_via_parent(rpl_parent_t *p)
   return rpl_mrhof.rank_via_parent(p);
 }
 
-/* Public function to update trust for a parent */
-void
-brpl_update_parent_trust(rpl_parent_t *p, rpl_dag_t *dag)
-{
-#if BRPL_CONF_TRUST_ENABLE
-  brpl_update_trust(p, dag);
-#endif
-}
-
 rpl_of_t rpl_brpl = {
   .reset = brpl_reset,
 #if RPL_WITH_DAO_ACK
@@ -820,6 +858,7 @@ rpl_of_t rpl_brpl = {
   .parent_path_cost = brpl_parent_path_cost,
   .rank_via_parent = brpl_rank_via_parent,
   .best_parent = brpl_best_parent,
+  .best_parent_batch = brpl_best_parent_batch,
   .best_dag = NULL,
   .update_metric_container = NULL,
   .ocp = RPL_OCP_BRPL,
@@ -93,78 +93,8 @@
 #define RPL_CONF_STATS 0
 #endif /* RPL_CONF_STATS */
 
-/* BRPL support */
-#ifndef BRPL_CONF_ENABLE
-#if defined(RPL_CONF_OF_OCP) && (RPL_CONF_OF_OCP == RPL_OCP_BRPL)
-#define BRPL_CONF_ENABLE 1
-#else
-#define BRPL_CONF_ENABLE 0
-#endif
-#endif
-
-#ifndef BRPL_CONF_QUEUE_MAX
-#define BRPL_CONF_QUEUE_MAX 200
-#endif
-
-#ifndef BRPL_CONF_QUEUE_EWMA_ALPHA
-#define BRPL_CONF_QUEUE_EWMA_ALPHA 125 /* scale 0-1000 */
-#endif
-
-#ifndef BRPL_CONF_BETA_WINDOW_SECONDS
-#define BRPL_CONF_BETA_WINDOW_SECONDS 60
-#endif
-
-#ifndef BRPL_CONF_LIFO_QUEUE
-#define BRPL_CONF_LIFO_QUEUE 1
-#endif
-
-#ifndef BRPL_CONF_QUEUE_OPTION_CODE
-#define BRPL_CONF_QUEUE_OPTION_CODE 0xCE
-#endif
-
-/* Trust-aware routing parameters */
-#ifndef BRPL_CONF_TRUST_ENABLE
-#define BRPL_CONF_TRUST_ENABLE 1
-#endif
-
-/* Sinkhole trust - Advertisement plausibility */
-#ifndef BRPL_CONF_LAMBDA_SH_ADV
-#define BRPL_CONF_LAMBDA_SH_ADV 2 /* Sensitivity to rank anomalies (scaled by 1000: 0.002) */
-#endif
-
-#ifndef BRPL_CONF_TAU_RANK
-#define BRPL_CONF_TAU_RANK 256 /* Rank jitter tolerance (1 hop worth) */
-#endif
-
-/* Sinkhole trust - Stability */
-#ifndef BRPL_CONF_LAMBDA_SH_STAB
-#define BRPL_CONF_LAMBDA_SH_STAB 3 /* Sensitivity to rank instability (scaled by 1000: 0.003) */
-#endif
-
-#ifndef BRPL_CONF_KAPPA_RANK
-#define BRPL_CONF_KAPPA_RANK 512 /* Acceptable rank increase threshold */
-#endif
-
-#ifndef BRPL_CONF_STABILITY_WINDOW
-#define BRPL_CONF_STABILITY_WINDOW 30 /* Seconds to track rank stability */
-#endif
-
-/* Trust combination weights */
-#ifndef BRPL_CONF_TRUST_BETA
-#define BRPL_CONF_TRUST_BETA 200 /* EWMA smoothing for trust (0-1000, default 0.2) */
-#endif
-
-#ifndef BRPL_CONF_TRUST_ALPHA
-#define BRPL_CONF_TRUST_ALPHA 500 /* Weight for grayhole vs sinkhole (0-1000, 0.5 = equal) */
-#endif
-
-#ifndef BRPL_CONF_TRUST_GAMMA
-#define BRPL_CONF_TRUST_GAMMA 2000 /* Penalty exponent (scaled by 1000, default 2.0) */
-#endif
-
-#ifndef BRPL_CONF_TRUST_LAMBDA_PENALTY
-#define BRPL_CONF_TRUST_LAMBDA_PENALTY 1000 /* Penalty weight in final metric (scaled by 1000) */
-#endif
+/* BRPL support, shared with rpl-lite */
+#include "net/routing/brpl-conf.h"
 
 /*
  * The objective function (OF) used by a RPL root is configurable through
@@ -187,10 +117,23 @@
  */
 #ifdef RPL_CONF_SUPPORTED_OFS
 #define RPL_SUPPORTED_OFS RPL_CONF_SUPPORTED_OFS
+#elif BRPL_CONF_ENABLE
+#define RPL_SUPPORTED_OFS {&rpl_brpl, &rpl_mrhof}
 #else /* RPL_CONF_SUPPORTED_OFS */
 #define RPL_SUPPORTED_OFS {&rpl_mrhof}
 #endif /* RPL_CONF_SUPPORTED_OFS */
 
+/*
+ * Let objective functions that implement best_parent_batch score all
+ * candidate parents in a single pass. This costs one rpl_parent_score_t
+ * per neighbor table entry, hence it is only enabled by default for BRPL.
+ */
+#ifdef RPL_CONF_WITH_PARENT_BATCH
+#define RPL_WITH_PARENT_BATCH RPL_CONF_WITH_PARENT_BATCH
+#else /* RPL_CONF_WITH_PARENT_BATCH */
+#define RPL_WITH_PARENT_BATCH BRPL_CONF_ENABLE
+#endif /* RPL_CONF_WITH_PARENT_BATCH */
+
 /*
  * Enable/disable RPL Metric Containers (MC). The actual MC in use for
  * a given DODAG is decided at runtime, when joining. Note that OF0
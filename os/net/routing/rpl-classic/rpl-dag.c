@@ -45,11 +45,14 @@
 #include "net/routing/rpl-classic/rpl.h"
 #include "net/routing/rpl-classic/rpl-private.h"
 #include "net/routing/rpl-classic/rpl-dag-root.h"
+#include "net/routing/rpl-classic/brpl-telemetry.h"
 #include "net/ipv6/uip.h"
 #include "net/ipv6/uip-nd6.h"
 #include "net/ipv6/uip-ds6-nbr.h"
 #include "net/linkaddr.h"
 #include "net/nbr-table.h"
+#include "net/routing/trust-engine.h"
+#include "net/routing/brpl-weight.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "lib/list.h"
 #include "lib/memb.h"
@@ -87,14 +90,9 @@ rpl_should_log(void)
 #ifdef RPL_CALLBACK_PARENT_SWITCH
 void RPL_CALLBACK_PARENT_SWITCH(rpl_parent_t *old, rpl_parent_t *new);
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
-__attribute__((weak)) void brpl_preferred_parent_changed(uint16_t old_id, uint16_t new_id)
-{
-  (void)old_id;
-  (void)new_id;
-}
 
 /*---------------------------------------------------------------------------*/
-extern rpl_of_t rpl_of0, rpl_mrhof;
+extern rpl_of_t rpl_of0, rpl_mrhof, rpl_brpl;
 static rpl_of_t *const objective_functions[] = RPL_SUPPORTED_OFS;
 
 /*---------------------------------------------------------------------------*/
@@ -287,29 +285,22 @@ rpl_set_preferred_parent(rpl_dag_t *dag, rpl_parent_t *p)
   if(rpl_should_log()) {
     const linkaddr_t *new_ll = p ? rpl_get_parent_lladdr(p) : NULL;
     const linkaddr_t *old_ll = dag->preferred_parent ? rpl_get_parent_lladdr(dag->preferred_parent) : NULL;
-    uint16_t self_id = (uint16_t)linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
-    uint16_t new_id = new_ll ? new_ll->u8[LINKADDR_SIZE - 1] : 0xFFFF;
-    uint16_t old_id = old_ll ? old_ll->u8[LINKADDR_SIZE - 1] : 0xFFFF;
-    uint16_t new_rank = p ? p->rank : RPL_INFINITE_RANK;
-    printf("CSV,RPL_PARENT,%u,%u,%u,%u\n",
-           (unsigned)self_id,
-           (unsigned)new_id,
-           (unsigned)old_id,
-           (unsigned)new_rank);
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_RPL_PARENT, 3);
+    if(f != NULL) {
+      f[0] = new_ll ? new_ll->u8[LINKADDR_SIZE - 1] : 0xFFFF;
+      f[1] = old_ll ? old_ll->u8[LINKADDR_SIZE - 1] : 0xFFFF;
+      f[2] = p ? p->rank : RPL_INFINITE_RANK;
+      brpl_telemetry_commit();
+    }
   }
 #endif
 
-  {
-    const linkaddr_t *new_ll = p ? rpl_get_parent_lladdr(p) : NULL;
-    const linkaddr_t *old_ll = dag->preferred_parent ? rpl_get_parent_lladdr(dag->preferred_parent) : NULL;
-    uint16_t new_id = new_ll ? new_ll->u8[LINKADDR_SIZE - 1] : 0xFFFF;
-    uint16_t old_id = old_ll ? old_ll->u8[LINKADDR_SIZE - 1] : 0xFFFF;
-    brpl_preferred_parent_changed(old_id, new_id);
-  }
-
 #ifdef RPL_CALLBACK_PARENT_SWITCH
   RPL_CALLBACK_PARENT_SWITCH(dag->preferred_parent, p);
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
+#if BRPL_CONF_ENABLE
+  brpl_preferred_parent_changed(dag, dag->preferred_parent, p);
+#endif /* BRPL_CONF_ENABLE */
 
   /* Always keep the preferred parent locked, so it remains in the
    * neighbor table. */
@@ -777,16 +768,9 @@ rpl_add_parent(rpl_dag_t *dag, rpl_dio_t *dio, uip_ipaddr_t *addr)
 #if RPL_WITH_MC
       memcpy(&p->mc, &dio->mc, sizeof(p->mc));
 #endif /* RPL_WITH_MC */
-#if BRPL_CONF_ENABLE && BRPL_CONF_TRUST_ENABLE
-      /* Initialize trust values for new parent */
-      p->trust_gray = 1000;
-      p->trust_sink_adv = 1000;
-      p->trust_sink_stab = 1000;
-      p->trust_total = 1000;
-      p->last_rank = dio->rank;
-      p->last_rank_update = clock_seconds();
-      p->packets_sent = 0;
-      p->packets_dropped = 0;
+#if BRPL_CONF_ENABLE
+      p->brpl_queue.duty = dio->brpl_duty;
+      brpl_parent_updated(p);
 #endif
     }
   }
@@ -930,7 +914,17 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
     /* The DAO parent set changed -- schedule a DAO transmission. If
        MOP = MOP0, we do not want downward routes. */
     if(instance->mop != RPL_MOP_NO_DOWNWARD_ROUTES) {
-      rpl_schedule_dao(instance);
+#if BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH
+      if(instance->of->ocp == RPL_OCP_BRPL) {
+        /* Only our own DAO is batched. The last parent may hold the
+         * routes of our children, forwarded as soon as they came, so it
+         * gets its No-Path DAO on every switch. */
+        rpl_schedule_dao_batch(instance);
+      } else
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH */
+      {
+        rpl_schedule_dao(instance);
+      }
     }
 
     rpl_reset_dio_timer(instance);
@@ -944,18 +938,30 @@ rpl_select_dag(rpl_instance_t *instance, rpl_parent_t *p)
   return best_dag;
 }
 /*---------------------------------------------------------------------------*/
+#if RPL_WITH_PARENT_BATCH
+/* Candidate parents of the current selection round, see best_parent_batch */
+static rpl_parent_score_t parent_scores[NBR_TABLE_MAX_NEIGHBORS];
+#endif /* RPL_WITH_PARENT_BATCH */
+
 static rpl_parent_t *
 best_parent(rpl_dag_t *dag, int fresh_only)
 {
   rpl_parent_t *p;
   rpl_of_t *of;
   rpl_parent_t *best = NULL;
+#if RPL_WITH_PARENT_BATCH
+  uint16_t count = 0;
+#endif /* RPL_WITH_PARENT_BATCH */
 
   if(dag == NULL || dag->instance == NULL || dag->instance->of == NULL) {
     return NULL;
   }
 
   of = dag->instance->of;
+#if BRPL_CONF_ENABLE
+  /* Let BRPL snapshot its state once for this selection round */
+  brpl_state_update(dag);
+#endif
   /* Search for the best parent according to the OF */
   for(p = nbr_table_head(rpl_parents); p != NULL; p = nbr_table_next(rpl_parents, p)) {
 
@@ -981,10 +987,24 @@ best_parent(rpl_dag_t *dag, int fresh_only)
     }
 #endif /* UIP_ND6_SEND_NS */
 
+#if RPL_WITH_PARENT_BATCH
+    if(of->best_parent_batch != NULL) {
+      /* Collect it, all candidates are scored at once below. */
+      parent_scores[count++].parent = p;
+      continue;
+    }
+#endif /* RPL_WITH_PARENT_BATCH */
+
     /* Now we have an acceptable parent, check if it is the new best. */
     best = of->best_parent(best, p);
   }
 
+#if RPL_WITH_PARENT_BATCH
+  if(count > 0) {
+    best = of->best_parent_batch(dag, parent_scores, count);
+  }
+#endif /* RPL_WITH_PARENT_BATCH */
+
   return best;
 }
 /*---------------------------------------------------------------------------*/
@@ -1034,6 +1054,9 @@ rpl_remove_parent(rpl_parent_t *parent)
   LOG_INFO_("\n");
 
   rpl_nullify_parent(parent);
+#if BRPL_CONF_ENABLE
+  brpl_parent_removed(parent);
+#endif
 
   nbr_table_remove(rpl_parents, parent);
 }
@@ -1096,6 +1119,9 @@ rpl_move_parent(rpl_dag_t *dag_src, rpl_dag_t *dag_dst, rpl_parent_t *parent)
   LOG_INFO_6ADDR(rpl_parent_get_ipaddr(parent));
   LOG_INFO_("\n");
 
+#if BRPL_CONF_ENABLE
+  brpl_parent_removed(parent);
+#endif
   parent->dag = dag_dst;
 }
 /*---------------------------------------------------------------------------*/
@@ -1337,32 +1363,31 @@ rpl_add_dag(uip_ipaddr_t *from, rpl_dio_t *dio)
     }
   }
   p->rank = dio->rank;
+  trust_engine_rank_observed(rpl_get_parent_lladdr(p), dio->rank,
+                             dag->rank, instance->min_hoprankinc);
 #if BRPL_CONF_ENABLE
   if(dio->brpl_queue_valid) {
-    p->brpl_queue = dio->brpl_queue;
-    p->brpl_queue_max = dio->brpl_queue_max;
-    p->brpl_queue_valid = 1;
+    p->brpl_queue.queue = dio->brpl_queue;
+    p->brpl_queue.queue_max = dio->brpl_queue_max;
+    p->brpl_queue.valid = 1;
+    p->brpl_queue.at = clock_time();
   } else {
-    p->brpl_queue_valid = 0;
+    p->brpl_queue.valid = 0;
   }
-  
-#if BRPL_CONF_TRUST_ENABLE
-  /* Update trust metrics when receiving DIO */
-  brpl_update_parent_trust(p, dag);
-#endif
+  p->brpl_queue.duty = dio->brpl_duty;
 
 #if defined(CSV_VERBOSE_LOGGING) && CSV_VERBOSE_LOGGING
   if(rpl_should_log()) {
     const linkaddr_t *lladdr = rpl_get_parent_lladdr(p);
-    uint16_t parent_id = lladdr ? lladdr->u8[LINKADDR_SIZE - 1] : 0xFFFF;
-    uint16_t self_id = (uint16_t)linkaddr_node_addr.u8[LINKADDR_SIZE - 1];
-    printf("CSV,BRPL_DIO,%u,%u,%u,%u,%u,%u\n",
-           (unsigned)self_id,
-           (unsigned)parent_id,
-           (unsigned)p->rank,
-           (unsigned)p->brpl_queue,
-           (unsigned)p->brpl_queue_max,
-           (unsigned)p->brpl_queue_valid);
+    int32_t *f = brpl_telemetry_begin(BRPL_TLM_DIO, 5);
+    if(f != NULL) {
+      f[0] = lladdr ? lladdr->u8[LINKADDR_SIZE - 1] : 0xFFFF;
+      f[1] = p->rank;
+      f[2] = p->brpl_queue.queue;
+      f[3] = p->brpl_queue.queue_max;
+      f[4] = p->brpl_queue.valid;
+      brpl_telemetry_commit();
+    }
   }
 #endif
 #endif
@@ -1524,6 +1549,11 @@ rpl_process_parent_event(rpl_instance_t *instance, rpl_parent_t *p)
 
   return_value = 1;
 
+#if BRPL_CONF_ENABLE
+  /* Rank or link metric of p may have changed */
+  brpl_parent_updated(p);
+#endif
+
   if(RPL_IS_STORING(instance)
      && uip_ds6_route_is_nexthop(rpl_parent_get_ipaddr(p))
      && !rpl_parent_is_reachable(p) && instance->mop > RPL_MOP_NON_STORING) {
@@ -1751,6 +1781,8 @@ rpl_process_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
     }
   }
   p->rank = dio->rank;
+  trust_engine_rank_observed(rpl_get_parent_lladdr(p), dio->rank,
+                             dag->rank, instance->min_hoprankinc);
 
   if(dio->rank == RPL_INFINITE_RANK && p == dag->preferred_parent) {
     /* Our preferred parent advertised an infinite rank, reset DIO timer. */
@@ -48,6 +48,7 @@
 #include "net/ipv6/uip-ds6.h"
 #include "net/ipv6/uip-sr.h"
 #include "net/routing/rpl-classic/rpl-private.h"
+#include "net/routing/brpl-queue.h"
 #include "net/packetbuf.h"
 
 #include "sys/log.h"
@@ -58,6 +59,48 @@
 #include <limits.h>
 #include <string.h>
 
+#define WITH_BRPL_QUEUE_RECORD (BRPL_CONF_ENABLE && BRPL_CONF_QUEUE_PIGGYBACK)
+
+#if WITH_BRPL_QUEUE_RECORD
+/* A BRPL queue record, when present, follows the RPL option and fills the
+ * second 8 octets of the hop-by-hop header */
+#define BRPL_HOP_BY_HOP_LEN (RPL_HOP_BY_HOP_LEN + 2 + BRPL_QUEUE_RECORD_LEN)
+#if BRPL_HOP_BY_HOP_LEN % 8 != 0
+#error "The BRPL queue record must pad the hop-by-hop header to 8 octets"
+#endif
+/*---------------------------------------------------------------------------*/
+/* The queue record of a hop-by-hop header, or NULL if it has none */
+static uint8_t *
+brpl_queue_record(uint8_t *ext_buf)
+{
+  struct uip_hbho_hdr *hbh_hdr = (struct uip_hbho_hdr *)ext_buf;
+  struct uip_ext_hdr_opt *opt = (struct uip_ext_hdr_opt *)(ext_buf + RPL_HOP_BY_HOP_LEN);
+
+  if(hbh_hdr->len == (BRPL_HOP_BY_HOP_LEN - 8) / 8
+     && opt->type == BRPL_CONF_QUEUE_HBH_OPTION
+     && opt->len == BRPL_QUEUE_RECORD_LEN) {
+    return (uint8_t *)(opt + 1);
+  }
+  return NULL;
+}
+#endif /* WITH_BRPL_QUEUE_RECORD */
+/*---------------------------------------------------------------------------*/
+/* Whether a hop-by-hop header has the size of one that only carries the
+ * RPL option, or also a BRPL queue record */
+static int
+hbh_len_is_valid(uint8_t *ext_buf)
+{
+  struct uip_hbho_hdr *hbh_hdr = (struct uip_hbho_hdr *)ext_buf;
+
+  if(hbh_hdr->len == (RPL_HOP_BY_HOP_LEN - 8) / 8) {
+    return 1;
+  }
+#if WITH_BRPL_QUEUE_RECORD
+  return brpl_queue_record(ext_buf) != NULL;
+#else /* WITH_BRPL_QUEUE_RECORD */
+  return 0;
+#endif /* WITH_BRPL_QUEUE_RECORD */
+}
 /*---------------------------------------------------------------------------*/
 int
 rpl_ext_header_hbh_update(uint8_t *ext_buf, int opt_offset)
@@ -78,7 +121,7 @@ rpl_ext_header_hbh_update(uint8_t *ext_buf, int opt_offset)
   struct uip_hbho_hdr *hbh_hdr = (struct uip_hbho_hdr *)ext_buf;
   struct uip_ext_hdr_opt_rpl *rpl_opt = (struct uip_ext_hdr_opt_rpl *)(ext_buf + opt_offset);
 
-  if(hbh_hdr->len != ((RPL_HOP_BY_HOP_LEN - 8) / 8)
+  if(opt_offset != 2 || !hbh_len_is_valid(ext_buf)
      || rpl_opt->opt_type != UIP_EXT_HDR_OPT_RPL
      || rpl_opt->opt_len != RPL_HDR_OPT_LEN) {
 
@@ -125,6 +168,15 @@ rpl_ext_header_hbh_update(uint8_t *ext_buf, int opt_offset)
   sender_rank = UIP_HTONS(rpl_opt->senderrank);
   sender = nbr_table_get_from_lladdr(rpl_parents, packetbuf_addr(PACKETBUF_ADDR_SENDER));
 
+#if WITH_BRPL_QUEUE_RECORD
+  /* Records come down from a parent, see update_brpl_queue_record() */
+  if(down && sender != NULL && brpl_queue_record(ext_buf) != NULL) {
+    struct brpl_queue_record record;
+    brpl_queue_record_read(brpl_queue_record(ext_buf), &record);
+    brpl_queue_record_input(sender, &record);
+  }
+#endif /* WITH_BRPL_QUEUE_RECORD */
+
   if(sender != NULL && (rpl_opt->flags & RPL_HDR_OPT_RANK_ERR)) {
     /* A rank error was signaled -- attempt to repair it by updating
        the sender's rank from the ext header. */
@@ -517,6 +569,48 @@ insert_srh_header(void)
   return 1;
 }
 /*---------------------------------------------------------------------------*/
+#if WITH_BRPL_QUEUE_RECORD
+/* Add our queue record to the hop-by-hop header, replacing the one of the
+ * previous hop, or remove it when the next hop does not need a new one.
+ * Only the nodes that chose us as their parent weigh our queue, so records
+ * go down the DAG, to children, and never up to our parent. */
+static void
+update_brpl_queue_record(rpl_instance_t *instance, int down)
+{
+  struct uip_hbho_hdr *hbh_hdr = (struct uip_hbho_hdr *)UIP_IP_PAYLOAD(0);
+  struct uip_ext_hdr_opt *opt = (struct uip_ext_hdr_opt *)UIP_IP_PAYLOAD(RPL_HOP_BY_HOP_LEN);
+  rpl_parent_t *next_hop = NULL;
+  uip_ds6_route_t *route;
+  int cur_len = (hbh_hdr->len << 3) + 8;
+  int new_len = RPL_HOP_BY_HOP_LEN;
+
+  if(down && uip_len - cur_len + BRPL_HOP_BY_HOP_LEN <= UIP_LINK_MTU) {
+    route = uip_ds6_route_lookup(&UIP_IP_BUF->destipaddr);
+    if(route != NULL) {
+      next_hop = rpl_find_parent(instance->current_dag,
+                                 (uip_ipaddr_t *)uip_ds6_route_nexthop(route));
+    }
+    if(brpl_queue_record_due(instance->current_dag, next_hop)) {
+      new_len = BRPL_HOP_BY_HOP_LEN;
+    }
+  }
+
+  if(new_len != cur_len) {
+    memmove(UIP_IP_PAYLOAD(new_len), UIP_IP_PAYLOAD(cur_len),
+            uip_len - UIP_IPH_LEN - cur_len);
+    hbh_hdr->len = (new_len - 8) / 8;
+    uipbuf_add_ext_hdr(new_len - cur_len);
+    uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+  }
+
+  if(new_len == BRPL_HOP_BY_HOP_LEN) {
+    opt->type = BRPL_CONF_QUEUE_HBH_OPTION;
+    opt->len = BRPL_QUEUE_RECORD_LEN;
+    brpl_queue_record_write((uint8_t *)(opt + 1));
+  }
+}
+#endif /* WITH_BRPL_QUEUE_RECORD */
+/*---------------------------------------------------------------------------*/
 static int
 update_hbh_header(void)
 {
@@ -527,7 +621,7 @@ update_hbh_header(void)
 
   if(UIP_IP_BUF->proto == UIP_PROTO_HBHO &&
      rpl_opt->opt_type == UIP_EXT_HDR_OPT_RPL) {
-    if(hbh_hdr->len != ((RPL_HOP_BY_HOP_LEN - 8) / 8) ||
+    if(!hbh_len_is_valid((uint8_t *)hbh_hdr) ||
        rpl_opt->opt_len != RPL_HDR_OPT_LEN) {
 
       LOG_ERR("Hop-by-hop extension header has wrong size (%u)\n",
@@ -589,6 +683,9 @@ update_hbh_header(void)
         }
       }
     }
+#if WITH_BRPL_QUEUE_RECORD
+    update_brpl_queue_record(instance, rpl_opt->flags & RPL_HDR_OPT_DOWN);
+#endif /* WITH_BRPL_QUEUE_RECORD */
   }
 
   return 1;
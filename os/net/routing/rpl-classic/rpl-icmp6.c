@@ -49,7 +49,9 @@
 #include "net/ipv6/uip-sr.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/routing/rpl-classic/rpl-private.h"
-#include "net/routing/rpl-classic/brpl-queue.h"
+#include "net/routing/brpl-queue.h"
+#include "net/routing/brpl-weight.h"
+#include "net/routing/brpl-energy.h"
 #include "net/packetbuf.h"
 #include "net/linkaddr.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
@@ -89,13 +91,11 @@ sinkhole_attack_is_enabled(void)
   return 1;
 }
 
-__attribute__((weak)) int
-smtrust_append_dio_options(uint8_t *buffer, int pos, int max_len)
-{
-  (void)buffer;
-  (void)max_len;
-  return pos;
-}
+/* A configurable function that appends options to outgoing DIOs, and
+ * returns the new end of the DIO. */
+#ifdef RPL_CALLBACK_DIO_OPTIONS
+int RPL_CALLBACK_DIO_OPTIONS(uint8_t *buffer, int pos, int max_len);
+#endif /* RPL_CALLBACK_DIO_OPTIONS */
 
 /*---------------------------------------------------------------------------*/
 static void dis_input(void);
@@ -333,6 +333,7 @@ dio_input(void)
   dio.lifetime_unit = RPL_DEFAULT_LIFETIME_UNIT;
 #if BRPL_CONF_ENABLE
   dio.brpl_queue_valid = 0;
+  dio.brpl_duty = 0;
 #endif
 
   uip_ipaddr_copy(&from, &UIP_IP_BUF->srcipaddr);
@@ -528,6 +529,13 @@ dio_input(void)
       dio.brpl_queue_max = get16(buffer, i + 4);
       dio.brpl_queue_valid = 1;
       break;
+    case BRPL_CONF_ENERGY_OPTION_CODE:
+      if(len != 4) {
+        LOG_WARN("Invalid BRPL energy option, len = %d\n", len);
+        goto discard;
+      }
+      dio.brpl_duty = get16(buffer, i + 2);
+      break;
 #endif
     default:
       LOG_WARN("Unsupported suboption type in DIO: %u\n",
@@ -672,6 +680,19 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
   pos += 2;
   set16(buffer, pos, brpl_queue_max());
   pos += 2;
+#if BRPL_CONF_ENERGY
+  if(brpl_energy_duty() != 0) {
+    buffer[pos++] = BRPL_CONF_ENERGY_OPTION_CODE;
+    buffer[pos++] = 2;
+    set16(buffer, pos, brpl_energy_duty());
+    pos += 2;
+  }
+#endif
+#if BRPL_CONF_QUEUE_ADV_LEVELS > 0
+  if(uc_addr == NULL) {
+    brpl_queue_dio_sent();
+  }
+#endif
 #endif
 
   /* Check if we have a prefix to send also. */
@@ -696,7 +717,9 @@ dio_output(rpl_instance_t *instance, uip_ipaddr_t *uc_addr)
             dag->prefix_info.length);
   }
 
-  pos = smtrust_append_dio_options(buffer, pos, UIP_BUFSIZE);
+#ifdef RPL_CALLBACK_DIO_OPTIONS
+  pos = RPL_CALLBACK_DIO_OPTIONS(buffer, pos, UIP_BUFSIZE);
+#endif /* RPL_CALLBACK_DIO_OPTIONS */
 
 #if RPL_LEAF_ONLY
   if(LOG_DBG_ENABLED) {
@@ -1300,6 +1323,9 @@ dao_output(rpl_parent_t *parent, uint8_t lifetime)
   }
 
   RPL_LOLLIPOP_INCREMENT(dao_sequence);
+#if BRPL_CONF_ENABLE
+  brpl_switch_stats.daos++;
+#endif /* BRPL_CONF_ENABLE */
 #if RPL_WITH_DAO_ACK
   /*
    * Set up the state since this will be the first transmission of
@@ -47,6 +47,7 @@
 #include "net/routing/rpl-classic/rpl-private.h"
 #include "net/nbr-table.h"
 #include "net/link-stats.h"
+#include "net/routing/trust-engine.h"
 
 #include "sys/log.h"
 
@@ -99,31 +100,6 @@
 /* Reject parents that have a higher path cost than the following. */
 #define MAX_PATH_COST      32768   /* Eq path ETX of 256 */
 
-/* SMTrust can override this to reject suspicious / low-trust parents
- * while leaving plain MRHOF behavior unchanged for other protocols. */
-__attribute__((weak)) int
-smtrust_is_parent_candidate(uint16_t node_id)
-{
-  (void)node_id;
-  return 1;
-}
-
-__attribute__((weak)) int
-smtrust_compare_parents(uint16_t p1_id, uint16_t p2_id,
-                        uint16_t p1_rank, uint16_t p2_rank,
-                        uint16_t self_rank,
-                        uint16_t p1_metric, uint16_t p2_metric)
-{
-  (void)p1_id;
-  (void)p2_id;
-  (void)p1_rank;
-  (void)p2_rank;
-  (void)self_rank;
-  (void)p1_metric;
-  (void)p2_metric;
-  return 0;
-}
-
 /*---------------------------------------------------------------------------*/
 static void
 reset(rpl_dag_t *dag)
@@ -217,17 +193,15 @@ parent_is_acceptable(rpl_parent_t *p)
 {
   uint16_t link_metric = parent_link_metric(p);
   uint16_t path_cost = parent_path_cost(p);
-  const linkaddr_t *lladdr = rpl_get_parent_lladdr(p);
-  uint16_t node_id = 0;
+  const struct trust_decision *trust;
 
-  if(lladdr != NULL) {
-    node_id = lladdr->u8[LINKADDR_SIZE - 1];
-  }
+  trust = trust_engine_decision(rpl_get_parent_lladdr(p));
 
-  /* Exclude links with too high link metrics or path cost. (RFC6719, 3.2.2) */
+  /* Exclude links with too high link metrics or path cost. (RFC6719, 3.2.2)
+     Also exclude the parents the trust engine does not allow. */
   return link_metric <= MAX_LINK_METRIC
       && path_cost <= MAX_PATH_COST
-      && smtrust_is_parent_candidate(node_id);
+      && (trust->flags & TRUST_DECISION_ALLOWED);
 }
 /*---------------------------------------------------------------------------*/
 static int
@@ -273,23 +247,18 @@ best_parent(rpl_parent_t *p1, rpl_parent_t *p2)
   p1_cost = parent_path_cost(p1);
   p2_cost = parent_path_cost(p2);
 
+#if TRUST_ENGINE_ENABLED
   {
-    const linkaddr_t *ll1 = rpl_get_parent_lladdr(p1);
-    const linkaddr_t *ll2 = rpl_get_parent_lladdr(p2);
-    uint16_t p1_id = ll1 != NULL ? ll1->u8[LINKADDR_SIZE - 1] : 0xffff;
-    uint16_t p2_id = ll2 != NULL ? ll2->u8[LINKADDR_SIZE - 1] : 0xffff;
-    uint16_t self_rank = dag != NULL ? dag->rank : RPL_INFINITE_RANK;
-    int trust_choice = smtrust_compare_parents(p1_id, p2_id,
-                                               p1->rank, p2->rank,
-                                               self_rank,
-                                               p1_cost, p2_cost);
-    if(trust_choice < 0) {
-      return p1;
-    }
-    if(trust_choice > 0) {
-      return p2;
+    /* Prefer a parent the trust engine does not ask us to leave */
+    uint8_t p1_escape = trust_engine_decision(rpl_get_parent_lladdr(p1))->flags
+      & TRUST_DECISION_ESCAPE;
+    uint8_t p2_escape = trust_engine_decision(rpl_get_parent_lladdr(p2))->flags
+      & TRUST_DECISION_ESCAPE;
+    if(p1_escape != p2_escape) {
+      return p1_escape ? p2 : p1;
     }
   }
+#endif /* TRUST_ENGINE_ENABLED */
 
   /* Maintain the stability of the preferred parent in case of similar ranks. */
   if(p1 == dag->preferred_parent || p2 == dag->preferred_parent) {
@@ -385,6 +354,7 @@ rpl_of_t rpl_mrhof = {
   parent_path_cost,
   rank_via_parent,
   best_parent,
+  NULL,
   best_dag,
   update_metric_container,
   RPL_OCP_MRHOF
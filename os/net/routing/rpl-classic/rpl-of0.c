@@ -230,6 +230,7 @@ rpl_of_t rpl_of0 = {
   parent_path_cost,
   rank_via_parent,
   best_parent,
+  NULL,
   best_dag,
   update_metric_container,
   RPL_OCP_OF0
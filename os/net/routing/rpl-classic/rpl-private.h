@@ -249,6 +249,7 @@ struct rpl_dio {
   uint16_t brpl_queue;
   uint16_t brpl_queue_max;
   uint8_t brpl_queue_valid;
+  uint16_t brpl_duty;
 #endif
 };
 typedef struct rpl_dio rpl_dio_t;
@@ -345,9 +346,47 @@ void rpl_purge_routes(void);
 /* Objective function. */
 rpl_of_t *rpl_find_of(rpl_ocp_t);
 
+#if BRPL_CONF_ENABLE
+/* DIO overhead of BRPL: Trickle DIOs sent and suppressed, DIOs sent on a
+ * queue occupancy level change, and Trickle resets on a backlog regime
+ * change */
+struct brpl_dio_stats {
+  uint32_t sent;
+  uint32_t suppressed;
+  uint32_t unsolicited;
+  uint32_t queue_resets;
+};
+extern struct brpl_dio_stats brpl_dio_stats;
+
+/* BRPL state engine. */
+void brpl_state_tick(rpl_dag_t *dag);
+void brpl_periodic_tick(void);
+void brpl_state_update(rpl_dag_t *dag);
+void brpl_parent_updated(rpl_parent_t *p);
+void brpl_parent_removed(rpl_parent_t *p);
+void brpl_preferred_parent_changed(rpl_dag_t *dag, rpl_parent_t *from,
+                                   rpl_parent_t *to);
+#if BRPL_CONF_PER_PACKET_NEXT_HOP
+int brpl_upward_next_hop(uip_ipaddr_t *ipaddr);
+#endif /* BRPL_CONF_PER_PACKET_NEXT_HOP */
+#if BRPL_CONF_QUEUE_PIGGYBACK
+struct brpl_queue_record;
+int brpl_queue_record_due(rpl_dag_t *dag, rpl_parent_t *p);
+void brpl_queue_record_input(rpl_parent_t *p,
+                             const struct brpl_queue_record *record);
+#endif /* BRPL_CONF_QUEUE_PIGGYBACK */
+#if BRPL_CONF_QUEUE_ADV_LEVELS > 0
+void brpl_queue_dio_sent(void);
+#endif /* BRPL_CONF_QUEUE_ADV_LEVELS > 0 */
+#endif /* BRPL_CONF_ENABLE */
+
 /* Timer functions. */
 void rpl_schedule_dao(rpl_instance_t *);
 void rpl_schedule_dao_immediately(rpl_instance_t *);
+#if BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH
+void rpl_schedule_dao_batch(rpl_instance_t *);
+int rpl_dao_batch_pending(rpl_instance_t *);
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH */
 void rpl_schedule_unicast_dio_immediately(rpl_instance_t *instance);
 void rpl_schedule_unicast_dao_immediately(
     rpl_instance_t *instance, rpl_parent_t *parent,
@@ -41,6 +41,7 @@
 
 #include "contiki.h"
 #include "net/routing/rpl-classic/rpl-private.h"
+#include "net/routing/brpl-weight.h"
 #include "net/link-stats.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 #include "net/ipv6/uip-sr.h"
@@ -91,6 +92,9 @@ handle_periodic_timer(void *ptr)
       uip_sr_periodic(1);
     }
   }
+#if BRPL_CONF_ENABLE
+  brpl_periodic_tick();
+#endif
   rpl_recalculate_ranks();
 
   /* Handle DIS. */
@@ -177,10 +181,16 @@ handle_dio_timer(void *ptr)
 #if RPL_CONF_STATS
       instance->dio_totsend++;
 #endif /* RPL_CONF_STATS */
+#if BRPL_CONF_ENABLE
+      brpl_dio_stats.sent++;
+#endif /* BRPL_CONF_ENABLE */
       dio_output(instance, NULL);
     } else {
       LOG_DBG("Suppressing DIO transmission (%d >= %d)\n",
               instance->dio_counter, instance->dio_redundancy);
+#if BRPL_CONF_ENABLE
+      brpl_dio_stats.suppressed++;
+#endif /* BRPL_CONF_ENABLE */
     }
     instance->dio_send = 0;
     LOG_DBG("Scheduling DIO timer %lu ticks in future (sent)\n",
@@ -286,6 +296,9 @@ handle_dao_timer(void *ptr)
     /* Set the route lifetime to the default value. */
     dao_output(instance->current_dag->preferred_parent,
                instance->default_lifetime);
+#if BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH
+    instance->dao_batch = 0;
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH */
 
 #if RPL_WITH_MULTICAST
     /* Send DAOs for multicast prefixes only if the instance is in MOP 3. */
@@ -361,6 +374,45 @@ rpl_schedule_dao_immediately(rpl_instance_t *instance)
   schedule_dao(instance, 0);
 }
 /*---------------------------------------------------------------------------*/
+#if BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH
+int
+rpl_dao_batch_pending(rpl_instance_t *instance)
+{
+  return instance->dao_batch && !ctimer_expired(&instance->dao_timer);
+}
+/*---------------------------------------------------------------------------*/
+void
+rpl_schedule_dao_batch(rpl_instance_t *instance)
+{
+  clock_time_t now = clock_time();
+  clock_time_t delay = (clock_time_t)BRPL_CONF_DAO_BATCH_DELAY * CLOCK_SECOND;
+  clock_time_t deadline;
+
+  if(rpl_get_mode() == RPL_MODE_FEATHER) {
+    return;
+  }
+
+  if(!rpl_dao_batch_pending(instance)) {
+    /* First switch of a batch, schedule the DAO as usual */
+    schedule_dao(instance, RPL_DAO_DELAY);
+    instance->dao_batch = 1;
+    instance->dao_batch_start = now;
+    return;
+  }
+
+  /* The DAO of an earlier switch is still pending: it will carry this
+   * switch too, once switching has settled */
+  deadline = instance->dao_batch_start +
+    (clock_time_t)BRPL_CONF_DAO_BATCH_MAX * CLOCK_SECOND;
+  if(now + delay > deadline) {
+    delay = deadline > now ? deadline - now : 0;
+  }
+  LOG_DBG("Batching DAO, %u ticks in the future\n", (unsigned)delay);
+  ctimer_set(&instance->dao_timer, delay, handle_dao_timer, instance);
+  brpl_switch_stats.daos_batched++;
+}
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH */
+/*---------------------------------------------------------------------------*/
 static void
 handle_unicast_dao_timer(void *ptr_instance)
 {
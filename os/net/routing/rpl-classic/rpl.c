@@ -46,8 +46,10 @@
 #include "net/ipv6/uip-sr.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/routing/routing.h"
+#include "net/routing/trust-engine.h"
 #include "net/routing/rpl-classic/rpl-private.h"
-#include "net/routing/rpl-classic/brpl-queue.h"
+#include "net/routing/brpl-queue.h"
+#include "net/routing/rpl-classic/brpl-telemetry.h"
 #include "net/routing/rpl-classic/rpl-dag-root.h"
 #include "net/ipv6/multicast/uip-mcast6.h"
 
@@ -270,6 +272,8 @@ rpl_link_callback(const linkaddr_t *addr, int status, int numtx)
   rpl_instance_t *instance;
   rpl_instance_t *end;
 
+  trust_engine_tx_outcome(addr, status, numtx);
+
   uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
   uip_ds6_set_addr_iid(&ipaddr, (uip_lladdr_t *)addr);
 
@@ -356,6 +360,10 @@ init(void)
   default_instance = NULL;
 
   rpl_dag_init();
+  trust_engine_init();
+#if BRPL_TELEMETRY_ENABLED
+  brpl_telemetry_init();
+#endif
 #if BRPL_CONF_ENABLE
   brpl_queue_init(BRPL_CONF_QUEUE_MAX);
 #endif
@@ -417,6 +425,16 @@ drop_route(uip_ds6_route_t *route)
   }
 }
 /*---------------------------------------------------------------------------*/
+static int
+default_route_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+#if BRPL_CONF_ENABLE && BRPL_CONF_PER_PACKET_NEXT_HOP
+  return brpl_upward_next_hop(ipaddr);
+#else /* BRPL_CONF_ENABLE && BRPL_CONF_PER_PACKET_NEXT_HOP */
+  return 0;
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_PER_PACKET_NEXT_HOP */
+}
+/*---------------------------------------------------------------------------*/
 static void
 leave_network(void)
 {
@@ -466,6 +484,7 @@ const struct routing_driver rpl_classic_driver = {
   rpl_ext_header_hbh_update,
   rpl_ext_header_srh_update,
   rpl_ext_header_srh_get_next_hop,
+  default_route_get_next_hop,
   rpl_link_callback,
   rpl_ipv6_neighbor_callback,
   drop_route,
@@ -38,6 +38,7 @@
 #define RPL_H
 
 #include "net/routing/rpl-classic/rpl-conf.h"
+#include "net/routing/brpl-queue.h"
 
 #include "lib/list.h"
 #include "net/ipv6/uip.h"
@@ -87,7 +88,7 @@ typedef uint16_t rpl_ocp_t;
 /* IANA Objective Code Point as defined in RFC6550. */
 #define RPL_OCP_OF0     0
 #define RPL_OCP_MRHOF   1
-#define RPL_OCP_BRPL    2
+/* RPL_OCP_BRPL is in net/routing/brpl-conf.h */
 
 struct rpl_metric_object_energy {
   uint8_t flags;
@@ -123,21 +124,10 @@ struct rpl_parent {
   uint8_t dtsn;
   uint8_t flags;
 #if BRPL_CONF_ENABLE
-  uint16_t brpl_queue;
-  uint16_t brpl_queue_max;
-  uint8_t brpl_queue_valid;
-  
-  /* Trust values (scaled by 1000) */
-  uint16_t trust_gray;         /* Grayhole trust (data-plane) */
-  uint16_t trust_sink_adv;     /* Sinkhole advertisement trust */
-  uint16_t trust_sink_stab;    /* Sinkhole stability trust */
-  uint16_t trust_total;        /* Combined total trust */
-  
-  /* Trust computation state */
-  rpl_rank_t last_rank;        /* For stability tracking */
-  uint32_t last_rank_update;   /* Timestamp of rank update */
-  uint32_t packets_sent;       /* For grayhole detection */
-  uint32_t packets_dropped;    /* For grayhole detection */
+  struct brpl_nbr_queue brpl_queue;
+  uint16_t brpl_adv_queue;     /* Local queue length last sent to it */
+  clock_time_t brpl_adv_at;    /* When it was last sent a queue record */
+  uint32_t brpl_p_tilde;       /* Path cost through this parent, for pmax */
 #endif
 };
 typedef struct rpl_parent rpl_parent_t;
@@ -172,13 +162,32 @@ struct rpl_dag {
   uint16_t brpl_beta;  /* scaled by 1000 */
   uint16_t brpl_q_avg; /* EWMA queue length (packets) */
   uint32_t brpl_pmax;  /* max p_tilde among neighbors */
-  uint32_t brpl_last_beta_update;
-  uint16_t brpl_last_nbr_count;
+  uint16_t brpl_qx;    /* local queue length snapshot of the current round */
+  uint16_t brpl_qmax;  /* local queue capacity snapshot of the current round */
+  uint32_t brpl_epoch; /* number of state ticks since the last reset */
+  uint8_t brpl_pmax_dirty; /* brpl_pmax may be too high, rescan needed */
+  uint8_t brpl_congested;  /* Backlog regime, for the Trickle resets */
+#if BRPL_CONF_ENERGY
+  uint16_t brpl_duty_median; /* median duty cycle of the parents (per mille) */
+#endif
 #endif
 };
 typedef struct rpl_dag rpl_dag_t;
 typedef struct rpl_instance rpl_instance_t;
 /*---------------------------------------------------------------------------*/
+/* Score of a candidate parent, filled in by an OF's best_parent_batch */
+struct rpl_parent_score {
+  rpl_parent_t *parent;
+  int32_t weight;      /* OF cost, lower is better */
+  int32_t raw_weight;  /* OF cost before trust penalties */
+  uint16_t id;
+  uint16_t trust;      /* scaled by 1000 */
+  uint16_t switch_margin; /* extra gain required to switch to it */
+  uint8_t trust_flags; /* TRUST_DECISION_* flags of the trust engine */
+  uint8_t allowed;
+};
+typedef struct rpl_parent_score rpl_parent_score_t;
+/*---------------------------------------------------------------------------*/
 /*
  * API for RPL objective functions (OF)
  *
@@ -211,6 +220,13 @@ typedef struct rpl_instance rpl_instance_t;
  *
  *  Compares two parents and returns the best one, according to the OF.
  *
+ * best_parent_batch(dag, scores, count)
+ *
+ *  Optional. Scores all candidate parents of a DAG in one pass and
+ *  returns the best one. The caller only sets the parent field of each
+ *  entry, the OF fills in the rest. Must select the same parent as
+ *  folding best_parent() over the candidates in the same order.
+ *
  * best_dag(dag1, dag2)
  *
  *  Compares two DAGs and returns the best one, according to the OF.
@@ -237,6 +253,7 @@ struct rpl_of {
   uint16_t (*parent_path_cost)(rpl_parent_t *);
   rpl_rank_t (*rank_via_parent)(rpl_parent_t *);
   rpl_parent_t *(*best_parent)(rpl_parent_t *, rpl_parent_t *);
+  rpl_parent_t *(*best_parent_batch)(rpl_dag_t *, struct rpl_parent_score *, uint16_t);
   rpl_dag_t *(*best_dag)(rpl_dag_t *, rpl_dag_t *);
   void (*update_metric_container)( rpl_instance_t *);
   rpl_ocp_t ocp;
@@ -295,6 +312,10 @@ struct rpl_instance {
   rpl_parent_t *unicast_dao_target;
   uip_ipaddr_t *unicast_dao_prefix;
   uint8_t unicast_dao_lifetime;
+#if BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH
+  clock_time_t dao_batch_start; /* First parent switch of the pending DAO */
+  uint8_t dao_batch;            /* The pending DAO follows a parent switch */
+#endif /* BRPL_CONF_ENABLE && BRPL_CONF_DAO_BATCH */
 };
 
 /*---------------------------------------------------------------------------*/
@@ -367,17 +388,6 @@ enum rpl_mode rpl_get_mode(void);
  */
 int rpl_has_joined(void);
 
-#if BRPL_CONF_ENABLE && BRPL_CONF_TRUST_ENABLE
-/**
- * Update trust metrics for a parent based on current observations.
- * Should be called periodically or when receiving DIOs.
- *
- * \param p The parent to update trust for
- * \param dag The DAG the parent belongs to
- */
-void brpl_update_parent_trust(rpl_parent_t *p, rpl_dag_t *dag);
-#endif
-
 /**
  * Get the RPL's best guess on if we have downward route or not.
  *
@@ -0,0 +1,277 @@
+/**
+ * \addtogroup rpl-lite
+ * @{
+ *
+ * \file
+ *         The BRPL objective function: backpressure parent selection,
+ *         blending the MRHOF path cost with the queue differential to each
+ *         neighbor. The weights are computed by net/routing/brpl-weight.h,
+ *         as in rpl-classic; the link and rank metrics are those of MRHOF.
+ */
+
+#include "net/routing/rpl-lite/rpl.h"
+#include "net/routing/brpl-weight.h"
+#include "net/routing/brpl-energy.h"
+#include "net/routing/trust-engine.h"
+#include "net/nbr-table.h"
+#include "sys/ctimer.h"
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "RPL"
+#define LOG_LEVEL LOG_LEVEL_RPL
+
+#if BRPL_CONF_ENABLE
+
+extern rpl_of_t rpl_mrhof;
+extern rpl_of_t rpl_brpl;
+
+/* Period of the queue EWMA, as the periodic timer of rpl-classic */
+#define TICK_PERIOD CLOCK_SECOND
+
+/*
+ * State of the OF. rpl-lite runs a single DAG, so it is kept here rather
+ * than in the DAG. The queue EWMA and theta advance on a timer, so that
+ * they do not depend on how often neighbors are compared, and the local
+ * queue and pmax are snapshotted once per selection round, so that all
+ * candidates of a round are scored against the same state.
+ */
+static struct {
+  uint16_t theta;  /* scaled by 1000 */
+  uint16_t q_avg;  /* EWMA queue length (packets) */
+  uint16_t qx;     /* local queue length snapshot of the current round */
+  uint16_t qmax;   /* local queue capacity snapshot of the current round */
+  uint32_t pmax;   /* max p_tilde among neighbors */
+  uint32_t epoch;  /* number of state ticks since the last reset */
+#if BRPL_CONF_ENERGY
+  uint16_t duty_median; /* median duty cycle of the neighbors (per mille) */
+#endif
+} state;
+
+static struct ctimer tick_timer;
+
+/* Everything the comparison needs of a neighbor */
+struct score {
+  int32_t weight;      /* OF cost, lower is better */
+  int32_t raw_weight;  /* OF cost before trust penalties */
+  uint16_t switch_margin;
+  uint8_t trust_flags;
+  uint8_t allowed;
+};
+/*---------------------------------------------------------------------------*/
+static int
+is_active(void)
+{
+  return curr_instance.used && curr_instance.of == &rpl_brpl;
+}
+/*---------------------------------------------------------------------------*/
+static void
+state_tick(void)
+{
+  state.q_avg = brpl_queue_ewma(state.q_avg, brpl_queue_length());
+  /* QuickTheta: theta = Qx / Qmax, the weight of the path cost grows
+   * with the local backlog */
+  state.theta = brpl_scale_ratio(state.q_avg, brpl_queue_max());
+  state.epoch++;
+  brpl_switch_stats_tick();
+#if BRPL_CONF_ENERGY
+  brpl_energy_tick();
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static void
+handle_tick_timer(void *ptr)
+{
+  if(!is_active()) {
+    return;
+  }
+  state_tick();
+  ctimer_reset(&tick_timer);
+}
+/*---------------------------------------------------------------------------*/
+/* Path cost through nbr */
+static uint32_t
+p_tilde(rpl_nbr_t *nbr)
+{
+  if(nbr->rank == RPL_INFINITE_RANK) {
+    return 0;
+  }
+  return (uint32_t)rpl_mrhof.nbr_link_metric(nbr) + nbr->rank;
+}
+/*---------------------------------------------------------------------------*/
+static void
+round_start(void)
+{
+  rpl_nbr_t *nbr;
+  rpl_nbr_t *preferred = curr_instance.dag.preferred_parent;
+  uint32_t p;
+#if BRPL_CONF_ENERGY
+  uint16_t duty[BRPL_ENERGY_MAX_SAMPLES];
+  uint8_t n = 0;
+#endif
+
+  if(state.epoch == 0) {
+    /* First round before any timer tick */
+    state_tick();
+  }
+
+  state.pmax = 1;
+  for(nbr = nbr_table_head(rpl_neighbors); nbr != NULL;
+      nbr = nbr_table_next(rpl_neighbors, nbr)) {
+    p = p_tilde(nbr);
+    if(p > state.pmax) {
+      state.pmax = p;
+    }
+#if BRPL_CONF_ENERGY
+    if(n < BRPL_ENERGY_MAX_SAMPLES) {
+      duty[n++] = nbr->brpl_queue.duty;
+    }
+#endif
+  }
+#if BRPL_CONF_ENERGY
+  state.duty_median = brpl_energy_median(duty, n);
+#endif
+  state.qx = brpl_queue_length();
+  state.qmax = brpl_queue_max();
+
+  brpl_track_preferred(preferred != NULL ? rpl_neighbor_get_lladdr(preferred) : NULL);
+  /* rpl-lite is non-storing: a switch costs our own DAO, sent end to end
+   * to the root */
+  brpl_switch_context(0, DAG_RANK(curr_instance.dag.rank));
+}
+/*---------------------------------------------------------------------------*/
+static void
+score_nbr(rpl_nbr_t *nbr, struct score *s)
+{
+  const struct trust_decision *d =
+    trust_engine_decision(rpl_neighbor_get_lladdr(nbr));
+  uint16_t qy = brpl_nbr_queue_length(&nbr->brpl_queue, nbr->rank,
+                                      curr_instance.dag.rank,
+                                      state.qx, state.qmax);
+  uint16_t p_norm = brpl_scale_ratio(p_tilde(nbr), state.pmax);
+
+  s->raw_weight = brpl_weight(state.theta, p_norm,
+                              brpl_dq_norm(state.qx, qy, state.qmax));
+#if BRPL_CONF_ENERGY
+  s->raw_weight += brpl_energy_term(nbr->brpl_queue.duty, state.duty_median);
+#endif
+  s->weight = brpl_trust_penalty(s->raw_weight, d, brpl_trust_clamped(d),
+                                 nbr == curr_instance.dag.preferred_parent);
+  s->switch_margin = d->switch_margin;
+  s->trust_flags = d->flags;
+  s->allowed = (d->flags & TRUST_DECISION_ALLOWED) ? 1 : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset(void)
+{
+  LOG_INFO("reset BRPL\n");
+  state.theta = BRPL_SCALE;
+  state.q_avg = 0;
+  state.qx = 0;
+  state.qmax = 0;
+  state.pmax = 1;
+  state.epoch = 0;
+  ctimer_set(&tick_timer, TICK_PERIOD, handle_tick_timer, NULL);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+nbr_link_metric(rpl_nbr_t *nbr)
+{
+  return rpl_mrhof.nbr_link_metric(nbr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+nbr_has_usable_link(rpl_nbr_t *nbr)
+{
+  return rpl_mrhof.nbr_has_usable_link(nbr);
+}
+/*---------------------------------------------------------------------------*/
+static int
+nbr_is_acceptable_parent(rpl_nbr_t *nbr)
+{
+  /* Trust is not checked here: best_parent() falls back to distrusted
+   * neighbors when no other is left */
+  return rpl_mrhof.nbr_is_acceptable_parent(nbr);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+nbr_path_cost(rpl_nbr_t *nbr)
+{
+  return rpl_mrhof.nbr_path_cost(nbr);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_rank_t
+rank_via_nbr(rpl_nbr_t *nbr)
+{
+  return rpl_mrhof.rank_via_nbr(nbr);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_nbr_t *
+best_parent(rpl_nbr_t *nbr1, rpl_nbr_t *nbr2)
+{
+  rpl_nbr_t *preferred = curr_instance.dag.preferred_parent;
+  struct score s1;
+  struct score s2;
+  rpl_nbr_t *best;
+
+  if(nbr1 == NULL) {
+    /* The neighbor module folds best_parent() over the candidates,
+     * starting from NULL: this is a new selection round */
+    round_start();
+    return nbr2;
+  }
+  if(nbr2 == NULL) {
+    return nbr1;
+  }
+
+  score_nbr(nbr1, &s1);
+  score_nbr(nbr2, &s2);
+
+  if(s1.allowed != s2.allowed) {
+    return s1.allowed ? nbr1 : nbr2;
+  }
+  /* Fallback policy: if both are hard-excluded, keep one lowest-cost
+   * candidate to avoid dead-end routing. */
+  if(!s1.allowed) {
+    return s2.raw_weight < s1.raw_weight ? nbr2 : nbr1;
+  }
+
+  best = s2.weight < s1.weight ? nbr2 : nbr1;
+
+  /* Hysteresis gate: if we are about to switch away from the currently
+   * preferred parent, require a meaningful score improvement. */
+  if(nbr1 == preferred && best == nbr2) {
+    if(!brpl_switch_allowed(s1.weight, s1.trust_flags, s1.allowed, s2.weight,
+                            s2.trust_flags, s2.switch_margin, NULL)) {
+      best = nbr1;
+    }
+  } else if(nbr2 == preferred && best == nbr1) {
+    if(!brpl_switch_allowed(s2.weight, s2.trust_flags, s2.allowed, s1.weight,
+                            s1.trust_flags, s1.switch_margin, NULL)) {
+      best = nbr2;
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+static void
+update_metric_container(void)
+{
+  rpl_mrhof.update_metric_container();
+}
+/*---------------------------------------------------------------------------*/
+rpl_of_t rpl_brpl = {
+  reset,
+  nbr_link_metric,
+  nbr_has_usable_link,
+  nbr_is_acceptable_parent,
+  nbr_path_cost,
+  rank_via_nbr,
+  best_parent,
+  update_metric_container,
+  RPL_OCP_BRPL
+};
+#endif /* BRPL_CONF_ENABLE */
+
+/** @}*/
@@ -46,6 +46,7 @@
 #define RPL_CONF_H
 
 #include "contiki.h"
+#include "net/routing/brpl-conf.h"
 
 /******************************************************************************/
 /*********************** Enabling/disabling features **************************/
@@ -76,7 +77,7 @@
 /*
  * The objective function (OF) used by a RPL root is configurable through
  * the RPL_CONF_OF_OCP parameter. This is defined as the objective code
- * point (OCP) of the OF, RPL_OCP_OF0 or RPL_OCP_MRHOF. This flag is of
+ * point (OCP) of the OF, RPL_OCP_OF0, RPL_OCP_MRHOF or RPL_OCP_BRPL. This flag is of
  * no relevance to non-root nodes, which run the OF advertised in the
  * instance they join.
  * Make sure the selected of is inRPL_SUPPORTED_OFS.
@@ -94,6 +95,8 @@
  */
 #ifdef RPL_CONF_SUPPORTED_OFS
 #define RPL_SUPPORTED_OFS RPL_CONF_SUPPORTED_OFS
+#elif BRPL_CONF_ENABLE
+#define RPL_SUPPORTED_OFS {&rpl_brpl, &rpl_mrhof}
 #else /* RPL_CONF_SUPPORTED_OFS */
 #define RPL_SUPPORTED_OFS {&rpl_mrhof}
 #endif /* RPL_CONF_SUPPORTED_OFS */
@@ -339,11 +342,11 @@
  * use 128 for RPL_MIN_HOPRANKINC, resulting in a rank equal to the
  * ETX path cost. Larger values may also be desirable, as discussed
  * in section 6.1 of RFC6719. */
-#if RPL_OF_OCP == RPL_OCP_MRHOF
+#if RPL_OF_OCP == RPL_OCP_MRHOF || RPL_OF_OCP == RPL_OCP_BRPL
 #define RPL_MIN_HOPRANKINC          128
-#else /* RPL_OF_OCP == RPL_OCP_MRHOF */
+#else /* RPL_OF_OCP == RPL_OCP_MRHOF || RPL_OF_OCP == RPL_OCP_BRPL */
 #define RPL_MIN_HOPRANKINC          256
-#endif /* RPL_OF_OCP == RPL_OCP_MRHOF */
+#endif /* RPL_OF_OCP == RPL_OCP_MRHOF || RPL_OF_OCP == RPL_OCP_BRPL */
 #else /* RPL_CONF_MIN_HOPRANKINC */
 #define RPL_MIN_HOPRANKINC          RPL_CONF_MIN_HOPRANKINC
 #endif /* RPL_CONF_MIN_HOPRANKINC */
@@ -89,6 +89,7 @@
 /* IANA Objective Code Point as defined in RFC6550 */
 #define RPL_OCP_OF0     0
 #define RPL_OCP_MRHOF   1
+/* RPL_OCP_BRPL is in net/routing/brpl-conf.h */
 
 /*---------------------------------------------------------------------------*/
 /* RPL message types */
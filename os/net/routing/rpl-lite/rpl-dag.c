@@ -46,6 +46,7 @@
 #include "net/ipv6/uip-sr.h"
 #include "net/nbr-table.h"
 #include "net/link-stats.h"
+#include "net/routing/trust-engine.h"
 
 /* Log configuration */
 #include "sys/log.h"
@@ -53,7 +54,7 @@
 #define LOG_LEVEL LOG_LEVEL_RPL
 
 /*---------------------------------------------------------------------------*/
-extern rpl_of_t rpl_of0, rpl_mrhof;
+extern rpl_of_t rpl_of0, rpl_mrhof, rpl_brpl;
 static rpl_of_t * const objective_functions[] = RPL_SUPPORTED_OFS;
 static int process_dio_init_dag(rpl_dio_t *dio);
 
@@ -390,6 +391,19 @@ update_nbr_from_dio(uip_ipaddr_t *from, rpl_dio_t *dio)
   /* Update neighbor info from DIO */
   nbr->rank = dio->rank;
   nbr->dtsn = dio->dtsn;
+  trust_engine_rank_observed(rpl_neighbor_get_lladdr(nbr), dio->rank,
+                             curr_instance.dag.rank, curr_instance.min_hoprankinc);
+#if BRPL_CONF_ENABLE
+  if(dio->brpl_queue_valid) {
+    nbr->brpl_queue.queue = dio->brpl_queue;
+    nbr->brpl_queue.queue_max = dio->brpl_queue_max;
+    nbr->brpl_queue.valid = 1;
+    nbr->brpl_queue.at = clock_time();
+  } else {
+    nbr->brpl_queue.valid = 0;
+  }
+  nbr->brpl_queue.duty = dio->brpl_duty;
+#endif /* BRPL_CONF_ENABLE */
 #if RPL_WITH_MC
   memcpy(&nbr->mc, &dio->mc, sizeof(nbr->mc));
 #endif /* RPL_WITH_MC */
@@ -47,6 +47,8 @@
 #include "net/routing/rpl-lite/rpl.h"
 #include "net/ipv6/uip-icmp6.h"
 #include "net/packetbuf.h"
+#include "net/routing/brpl-weight.h"
+#include "net/routing/brpl-energy.h"
 #include "lib/random.h"
 
 #include <inttypes.h>
@@ -332,6 +334,24 @@ dio_input(void)
         /* 32-bit reserved at i + 12 */
         memcpy(&dio.prefix_info.prefix, &buffer[i + 16], 16);
         break;
+#if BRPL_CONF_ENABLE
+      case BRPL_CONF_QUEUE_OPTION_CODE:
+        if(len != 6) {
+          LOG_WARN("dio_input: invalid BRPL queue option, len %u, discard\n", len);
+          goto discard;
+        }
+        dio.brpl_queue = get16(buffer, i + 2);
+        dio.brpl_queue_max = get16(buffer, i + 4);
+        dio.brpl_queue_valid = 1;
+        break;
+      case BRPL_CONF_ENERGY_OPTION_CODE:
+        if(len != 4) {
+          LOG_WARN("dio_input: invalid BRPL energy option, len %u, discard\n", len);
+          goto discard;
+        }
+        dio.brpl_duty = get16(buffer, i + 2);
+        break;
+#endif /* BRPL_CONF_ENABLE */
       default:
         LOG_WARN("dio_input: unsupported suboption type in DIO: %u, discard\n", (unsigned)subopt_type);
         goto discard;
@@ -441,6 +461,23 @@ rpl_icmp6_dio_output(uip_ipaddr_t *uc_addr)
   set16(buffer, pos, curr_instance.lifetime_unit);
   pos += 2;
 
+#if BRPL_CONF_ENABLE
+  buffer[pos++] = BRPL_CONF_QUEUE_OPTION_CODE;
+  buffer[pos++] = 4;
+  set16(buffer, pos, brpl_queue_length());
+  pos += 2;
+  set16(buffer, pos, brpl_queue_max());
+  pos += 2;
+#if BRPL_CONF_ENERGY
+  if(brpl_energy_duty() != 0) {
+    buffer[pos++] = BRPL_CONF_ENERGY_OPTION_CODE;
+    buffer[pos++] = 2;
+    set16(buffer, pos, brpl_energy_duty());
+    pos += 2;
+  }
+#endif /* BRPL_CONF_ENERGY */
+#endif /* BRPL_CONF_ENABLE */
+
   /* Check if we have a prefix to send also. */
   if(curr_instance.dag.prefix_info.length > 0) {
     buffer[pos++] = RPL_OPTION_PREFIX_INFO;
@@ -618,6 +655,10 @@ rpl_icmp6_dao_output(uint8_t lifetime)
     return;
   }
 
+#if BRPL_CONF_ENABLE
+  brpl_switch_stats.daos++;
+#endif /* BRPL_CONF_ENABLE */
+
   buffer = UIP_ICMP_PAYLOAD;
   pos = 0;
 
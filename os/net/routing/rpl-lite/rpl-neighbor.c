@@ -47,6 +47,7 @@
 #include "net/link-stats.h"
 #include "net/nbr-table.h"
 #include "net/ipv6/uiplib.h"
+#include "net/routing/brpl-weight.h"
 
 /* Log configuration */
 #include "sys/log.h"
@@ -287,6 +288,12 @@ rpl_neighbor_set_preferred_parent(rpl_nbr_t *nbr)
 #ifdef RPL_CALLBACK_PARENT_SWITCH
     RPL_CALLBACK_PARENT_SWITCH(curr_instance.dag.preferred_parent, nbr);
 #endif /* RPL_CALLBACK_PARENT_SWITCH */
+#if BRPL_CONF_ENABLE
+    if(curr_instance.of->ocp == RPL_OCP_BRPL
+       && curr_instance.dag.preferred_parent != NULL && nbr != NULL) {
+      brpl_switch_stats.switches++;
+    }
+#endif /* BRPL_CONF_ENABLE */
 
     /* Always keep the preferred parent locked, so it remains in the
      * neighbor table. */
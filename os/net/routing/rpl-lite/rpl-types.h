@@ -142,6 +142,9 @@ struct rpl_nbr {
 #endif /* RPL_WITH_MC */
   rpl_rank_t rank;
   uint8_t dtsn;
+#if BRPL_CONF_ENABLE
+  struct brpl_nbr_queue brpl_queue;
+#endif
 };
 typedef struct rpl_nbr rpl_nbr_t;
 
@@ -43,6 +43,7 @@
 
 #include "net/routing/rpl-lite/rpl.h"
 #include "net/routing/routing.h"
+#include "net/routing/trust-engine.h"
 
 /* Log configuration */
 #include "sys/log.h"
@@ -96,6 +97,8 @@ rpl_get_global_address(void)
 void
 rpl_link_callback(const linkaddr_t *addr, int status, int numtx)
 {
+  trust_engine_tx_outcome(addr, status, numtx);
+
   if(curr_instance.used == 1 ) {
     rpl_nbr_t *nbr = rpl_neighbor_get_from_lladdr((uip_lladdr_t *)addr);
     if(nbr != NULL) {
@@ -202,6 +205,10 @@ init(void)
 
   rpl_dag_init();
   rpl_neighbor_init();
+  trust_engine_init();
+#if BRPL_CONF_ENABLE
+  brpl_queue_init(BRPL_CONF_QUEUE_MAX);
+#endif
   rpl_timers_init();
   rpl_icmp6_init();
 
@@ -238,6 +245,13 @@ rpl_set_leaf_only(uint8_t value)
   rpl_leaf_only = value;
 }
 /*---------------------------------------------------------------------------*/
+static int
+default_route_get_next_hop(uip_ipaddr_t *ipaddr)
+{
+  /* Upward traffic always goes to the preferred parent */
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 rpl_get_leaf_only(void)
 {
@@ -262,6 +276,7 @@ const struct routing_driver rpl_lite_driver = {
   rpl_ext_header_hbh_update,
   rpl_ext_header_srh_update,
   rpl_ext_header_srh_get_next_hop,
+  default_route_get_next_hop,
   rpl_link_callback,
   neighbor_state_changed,
   drop_route,
@@ -50,6 +50,7 @@
 #include "net/ipv6/uip.h"
 #include "net/routing/rpl-lite/rpl-const.h"
 #include "net/routing/rpl-lite/rpl-conf.h"
+#include "net/routing/brpl-queue.h"
 #include "net/routing/rpl-lite/rpl-types.h"
 
 /********** Public symbols **********/
@@ -0,0 +1,581 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         Per-neighbor trust engine for routing.
+ */
+
+#include "contiki.h"
+#include "net/routing/trust-engine.h"
+#include "net/nbr-table.h"
+#include "net/mac/mac.h"
+#include "sys/ctimer.h"
+#include "lib/fixmath.h"
+#if TRUST_ENGINE_ENABLED && TRUST_ENGINE_WATCHDOG
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-icmp6.h"
+#include "net/mac/mac-overhear.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/routing/routing.h"
+#include "lib/random.h"
+#endif /* TRUST_ENGINE_ENABLED && TRUST_ENGINE_WATCHDOG */
+
+#include <string.h>
+
+const struct trust_decision trust_engine_neutral = {
+  TRUST_ENGINE_SCALE, TRUST_ENGINE_SCALE, TRUST_ENGINE_SCALE, 0,
+  TRUST_DECISION_ALLOWED
+};
+
+#if TRUST_ENGINE_ENABLED
+
+#define NO_SAMPLE 0xffff
+#define NO_RANK   0xffff
+
+struct trust_record {
+  /* Precomputed once per epoch, read by the objective functions */
+  struct trust_decision decision;
+  /* Verdict of an external trust agent, trust_engine_neutral if none */
+  struct trust_decision verdict;
+  /* Trust components, EWMA over the epochs */
+  uint16_t data;        /* delivery of our unicast packets */
+  uint16_t forwarding;  /* forwarding of the packets it acknowledged */
+  uint16_t sink_adv;    /* plausibility of the advertised rank */
+  uint16_t sink_stab;   /* stability of the advertised rank */
+  /* Observations of the current epoch */
+  uint16_t tx_ok;
+  uint16_t tx_failed;
+  uint16_t fwd_ok;
+  uint16_t fwd_missed;
+  uint16_t adv_sample;  /* lowest of the epoch, or NO_SAMPLE */
+  uint16_t stab_sample; /* lowest of the epoch, or NO_SAMPLE */
+  /* Rank at the start of the stability window, or NO_RANK */
+  uint16_t window_rank;
+  unsigned long window_start;
+};
+
+NBR_TABLE(struct trust_record, trust_records);
+
+struct trust_engine_stats trust_engine_stats;
+static struct ctimer epoch_timer;
+
+#if TRUST_ENGINE_WATCHDOG
+/* Bytes at the end of a packet that identify it. 6LoWPAN carries the tail
+ * of the IPv6 payload as is, in the last fragment if it fragments it. */
+#define FINGERPRINT_LEN 8
+/* Only packets with enough payload that the fingerprint cannot include a
+ * compressed next header */
+#define WATCH_MIN_LEN   (UIP_IPH_LEN + 8 + FINGERPRINT_LEN)
+
+#define PROBE_ID        0x7477
+#define PROBE_LEN       (4 + FINGERPRINT_LEN)
+
+/* With link-layer security, overheard frames are encrypted for their
+ * receiver and their payload cannot be matched: only the probes can check
+ * forwarding */
+#define WATCH_OVERHEARING (!LLSEC802154_ENABLED)
+
+enum watch_state {
+  WATCH_FREE,
+  WATCH_STAGED, /* handed to the MAC, waiting for the link-layer ACK */
+  WATCH_ARMED,  /* acknowledged, waiting for the neighbor to forward it */
+};
+
+enum watch_outcome {
+  WATCH_INCONCLUSIVE,
+  WATCH_FORWARDED,
+  WATCH_MISSED,
+};
+
+struct watch {
+  linkaddr_t nexthop;
+  clock_time_t start;
+  uint16_t fingerprint;
+  uint16_t tag;         /* UIPBUF_ATTR_TX_TAG of the packet */
+  uint8_t state;
+  uint8_t is_probe;
+};
+
+static struct watch watches[TRUST_ENGINE_WATCHDOG_SLOTS];
+static uint8_t num_armed;
+static uint16_t last_tag;
+static uint8_t overheard;
+static clock_time_t last_overheard;
+static uint8_t probing;
+static uint16_t probe_seqno;
+static struct ctimer probe_timer;
+static struct uip_icmp6_echo_reply_notification echo_notification;
+#endif /* TRUST_ENGINE_WATCHDOG */
+/*---------------------------------------------------------------------------*/
+static uint16_t
+ewma(uint16_t avg, uint16_t sample)
+{
+  return ((uint32_t)(TRUST_ENGINE_SCALE - TRUST_ENGINE_BETA) * avg +
+          (uint32_t)TRUST_ENGINE_BETA * sample) / TRUST_ENGINE_SCALE;
+}
+/*---------------------------------------------------------------------------*/
+/* exp(-lambda * excess), lambda scaled by 1000 */
+static uint16_t
+excess_trust(int32_t excess, uint16_t lambda)
+{
+  if(excess <= 0) {
+    return TRUST_ENGINE_SCALE;
+  }
+  return FIX_TO_SCALED(fix_exp(-FIX_FROM_SCALED((int64_t)excess * lambda, 1000)),
+                       TRUST_ENGINE_SCALE);
+}
+/*---------------------------------------------------------------------------*/
+/* Weighted geometric mean data^alpha * sink^(1 - alpha): a neighbor that
+ * fails either test entirely is not trusted, however well it does on the
+ * other one */
+static uint16_t
+combine(uint32_t data, uint32_t sink)
+{
+  fix_t d = FIX_FROM_SCALED(data, TRUST_ENGINE_SCALE);
+  fix_t s = FIX_FROM_SCALED(sink, TRUST_ENGINE_SCALE);
+
+  if(TRUST_ENGINE_ALPHA * 2 == TRUST_ENGINE_SCALE) {
+    return FIX_TO_SCALED(fix_sqrt(fix_mul(d, s)), TRUST_ENGINE_SCALE);
+  }
+  return FIX_TO_SCALED(
+    fix_mul(fix_pow(d, FIX_FROM_SCALED(TRUST_ENGINE_ALPHA, TRUST_ENGINE_SCALE)),
+            fix_pow(s, FIX_FROM_SCALED(TRUST_ENGINE_SCALE - TRUST_ENGINE_ALPHA,
+                                       TRUST_ENGINE_SCALE))),
+    TRUST_ENGINE_SCALE);
+}
+/*---------------------------------------------------------------------------*/
+static void
+decide(struct trust_record *r)
+{
+  uint32_t data = ((uint32_t)r->data * r->forwarding) / TRUST_ENGINE_SCALE;
+  uint32_t sink = ((uint32_t)r->sink_adv * r->sink_stab) / TRUST_ENGINE_SCALE;
+  uint16_t trust = combine(data, sink);
+
+  r->decision = r->verdict;
+  if(trust < r->decision.trust) {
+    r->decision.trust = trust;
+  }
+  if(r->decision.trust < TRUST_ENGINE_ESCAPE_THRESHOLD) {
+    r->decision.flags |= TRUST_DECISION_ESCAPE;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static struct trust_record *
+record_get(const linkaddr_t *addr, int create)
+{
+  struct trust_record *r;
+
+  if(addr == NULL) {
+    return NULL;
+  }
+  r = nbr_table_get_from_lladdr(trust_records, addr);
+  if(r == NULL && create) {
+    r = nbr_table_add_lladdr(trust_records, addr, NBR_TABLE_REASON_TRUST, NULL);
+    if(r != NULL) {
+      r->decision = trust_engine_neutral;
+      r->verdict = trust_engine_neutral;
+      r->data = TRUST_ENGINE_SCALE;
+      r->forwarding = TRUST_ENGINE_SCALE;
+      r->sink_adv = TRUST_ENGINE_SCALE;
+      r->sink_stab = TRUST_ENGINE_SCALE;
+      r->tx_ok = 0;
+      r->tx_failed = 0;
+      r->fwd_ok = 0;
+      r->fwd_missed = 0;
+      r->adv_sample = NO_SAMPLE;
+      r->stab_sample = NO_SAMPLE;
+      r->window_rank = NO_RANK;
+      r->window_start = 0;
+    }
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+#if TRUST_ENGINE_WATCHDOG
+static uint16_t
+fingerprint(const uint8_t *end)
+{
+  const uint8_t *p;
+  uint16_t h = 5381;
+
+  for(p = end - FINGERPRINT_LEN; p < end; p++) {
+    h = (h << 5) + h + *p;
+  }
+  return h;
+}
+/*---------------------------------------------------------------------------*/
+static int
+overhearing_works(void)
+{
+  return WATCH_OVERHEARING && overheard &&
+    clock_time() - last_overheard < TRUST_ENGINE_OVERHEAR_WINDOW;
+}
+/*---------------------------------------------------------------------------*/
+static void
+watch_done(struct watch *w, enum watch_outcome outcome)
+{
+  struct trust_record *r;
+
+  if(w->state == WATCH_ARMED) {
+    num_armed--;
+  }
+  w->state = WATCH_FREE;
+  if(outcome == WATCH_INCONCLUSIVE) {
+    return;
+  }
+  if(outcome == WATCH_FORWARDED) {
+    trust_engine_stats.forwarded++;
+  } else {
+    trust_engine_stats.missed++;
+  }
+  r = record_get(&w->nexthop, 0);
+  if(r == NULL) {
+    return;
+  }
+  if(r->fwd_ok + r->fwd_missed >= 0xffff) {
+    r->fwd_ok /= 2;
+    r->fwd_missed /= 2;
+  }
+  if(outcome == WATCH_FORWARDED) {
+    r->fwd_ok++;
+  } else {
+    r->fwd_missed++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+watch_expire(void)
+{
+  clock_time_t now = clock_time();
+  struct watch *w;
+
+  for(w = watches; w < watches + TRUST_ENGINE_WATCHDOG_SLOTS; w++) {
+    if(w->state == WATCH_FREE) {
+      continue;
+    }
+    if(w->is_probe) {
+      if(now - w->start >= TRUST_ENGINE_PROBE_TIMEOUT) {
+        watch_done(w, w->state == WATCH_ARMED ?
+                   WATCH_MISSED : WATCH_INCONCLUSIVE);
+      }
+    } else if(now - w->start >= TRUST_ENGINE_WATCHDOG_TIMEOUT) {
+      /* Not having overheard the packet only means something if we
+       * overhear other packets */
+      watch_done(w, w->state == WATCH_ARMED && overhearing_works() ?
+                 WATCH_MISSED : WATCH_INCONCLUSIVE);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* IPv6 output: stage unicast packets that the next hop has to forward */
+static enum netstack_ip_action
+watch_ip_output(const linkaddr_t *localdest)
+{
+  uip_ipaddr_t nexthop_ipaddr;
+  struct watch *w;
+
+  uipbuf_set_attr(UIPBUF_ATTR_TX_TAG, 0);
+  if(localdest == NULL || uip_len < WATCH_MIN_LEN ||
+     uip_is_addr_mcast(&UIP_IP_BUF->destipaddr) ||
+     (!WATCH_OVERHEARING && !probing)) {
+    return NETSTACK_IP_PROCESS;
+  }
+  /* A packet for the next hop itself is not forwarded */
+  uip_ds6_set_addr_iid(&nexthop_ipaddr, (const uip_lladdr_t *)localdest);
+  if(memcmp(&nexthop_ipaddr.u8[8], &UIP_IP_BUF->destipaddr.u8[8], 8) == 0) {
+    return NETSTACK_IP_PROCESS;
+  }
+
+  watch_expire();
+  for(w = watches; w < watches + TRUST_ENGINE_WATCHDOG_SLOTS; w++) {
+    if(w->state == WATCH_FREE) {
+      linkaddr_copy(&w->nexthop, localdest);
+      w->fingerprint = fingerprint(uip_buf + uip_len);
+      if(++last_tag == 0) {
+        last_tag = 1;
+      }
+      w->tag = last_tag;
+      uipbuf_set_attr(UIPBUF_ATTR_TX_TAG, w->tag);
+      w->start = clock_time();
+      w->state = WATCH_STAGED;
+      w->is_probe = probing;
+      return NETSTACK_IP_PROCESS;
+    }
+  }
+  trust_engine_stats.unwatched++;
+  return NETSTACK_IP_PROCESS;
+}
+/*---------------------------------------------------------------------------*/
+/* MAC sent callback: arm the staged packet once the next hop has it. The
+ * packet is found by its tag, not its payload, which link-layer security
+ * has encrypted by now. */
+static void
+watch_sent(const linkaddr_t *addr, int status)
+{
+  uint16_t tag = packetbuf_attr(PACKETBUF_ATTR_TX_TAG);
+  struct watch *w;
+
+  if(tag == 0) {
+    return;
+  }
+  for(w = watches; w < watches + TRUST_ENGINE_WATCHDOG_SLOTS; w++) {
+    if(w->state == WATCH_STAGED && w->tag == tag &&
+       linkaddr_cmp(&w->nexthop, addr)) {
+      if(status == MAC_TX_OK) {
+        w->state = WATCH_ARMED;
+        w->start = clock_time();
+        num_armed++;
+        trust_engine_stats.watched++;
+      } else {
+        /* Not the neighbor's packet to forward */
+        watch_done(w, WATCH_INCONCLUSIVE);
+      }
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Overheard unicast frame: did the sender forward a packet we gave it? */
+static void
+watch_overheard(void)
+{
+  const linkaddr_t *sender = packetbuf_addr(PACKETBUF_ADDR_SENDER);
+  struct watch *w;
+  uint16_t fp;
+
+  overheard = 1;
+  last_overheard = clock_time();
+  if(num_armed == 0 || packetbuf_datalen() < FINGERPRINT_LEN) {
+    return;
+  }
+  watch_expire();
+  fp = fingerprint((uint8_t *)packetbuf_dataptr() + packetbuf_datalen());
+  for(w = watches; w < watches + TRUST_ENGINE_WATCHDOG_SLOTS; w++) {
+    if(w->state == WATCH_ARMED && !w->is_probe && w->fingerprint == fp &&
+       linkaddr_cmp(&w->nexthop, sender)) {
+      watch_done(w, WATCH_FORWARDED);
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+probe_reply(uip_ipaddr_t *source, uint8_t ttl, uint8_t *data, uint16_t datalen)
+{
+  struct watch *w;
+  uint16_t fp;
+
+  if(datalen != PROBE_LEN || ((data[0] << 8) | data[1]) != PROBE_ID) {
+    return;
+  }
+  fp = fingerprint(data + datalen);
+  for(w = watches; w < watches + TRUST_ENGINE_WATCHDOG_SLOTS; w++) {
+    if(w->state == WATCH_ARMED && w->is_probe && w->fingerprint == fp) {
+      watch_done(w, WATCH_FORWARDED);
+      return;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Without overhearing, sample end-to-end delivery through the next hop */
+static void
+probe_timer_callback(void *ptr)
+{
+  uip_ipaddr_t root_ipaddr;
+  uint8_t *payload;
+  int i;
+
+  ctimer_reset(&probe_timer);
+  watch_expire();
+  if(overhearing_works() || NETSTACK_ROUTING.node_is_root() ||
+     !NETSTACK_ROUTING.get_root_ipaddr(&root_ipaddr)) {
+    return;
+  }
+
+  uipbuf_clear();
+  payload = UIP_ICMP_PAYLOAD;
+  probe_seqno++;
+  payload[0] = PROBE_ID >> 8;
+  payload[1] = PROBE_ID & 0xff;
+  payload[2] = probe_seqno >> 8;
+  payload[3] = probe_seqno & 0xff;
+  for(i = 4; i < PROBE_LEN; i += 2) {
+    uint16_t rnd = random_rand();
+    payload[i] = rnd >> 8;
+    payload[i + 1] = rnd & 0xff;
+  }
+
+  /* Output is synchronous: watch_ip_output() stages the probe */
+  probing = 1;
+  uip_icmp6_send(&root_ipaddr, ICMP6_ECHO_REQUEST, 0, PROBE_LEN);
+  probing = 0;
+  trust_engine_stats.probes++;
+}
+/*---------------------------------------------------------------------------*/
+static struct netstack_ip_packet_processor watch_processor = {
+  .process_input = NULL,
+  .process_output = watch_ip_output
+};
+#endif /* TRUST_ENGINE_WATCHDOG */
+/*---------------------------------------------------------------------------*/
+static void
+epoch_timer_callback(void *ptr)
+{
+  ctimer_reset(&epoch_timer);
+  trust_engine_epoch();
+}
+/*---------------------------------------------------------------------------*/
+void
+trust_engine_init(void)
+{
+  nbr_table_register(trust_records, NULL);
+  memset(&trust_engine_stats, 0, sizeof(trust_engine_stats));
+  ctimer_set(&epoch_timer, TRUST_ENGINE_EPOCH, epoch_timer_callback, NULL);
+#if TRUST_ENGINE_WATCHDOG
+  memset(watches, 0, sizeof(watches));
+  num_armed = 0;
+  netstack_ip_packet_processor_add(&watch_processor);
+  mac_overhear_set_callback(watch_overheard);
+  uip_icmp6_echo_reply_callback_add(&echo_notification, probe_reply);
+  if(TRUST_ENGINE_PROBE_INTERVAL > 0) {
+    ctimer_set(&probe_timer, TRUST_ENGINE_PROBE_INTERVAL,
+               probe_timer_callback, NULL);
+  }
+#endif /* TRUST_ENGINE_WATCHDOG */
+}
+/*---------------------------------------------------------------------------*/
+const struct trust_decision *
+trust_engine_decision(const linkaddr_t *addr)
+{
+  struct trust_record *r = record_get(addr, 0);
+
+  trust_engine_stats.lookups++;
+  return r != NULL ? &r->decision : &trust_engine_neutral;
+}
+/*---------------------------------------------------------------------------*/
+void
+trust_engine_tx_outcome(const linkaddr_t *addr, int status, int numtx)
+{
+  struct trust_record *r;
+
+#if TRUST_ENGINE_WATCHDOG
+  watch_sent(addr, status);
+#endif /* TRUST_ENGINE_WATCHDOG */
+
+  /* Only a packet that is still unacknowledged after all retransmissions
+   * counts against the neighbor: collisions, channel access failures and
+   * full queues are local conditions. */
+  if(status != MAC_TX_OK && status != MAC_TX_NOACK) {
+    return;
+  }
+  /* As link-stats, do not add a neighbor on a failure */
+  r = record_get(addr, status == MAC_TX_OK);
+  if(r == NULL) {
+    return;
+  }
+  if(r->tx_ok + r->tx_failed >= 0xffff) {
+    r->tx_ok /= 2;
+    r->tx_failed /= 2;
+  }
+  if(status == MAC_TX_OK) {
+    r->tx_ok++;
+  } else {
+    r->tx_failed++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+trust_engine_rank_observed(const linkaddr_t *addr, uint16_t rank,
+                           uint16_t own_rank, uint16_t min_hoprankinc)
+{
+  struct trust_record *r = record_get(addr, 1);
+  unsigned long now = clock_seconds();
+  uint16_t sample;
+
+  if(r == NULL || rank == NO_RANK) {
+    /* An infinite rank is a legitimate way to leave the DAG */
+    return;
+  }
+
+  /* Advertisement: a neighbor should not claim to be much more than one
+   * hop closer to the root than we are */
+  if(own_rank != NO_RANK) {
+    sample = excess_trust((int32_t)own_rank - rank - min_hoprankinc -
+                          TRUST_ENGINE_TAU_RANK, TRUST_ENGINE_LAMBDA_ADV);
+    if(sample < r->adv_sample) {
+      r->adv_sample = sample;
+    }
+  }
+
+  /* Stability: the rank should not grow much within a window */
+  if(r->window_rank == NO_RANK ||
+     now - r->window_start >= TRUST_ENGINE_STABILITY_WINDOW) {
+    r->window_rank = rank;
+    r->window_start = now;
+  }
+  sample = excess_trust((int32_t)rank - r->window_rank -
+                        TRUST_ENGINE_KAPPA_RANK, TRUST_ENGINE_LAMBDA_STAB);
+  if(sample < r->stab_sample) {
+    r->stab_sample = sample;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+trust_engine_set_verdict(const linkaddr_t *addr,
+                         const struct trust_decision *verdict)
+{
+  struct trust_record *r = record_get(addr, verdict != NULL);
+
+  if(r == NULL) {
+    return verdict == NULL;
+  }
+  r->verdict = verdict != NULL ? *verdict : trust_engine_neutral;
+  decide(r);
+  trust_engine_stats.verdicts++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+trust_engine_epoch(void)
+{
+  struct trust_record *r;
+
+#if TRUST_ENGINE_WATCHDOG
+  watch_expire();
+#endif /* TRUST_ENGINE_WATCHDOG */
+
+  for(r = nbr_table_head(trust_records);
+      r != NULL;
+      r = nbr_table_next(trust_records, r)) {
+    uint32_t sent = (uint32_t)r->tx_ok + r->tx_failed;
+
+    if(sent > 0) {
+      r->data = ewma(r->data, ((uint32_t)TRUST_ENGINE_SCALE * r->tx_ok) / sent);
+    }
+    sent = (uint32_t)r->fwd_ok + r->fwd_missed;
+    if(sent > 0) {
+      r->forwarding = ewma(r->forwarding,
+                           ((uint32_t)TRUST_ENGINE_SCALE * r->fwd_ok) / sent);
+    }
+    if(r->adv_sample != NO_SAMPLE) {
+      r->sink_adv = ewma(r->sink_adv, r->adv_sample);
+    }
+    if(r->stab_sample != NO_SAMPLE) {
+      r->sink_stab = ewma(r->sink_stab, r->stab_sample);
+    }
+    r->tx_ok = 0;
+    r->tx_failed = 0;
+    r->fwd_ok = 0;
+    r->fwd_missed = 0;
+    r->adv_sample = NO_SAMPLE;
+    r->stab_sample = NO_SAMPLE;
+    decide(r);
+  }
+  trust_engine_stats.epochs++;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* TRUST_ENGINE_ENABLED */
+/** @} */
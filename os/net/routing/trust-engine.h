@@ -0,0 +1,252 @@
+/**
+ * \addtogroup routing
+ * @{
+ *
+ * \file
+ *         Per-neighbor trust engine for routing.
+ *
+ *         The engine keeps one record per neighbor, in a neighbor table
+ *         so that it lives alongside the other per-neighbor state. The
+ *         record is fed by the routing protocol with the outcome of each
+ *         unicast transmission (the one link-stats sees) and with the rank
+ *         the neighbor advertises in its DIOs. An external trust agent can
+ *         add its own verdict with trust_engine_set_verdict().
+ *
+ *         Observations are only accumulated when they arrive. Once per
+ *         epoch, the engine folds them into EWMA trust components and
+ *         precomputes a struct trust_decision for every neighbor. Objective
+ *         functions read that decision with a single lookup, no matter how
+ *         many times they compare the neighbor during the epoch.
+ *
+ *         With TRUST_ENGINE_WATCHDOG, the engine also checks that the
+ *         neighbors forward the packets we hand them. A small, fixed set of
+ *         packets is watched at a time: each is identified by a fingerprint
+ *         of its last bytes, which 6LoWPAN carries unchanged. The packet is
+ *         forwarded if the neighbor is overheard sending it on (where the MAC
+ *         reports overheard frames, see mac-overhear.h). Otherwise, an ICMPv6
+ *         echo to the root is sampled from time to time, and its reply
+ *         stands for the neighbor forwarding it. With link-layer security,
+ *         overheard frames are encrypted and only the echoes are used.
+ */
+
+#ifndef TRUST_ENGINE_H_
+#define TRUST_ENGINE_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+/* Provides the default of TRUST_ENGINE_CONF_ENABLED */
+#include "net/routing/brpl-conf.h"
+
+#ifdef TRUST_ENGINE_CONF_ENABLED
+#define TRUST_ENGINE_ENABLED TRUST_ENGINE_CONF_ENABLED
+#else /* TRUST_ENGINE_CONF_ENABLED */
+#define TRUST_ENGINE_ENABLED 0
+#endif /* TRUST_ENGINE_CONF_ENABLED */
+
+/* Trust values and scale factors are fixed point, 1000 is 1.0 */
+#define TRUST_ENGINE_SCALE 1000
+
+/* Period over which observations are folded into the decisions */
+#ifdef TRUST_ENGINE_CONF_EPOCH
+#define TRUST_ENGINE_EPOCH TRUST_ENGINE_CONF_EPOCH
+#else /* TRUST_ENGINE_CONF_EPOCH */
+#define TRUST_ENGINE_EPOCH (10 * CLOCK_SECOND)
+#endif /* TRUST_ENGINE_CONF_EPOCH */
+
+/* EWMA weight of the samples of an epoch (0-1000) */
+#ifdef TRUST_ENGINE_CONF_BETA
+#define TRUST_ENGINE_BETA TRUST_ENGINE_CONF_BETA
+#else /* TRUST_ENGINE_CONF_BETA */
+#define TRUST_ENGINE_BETA 200
+#endif /* TRUST_ENGINE_CONF_BETA */
+
+/* Weight of the data-plane trust against the sinkhole trust (0-1000), the
+ * exponents of their weighted geometric mean */
+#ifdef TRUST_ENGINE_CONF_ALPHA
+#define TRUST_ENGINE_ALPHA TRUST_ENGINE_CONF_ALPHA
+#else /* TRUST_ENGINE_CONF_ALPHA */
+#define TRUST_ENGINE_ALPHA 500
+#endif /* TRUST_ENGINE_CONF_ALPHA */
+
+/* Sinkhole advertisement trust: rank jitter tolerance, and sensitivity
+ * to ranks that are lower than plausible (scaled by 1000) */
+#ifdef TRUST_ENGINE_CONF_TAU_RANK
+#define TRUST_ENGINE_TAU_RANK TRUST_ENGINE_CONF_TAU_RANK
+#else /* TRUST_ENGINE_CONF_TAU_RANK */
+#define TRUST_ENGINE_TAU_RANK 256
+#endif /* TRUST_ENGINE_CONF_TAU_RANK */
+
+#ifdef TRUST_ENGINE_CONF_LAMBDA_ADV
+#define TRUST_ENGINE_LAMBDA_ADV TRUST_ENGINE_CONF_LAMBDA_ADV
+#else /* TRUST_ENGINE_CONF_LAMBDA_ADV */
+#define TRUST_ENGINE_LAMBDA_ADV 2
+#endif /* TRUST_ENGINE_CONF_LAMBDA_ADV */
+
+/* Sinkhole stability trust: acceptable rank increase within a stability
+ * window (in seconds), and sensitivity to larger increases */
+#ifdef TRUST_ENGINE_CONF_KAPPA_RANK
+#define TRUST_ENGINE_KAPPA_RANK TRUST_ENGINE_CONF_KAPPA_RANK
+#else /* TRUST_ENGINE_CONF_KAPPA_RANK */
+#define TRUST_ENGINE_KAPPA_RANK 512
+#endif /* TRUST_ENGINE_CONF_KAPPA_RANK */
+
+#ifdef TRUST_ENGINE_CONF_LAMBDA_STAB
+#define TRUST_ENGINE_LAMBDA_STAB TRUST_ENGINE_CONF_LAMBDA_STAB
+#else /* TRUST_ENGINE_CONF_LAMBDA_STAB */
+#define TRUST_ENGINE_LAMBDA_STAB 3
+#endif /* TRUST_ENGINE_CONF_LAMBDA_STAB */
+
+#ifdef TRUST_ENGINE_CONF_STABILITY_WINDOW
+#define TRUST_ENGINE_STABILITY_WINDOW TRUST_ENGINE_CONF_STABILITY_WINDOW
+#else /* TRUST_ENGINE_CONF_STABILITY_WINDOW */
+#define TRUST_ENGINE_STABILITY_WINDOW 30
+#endif /* TRUST_ENGINE_CONF_STABILITY_WINDOW */
+
+/* Below this trust, a neighbor is no longer kept as a sticky preferred
+ * parent (TRUST_DECISION_ESCAPE) */
+#ifdef TRUST_ENGINE_CONF_ESCAPE_THRESHOLD
+#define TRUST_ENGINE_ESCAPE_THRESHOLD TRUST_ENGINE_CONF_ESCAPE_THRESHOLD
+#else /* TRUST_ENGINE_CONF_ESCAPE_THRESHOLD */
+#define TRUST_ENGINE_ESCAPE_THRESHOLD 500
+#endif /* TRUST_ENGINE_CONF_ESCAPE_THRESHOLD */
+
+/* Forwarding watchdog */
+#ifdef TRUST_ENGINE_CONF_WATCHDOG
+#define TRUST_ENGINE_WATCHDOG TRUST_ENGINE_CONF_WATCHDOG
+#else /* TRUST_ENGINE_CONF_WATCHDOG */
+#define TRUST_ENGINE_WATCHDOG TRUST_ENGINE_ENABLED
+#endif /* TRUST_ENGINE_CONF_WATCHDOG */
+
+/* Number of packets watched at a time. Packets sent while all are in use
+ * are not watched, which caps memory and CPU under load. */
+#ifdef TRUST_ENGINE_CONF_WATCHDOG_SLOTS
+#define TRUST_ENGINE_WATCHDOG_SLOTS TRUST_ENGINE_CONF_WATCHDOG_SLOTS
+#else /* TRUST_ENGINE_CONF_WATCHDOG_SLOTS */
+#define TRUST_ENGINE_WATCHDOG_SLOTS 8
+#endif /* TRUST_ENGINE_CONF_WATCHDOG_SLOTS */
+
+/* Time a neighbor has to forward a packet once it acknowledged it */
+#ifdef TRUST_ENGINE_CONF_WATCHDOG_TIMEOUT
+#define TRUST_ENGINE_WATCHDOG_TIMEOUT TRUST_ENGINE_CONF_WATCHDOG_TIMEOUT
+#else /* TRUST_ENGINE_CONF_WATCHDOG_TIMEOUT */
+#define TRUST_ENGINE_WATCHDOG_TIMEOUT (2 * CLOCK_SECOND)
+#endif /* TRUST_ENGINE_CONF_WATCHDOG_TIMEOUT */
+
+/* A packet that is not overheard in time only counts as missed if some
+ * other frame was overheard within this period, i.e. if overhearing works */
+#ifdef TRUST_ENGINE_CONF_OVERHEAR_WINDOW
+#define TRUST_ENGINE_OVERHEAR_WINDOW TRUST_ENGINE_CONF_OVERHEAR_WINDOW
+#else /* TRUST_ENGINE_CONF_OVERHEAR_WINDOW */
+#define TRUST_ENGINE_OVERHEAR_WINDOW (60 * CLOCK_SECOND)
+#endif /* TRUST_ENGINE_CONF_OVERHEAR_WINDOW */
+
+/* Period of the end-to-end probes while overhearing does not work (0 to
+ * disable them), and time the root has to reply */
+#ifdef TRUST_ENGINE_CONF_PROBE_INTERVAL
+#define TRUST_ENGINE_PROBE_INTERVAL TRUST_ENGINE_CONF_PROBE_INTERVAL
+#else /* TRUST_ENGINE_CONF_PROBE_INTERVAL */
+#define TRUST_ENGINE_PROBE_INTERVAL (60 * CLOCK_SECOND)
+#endif /* TRUST_ENGINE_CONF_PROBE_INTERVAL */
+
+#ifdef TRUST_ENGINE_CONF_PROBE_TIMEOUT
+#define TRUST_ENGINE_PROBE_TIMEOUT TRUST_ENGINE_CONF_PROBE_TIMEOUT
+#else /* TRUST_ENGINE_CONF_PROBE_TIMEOUT */
+#define TRUST_ENGINE_PROBE_TIMEOUT (10 * CLOCK_SECOND)
+#endif /* TRUST_ENGINE_CONF_PROBE_TIMEOUT */
+
+/* Decision flags */
+#define TRUST_DECISION_ALLOWED      0x01 /* may be selected as parent */
+#define TRUST_DECISION_ESCAPE       0x02 /* do not keep it sticky as preferred parent */
+#define TRUST_DECISION_NO_SWITCH_TO 0x04 /* do not switch to it as a challenger */
+#define TRUST_DECISION_BYPASS_DWELL 0x08 /* leaving it ignores the dwell timer */
+
+/* What the routing protocol needs to know about a neighbor */
+struct trust_decision {
+  uint16_t trust;            /* 0 to TRUST_ENGINE_SCALE */
+  uint16_t penalty_scale;    /* cost multiplier, TRUST_ENGINE_SCALE is neutral */
+  uint16_t validation_scale; /* cost multiplier, TRUST_ENGINE_SCALE is neutral */
+  uint16_t switch_margin;    /* extra gain required to switch to it */
+  uint8_t flags;             /* TRUST_DECISION_* */
+};
+
+/* The decision for neighbors the engine knows nothing against */
+extern const struct trust_decision trust_engine_neutral;
+
+struct trust_engine_stats {
+  uint32_t epochs;
+  uint32_t lookups;
+  uint32_t verdicts;
+  /* Forwarding watchdog */
+  uint32_t watched;   /* packets acknowledged by the neighbor and watched */
+  uint32_t forwarded; /* of which seen forwarded */
+  uint32_t missed;    /* of which not forwarded in time */
+  uint32_t unwatched; /* packets not watched because all slots were in use */
+  uint32_t probes;    /* end-to-end probes sent */
+};
+
+#if TRUST_ENGINE_ENABLED
+
+extern struct trust_engine_stats trust_engine_stats;
+
+void trust_engine_init(void);
+
+/**
+ * \brief Returns the decision of the current epoch for a neighbor
+ * \param addr The link-layer address of the neighbor
+ * \return The decision, trust_engine_neutral for unknown neighbors.
+ *         Never NULL. Valid until the neighbor leaves the neighbor table.
+ */
+const struct trust_decision *trust_engine_decision(const linkaddr_t *addr);
+
+/**
+ * \brief Records the outcome of a unicast transmission to a neighbor
+ * \param addr The link-layer address of the neighbor
+ * \param status The MAC_TX_* status of the transmission
+ * \param numtx The number of transmission attempts
+ *
+ * Called from the MAC sent callback, while the packetbuf still holds the
+ * frame.
+ */
+void trust_engine_tx_outcome(const linkaddr_t *addr, int status, int numtx);
+
+/**
+ * \brief Records the rank advertised by a neighbor in a DIO
+ * \param addr The link-layer address of the neighbor
+ * \param rank The rank advertised by the neighbor
+ * \param own_rank Our own rank in the same DAG
+ * \param min_hoprankinc The MinHopRankIncrease of the DAG
+ */
+void trust_engine_rank_observed(const linkaddr_t *addr, uint16_t rank,
+                                uint16_t own_rank, uint16_t min_hoprankinc);
+
+/**
+ * \brief Sets the verdict of an external trust agent on a neighbor
+ * \param addr The link-layer address of the neighbor
+ * \param verdict The verdict, NULL to clear it
+ * \return 1 on success, 0 if the neighbor table is full
+ *
+ * The trust of the neighbor is capped by the trust of the verdict, and
+ * its scales, margin and flags are used as they are. Unlike observations,
+ * verdicts take effect immediately.
+ */
+int trust_engine_set_verdict(const linkaddr_t *addr,
+                             const struct trust_decision *verdict);
+
+/**
+ * \brief Folds the observations into the decisions. Runs once per
+ *        TRUST_ENGINE_EPOCH, and may be called to start an epoch early.
+ */
+void trust_engine_epoch(void);
+
+#else /* TRUST_ENGINE_ENABLED */
+
+#define trust_engine_init()
+#define trust_engine_decision(addr) (&trust_engine_neutral)
+#define trust_engine_tx_outcome(addr, status, numtx)
+#define trust_engine_rank_observed(addr, rank, own_rank, min_hoprankinc)
+
+#endif /* TRUST_ENGINE_ENABLED */
+
+#endif /* TRUST_ENGINE_H_ */
+/** @} */
@@ -0,0 +1,2 @@
+#define BUILD_WITH_MSF 1
+#define TSCH_CONF_WITH_SIXTOP 1
@@ -0,0 +1,129 @@
+/**
+ * \addtogroup msf
+ * @{
+ *
+ * \file
+ *         MSF configuration
+ */
+
+#ifndef MSF_CONF_H_
+#define MSF_CONF_H_
+
+#include "net/mac/tsch/tsch-conf.h"
+
+/* The SFID of MSF (RFC 9033) */
+#ifdef MSF_CONF_SFID
+#define MSF_SFID                   MSF_CONF_SFID
+#else
+#define MSF_SFID                   0
+#endif
+
+/* The slotframe holding the negotiated cells. It must not be used by any
+ * other scheduler, such as Orchestra's rules or the minimal schedule */
+#ifdef MSF_CONF_SLOTFRAME_HANDLE
+#define MSF_SLOTFRAME_HANDLE       MSF_CONF_SLOTFRAME_HANDLE
+#else
+#define MSF_SLOTFRAME_HANDLE       1
+#endif
+
+#ifdef MSF_CONF_SLOTFRAME_LENGTH
+#define MSF_SLOTFRAME_LENGTH       MSF_CONF_SLOTFRAME_LENGTH
+#else
+#define MSF_SLOTFRAME_LENGTH       TSCH_SCHEDULE_DEFAULT_LENGTH
+#endif
+
+/* Negotiated cells use channel offsets 0 to MSF_CHANNEL_OFFSETS - 1 */
+#ifdef MSF_CONF_CHANNEL_OFFSETS
+#define MSF_CHANNEL_OFFSETS        MSF_CONF_CHANNEL_OFFSETS
+#else
+#define MSF_CHANNEL_OFFSETS        16
+#endif
+
+/* Number of cells proposed in the CellList of an ADD or RELOCATE request */
+#ifdef MSF_CONF_CANDIDATE_CELLS
+#define MSF_CANDIDATE_CELLS        MSF_CONF_CANDIDATE_CELLS
+#else
+#define MSF_CANDIDATE_CELLS        5
+#endif
+
+/* Bounds of the number of TX cells to the preferred parent */
+#ifdef MSF_CONF_MIN_CELLS
+#define MSF_MIN_CELLS              MSF_CONF_MIN_CELLS
+#else
+#define MSF_MIN_CELLS              1
+#endif
+
+#ifdef MSF_CONF_MAX_CELLS
+#define MSF_MAX_CELLS              MSF_CONF_MAX_CELLS
+#else
+#define MSF_MAX_CELLS              8
+#endif
+
+/* How often the cell usage and the queue backlog are looked at */
+#ifdef MSF_CONF_HOUSEKEEPING_PERIOD
+#define MSF_HOUSEKEEPING_PERIOD    MSF_CONF_HOUSEKEEPING_PERIOD
+#else
+#define MSF_HOUSEKEEPING_PERIOD    CLOCK_SECOND
+#endif
+
+/* Minimum time between two requests, the rate limit. It is doubled, up to
+ * 8 times, after each failed transaction */
+#ifdef MSF_CONF_REQUEST_INTERVAL
+#define MSF_REQUEST_INTERVAL       MSF_CONF_REQUEST_INTERVAL
+#else
+#define MSF_REQUEST_INTERVAL       (10 * CLOCK_SECOND)
+#endif
+
+/* Number of elapsed TX cells over which the cell usage is measured
+ * (MAX_NUM_CELLS in RFC 9033) */
+#ifdef MSF_CONF_USAGE_WINDOW
+#define MSF_USAGE_WINDOW           MSF_CONF_USAGE_WINDOW
+#else
+#define MSF_USAGE_WINDOW           32
+#endif
+
+/* Cell usage in percent above which a cell is added, and below which one
+ * is deleted. The gap between both is the hysteresis */
+#ifdef MSF_CONF_USAGE_HIGH
+#define MSF_USAGE_HIGH             MSF_CONF_USAGE_HIGH
+#else
+#define MSF_USAGE_HIGH             75
+#endif
+
+#ifdef MSF_CONF_USAGE_LOW
+#define MSF_USAGE_LOW              MSF_CONF_USAGE_LOW
+#else
+#define MSF_USAGE_LOW              25
+#endif
+
+/* A cell is added when the queue to the parent holds at least
+ * MSF_BACKLOG_HIGH packets for MSF_BACKLOG_PERIODS housekeeping periods
+ * in a row. No cell is deleted while the queue is not empty */
+#ifdef MSF_CONF_BACKLOG_HIGH
+#define MSF_BACKLOG_HIGH           MSF_CONF_BACKLOG_HIGH
+#else
+#define MSF_BACKLOG_HIGH           4
+#endif
+
+#ifdef MSF_CONF_BACKLOG_PERIODS
+#define MSF_BACKLOG_PERIODS        MSF_CONF_BACKLOG_PERIODS
+#else
+#define MSF_BACKLOG_PERIODS        3
+#endif
+
+/* A cell is relocated when, after MSF_RELOCATE_MIN_TX transmissions, its
+ * PDR is MSF_RELOCATE_PDR_GAP percent below the one of the best cell */
+#ifdef MSF_CONF_RELOCATE_MIN_TX
+#define MSF_RELOCATE_MIN_TX        MSF_CONF_RELOCATE_MIN_TX
+#else
+#define MSF_RELOCATE_MIN_TX        16
+#endif
+
+#ifdef MSF_CONF_RELOCATE_PDR_GAP
+#define MSF_RELOCATE_PDR_GAP       MSF_CONF_RELOCATE_PDR_GAP
+#else
+#define MSF_RELOCATE_PDR_GAP       50
+#endif
+
+#endif /* MSF_CONF_H_ */
+/** @} */
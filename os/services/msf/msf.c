@@ -0,0 +1,909 @@
+/**
+ * \addtogroup msf
+ * @{
+ *
+ * \file
+ *         An MSF-style 6P scheduling function, driven by the cell usage and
+ *         the backlog of the queue to the preferred parent.
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch.h"
+#include "net/mac/tsch/sixtop/sixtop.h"
+#include "net/mac/tsch/sixtop/sixp.h"
+#include "net/mac/tsch/sixtop/sixp-pkt.h"
+#include "net/mac/tsch/sixtop/sixp-trans.h"
+#include "services/msf/msf.h"
+#include "services/msf/msf-conf.h"
+
+#include <string.h>
+
+#if !TSCH_WITH_SIXTOP
+#error MSF requires 6top. Please enable TSCH_CONF_WITH_SIXTOP.
+#endif /* !TSCH_WITH_SIXTOP */
+
+#if MSF_CANDIDATE_CELLS > 255 || MSF_MAX_CELLS > 255
+#error MSF cell counts must fit in the 6P NumCells field
+#endif
+
+/* Log configuration */
+#include "sys/log.h"
+#define LOG_MODULE "MSF"
+#define LOG_LEVEL  LOG_LEVEL_MAC
+
+/* A cell in a 6P CellList: slot offset and channel offset, little endian */
+#define CELL_LEN      sizeof(sixp_pkt_cell_t)
+/* Metadata, CellOptions and NumCells of a request */
+#define REQ_HDR_LEN   4
+/* Cap of the per-cell counters, halved beyond it to follow changes */
+#define CELL_TX_CAP   1024
+
+/* Transmission statistics of a negotiated TX cell, the link's data */
+struct msf_cell {
+  uint16_t tx;
+  uint16_t ack;
+  uint8_t in_use;
+};
+
+static struct msf_cell cells[MSF_MAX_CELLS];
+static struct ctimer housekeeping_timer;
+/* Rate limit of the requests */
+static struct timer request_timer;
+static uint8_t backoff;
+
+/* The parent our TX cells go to */
+static linkaddr_t peer;
+/* A former parent that still holds RX cells for us, to be cleared */
+static linkaddr_t clear_peer;
+/* Cells still to get from a new parent after a switch */
+static uint8_t cells_to_move;
+/* The cell of the pending RELOCATE request */
+static uint16_t relocating_timeslot;
+static uint16_t relocating_channel_offset;
+
+/* Cell usage: TX cells elapsed, in cell-slots, and used since the start of
+ * the window. cells_used is counted from the TSCH interrupt */
+static uint32_t cell_slots;
+static volatile uint16_t cells_used;
+static struct tsch_asn_t last_asn;
+static uint8_t backlog_periods;
+
+static uint8_t req_storage[REQ_HDR_LEN + 2 * MSF_CANDIDATE_CELLS * CELL_LEN];
+/* A response, and the cells it applies to once sent: for RELOCATE, the
+ * relocated cells followed by their new ones */
+static uint8_t res_storage[2 * MSF_CANDIDATE_CELLS * CELL_LEN];
+
+static void reset(void);
+/*---------------------------------------------------------------------------*/
+static void
+read_cell(const uint8_t *buf, uint16_t *timeslot, uint16_t *channel_offset)
+{
+  *timeslot = buf[0] + (buf[1] << 8);
+  *channel_offset = buf[2] + (buf[3] << 8);
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_cell(uint8_t *buf, uint16_t timeslot, uint16_t channel_offset)
+{
+  buf[0] = timeslot & 0xff;
+  buf[1] = timeslot >> 8;
+  buf[2] = channel_offset & 0xff;
+  buf[3] = channel_offset >> 8;
+}
+/*---------------------------------------------------------------------------*/
+/* The slotframe of the negotiated cells. The minimal schedule removes all
+ * slotframes when joining, in which case MSF starts over */
+static struct tsch_slotframe *
+get_slotframe(void)
+{
+  struct tsch_slotframe *sf;
+
+  sf = tsch_schedule_get_slotframe_by_handle(MSF_SLOTFRAME_HANDLE);
+  if(sf == NULL) {
+    reset();
+    sf = tsch_schedule_add_slotframe(MSF_SLOTFRAME_HANDLE, MSF_SLOTFRAME_LENGTH);
+  }
+  return sf;
+}
+/*---------------------------------------------------------------------------*/
+/* Timeslot 0 is kept clear of negotiated cells: it holds the minimal
+ * shared cell when both slotframes have the same length */
+static int
+is_free(struct tsch_slotframe *sf, uint16_t timeslot)
+{
+  return timeslot != 0 && timeslot < sf->size.val
+         && tsch_schedule_get_link_by_timeslot(sf, timeslot) == NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+is_peer_link(const struct tsch_link *l, const linkaddr_t *addr, uint8_t option)
+{
+  return (l->link_options & option) && linkaddr_cmp(&l->addr, addr);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+count_tx_cells(struct tsch_slotframe *sf)
+{
+  struct tsch_link *l;
+  uint8_t n = 0;
+
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if(is_peer_link(l, &peer, LINK_OPTION_TX)) {
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_cell(struct tsch_slotframe *sf, const linkaddr_t *addr, uint8_t option,
+         uint16_t timeslot, uint16_t channel_offset)
+{
+  struct tsch_link *l;
+  struct msf_cell *c = NULL;
+  int i;
+
+  if(!is_free(sf, timeslot)) {
+    LOG_WARN("cell %u/%u is taken\n", timeslot, channel_offset);
+    return;
+  }
+  if(option == LINK_OPTION_TX) {
+    for(i = 0; i < MSF_MAX_CELLS; i++) {
+      if(!cells[i].in_use) {
+        c = &cells[i];
+        break;
+      }
+    }
+    if(c == NULL) {
+      return;
+    }
+  }
+  l = tsch_schedule_add_link(sf, option, LINK_TYPE_NORMAL, addr,
+                             timeslot, channel_offset, 0);
+  if(l != NULL && c != NULL) {
+    c->tx = 0;
+    c->ack = 0;
+    c->in_use = 1;
+    l->data = c;
+  }
+  LOG_INFO("add %s cell %u/%u with ", option == LINK_OPTION_TX ? "TX" : "RX",
+           timeslot, channel_offset);
+  LOG_INFO_LLADDR(addr);
+  LOG_INFO_("\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_cell(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  if(l->data != NULL) {
+    ((struct msf_cell *)l->data)->in_use = 0;
+  }
+  LOG_INFO("remove cell %u/%u with ", l->timeslot, l->channel_offset);
+  LOG_INFO_LLADDR(&l->addr);
+  LOG_INFO_("\n");
+  tsch_schedule_remove_link(sf, l);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+remove_cells(struct tsch_slotframe *sf, const linkaddr_t *addr, uint8_t options)
+{
+  struct tsch_link *l;
+  struct tsch_link *next;
+  uint8_t n = 0;
+
+  for(l = list_head(sf->links_list); l != NULL; l = next) {
+    next = list_item_next(l);
+    if(is_peer_link(l, addr, options)) {
+      remove_cell(sf, l);
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+remove_listed_cell(struct tsch_slotframe *sf, const linkaddr_t *addr,
+                   uint8_t option, uint16_t timeslot, uint16_t channel_offset)
+{
+  struct tsch_link *l;
+
+  l = tsch_schedule_get_link_by_offsets(sf, timeslot, channel_offset);
+  if(l != NULL && is_peer_link(l, addr, option)) {
+    remove_cell(sf, l);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset_window(void)
+{
+  cell_slots = 0;
+  cells_used = 0;
+  backlog_periods = 0;
+  last_asn = tsch_current_asn;
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset(void)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  struct tsch_link *next;
+
+  sf = tsch_schedule_get_slotframe_by_handle(MSF_SLOTFRAME_HANDLE);
+  if(sf != NULL) {
+    for(l = list_head(sf->links_list); l != NULL; l = next) {
+      next = list_item_next(l);
+      remove_cell(sf, l);
+    }
+  }
+  memset(cells, 0, sizeof(cells));
+  linkaddr_copy(&peer, &linkaddr_null);
+  linkaddr_copy(&clear_peer, &linkaddr_null);
+  cells_to_move = 0;
+  backoff = 0;
+  timer_set(&request_timer, 0);
+  reset_window();
+}
+/*---------------------------------------------------------------------------*/
+/* Random free cells, written as a CellList */
+static uint8_t
+select_cells(struct tsch_slotframe *sf, uint8_t *list, uint8_t max)
+{
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint16_t t;
+  uint8_t n = 0;
+  uint8_t i;
+  int tries;
+
+  for(tries = 4 * MSF_SLOTFRAME_LENGTH; tries > 0 && n < max; tries--) {
+    timeslot = random_rand() % MSF_SLOTFRAME_LENGTH;
+    if(!is_free(sf, timeslot)) {
+      continue;
+    }
+    for(i = 0; i < n; i++) {
+      read_cell(&list[i * CELL_LEN], &t, &channel_offset);
+      if(t == timeslot) {
+        break;
+      }
+    }
+    if(i == n) {
+      channel_offset = random_rand() % MSF_CHANNEL_OFFSETS;
+      write_cell(&list[n * CELL_LEN], timeslot, channel_offset);
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+             sixp_output_status_t status)
+{
+  if(status != SIXP_OUTPUT_STATUS_SUCCESS && backoff < 3) {
+    backoff++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static int
+send_request(sixp_pkt_cmd_t cmd, uint16_t len, const linkaddr_t *dest)
+{
+  clock_time_t interval = MSF_REQUEST_INTERVAL << backoff;
+
+  /* Jitter, so that children of the same parent don't ask in step */
+  timer_set(&request_timer, interval + random_rand() % (interval / 2 + 1));
+  if(sixp_output(SIXP_PKT_TYPE_REQUEST, (sixp_pkt_code_t)(uint8_t)cmd,
+                 MSF_SFID, req_storage, len, dest,
+                 request_sent, NULL, 0) < 0) {
+    LOG_ERR("failed to send request %u\n", cmd);
+    return -1;
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+build_request(sixp_pkt_cmd_t cmd, uint8_t num_cells)
+{
+  sixp_pkt_code_t code = (sixp_pkt_code_t)(uint8_t)cmd;
+
+  memset(req_storage, 0, sizeof(req_storage));
+  return sixp_pkt_set_cell_options(SIXP_PKT_TYPE_REQUEST, code,
+                                   SIXP_PKT_CELL_OPTION_TX,
+                                   req_storage, sizeof(req_storage)) < 0 ||
+         sixp_pkt_set_num_cells(SIXP_PKT_TYPE_REQUEST, code, num_cells,
+                                req_storage, sizeof(req_storage)) < 0 ? -1 : 0;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_add(struct tsch_slotframe *sf, uint8_t num_cells)
+{
+  uint8_t list[MSF_CANDIDATE_CELLS * CELL_LEN];
+  uint8_t n;
+
+  if(num_cells > MSF_CANDIDATE_CELLS) {
+    num_cells = MSF_CANDIDATE_CELLS;
+  }
+  n = select_cells(sf, list, MSF_CANDIDATE_CELLS);
+  if(n < num_cells) {
+    LOG_WARN("no room for %u more cells\n", num_cells);
+    return;
+  }
+  if(build_request(SIXP_PKT_CMD_ADD, num_cells) < 0 ||
+     sixp_pkt_set_cell_list(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_ADD,
+                            list, n * CELL_LEN, 0,
+                            req_storage, sizeof(req_storage)) < 0) {
+    LOG_ERR("failed to build an ADD request\n");
+    return;
+  }
+  LOG_INFO("ADD %u cells to ", num_cells);
+  LOG_INFO_LLADDR(&peer);
+  LOG_INFO_("\n");
+  send_request(SIXP_PKT_CMD_ADD, REQ_HDR_LEN + n * CELL_LEN, &peer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_delete(struct tsch_link *l)
+{
+  uint8_t cell[CELL_LEN];
+
+  write_cell(cell, l->timeslot, l->channel_offset);
+  if(build_request(SIXP_PKT_CMD_DELETE, 1) < 0 ||
+     sixp_pkt_set_cell_list(SIXP_PKT_TYPE_REQUEST,
+                            (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_DELETE,
+                            cell, sizeof(cell), 0,
+                            req_storage, sizeof(req_storage)) < 0) {
+    LOG_ERR("failed to build a DELETE request\n");
+    return;
+  }
+  LOG_INFO("DELETE cell %u/%u\n", l->timeslot, l->channel_offset);
+  send_request(SIXP_PKT_CMD_DELETE, REQ_HDR_LEN + CELL_LEN, &peer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_relocate(struct tsch_slotframe *sf, struct tsch_link *l)
+{
+  uint8_t cell[CELL_LEN];
+  uint8_t list[MSF_CANDIDATE_CELLS * CELL_LEN];
+  uint8_t n;
+
+  n = select_cells(sf, list, MSF_CANDIDATE_CELLS);
+  write_cell(cell, l->timeslot, l->channel_offset);
+  if(n == 0 ||
+     build_request(SIXP_PKT_CMD_RELOCATE, 1) < 0 ||
+     sixp_pkt_set_rel_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                cell, sizeof(cell), 0,
+                                req_storage, sizeof(req_storage)) < 0 ||
+     sixp_pkt_set_cand_cell_list(SIXP_PKT_TYPE_REQUEST,
+                                 (sixp_pkt_code_t)(uint8_t)SIXP_PKT_CMD_RELOCATE,
+                                 list, n * CELL_LEN, 0,
+                                 req_storage, sizeof(req_storage)) < 0) {
+    LOG_ERR("failed to build a RELOCATE request\n");
+    return;
+  }
+  relocating_timeslot = l->timeslot;
+  relocating_channel_offset = l->channel_offset;
+  LOG_INFO("RELOCATE cell %u/%u\n", l->timeslot, l->channel_offset);
+  send_request(SIXP_PKT_CMD_RELOCATE,
+               REQ_HDR_LEN + CELL_LEN + n * CELL_LEN, &peer);
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_clear(const linkaddr_t *addr)
+{
+  memset(req_storage, 0, sizeof(req_storage));
+  LOG_INFO("CLEAR with ");
+  LOG_INFO_LLADDR(addr);
+  LOG_INFO_("\n");
+  /* CLEAR has only the Metadata */
+  send_request(SIXP_PKT_CMD_CLEAR, sizeof(sixp_pkt_metadata_t), addr);
+}
+/*---------------------------------------------------------------------------*/
+/* Follow the preferred parent, which tsch-rpl keeps as time source: the
+ * TX cells are given up and as many are asked to the new parent */
+static void
+switch_parent(struct tsch_slotframe *sf, const linkaddr_t *parent)
+{
+  uint8_t n = 0;
+
+  if(!linkaddr_cmp(&peer, &linkaddr_null)) {
+    n = remove_cells(sf, &peer, LINK_OPTION_TX);
+    if(n > 0) {
+      linkaddr_copy(&clear_peer, &peer);
+    }
+  }
+  LOG_INFO("parent switch, moving %u cells to ", n);
+  LOG_INFO_LLADDR(parent);
+  LOG_INFO_("\n");
+  linkaddr_copy(&peer, parent);
+  cells_to_move = n;
+  backoff = 0;
+  timer_set(&request_timer, 0);
+  reset_window();
+}
+/*---------------------------------------------------------------------------*/
+/* Add, delete or relocate one cell at most, from the usage of the cells
+ * and the backlog of the queue to the parent */
+static void
+adapt(struct tsch_slotframe *sf, uint16_t backlog)
+{
+  struct tsch_link *l;
+  struct tsch_link *least_used = NULL;
+  struct tsch_link *worst = NULL;
+  struct msf_cell *c;
+  uint32_t elapsed;
+  uint32_t usage;
+  uint16_t pdr;
+  uint16_t best_pdr = 0;
+  uint16_t worst_pdr = 100;
+  uint8_t num_cells = 0;
+
+  for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+    if(!is_peer_link(l, &peer, LINK_OPTION_TX) || l->data == NULL) {
+      continue;
+    }
+    num_cells++;
+    c = l->data;
+    if(least_used == NULL || c->tx <= ((struct msf_cell *)least_used->data)->tx) {
+      least_used = l;
+    }
+    if(c->tx >= MSF_RELOCATE_MIN_TX) {
+      pdr = (uint32_t)c->ack * 100 / c->tx;
+      if(pdr > best_pdr) {
+        best_pdr = pdr;
+      }
+      if(pdr <= worst_pdr) {
+        worst_pdr = pdr;
+        worst = l;
+      }
+      if(c->tx >= CELL_TX_CAP) {
+        c->tx /= 2;
+        c->ack /= 2;
+      }
+    }
+  }
+
+  if(num_cells < MSF_MIN_CELLS || cells_to_move > 0) {
+    request_add(sf, cells_to_move > 0 ? cells_to_move : MSF_MIN_CELLS - num_cells);
+    return;
+  }
+
+  if(backlog_periods >= MSF_BACKLOG_PERIODS && num_cells < MSF_MAX_CELLS) {
+    LOG_INFO("backlog of %u packets\n", backlog);
+    backlog_periods = 0;
+    request_add(sf, 1);
+    return;
+  }
+
+  elapsed = cell_slots / MSF_SLOTFRAME_LENGTH;
+  if(elapsed >= MSF_USAGE_WINDOW) {
+    usage = (uint32_t)cells_used * 100 / elapsed;
+    reset_window();
+    LOG_DBG("usage %lu%% of %u cells\n", (unsigned long)usage, num_cells);
+    if(usage >= MSF_USAGE_HIGH && num_cells < MSF_MAX_CELLS) {
+      request_add(sf, 1);
+      return;
+    }
+    if(usage <= MSF_USAGE_LOW && num_cells > MSF_MIN_CELLS && backlog == 0) {
+      request_delete(least_used);
+      return;
+    }
+  }
+
+  if(worst != NULL && best_pdr >= worst_pdr + MSF_RELOCATE_PDR_GAP) {
+    request_relocate(sf, worst);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+housekeeping(void *ptr)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_neighbor *n;
+  const linkaddr_t *parent;
+  uint16_t backlog;
+  uint8_t num_cells;
+
+  ctimer_reset(&housekeeping_timer);
+
+  if(!tsch_is_associated) {
+    if(!linkaddr_cmp(&peer, &linkaddr_null)) {
+      reset();
+    }
+    return;
+  }
+
+  if((sf = get_slotframe()) == NULL ||
+     (n = tsch_queue_get_time_source()) == NULL ||
+     (parent = tsch_queue_get_nbr_address(n)) == NULL) {
+    return;
+  }
+
+  if(!linkaddr_cmp(parent, &peer)) {
+    switch_parent(sf, parent);
+  }
+
+  num_cells = count_tx_cells(sf);
+  cell_slots += TSCH_ASN_DIFF(tsch_current_asn, last_asn) * num_cells;
+  last_asn = tsch_current_asn;
+  backlog = tsch_queue_nbr_packet_count(n);
+  if(backlog >= MSF_BACKLOG_HIGH) {
+    if(backlog_periods < 0xff) {
+      backlog_periods++;
+    }
+  } else {
+    backlog_periods = 0;
+  }
+
+  if(!timer_expired(&request_timer) || sixp_trans_find(&peer) != NULL) {
+    return;
+  }
+
+  /* The new parent first, then the old one */
+  if(cells_to_move == 0 && !linkaddr_cmp(&clear_peer, &linkaddr_null)) {
+    if(sixp_trans_find(&clear_peer) == NULL) {
+      request_clear(&clear_peer);
+      linkaddr_copy(&clear_peer, &linkaddr_null);
+    }
+    return;
+  }
+
+  adapt(sf, backlog);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                  sixp_output_status_t status)
+{
+  struct tsch_slotframe *sf;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint16_t i;
+
+  if(status != SIXP_OUTPUT_STATUS_SUCCESS || (sf = get_slotframe()) == NULL) {
+    return;
+  }
+  for(i = 0; i < arg_len; i += CELL_LEN) {
+    read_cell((uint8_t *)arg + i, &timeslot, &channel_offset);
+    add_cell(sf, dest_addr, LINK_OPTION_RX, timeslot, channel_offset);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+delete_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                     sixp_output_status_t status)
+{
+  struct tsch_slotframe *sf;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint16_t i;
+
+  if(status != SIXP_OUTPUT_STATUS_SUCCESS || (sf = get_slotframe()) == NULL) {
+    return;
+  }
+  for(i = 0; i < arg_len; i += CELL_LEN) {
+    read_cell((uint8_t *)arg + i, &timeslot, &channel_offset);
+    remove_listed_cell(sf, dest_addr, LINK_OPTION_RX, timeslot, channel_offset);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+relocate_response_sent(void *arg, uint16_t arg_len, const linkaddr_t *dest_addr,
+                       sixp_output_status_t status)
+{
+  /* The relocated cells, then their new ones */
+  delete_response_sent(arg, arg_len / 2, dest_addr, status);
+  add_response_sent((uint8_t *)arg + arg_len / 2, arg_len / 2, dest_addr, status);
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_response(sixp_pkt_rc_t rc, uint16_t len, uint16_t arg_len,
+              const linkaddr_t *peer_addr, sixp_sent_callback_t func)
+{
+  uint8_t *body = res_storage + arg_len - len;
+
+  sixp_output(SIXP_PKT_TYPE_RESPONSE, (sixp_pkt_code_t)(uint8_t)rc, MSF_SFID,
+              len > 0 ? body : NULL, len, peer_addr,
+              func, res_storage, arg_len);
+}
+/*---------------------------------------------------------------------------*/
+/* Take up to num_cells free cells out of the list into res_storage at
+ * offset, as the CellList of the response */
+static uint16_t
+take_cells(struct tsch_slotframe *sf, const uint8_t *list, uint16_t list_len,
+           uint8_t num_cells, uint16_t offset)
+{
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint16_t t;
+  uint16_t c;
+  uint16_t len = 0;
+  uint16_t i;
+  uint16_t j;
+
+  for(i = 0; i + CELL_LEN <= list_len && len < num_cells * CELL_LEN
+      && offset + len + CELL_LEN <= sizeof(res_storage); i += CELL_LEN) {
+    read_cell(&list[i], &timeslot, &channel_offset);
+    if(!is_free(sf, timeslot)) {
+      continue;
+    }
+    /* Twice the same timeslot in the list */
+    for(j = 0; j < len; j += CELL_LEN) {
+      read_cell(&res_storage[offset + j], &t, &c);
+      if(t == timeslot) {
+        break;
+      }
+    }
+    if(j == len) {
+      write_cell(&res_storage[offset + len], timeslot, channel_offset);
+      len += CELL_LEN;
+    }
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
+static void
+request_input(sixp_pkt_cmd_t cmd, const uint8_t *body, uint16_t body_len,
+              const linkaddr_t *peer_addr)
+{
+  sixp_pkt_code_t code = (sixp_pkt_code_t)(uint8_t)cmd;
+  struct tsch_slotframe *sf;
+  const uint8_t *list = NULL;
+  const uint8_t *rel_list = NULL;
+  sixp_pkt_offset_t list_len;
+  sixp_pkt_offset_t rel_list_len;
+  sixp_pkt_num_cells_t num_cells;
+  sixp_pkt_cell_options_t options;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  struct tsch_link *l;
+  uint16_t len;
+  uint16_t i;
+
+  if((sf = get_slotframe()) == NULL) {
+    send_response(SIXP_PKT_RC_ERR, 0, 0, peer_addr, NULL);
+    return;
+  }
+
+  switch(cmd) {
+  case SIXP_PKT_CMD_ADD:
+    if(sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST, code, &num_cells,
+                              body, body_len) < 0 ||
+       sixp_pkt_get_cell_options(SIXP_PKT_TYPE_REQUEST, code, &options,
+                                 body, body_len) < 0 ||
+       sixp_pkt_get_cell_list(SIXP_PKT_TYPE_REQUEST, code, &list, &list_len,
+                              body, body_len) < 0 ||
+       options != SIXP_PKT_CELL_OPTION_TX) {
+      send_response(SIXP_PKT_RC_ERR, 0, 0, peer_addr, NULL);
+      return;
+    }
+    len = take_cells(sf, list, list_len, num_cells, 0);
+    send_response(SIXP_PKT_RC_SUCCESS, len, len, peer_addr, add_response_sent);
+    break;
+
+  case SIXP_PKT_CMD_DELETE:
+    if(sixp_pkt_get_cell_list(SIXP_PKT_TYPE_REQUEST, code, &list, &list_len,
+                              body, body_len) < 0) {
+      send_response(SIXP_PKT_RC_ERR, 0, 0, peer_addr, NULL);
+      return;
+    }
+    len = 0;
+    for(i = 0; i + CELL_LEN <= list_len && len < sizeof(res_storage);
+        i += CELL_LEN) {
+      read_cell(&list[i], &timeslot, &channel_offset);
+      l = tsch_schedule_get_link_by_offsets(sf, timeslot, channel_offset);
+      if(l != NULL && is_peer_link(l, peer_addr, LINK_OPTION_RX)) {
+        memcpy(&res_storage[len], &list[i], CELL_LEN);
+        len += CELL_LEN;
+      }
+    }
+    send_response(SIXP_PKT_RC_SUCCESS, len, len, peer_addr, delete_response_sent);
+    break;
+
+  case SIXP_PKT_CMD_RELOCATE:
+    if(sixp_pkt_get_num_cells(SIXP_PKT_TYPE_REQUEST, code, &num_cells,
+                              body, body_len) < 0 ||
+       sixp_pkt_get_rel_cell_list(SIXP_PKT_TYPE_REQUEST, code, &rel_list,
+                                  &rel_list_len, body, body_len) < 0 ||
+       sixp_pkt_get_cand_cell_list(SIXP_PKT_TYPE_REQUEST, code, &list,
+                                   &list_len, body, body_len) < 0 ||
+       num_cells > MSF_CANDIDATE_CELLS) {
+      send_response(SIXP_PKT_RC_ERR, 0, 0, peer_addr, NULL);
+      return;
+    }
+    for(i = 0; i < rel_list_len; i += CELL_LEN) {
+      read_cell(&rel_list[i], &timeslot, &channel_offset);
+      l = tsch_schedule_get_link_by_offsets(sf, timeslot, channel_offset);
+      if(l == NULL || !is_peer_link(l, peer_addr, LINK_OPTION_RX)) {
+        send_response(SIXP_PKT_RC_ERR_CELLLIST, 0, 0, peer_addr, NULL);
+        return;
+      }
+    }
+    /* The new cells after room for the relocated ones, of which the
+     * first as many are relocated */
+    len = take_cells(sf, list, list_len, num_cells,
+                     MSF_CANDIDATE_CELLS * CELL_LEN);
+    memmove(&res_storage[len], &res_storage[MSF_CANDIDATE_CELLS * CELL_LEN], len);
+    memcpy(res_storage, rel_list, len);
+    send_response(SIXP_PKT_RC_SUCCESS, len, 2 * len, peer_addr,
+                  relocate_response_sent);
+    break;
+
+  case SIXP_PKT_CMD_CLEAR:
+    remove_cells(sf, peer_addr, LINK_OPTION_TX | LINK_OPTION_RX);
+    if(linkaddr_cmp(peer_addr, &peer)) {
+      linkaddr_copy(&peer, &linkaddr_null);
+    }
+    send_response(SIXP_PKT_RC_SUCCESS, 0, 0, peer_addr, NULL);
+    break;
+
+  default:
+    send_response(SIXP_PKT_RC_ERR, 0, 0, peer_addr, NULL);
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+response_input(sixp_pkt_rc_t rc, const uint8_t *body, uint16_t body_len,
+               const linkaddr_t *peer_addr)
+{
+  struct tsch_slotframe *sf;
+  sixp_trans_t *trans;
+  sixp_pkt_cmd_t cmd;
+  const uint8_t *list;
+  sixp_pkt_offset_t list_len;
+  uint16_t timeslot;
+  uint16_t channel_offset;
+  uint16_t i;
+
+  if((trans = sixp_trans_find(peer_addr)) == NULL ||
+     (sf = get_slotframe()) == NULL) {
+    return;
+  }
+  cmd = sixp_trans_get_cmd(trans);
+
+  if(rc != SIXP_PKT_RC_SUCCESS) {
+    LOG_WARN("request %u failed with rc %u\n", cmd, rc);
+    if(backoff < 3) {
+      backoff++;
+    }
+    if(rc == SIXP_PKT_RC_ERR_SEQNUM || rc == SIXP_PKT_RC_RESET) {
+      /* Both ends disagree on the schedule: start over with this peer */
+      remove_cells(sf, peer_addr, LINK_OPTION_TX | LINK_OPTION_RX);
+      linkaddr_copy(&clear_peer, peer_addr);
+    }
+    if(cmd == SIXP_PKT_CMD_ADD) {
+      cells_to_move = 0;
+    }
+    return;
+  }
+
+  backoff = 0;
+  if(cmd == SIXP_PKT_CMD_CLEAR ||
+     !linkaddr_cmp(peer_addr, &peer) ||
+     sixp_pkt_get_cell_list(SIXP_PKT_TYPE_RESPONSE,
+                            (sixp_pkt_code_t)(uint8_t)rc,
+                            &list, &list_len, body, body_len) < 0) {
+    return;
+  }
+
+  switch(cmd) {
+  case SIXP_PKT_CMD_ADD:
+    for(i = 0; i + CELL_LEN <= list_len; i += CELL_LEN) {
+      read_cell(&list[i], &timeslot, &channel_offset);
+      add_cell(sf, peer_addr, LINK_OPTION_TX, timeslot, channel_offset);
+    }
+    if(list_len == 0 || cells_to_move <= list_len / CELL_LEN) {
+      cells_to_move = 0;
+    } else {
+      cells_to_move -= list_len / CELL_LEN;
+      /* Get the rest of the cells without waiting */
+      timer_set(&request_timer, 0);
+    }
+    break;
+  case SIXP_PKT_CMD_DELETE:
+    for(i = 0; i + CELL_LEN <= list_len; i += CELL_LEN) {
+      read_cell(&list[i], &timeslot, &channel_offset);
+      remove_listed_cell(sf, peer_addr, LINK_OPTION_TX, timeslot, channel_offset);
+    }
+    break;
+  case SIXP_PKT_CMD_RELOCATE:
+    if(list_len >= CELL_LEN) {
+      remove_listed_cell(sf, peer_addr, LINK_OPTION_TX,
+                         relocating_timeslot, relocating_channel_offset);
+      read_cell(list, &timeslot, &channel_offset);
+      add_cell(sf, peer_addr, LINK_OPTION_TX, timeslot, channel_offset);
+    }
+    break;
+  default:
+    break;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+input(sixp_pkt_type_t type, sixp_pkt_code_t code,
+      const uint8_t *body, uint16_t body_len, const linkaddr_t *src_addr)
+{
+  if(type == SIXP_PKT_TYPE_REQUEST) {
+    request_input(code.cmd, body, body_len, src_addr);
+  } else if(type == SIXP_PKT_TYPE_RESPONSE) {
+    response_input(code.rc, body, body_len, src_addr);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+timeout_input(sixp_pkt_cmd_t cmd, const linkaddr_t *peer_addr)
+{
+  LOG_WARN("request %u timed out\n", cmd);
+  if(backoff < 3) {
+    backoff++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+error_input(sixp_error_t err, sixp_pkt_cmd_t cmd, uint8_t seqno,
+      const linkaddr_t *peer_addr)
+{
+  struct tsch_slotframe *sf;
+
+  if(err == SIXP_ERROR_SCHEDULE_INCONSISTENCY &&
+     (sf = get_slotframe()) != NULL) {
+    /* The peer restarted: its cells with us are gone */
+    remove_cells(sf, peer_addr, LINK_OPTION_TX | LINK_OPTION_RX);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+init(void)
+{
+  reset();
+}
+/*---------------------------------------------------------------------------*/
+static const sixtop_sf_t msf_driver = {
+  MSF_SFID,
+  MSF_REQUEST_INTERVAL,
+  init,
+  input,
+  timeout_input,
+  error_input
+};
+/*---------------------------------------------------------------------------*/
+void
+msf_callback_tx_done(const struct tsch_link *link, uint8_t mac_tx_status)
+{
+  struct msf_cell *c;
+
+  if(link == NULL || link->slotframe_handle != MSF_SLOTFRAME_HANDLE
+     || link->data == NULL) {
+    return;
+  }
+  c = link->data;
+  c->tx++;
+  if(mac_tx_status == MAC_TX_OK) {
+    c->ack++;
+  }
+  cells_used++;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+msf_num_tx_cells(void)
+{
+  struct tsch_slotframe *sf;
+
+  sf = tsch_schedule_get_slotframe_by_handle(MSF_SLOTFRAME_HANDLE);
+  return sf == NULL ? 0 : count_tx_cells(sf);
+}
+/*---------------------------------------------------------------------------*/
+void
+msf_init(void)
+{
+  if(sixtop_add_sf(&msf_driver) < 0) {
+    LOG_ERR("failed to add MSF to 6top\n");
+    return;
+  }
+  ctimer_set(&housekeeping_timer, MSF_HOUSEKEEPING_PERIOD, housekeeping, NULL);
+}
+/*---------------------------------------------------------------------------*/
+/** @} */
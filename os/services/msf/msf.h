@@ -0,0 +1,46 @@
+/**
+ * \defgroup msf 6TiSCH Minimal Scheduling Function
+ * @{
+ *
+ * \file
+ *         An MSF-style 6P scheduling function (RFC 9033). It negotiates TX
+ *         cells to the preferred parent, adds one when the cells are busy or
+ *         the queue to the parent keeps a backlog, deletes one when they are
+ *         mostly idle, relocates cells whose PDR is much worse than the
+ *         others, and moves all of them when the parent changes. Shared and
+ *         broadcast traffic is left to the minimal schedule or Orchestra.
+ *
+ *         Build with MODULES += os/services/msf. A node that is both child
+ *         and parent runs two transactions at once and needs
+ *         SIXTOP_CONF_MAX_TRANSACTIONS 2.
+ */
+
+#ifndef MSF_H_
+#define MSF_H_
+
+#include "contiki.h"
+#include "net/linkaddr.h"
+
+struct tsch_link;
+
+/**
+ * \brief Start MSF: adds it to 6top and starts the housekeeping.
+ * Called from contiki-main when built with the MSF module.
+ */
+void msf_init(void);
+
+/**
+ * \brief Count a transmission attempt. Set with
+ * #define TSCH_CALLBACK_TX_DONE msf_callback_tx_done, the default with MSF.
+ * \param link The link used
+ * \param mac_tx_status The MAC status of the attempt
+ */
+void msf_callback_tx_done(const struct tsch_link *link, uint8_t mac_tx_status);
+
+/**
+ * \brief The number of negotiated TX cells to the preferred parent
+ */
+uint8_t msf_num_tx_cells(void);
+
+#endif /* MSF_H_ */
+/** @} */
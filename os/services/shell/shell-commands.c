@@ -846,6 +846,65 @@ PT_THREAD(cmd_tsch_schedule(struct pt *pt, shell_output_func output, char *args)
   }
   PT_END(pt);
 }
+#if TSCH_PROFILE_ON
+/*---------------------------------------------------------------------------*/
+static
+PT_THREAD(cmd_tsch_profile(struct pt *pt, shell_output_func output, char *args))
+{
+  char *next_args;
+  int i;
+
+  PT_BEGIN(pt);
+
+  SHELL_ARGS_INIT(args, next_args);
+
+  /* Get and parse argument */
+  SHELL_ARGS_NEXT(args, next_args);
+  if(args != NULL && !strcmp(args, "reset")) {
+    tsch_profile_reset();
+    SHELL_OUTPUT(output, "TSCH profile reset\n");
+  } else if(args != NULL && !strcmp(args, "dump")) {
+    uint8_t buf[TSCH_PROFILE_RING_LEN * TSCH_PROFILE_RECORD_LEN];
+    int len = tsch_profile_dump(buf, sizeof(buf));
+
+    /* One record of TSCH_PROFILE_RECORD_LEN bytes per line */
+    for(i = 0; i < len; i++) {
+      SHELL_OUTPUT(output, "%02x%s", buf[i],
+                   (i + 1) % TSCH_PROFILE_RECORD_LEN == 0 ? "\n" : "");
+    }
+  } else if(args == NULL) {
+    SHELL_OUTPUT(output, "TSCH slot profile, ticks from the slot start (%lu ticks/s):\n",
+                 (unsigned long)RTIMER_SECOND);
+    for(i = 0; i < TSCH_PROFILE_NUM_PHASES; i++) {
+      struct tsch_profile_stats s;
+      int16_t deadline;
+
+      if(!tsch_profile_get_stats(i, &s)) {
+        PT_EXIT(pt);
+      }
+      SHELL_OUTPUT(output, "-- %s: ", tsch_profile_phase_name(i));
+      if(s.count == 0) {
+        SHELL_OUTPUT(output, "not reached");
+      } else {
+        SHELL_OUTPUT(output, "min %d, avg %ld, max %d, count %lu, overruns %lu",
+                     s.min, (long)(s.sum / (int64_t)s.count), s.max,
+                     (unsigned long)s.count, (unsigned long)s.overruns);
+      }
+      deadline = tsch_profile_deadline(NULL, i);
+      if(deadline != TSCH_PROFILE_NO_DEADLINE) {
+        SHELL_OUTPUT(output, ", deadline %d\n", deadline);
+      } else {
+        SHELL_OUTPUT(output, ", deadline rx-end + %u\n",
+                     (unsigned)tsch_timing[tsch_ts_tx_ack_delay]);
+      }
+    }
+  } else {
+    SHELL_OUTPUT(output, "Invalid argument: %s\n", args);
+  }
+
+  PT_END(pt);
+}
+#endif /* TSCH_PROFILE_ON */
 #endif /* MAC_CONF_WITH_TSCH */
 /*---------------------------------------------------------------------------*/
 #if TSCH_WITH_SIXTOP
@@ -1024,6 +1083,9 @@ const struct shell_command_t builtin_shell_commands[] = {
   { "tsch-set-coordinator", cmd_tsch_set_coordinator, "'> tsch-set-coordinator 0/1 [0/1]': Sets node as coordinator (1) or not (0). Second, optional parameter: enable (1) or disable (0) security." },
   { "tsch-schedule",        cmd_tsch_schedule,        "'> tsch-schedule': Shows the current TSCH schedule" },
   { "tsch-status",          cmd_tsch_status,          "'> tsch-status': Shows a summary of the current TSCH state" },
+#if TSCH_PROFILE_ON
+  { "tsch-profile",         cmd_tsch_profile,         "'> tsch-profile [reset|dump]': Shows the timing of the TSCH slot phases, resets it, or dumps the last slots in hex" },
+#endif /* TSCH_PROFILE_ON */
 #endif /* MAC_CONF_WITH_TSCH */
 #if TSCH_WITH_SIXTOP
   { "6top",                 cmd_6top,                 "'> 6top help': Shows 6top command usage" },
@@ -37,6 +37,8 @@
 #include "lib/dbl-list.h"
 #include "lib/dbl-circ-list.h"
 #include "lib/random.h"
+#include "lib/memb.h"
+#include "lib/hash-index.h"
 #include "services/unit-test/unit-test.h"
 
 #include <string.h>
@@ -1024,6 +1026,96 @@ UNIT_TEST(test_cdll)
   UNIT_TEST_END();
 }
 /*---------------------------------------------------------------------------*/
+typedef struct hashed_s {
+  uint32_t value;
+} hashed_t;
+
+static uint32_t
+hashed_hash(const void *item)
+{
+  return ((const hashed_t *)item)->value;
+}
+
+MEMB(hashed_memb, hashed_t, 6);
+HASH_INDEX(hidx, 8, hashed_hash, hashed_memb);
+
+static hashed_t *
+hashed_find(uint32_t value)
+{
+  unsigned pos = hash_index_first(&hidx, value);
+  hashed_t *h;
+
+  while((h = hash_index_next(&hidx, &pos)) != NULL) {
+    if(h->value == value) {
+      return h;
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_hash_index, "Open-addressing hash index");
+UNIT_TEST(test_hash_index)
+{
+  /* 6, 14 and 22 share slot 6 as home, the chain wraps around */
+  static const uint32_t values[] = { 6, 14, 22, 7, 3 };
+  hashed_t *items[5];
+  hashed_t *other;
+  uint32_t h;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  memb_init(&hashed_memb);
+  for(i = 0; i < 5; i++) {
+    items[i] = memb_alloc(&hashed_memb);
+    items[i]->value = values[i];
+  }
+  other = memb_alloc(&hashed_memb);
+  other->value = 6;
+
+  hash_index_clear(&hidx);
+  for(i = 0; i < 5; i++) {
+    UNIT_TEST_ASSERT(hash_index_add(&hidx, items[i]) == 1);
+  }
+  for(i = 0; i < 5; i++) {
+    UNIT_TEST_ASSERT(hashed_find(items[i]->value) == items[i]);
+  }
+  UNIT_TEST_ASSERT(hashed_find(30) == NULL);
+
+  /* Removing the head of the chain shifts the rest back */
+  UNIT_TEST_ASSERT(hash_index_remove(&hidx, items[0]) == 1);
+  UNIT_TEST_ASSERT(hash_index_remove(&hidx, items[0]) == 0);
+  UNIT_TEST_ASSERT(hash_index_remove(&hidx, other) == 0);
+  UNIT_TEST_ASSERT(hashed_find(6) == NULL);
+  for(i = 1; i < 5; i++) {
+    UNIT_TEST_ASSERT(hashed_find(items[i]->value) == items[i]);
+  }
+  /* The chain moved up by one slot. Slots hold pool indexes plus one */
+  UNIT_TEST_ASSERT(hidx.slots[6] == 2);
+  UNIT_TEST_ASSERT(hidx.slots[0] == 4);
+  UNIT_TEST_ASSERT(hidx.slots[1] == 0);
+
+  /* Fill it up */
+  UNIT_TEST_ASSERT(hash_index_add(&hidx, items[0]) == 1);
+  for(i = 0; i < 3; i++) {
+    UNIT_TEST_ASSERT(hash_index_add(&hidx, other) == 1);
+  }
+  UNIT_TEST_ASSERT(hash_index_add(&hidx, other) == 0);
+
+  hash_index_clear(&hidx);
+  UNIT_TEST_ASSERT(hashed_find(14) == NULL);
+
+  /* FNV-1a test vectors */
+  h = hash_index_fnv1a(HASH_INDEX_FNV1A_INIT, "", 0);
+  UNIT_TEST_ASSERT(h == 0x811c9dc5UL);
+  h = hash_index_fnv1a(HASH_INDEX_FNV1A_INIT, "a", 1);
+  UNIT_TEST_ASSERT(h == 0xe40c292cUL);
+  h = hash_index_fnv1a(HASH_INDEX_FNV1A_INIT, "foobar", 6);
+  UNIT_TEST_ASSERT(h == 0xbf9cf968UL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(data_structure_test_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -1039,6 +1131,7 @@ PROCESS_THREAD(data_structure_test_process, ev, data)
   UNIT_TEST_RUN(test_csll);
   UNIT_TEST_RUN(test_dll);
   UNIT_TEST_RUN(test_cdll);
+  UNIT_TEST_RUN(test_hash_index);
 
   printf("=check-me= DONE\n");
 
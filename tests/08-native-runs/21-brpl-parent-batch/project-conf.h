@@ -0,0 +1,9 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define RPL_CONF_OF_OCP RPL_OCP_BRPL
+
+/* Let the margin gate, not the dwell timer, decide on parent switches */
+#define BRPL_CONF_PARENT_DWELL_SECONDS 0
+
+#endif /* PROJECT_CONF_H_ */
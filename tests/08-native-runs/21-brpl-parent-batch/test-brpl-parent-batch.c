@@ -0,0 +1,218 @@
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/routing/rpl-classic/rpl.h"
+#include "net/routing/rpl-classic/rpl-private.h"
+#include "net/routing/trust-engine.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_PARENTS    64
+#define NUM_ROUNDS     2000
+#define INSTANCE_ID    0x1e
+
+PROCESS(test_process, "BRPL parent batch test");
+AUTOSTART_PROCESSES(&test_process);
+
+extern rpl_of_t rpl_brpl;
+
+static rpl_dag_t *dag;
+static rpl_parent_t *parents[NUM_PARENTS];
+static rpl_parent_score_t scores[NUM_PARENTS];
+/*---------------------------------------------------------------------------*/
+static int
+setup_dag(void)
+{
+  uip_ipaddr_t dag_id;
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+  rpl_dio_t dio;
+  int i;
+
+  uip_ip6addr(&dag_id, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  dag = rpl_alloc_dag(INSTANCE_ID, &dag_id);
+  if(dag == NULL) {
+    return 0;
+  }
+  dag->instance->of = &rpl_brpl;
+  dag->instance->min_hoprankinc = RPL_MIN_HOPRANKINC;
+  dag->instance->max_rankinc = RPL_MAX_RANKINC;
+  dag->rank = 8 * RPL_MIN_HOPRANKINC;
+  rpl_brpl.reset(dag);
+
+  memset(&dio, 0, sizeof(dio));
+  dio.rank = RPL_MIN_HOPRANKINC;
+  for(i = 0; i < NUM_PARENTS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[0] = 0x02;
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&ipaddr, &lladdr);
+    if(uip_ds6_nbr_add(&ipaddr, &lladdr, 1, NBR_REACHABLE,
+                       NBR_TABLE_REASON_UNDEFINED, NULL) == NULL) {
+      return 0;
+    }
+    parents[i] = rpl_add_parent(dag, &dio, &ipaddr);
+    if(parents[i] == NULL) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Draw new ranks, queues, trust verdicts and preferred parent */
+static void
+shuffle_round(void)
+{
+  struct trust_decision verdict;
+  int i;
+
+  for(i = 0; i < NUM_PARENTS; i++) {
+    rpl_parent_t *p = parents[i];
+    p->rank = RPL_MIN_HOPRANKINC + random_rand() % (16 * RPL_MIN_HOPRANKINC);
+    p->brpl_queue.queue = random_rand() % BRPL_CONF_QUEUE_MAX;
+    p->brpl_queue.queue_max = BRPL_CONF_QUEUE_MAX;
+    p->brpl_queue.valid = 1;
+    brpl_parent_updated(p);
+    verdict = trust_engine_neutral;
+    verdict.trust = 200 + random_rand() % 801;
+    if(random_rand() % 10 == 0) {
+      verdict.flags &= ~TRUST_DECISION_ALLOWED;
+    }
+    trust_engine_set_verdict(rpl_get_parent_lladdr(p), &verdict);
+  }
+  dag->preferred_parent = (random_rand() % 4) == 0 ?
+    NULL : parents[random_rand() % NUM_PARENTS];
+  brpl_state_update(dag);
+}
+/*---------------------------------------------------------------------------*/
+static rpl_parent_t *
+select_pairwise(void)
+{
+  rpl_parent_t *best = NULL;
+  int i;
+
+  for(i = 0; i < NUM_PARENTS; i++) {
+    best = rpl_brpl.best_parent(best, parents[i]);
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
+static rpl_parent_t *
+select_batch(void)
+{
+  int i;
+
+  for(i = 0; i < NUM_PARENTS; i++) {
+    scores[i].parent = parents[i];
+  }
+  return rpl_brpl.best_parent_batch(dag, scores, NUM_PARENTS);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(same_choice, "Batch and pairwise select the same parent");
+UNIT_TEST(same_choice)
+{
+  int round;
+  int switches = 0;
+
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(rpl_brpl.best_parent_batch != NULL);
+
+  RANDOM_PRNG.seed(0x1234);
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    rpl_parent_t *pairwise;
+    rpl_parent_t *batch;
+
+    shuffle_round();
+    pairwise = select_pairwise();
+    batch = select_batch();
+    UNIT_TEST_ASSERT(pairwise != NULL);
+    UNIT_TEST_ASSERT(pairwise == batch);
+    if(dag->preferred_parent != NULL && batch != dag->preferred_parent) {
+      switches++;
+    }
+  }
+  /* Make sure both the switch and the hysteresis paths were exercised */
+  printf("switches: %d/%d\n", switches, NUM_ROUNDS);
+  UNIT_TEST_ASSERT(switches > 0 && switches < NUM_ROUNDS);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(speedup, "Batch scores each parent once");
+UNIT_TEST(speedup)
+{
+  int round;
+  clock_t start;
+  clock_t pairwise_time;
+  clock_t batch_time;
+  uint32_t pairwise_calls;
+  uint32_t batch_calls;
+
+  UNIT_TEST_BEGIN();
+
+  RANDOM_PRNG.seed(0x5678);
+  shuffle_round();
+
+  /* Scoring a parent looks its trust decision up once. The scorings are
+   * counted; the times vary with the load of the host and are printed
+   * only */
+  pairwise_calls = trust_engine_stats.lookups;
+  start = clock();
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    select_pairwise();
+  }
+  pairwise_time = clock() - start;
+  pairwise_calls = trust_engine_stats.lookups - pairwise_calls;
+
+  batch_calls = trust_engine_stats.lookups;
+  start = clock();
+  for(round = 0; round < NUM_ROUNDS; round++) {
+    select_batch();
+  }
+  batch_time = clock() - start;
+  batch_calls = trust_engine_stats.lookups - batch_calls;
+
+  printf("pairwise: %lu us, %lu scorings; batch: %lu us, %lu scorings\n",
+         (unsigned long)(pairwise_time * 1000000 / CLOCKS_PER_SEC),
+         (unsigned long)pairwise_calls,
+         (unsigned long)(batch_time * 1000000 / CLOCKS_PER_SEC),
+         (unsigned long)batch_calls);
+
+  UNIT_TEST_ASSERT(pairwise_calls == (uint32_t)NUM_ROUNDS * 2 * (NUM_PARENTS - 1));
+  UNIT_TEST_ASSERT(batch_calls == (uint32_t)NUM_ROUNDS * NUM_PARENTS);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  if(!setup_dag()) {
+    printf("DAG setup failed\n");
+    printf("=check-me= FAILED\n");
+  } else {
+    UNIT_TEST_RUN(same_choice);
+    UNIT_TEST_RUN(speedup);
+
+    if(!UNIT_TEST_PASSED(same_choice)
+       || !UNIT_TEST_PASSED(speedup)) {
+      printf("=check-me= FAILED\n");
+      printf("---\n");
+    }
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 256
+#define NBR_TABLE_CONF_WITH_HASH_INDEX 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,181 @@
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/nbr-table.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_LOOKUPS 200000
+#define NUM_CHURN   1000
+
+PROCESS(test_process, "nbr-table hash index test");
+AUTOSTART_PROCESSES(&test_process);
+
+NBR_TABLE(uint32_t, bench_table);
+
+static const int sizes[] = { 16, 64, 256 };
+static linkaddr_t addrs[NBR_TABLE_MAX_NEIGHBORS + NUM_CHURN];
+/*---------------------------------------------------------------------------*/
+/* Addresses that share their last byte, as EUI-64s of one vendor would */
+static void
+make_addr(linkaddr_t *addr, uint32_t i)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->u8[0] = 0x02;
+  addr->u8[1] = (i >> 16) & 0xff;
+  addr->u8[2] = (i >> 8) & 0xff;
+  addr->u8[3] = i & 0xff;
+  addr->u8[LINKADDR_SIZE - 1] = 0x01;
+}
+/*---------------------------------------------------------------------------*/
+/* Reference lookup: the linear scan of the key list used without the
+ * hash index */
+static uint32_t *
+linear_lookup(const linkaddr_t *addr)
+{
+  nbr_table_key_t *k;
+  for(k = nbr_table_key_head(); k != NULL; k = nbr_table_key_next(k)) {
+    if(linkaddr_cmp(addr, &k->lladdr)) {
+      return nbr_table_get_from_lladdr(bench_table, &k->lladdr);
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+static int
+fill(int n)
+{
+  int i;
+
+  nbr_table_clear();
+  for(i = 0; i < n; i++) {
+    uint32_t *item;
+    make_addr(&addrs[i], i);
+    item = nbr_table_add_lladdr(bench_table, &addrs[i],
+                                NBR_TABLE_REASON_UNDEFINED, NULL);
+    if(item == NULL) {
+      return 0;
+    }
+    *item = i;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+check_consistent(int first, int last)
+{
+  linkaddr_t absent;
+  int i;
+
+  for(i = first; i < last; i++) {
+    uint32_t *item = nbr_table_get_from_lladdr(bench_table, &addrs[i]);
+    if(item != linear_lookup(&addrs[i])) {
+      return 0;
+    }
+    if(item != NULL && *item != (uint32_t)i) {
+      return 0;
+    }
+  }
+  make_addr(&absent, 0xffffff);
+  return nbr_table_get_from_lladdr(bench_table, &absent) == NULL;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(lookup, "Hash lookup matches the key list");
+UNIT_TEST(lookup)
+{
+  int i;
+  int n;
+
+  UNIT_TEST_BEGIN();
+
+  for(n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+    UNIT_TEST_ASSERT(fill(sizes[n]));
+    UNIT_TEST_ASSERT(nbr_table_count_entries() == sizes[n]);
+    UNIT_TEST_ASSERT(check_consistent(0, sizes[n]));
+  }
+
+  /* The table is full: each new address evicts an old one, which
+   * exercises removal from the index */
+  for(i = 0; i < NUM_CHURN; i++) {
+    int index = NBR_TABLE_MAX_NEIGHBORS + i;
+    uint32_t *item;
+    make_addr(&addrs[index], index);
+    item = nbr_table_add_lladdr(bench_table, &addrs[index],
+                                NBR_TABLE_REASON_UNDEFINED, NULL);
+    UNIT_TEST_ASSERT(item != NULL);
+    *item = index;
+  }
+  UNIT_TEST_ASSERT(nbr_table_count_entries() == NBR_TABLE_MAX_NEIGHBORS);
+  UNIT_TEST_ASSERT(check_consistent(0, NBR_TABLE_MAX_NEIGHBORS + NUM_CHURN));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(benchmark, "Lookup cost at 16, 64 and 256 neighbors");
+UNIT_TEST(benchmark)
+{
+  static uint16_t targets[NUM_LOOKUPS];
+  volatile uint32_t sink = 0;
+  clock_t start;
+  clock_t linear_time;
+  clock_t hash_time;
+  int n;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+    UNIT_TEST_ASSERT(fill(sizes[n]));
+    for(i = 0; i < NUM_LOOKUPS; i++) {
+      targets[i] = random_rand() % sizes[n];
+    }
+
+    /* Printed only: wall-clock times vary with the load of the host */
+    start = clock();
+    for(i = 0; i < NUM_LOOKUPS; i++) {
+      sink += *linear_lookup(&addrs[targets[i]]);
+    }
+    linear_time = clock() - start;
+
+    start = clock();
+    for(i = 0; i < NUM_LOOKUPS; i++) {
+      sink += *(uint32_t *)nbr_table_get_from_lladdr(bench_table, &addrs[targets[i]]);
+    }
+    hash_time = clock() - start;
+
+    printf("%3d neighbors: linear %lu ns/lookup, hash %lu ns/lookup\n",
+           sizes[n],
+           (unsigned long)(linear_time * (1000000000 / CLOCKS_PER_SEC) / NUM_LOOKUPS),
+           (unsigned long)(hash_time * (1000000000 / CLOCKS_PER_SEC) / NUM_LOOKUPS));
+  }
+  (void)sink;
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  nbr_table_register(bench_table, NULL);
+
+  UNIT_TEST_RUN(lookup);
+  UNIT_TEST_RUN(benchmark);
+
+  if(!UNIT_TEST_PASSED(lookup)
+     || !UNIT_TEST_PASSED(benchmark)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define UIP_CONF_MAX_ROUTES 1024
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 16
+#define UIP_DS6_ROUTE_CONF_LPM_INDEX 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,213 @@
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_NEXTHOPS 8
+#define NUM_OPS      200000
+#define NUM_LOOKUPS  200000
+
+PROCESS(test_process, "ds6 route LPM index test");
+AUTOSTART_PROCESSES(&test_process);
+
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+/*---------------------------------------------------------------------------*/
+/* Reference lookup: the linear longest-prefix scan used without the
+ * index, minus the move-to-front */
+static uip_ds6_route_t *
+linear_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *found_route = NULL;
+  uint8_t longestmatch = 0;
+
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->length >= longestmatch &&
+       uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      longestmatch = r->length;
+      found_route = r;
+      if(longestmatch == 128) {
+        break;
+      }
+    }
+  }
+  return found_route;
+}
+/*---------------------------------------------------------------------------*/
+static int
+setup_nexthops(void)
+{
+  uip_lladdr_t lladdr;
+  int i;
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    memset(&lladdr, 0, sizeof(lladdr));
+    lladdr.addr[0] = 0x02;
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+    uip_ds6_set_addr_iid(&nexthops[i], &lladdr);
+    if(uip_ds6_nbr_add(&nexthops[i], &lladdr, 1, NBR_REACHABLE,
+                       NBR_TABLE_REASON_UNDEFINED, NULL) == NULL) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+clear_routes(void)
+{
+  while(uip_ds6_route_head() != NULL) {
+    uip_ds6_route_rm(uip_ds6_route_head());
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Addresses from a small space, so that prefixes overlap a lot */
+static void
+random_addr(uip_ipaddr_t *addr)
+{
+  uip_ip6addr(addr, 0xfd00, random_rand() % 4, 0, random_rand() % 16,
+              0, 0, random_rand() % 16, random_rand() % 256);
+}
+/*---------------------------------------------------------------------------*/
+static uint8_t
+random_length(void)
+{
+  static const uint8_t lengths[] = { 128, 128, 128, 128, 64, 64, 60, 48, 0 };
+  return lengths[random_rand() % sizeof(lengths)];
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+random_route(void)
+{
+  uip_ds6_route_t *r = uip_ds6_route_head();
+  int n = uip_ds6_route_num_routes();
+
+  if(n > 0) {
+    for(n = random_rand() % n; n > 0; n--) {
+      r = uip_ds6_route_next(r);
+    }
+  }
+  return r;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(same_result, "Index lookups match the linear scan");
+UNIT_TEST(same_result)
+{
+  uip_ipaddr_t addr;
+  int op;
+  int max_routes = 0;
+
+  UNIT_TEST_BEGIN();
+
+  RANDOM_PRNG.seed(0x4321);
+  clear_routes();
+  for(op = 0; op < NUM_OPS; op++) {
+    int action = random_rand() % 16;
+
+    random_addr(&addr);
+    if(action < 8) {
+      uip_ds6_route_add(&addr, random_length(),
+                        &nexthops[random_rand() % NUM_NEXTHOPS]);
+    } else if(action < 10) {
+      uip_ds6_route_rm(random_route());
+    } else if(action == 10 && random_rand() % 64 == 0) {
+      uip_ds6_route_rm_by_nexthop(&nexthops[random_rand() % NUM_NEXTHOPS]);
+    } else {
+      uip_ds6_route_t *expected = linear_lookup(&addr);
+      UNIT_TEST_ASSERT(uip_ds6_route_lookup(&addr) == expected);
+      UNIT_TEST_ASSERT(expected == NULL || uip_ds6_route_head() == expected);
+    }
+    if(uip_ds6_route_num_routes() > max_routes) {
+      max_routes = uip_ds6_route_num_routes();
+    }
+  }
+  printf("peak routes: %d\n", max_routes);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(benchmark, "Host route lookup cost at 1000 routes");
+UNIT_TEST(benchmark)
+{
+  static uip_ipaddr_t targets[NUM_LOOKUPS];
+  uip_ipaddr_t addr;
+  volatile uint32_t sink = 0;
+  clock_t start;
+  clock_t linear_time;
+  clock_t index_time;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  clear_routes();
+  for(i = 1; i <= 1000; i++) {
+    uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, i >> 8, i & 0xff);
+    UNIT_TEST_ASSERT(uip_ds6_route_add(&addr, 128,
+                                       &nexthops[i % NUM_NEXTHOPS]) != NULL);
+  }
+  /* Covers the hosts without a route of their own */
+  uip_ip6addr(&addr, 0xfd00, 0, 0, 0, 0, 0, 0, 0);
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&addr, 64, &nexthops[0]) != NULL);
+
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    uint16_t host = random_rand() % 1100;
+    uip_ip6addr(&targets[i], 0xfd00, 0, 0, 0, 0, 0, host >> 8, host & 0xff);
+  }
+
+  /* Printed only: wall-clock times vary with the load of the host */
+  start = clock();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    sink += linear_lookup(&targets[i])->length;
+  }
+  linear_time = clock() - start;
+
+  start = clock();
+  for(i = 0; i < NUM_LOOKUPS; i++) {
+    sink += uip_ds6_route_lookup(&targets[i])->length;
+  }
+  index_time = clock() - start;
+
+  printf("1001 routes: linear %lu ns/lookup, index %lu ns/lookup\n",
+         (unsigned long)(linear_time * (1000000000 / CLOCKS_PER_SEC) / NUM_LOOKUPS),
+         (unsigned long)(index_time * (1000000000 / CLOCKS_PER_SEC) / NUM_LOOKUPS));
+  (void)sink;
+
+  clear_routes();
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  if(!setup_nexthops()) {
+    printf("Neighbor setup failed\n");
+    printf("=check-me= FAILED\n");
+  } else {
+    UNIT_TEST_RUN(same_result);
+    UNIT_TEST_RUN(benchmark);
+
+    if(!UNIT_TEST_PASSED(same_result)
+       || !UNIT_TEST_PASSED(benchmark)) {
+      printf("=check-me= FAILED\n");
+      printf("---\n");
+    }
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
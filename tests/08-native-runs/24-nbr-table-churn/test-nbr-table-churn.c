@@ -0,0 +1,216 @@
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/nbr-table.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* More addresses than slots, so that keys get recycled */
+#define NUM_ADDRS   (4 * NBR_TABLE_MAX_NEIGHBORS)
+#define NUM_WINDOWS 2000
+#define NUM_STEPS   8
+
+PROCESS(test_process, "nbr-table churn test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* The tracked table, and another table that keeps keys alive */
+NBR_TABLE(uint8_t, tracked_table);
+NBR_TABLE(uint8_t, other_table);
+
+static linkaddr_t addrs[NUM_ADDRS];
+/* Reference: membership of the tracked table at the start of the window */
+static uint8_t in_start[NUM_ADDRS];
+/* Addresses of the start set that lost their key in this window. An
+ * address that is forgotten by every table is a new neighbor when it comes
+ * back, so the generator does not bring them back in the same window. */
+static uint8_t forgotten[NUM_ADDRS];
+/*---------------------------------------------------------------------------*/
+static void
+make_addr(linkaddr_t *addr, uint32_t i)
+{
+  memset(addr, 0, sizeof(*addr));
+  addr->u8[0] = 0x02;
+  addr->u8[LINKADDR_SIZE - 1] = i;
+}
+/*---------------------------------------------------------------------------*/
+static int
+has_key(const linkaddr_t *addr)
+{
+  nbr_table_key_t *k;
+  for(k = nbr_table_key_head(); k != NULL; k = nbr_table_key_next(k)) {
+    if(linkaddr_cmp(addr, &k->lladdr)) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_tracked(int i)
+{
+  return nbr_table_get_from_lladdr(tracked_table, &addrs[i]) != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+snapshot(int empty)
+{
+  int i;
+  for(i = 0; i < NUM_ADDRS; i++) {
+    in_start[i] = !empty && in_tracked(i);
+    forgotten[i] = 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* The symmetric difference of the address sets, as BRPL computed it from
+ * copies of the neighbor cache */
+static void
+reference_diff(uint16_t *changed, uint16_t *total)
+{
+  int i;
+  *changed = 0;
+  *total = 0;
+  for(i = 0; i < NUM_ADDRS; i++) {
+    int now = in_tracked(i);
+    *changed += in_start[i] != now;
+    *total += in_start[i] || now;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_step(void)
+{
+  static uint8_t had_key[NUM_ADDRS];
+  int i = random_rand() % NUM_ADDRS;
+  int j;
+  void *item;
+
+  for(j = 0; j < NUM_ADDRS; j++) {
+    had_key[j] = has_key(&addrs[j]);
+  }
+
+  switch(random_rand() % 5) {
+  case 0:
+  case 1:
+    if(!forgotten[i]) {
+      nbr_table_add_lladdr(tracked_table, &addrs[i],
+                           NBR_TABLE_REASON_UNDEFINED, NULL);
+    }
+    break;
+  case 2:
+    item = nbr_table_get_from_lladdr(tracked_table, &addrs[i]);
+    nbr_table_remove(tracked_table, item);
+    break;
+  case 3:
+    if(!forgotten[i]) {
+      nbr_table_add_lladdr(other_table, &addrs[i],
+                           NBR_TABLE_REASON_UNDEFINED, NULL);
+    }
+    break;
+  case 4:
+    item = nbr_table_get_from_lladdr(other_table, &addrs[i]);
+    nbr_table_remove(other_table, item);
+    break;
+  }
+
+  /* Keys freed by eviction when the table is full */
+  for(j = 0; j < NUM_ADDRS; j++) {
+    if(had_key[j] && in_start[j] && !has_key(&addrs[j])) {
+      forgotten[j] = 1;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(churn, "Incremental churn matches the symmetric difference");
+UNIT_TEST(churn)
+{
+  uint16_t changed;
+  uint16_t total;
+  uint16_t ref_changed;
+  uint16_t ref_total;
+  int window;
+  int step;
+
+  UNIT_TEST_BEGIN();
+
+  for(window = 0; window < NUM_WINDOWS; window++) {
+    if(window % 100 == 0) {
+      /* As BRPL does when its DAG is reset */
+      nbr_table_churn_reset();
+      snapshot(1);
+    }
+    for(step = 0; step < NUM_STEPS; step++) {
+      random_step();
+    }
+    reference_diff(&ref_changed, &ref_total);
+    nbr_table_churn_next_window(&changed, &total);
+    UNIT_TEST_ASSERT(changed == ref_changed);
+    UNIT_TEST_ASSERT(total == ref_total);
+    snapshot(0);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(clear, "Clearing the table counts as churn");
+UNIT_TEST(clear)
+{
+  uint16_t changed;
+  uint16_t total;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  nbr_table_clear();
+  nbr_table_churn_reset();
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    nbr_table_add_lladdr(tracked_table, &addrs[i],
+                         NBR_TABLE_REASON_UNDEFINED, NULL);
+  }
+  nbr_table_churn_next_window(&changed, &total);
+  UNIT_TEST_ASSERT(changed == NBR_TABLE_MAX_NEIGHBORS);
+  UNIT_TEST_ASSERT(total == NBR_TABLE_MAX_NEIGHBORS);
+
+  nbr_table_churn_next_window(&changed, &total);
+  UNIT_TEST_ASSERT(changed == 0);
+  UNIT_TEST_ASSERT(total == NBR_TABLE_MAX_NEIGHBORS);
+
+  nbr_table_clear();
+  nbr_table_churn_next_window(&changed, &total);
+  UNIT_TEST_ASSERT(changed == NBR_TABLE_MAX_NEIGHBORS);
+  UNIT_TEST_ASSERT(total == NBR_TABLE_MAX_NEIGHBORS);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  for(i = 0; i < NUM_ADDRS; i++) {
+    make_addr(&addrs[i], i + 1);
+  }
+  nbr_table_register(tracked_table, NULL);
+  nbr_table_register(other_table, NULL);
+  nbr_table_churn_track(tracked_table);
+
+  UNIT_TEST_RUN(churn);
+  UNIT_TEST_RUN(clear);
+
+  if(!UNIT_TEST_PASSED(churn)
+     || !UNIT_TEST_PASSED(clear)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,200 @@
+#include "contiki.h"
+#include "lib/fixmath.h"
+#include "unit-test/unit-test.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+/* Largest error allowed, in units of 2^-16 (relative above 1.0) */
+#define MAX_ULP   2.0
+#define NUM_CALLS 1000000
+
+PROCESS(test_process, "fixmath test");
+AUTOSTART_PROCESSES(&test_process);
+
+static volatile fix_t sink;
+/*---------------------------------------------------------------------------*/
+static double
+to_double(fix_t x)
+{
+  return (double)x / FIX_ONE;
+}
+/*---------------------------------------------------------------------------*/
+/* Error of a result, in units of 2^-16 */
+static double
+ulp_error(fix_t result, double expected)
+{
+  double err = fabs(to_double(result) - expected);
+
+  if(expected > 1.0) {
+    err /= expected;
+  }
+  return err * FIX_ONE;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(exp, "exp2 and exp against libm");
+UNIT_TEST(exp)
+{
+  double max_exp2 = 0;
+  double max_exp = 0;
+  double err;
+  int32_t x;
+
+  UNIT_TEST_BEGIN();
+
+  for(x = -16 * FIX_ONE; x < 15 * FIX_ONE; x += 7) {
+    err = ulp_error(fix_exp2(x), exp2(to_double(x)));
+    max_exp2 = err > max_exp2 ? err : max_exp2;
+  }
+  for(x = -11 * FIX_ONE; x < 10 * FIX_ONE; x += 7) {
+    err = ulp_error(fix_exp(x), exp(to_double(x)));
+    max_exp = err > max_exp ? err : max_exp;
+  }
+  printf("exp2: %.2f ulp, exp: %.2f ulp\n", max_exp2, max_exp);
+
+  UNIT_TEST_ASSERT(max_exp2 <= MAX_ULP);
+  UNIT_TEST_ASSERT(max_exp <= MAX_ULP);
+  UNIT_TEST_ASSERT(fix_exp2(15 * FIX_ONE) == FIX_MAX);
+  UNIT_TEST_ASSERT(fix_exp(11 * FIX_ONE) == FIX_MAX);
+  UNIT_TEST_ASSERT(fix_exp(-20 * FIX_ONE) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(log_sqrt, "log2 and sqrt against libm");
+UNIT_TEST(log_sqrt)
+{
+  double max_log2 = 0;
+  double max_sqrt = 0;
+  double err;
+  int32_t x;
+
+  UNIT_TEST_BEGIN();
+
+  for(x = 1; x > 0 && x < INT32_MAX - (INT32_MAX >> 10); x += (x >> 10) + 1) {
+    err = fabs(to_double(fix_log2(x)) - log2(to_double(x))) * FIX_ONE;
+    max_log2 = err > max_log2 ? err : max_log2;
+    err = ulp_error(fix_sqrt(x), sqrt(to_double(x)));
+    max_sqrt = err > max_sqrt ? err : max_sqrt;
+  }
+  printf("log2: %.2f ulp, sqrt: %.2f ulp\n", max_log2, max_sqrt);
+
+  UNIT_TEST_ASSERT(max_log2 <= MAX_ULP);
+  UNIT_TEST_ASSERT(max_sqrt <= MAX_ULP);
+  UNIT_TEST_ASSERT(fix_log2(0) == INT32_MIN);
+  UNIT_TEST_ASSERT(fix_sqrt(4 * FIX_ONE) == 2 * FIX_ONE);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(pow, "pow with fractional exponents against libm");
+UNIT_TEST(pow)
+{
+  double max_pow = 0;
+  double expected;
+  double err;
+  int32_t x;
+  int32_t y;
+
+  UNIT_TEST_BEGIN();
+
+  /* The range of the trust functions: bases in [0, 1] */
+  for(x = 1; x <= FIX_ONE; x += 13) {
+    for(y = -4 * FIX_ONE; y <= 4 * FIX_ONE; y += 4099) {
+      expected = pow(to_double(x), to_double(y));
+      if(expected < 32767.0) {
+        err = ulp_error(fix_pow(x, y), expected);
+        max_pow = err > max_pow ? err : max_pow;
+      }
+    }
+  }
+  printf("pow: %.2f ulp\n", max_pow);
+
+  UNIT_TEST_ASSERT(max_pow <= MAX_ULP);
+  UNIT_TEST_ASSERT(fix_pow(0, FIX_ONE / 2) == 0);
+  UNIT_TEST_ASSERT(fix_pow(0, 0) == FIX_ONE);
+  UNIT_TEST_ASSERT(fix_pow(FIX_ONE / 2, 0) == FIX_ONE);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+time_function(const char *name, fix_t (*f)(fix_t), fix_t from, fix_t step)
+{
+  clock_t start;
+  clock_t elapsed;
+  fix_t x = from;
+  int i;
+#if HAVE_TSC
+  unsigned long long cycles = __rdtsc();
+#endif
+
+  start = clock();
+  for(i = 0; i < NUM_CALLS; i++) {
+    sink = f(x);
+    x += step;
+  }
+  elapsed = clock() - start;
+#if HAVE_TSC
+  cycles = __rdtsc() - cycles;
+  printf("%s: %lu ns, %lu cycles per call\n", name,
+         (unsigned long)(elapsed * 1000000000.0 / CLOCKS_PER_SEC / NUM_CALLS),
+         (unsigned long)(cycles / NUM_CALLS));
+#else
+  printf("%s: %lu ns per call\n", name,
+         (unsigned long)(elapsed * 1000000000.0 / CLOCKS_PER_SEC / NUM_CALLS));
+#endif
+}
+/*---------------------------------------------------------------------------*/
+static fix_t
+pow_gamma(fix_t x)
+{
+  /* As the BRPL penalty, with gamma 2.0 */
+  return fix_pow(x & (FIX_ONE - 1), 2 * FIX_ONE);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(timing, "Cost per call");
+UNIT_TEST(timing)
+{
+  UNIT_TEST_BEGIN();
+
+  time_function("exp2", fix_exp2, -8 * FIX_ONE, 1);
+  time_function("exp", fix_exp, -8 * FIX_ONE, 1);
+  time_function("log2", fix_log2, 1, 2111);
+  time_function("sqrt", fix_sqrt, 1, 2111);
+  time_function("pow", pow_gamma, 1, 7);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(exp);
+  UNIT_TEST_RUN(log_sqrt);
+  UNIT_TEST_RUN(pow);
+  UNIT_TEST_RUN(timing);
+
+  if(!UNIT_TEST_PASSED(exp)
+     || !UNIT_TEST_PASSED(log_sqrt)
+     || !UNIT_TEST_PASSED(pow)
+     || !UNIT_TEST_PASSED(timing)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
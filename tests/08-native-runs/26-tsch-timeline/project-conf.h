@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Schedules as large as those of Orchestra with many 6P cells */
+#define TSCH_SCHEDULE_CONF_MAX_SLOTFRAMES 5
+#define TSCH_SCHEDULE_CONF_MAX_LINKS 160
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,295 @@
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/mac/tsch/tsch.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define NUM_ADDRS     6
+#define NUM_SCHEDULES 400
+#define NUM_LOOKUPS   500
+#define NUM_CALLS     200000
+
+PROCESS(test_process, "TSCH timeline test");
+AUTOSTART_PROCESSES(&test_process);
+
+static linkaddr_t addrs[NUM_ADDRS];
+/* The neighbor queues that the link comparator looks at */
+static struct tsch_neighbor nbrs[NUM_ADDRS];
+
+/* Slotframe sizes, coprime or not */
+static const uint16_t sizes[] = { 1, 3, 7, 8, 11, 16, 17, 31, 101, 397 };
+
+static const uint8_t options[] = {
+  LINK_OPTION_TX,
+  LINK_OPTION_RX,
+  LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED,
+  LINK_OPTION_RX | LINK_OPTION_TIME_KEEPING,
+  LINK_OPTION_TX | LINK_OPTION_SHARED,
+};
+
+static volatile struct tsch_link *sink;
+
+/* What the schedule needs of the rest of TSCH */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff } };
+struct tsch_link *current_link;
+/*---------------------------------------------------------------------------*/
+int
+tsch_is_locked(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_release_lock(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_neighbor *
+tsch_queue_get_nbr(const linkaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < NUM_ADDRS; i++) {
+    if(linkaddr_cmp(addr, &addrs[i])) {
+      return &nbrs[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+struct tsch_neighbor *
+tsch_queue_add_nbr(const linkaddr_t *addr)
+{
+  return tsch_queue_get_nbr(addr);
+}
+/*---------------------------------------------------------------------------*/
+static const linkaddr_t *
+random_addr(void)
+{
+  unsigned i = random_rand() % (NUM_ADDRS + 1);
+
+  return i == NUM_ADDRS ? &tsch_broadcast_address : &addrs[i];
+}
+/*---------------------------------------------------------------------------*/
+static void
+random_asn(struct tsch_asn_t *asn)
+{
+  asn->ls4b = ((uint32_t)random_rand() << 16) | random_rand();
+  asn->ms1b = random_rand() % 4;
+}
+/*---------------------------------------------------------------------------*/
+static int
+count_links(void)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  int n = 0;
+
+  for(sf = tsch_schedule_slotframe_head(); sf != NULL;
+      sf = tsch_schedule_slotframe_next(sf)) {
+    for(l = list_head(sf->links_list); l != NULL; l = list_item_next(l)) {
+      n++;
+    }
+  }
+  return n;
+}
+/*---------------------------------------------------------------------------*/
+/* A random schedule: overlapping slotframes, several links per timeslot,
+ * and links removed after being added, as 6P does */
+static void
+random_schedule(int max_links)
+{
+  struct tsch_slotframe *sf;
+  struct tsch_link *l;
+  struct tsch_link *next;
+  int num_sf = 1 + random_rand() % TSCH_SCHEDULE_MAX_SLOTFRAMES;
+  int i;
+  int n;
+
+  tsch_schedule_remove_all_slotframes();
+  for(i = 0; i < num_sf; i++) {
+    /* Handles in any order, the lowest one wins overlaps */
+    tsch_schedule_add_slotframe(random_rand() % 8,
+                                sizes[random_rand() % (sizeof(sizes) / sizeof(sizes[0]))]);
+  }
+  n = random_rand() % (max_links + 1);
+  for(i = 0; i < n && count_links() < TSCH_SCHEDULE_MAX_LINKS; i++) {
+    int k = random_rand() % num_sf;
+
+    for(sf = tsch_schedule_slotframe_head(); sf != NULL && k > 0;
+        sf = tsch_schedule_slotframe_next(sf)) {
+      k--;
+    }
+    if(sf == NULL) {
+      continue;
+    }
+    tsch_schedule_add_link(sf, options[random_rand() % sizeof(options)],
+                           LINK_TYPE_NORMAL, random_addr(),
+                           random_rand() % sf->size.val, random_rand() % 4,
+                           random_rand() % 2);
+  }
+  /* Remove some of them */
+  for(sf = tsch_schedule_slotframe_head(); sf != NULL;
+      sf = tsch_schedule_slotframe_next(sf)) {
+    for(l = list_head(sf->links_list); l != NULL; l = next) {
+      next = list_item_next(l);
+      if(random_rand() % 4 == 0) {
+        tsch_schedule_remove_link(sf, l);
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Random queue lengths, which the link comparator looks at */
+static void
+random_queues(void)
+{
+  int i;
+  int n;
+
+  for(i = 0; i < NUM_ADDRS; i++) {
+    ringbufindex_init(&nbrs[i].tx_ringbuf, TSCH_QUEUE_NUM_PER_NEIGHBOR);
+    for(n = random_rand() % 4; n > 0; n--) {
+      ringbufindex_put(&nbrs[i].tx_ringbuf);
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(differential, "Timeline against the scan");
+UNIT_TEST(differential)
+{
+  struct tsch_asn_t asn;
+  struct tsch_link *link;
+  struct tsch_link *ref;
+  struct tsch_link *backup;
+  struct tsch_link *ref_backup;
+  uint16_t offset;
+  uint16_t ref_offset;
+  uint32_t lookups = 0;
+  uint32_t mismatches = 0;
+  uint32_t overlaps = 0;
+  int i;
+  int j;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < NUM_SCHEDULES; i++) {
+    /* Sparse and dense schedules */
+    random_schedule(i % 2 ? 12 : TSCH_SCHEDULE_MAX_LINKS);
+    random_queues();
+    for(j = 0; j < NUM_LOOKUPS; j++) {
+      random_asn(&asn);
+      offset = ref_offset = 0xffff;
+      link = tsch_schedule_get_next_active_link(&asn, &offset, &backup);
+      ref = tsch_schedule_scan_next_active_link(&asn, &ref_offset, &ref_backup);
+      lookups++;
+      if(ref_backup != NULL) {
+        overlaps++;
+      }
+      if(link != ref || offset != ref_offset || backup != ref_backup) {
+        if(mismatches++ < 10) {
+          printf("mismatch at ASN %u.%lu: %p+%u/%p, expected %p+%u/%p\n",
+                 asn.ms1b, (unsigned long)asn.ls4b, (void *)link, offset,
+                 (void *)backup, (void *)ref, ref_offset, (void *)ref_backup);
+        }
+      }
+    }
+  }
+  printf("lookups: %lu, with a backup link: %lu, mismatches: %lu\n",
+         (unsigned long)lookups, (unsigned long)overlaps,
+         (unsigned long)mismatches);
+
+  UNIT_TEST_ASSERT(mismatches == 0);
+  UNIT_TEST_ASSERT(overlaps > 0);
+
+  /* An empty schedule */
+  tsch_schedule_remove_all_slotframes();
+  random_asn(&asn);
+  UNIT_TEST_ASSERT(tsch_schedule_get_next_active_link(&asn, &offset, &backup) == NULL);
+  UNIT_TEST_ASSERT(offset == 0 && backup == NULL);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static unsigned long
+time_lookups(struct tsch_link *(*f)(struct tsch_asn_t *, uint16_t *,
+                                    struct tsch_link **))
+{
+  struct tsch_asn_t asn = { 0, 0 };
+  struct tsch_link *backup;
+  uint16_t offset;
+  clock_t start;
+  int i;
+
+  start = clock();
+  for(i = 0; i < NUM_CALLS; i++) {
+    sink = f(&asn, &offset, &backup);
+    TSCH_ASN_INC(asn, offset);
+  }
+  return (unsigned long)((clock() - start) * 1000000000.0 / CLOCKS_PER_SEC / NUM_CALLS);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(timing, "Cost per lookup");
+UNIT_TEST(timing)
+{
+  UNIT_TEST_BEGIN();
+
+  /* A full schedule, as Orchestra with many 6P cells */
+  tsch_schedule_remove_all_slotframes();
+  tsch_schedule_add_slotframe(0, 397);
+  tsch_schedule_add_slotframe(1, 31);
+  tsch_schedule_add_slotframe(2, 17);
+  tsch_schedule_add_slotframe(3, 101);
+  while(count_links() < TSCH_SCHEDULE_MAX_LINKS) {
+    struct tsch_slotframe *sf = tsch_schedule_get_slotframe_by_handle(random_rand() % 4);
+
+    tsch_schedule_add_link(sf, options[random_rand() % sizeof(options)],
+                           LINK_TYPE_NORMAL, random_addr(),
+                           random_rand() % sf->size.val, random_rand() % 4, 0);
+  }
+  printf("%d links: scan %lu ns, timeline %lu ns per lookup\n", count_links(),
+         time_lookups(tsch_schedule_scan_next_active_link),
+         time_lookups(tsch_schedule_get_next_active_link));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_ADDRS; i++) {
+    memset(&addrs[i], 0, sizeof(addrs[i]));
+    addrs[i].u8[0] = 0x02;
+    addrs[i].u8[LINKADDR_SIZE - 1] = i + 1;
+  }
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(differential);
+  UNIT_TEST_RUN(timing);
+
+  if(!UNIT_TEST_PASSED(differential)
+     || !UNIT_TEST_PASSED(timing)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
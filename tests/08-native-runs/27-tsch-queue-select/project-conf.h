@@ -0,0 +1,9 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* 16 packets per neighbor queue */
+#define QUEUEBUF_CONF_NUM 16
+
+#define TSCH_CONF_MAC_BACKOFF_QUEUE_AWARE 1
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,225 @@
+#include "contiki.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac.h"
+#include "net/mac/tsch/tsch.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_ADDRS 3
+
+PROCESS(test_process, "TSCH queue selection test");
+AUTOSTART_PROCESSES(&test_process);
+
+static linkaddr_t addrs[NUM_ADDRS];
+static struct tsch_link shared_link = {
+  .link_options = LINK_OPTION_TX | LINK_OPTION_RX | LINK_OPTION_SHARED,
+};
+
+/* What the queues need of the rest of TSCH */
+const linkaddr_t tsch_broadcast_address = { { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff } };
+const linkaddr_t tsch_eb_address = { { 0, 0, 0, 0, 0, 0, 0, 0 } };
+int tsch_is_coordinator;
+/*---------------------------------------------------------------------------*/
+int
+tsch_is_locked(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_release_lock(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_set_ka_timeout(uint32_t timeout)
+{
+}
+/*---------------------------------------------------------------------------*/
+/* Queue a data packet of a given class, queued age ticks ago */
+static struct tsch_packet *
+add_packet(int i, uint8_t class, clock_time_t age)
+{
+  struct tsch_packet *p;
+
+  packetbuf_clear();
+  packetbuf_set_attr(PACKETBUF_ATTR_FRAME_TYPE, FRAME802154_DATAFRAME);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TX_CLASS, class);
+  p = tsch_queue_add_packet(&addrs[i], 1, NULL, NULL);
+  if(p != NULL) {
+    p->enqueued_at = clock_time() - age;
+  }
+  return p;
+}
+/*---------------------------------------------------------------------------*/
+/* Index of the neighbor a shared link serves, -1 if none */
+static int
+selected(void)
+{
+  struct tsch_neighbor *n = NULL;
+  int i;
+
+  if(tsch_queue_get_unicast_packet_for_any(&n, &shared_link) == NULL) {
+    return -1;
+  }
+  for(i = 0; i < NUM_ADDRS; i++) {
+    if(n == tsch_queue_get_nbr(&addrs[i])) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(head_age, "Head-of-line age");
+UNIT_TEST(head_age)
+{
+  UNIT_TEST_BEGIN();
+
+  tsch_queue_reset();
+  UNIT_TEST_ASSERT(tsch_queue_nbr_head_age(tsch_queue_get_nbr(&addrs[0])) == 0);
+  add_packet(0, MAC_TX_CLASS_UNSET, 50);
+  add_packet(0, MAC_TX_CLASS_UNSET, 10);
+  /* The oldest packet is the head */
+  UNIT_TEST_ASSERT(tsch_queue_nbr_head_age(tsch_queue_get_nbr(&addrs[0])) >= 50);
+  UNIT_TEST_ASSERT(tsch_queue_nbr_head_age(tsch_queue_get_nbr(&addrs[0])) < 60);
+  tsch_queue_reset();
+  UNIT_TEST_ASSERT(tsch_queue_nbr_head_age(tsch_queue_get_nbr(&addrs[0])) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(select_oldest, "Oldest head of line first");
+UNIT_TEST(select_oldest)
+{
+  UNIT_TEST_BEGIN();
+
+  /* Not the first neighbor in the table, but the oldest packet */
+  tsch_queue_reset();
+  add_packet(0, MAC_TX_CLASS_UNSET, 10);
+  add_packet(0, MAC_TX_CLASS_UNSET, 10);
+  add_packet(0, MAC_TX_CLASS_UNSET, 10);
+  add_packet(1, MAC_TX_CLASS_UNSET, 100);
+  add_packet(2, MAC_TX_CLASS_UNSET, 40);
+  UNIT_TEST_ASSERT(selected() == 1);
+
+  /* Expedited packets weigh three times best effort ones */
+  tsch_queue_reset();
+  add_packet(0, MAC_TX_CLASS_BEST_EFFORT, 200);
+  add_packet(1, MAC_TX_CLASS_EXPEDITED, 100);
+  UNIT_TEST_ASSERT(selected() == 1);
+  tsch_queue_reset();
+  add_packet(0, MAC_TX_CLASS_BEST_EFFORT, 400);
+  add_packet(1, MAC_TX_CLASS_EXPEDITED, 100);
+  UNIT_TEST_ASSERT(selected() == 0);
+
+  /* Control packets go first */
+  add_packet(2, MAC_TX_CLASS_CONTROL, 0);
+  UNIT_TEST_ASSERT(selected() == 2);
+
+  /* Neighbors in backoff or with a Tx link are left out */
+  tsch_queue_get_nbr(&addrs[2])->backoff_window = 2;
+  UNIT_TEST_ASSERT(selected() == 0);
+  tsch_queue_get_nbr(&addrs[0])->tx_links_count = 1;
+  UNIT_TEST_ASSERT(selected() == 1);
+  tsch_queue_get_nbr(&addrs[0])->tx_links_count = 0;
+  tsch_queue_reset();
+  UNIT_TEST_ASSERT(selected() == -1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(backoff, "Queue-aware backoff");
+UNIT_TEST(backoff)
+{
+  struct tsch_neighbor *n;
+  uint16_t max_short = 0;
+  uint16_t max_half = 0;
+  uint16_t max_full = 0;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  tsch_queue_reset();
+  add_packet(0, MAC_TX_CLASS_UNSET, 0);
+  n = tsch_queue_get_nbr(&addrs[0]);
+  for(i = 0; i < 1000; i++) {
+    tsch_queue_backoff_reset(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    max_short = MAX(max_short, n->backoff_window);
+  }
+  while(tsch_queue_nbr_packet_count(n) < TSCH_QUEUE_NUM_PER_NEIGHBOR / 2) {
+    add_packet(0, MAC_TX_CLASS_UNSET, 0);
+  }
+  for(i = 0; i < 1000; i++) {
+    tsch_queue_backoff_reset(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    max_half = MAX(max_half, n->backoff_window);
+  }
+  while(add_packet(0, MAC_TX_CLASS_UNSET, 0) != NULL);
+  for(i = 0; i < 1000; i++) {
+    tsch_queue_backoff_reset(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    tsch_queue_backoff_inc(n);
+    max_full = MAX(max_full, n->backoff_window);
+  }
+  printf("largest windows: %u, half full %u, full %u\n",
+         max_short, max_half, max_full);
+  tsch_queue_reset();
+
+  /* The exponent is 5 (1 + 4): windows of up to 32 slots, 16 and 8 */
+  UNIT_TEST_ASSERT(max_short == 32);
+  UNIT_TEST_ASSERT(max_half == 16);
+  UNIT_TEST_ASSERT(max_full == 8);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_ADDRS; i++) {
+    memset(&addrs[i], 0, sizeof(addrs[i]));
+    addrs[i].u8[0] = 0x02;
+    addrs[i].u8[LINKADDR_SIZE - 1] = i + 1;
+  }
+  tsch_queue_init();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(head_age);
+  UNIT_TEST_RUN(select_oldest);
+  UNIT_TEST_RUN(backoff);
+
+  if(!UNIT_TEST_PASSED(head_age)
+     || !UNIT_TEST_PASSED(select_oldest)
+     || !UNIT_TEST_PASSED(backoff)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define TSCH_PROFILE_CONF_ON 1
+#define TSCH_PROFILE_CONF_RING_LEN 8
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,174 @@
+#include "contiki.h"
+#include "net/mac/tsch/tsch.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+
+PROCESS(test_process, "TSCH profile test");
+AUTOSTART_PROCESSES(&test_process);
+
+/* What the profiler needs of the rest of TSCH. On native, rtimer ticks
+ * are clock ticks: a template of 100-tick slots */
+tsch_timeslot_timing_ticks tsch_timing = {
+  [tsch_ts_cca_offset] = 18,
+  [tsch_ts_cca] = 1,
+  [tsch_ts_tx_offset] = 21,
+  [tsch_ts_rx_offset] = 11,
+  [tsch_ts_rx_ack_delay] = 8,
+  [tsch_ts_tx_ack_delay] = 10,
+  [tsch_ts_rx_wait] = 22,
+  [tsch_ts_ack_wait] = 4,
+  [tsch_ts_rx_tx] = 2,
+  [tsch_ts_max_ack] = 24,
+  [tsch_ts_max_tx] = 42,
+  [tsch_ts_timeslot_length] = 100,
+};
+/*---------------------------------------------------------------------------*/
+int
+tsch_get_lock(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+tsch_release_lock(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+/* A Tx slot whose phases all end up at the given offset */
+static void
+tx_slot(uint32_t asn_ls4b, rtimer_clock_t offset)
+{
+  struct tsch_asn_t asn = { asn_ls4b, 0 };
+
+  tsch_profile_slot_start(&asn, RTIMER_NOW() - offset);
+  tsch_profile_mark(TSCH_PROFILE_TX_PREPARED);
+  tsch_profile_mark(TSCH_PROFILE_TX_START);
+  tsch_profile_mark(TSCH_PROFILE_ACK_WAIT);
+  tsch_profile_mark(TSCH_PROFILE_ACK_PARSED);
+  tsch_profile_slot_end(1, 26);
+}
+/*---------------------------------------------------------------------------*/
+static int
+near(int16_t offset, int16_t expected)
+{
+  /* The clock may tick between two marks */
+  return offset >= expected && offset <= expected + 1;
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(stats, "Phase statistics");
+UNIT_TEST(stats)
+{
+  struct tsch_profile_stats s;
+  struct tsch_asn_t asn = { 100, 0 };
+
+  UNIT_TEST_BEGIN();
+
+  tsch_profile_reset();
+  /* Late, then on time */
+  tx_slot(1, 30);
+  tx_slot(2, 6);
+
+  UNIT_TEST_ASSERT(tsch_profile_get_stats(TSCH_PROFILE_TX_START, &s));
+  printf("tx-start: min %d, max %d, count %lu, overruns %lu\n",
+         s.min, s.max, (unsigned long)s.count, (unsigned long)s.overruns);
+  UNIT_TEST_ASSERT(s.count == 2);
+  UNIT_TEST_ASSERT(near(s.min, 6));
+  UNIT_TEST_ASSERT(near(s.max, 30));
+  UNIT_TEST_ASSERT(s.sum >= 36 && s.sum <= 38);
+  /* Past the Tx offset once */
+  UNIT_TEST_ASSERT(s.overruns == 1);
+
+  /* Within the slot both times */
+  UNIT_TEST_ASSERT(tsch_profile_get_stats(TSCH_PROFILE_SLOT_END, &s));
+  UNIT_TEST_ASSERT(s.count == 2 && s.overruns == 0);
+
+  /* Never reached */
+  UNIT_TEST_ASSERT(tsch_profile_get_stats(TSCH_PROFILE_RX_END, &s));
+  UNIT_TEST_ASSERT(s.count == 0);
+
+  /* An Rx slot: the ACK deadline follows the end of the frame */
+  tsch_profile_slot_start(&asn, RTIMER_NOW() - 60);
+  tsch_profile_mark(TSCH_PROFILE_RX_START);
+  tsch_profile_mark(TSCH_PROFILE_RX_END);
+  tsch_profile_mark(TSCH_PROFILE_ACK_READY);
+  tsch_profile_slot_end(0, 26);
+  UNIT_TEST_ASSERT(tsch_profile_get_stats(TSCH_PROFILE_RX_START, &s));
+  UNIT_TEST_ASSERT(s.count == 1 && s.overruns == 1);
+  UNIT_TEST_ASSERT(tsch_profile_get_stats(TSCH_PROFILE_ACK_READY, &s));
+  UNIT_TEST_ASSERT(s.count == 1 && s.overruns == 0);
+  UNIT_TEST_ASSERT(tsch_profile_deadline(NULL, TSCH_PROFILE_ACK_READY) == TSCH_PROFILE_NO_DEADLINE);
+
+  tsch_profile_reset();
+  UNIT_TEST_ASSERT(tsch_profile_get_stats(TSCH_PROFILE_TX_START, &s));
+  UNIT_TEST_ASSERT(s.count == 0 && s.overruns == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(ring, "Ring and binary dump");
+UNIT_TEST(ring)
+{
+  struct tsch_profile_slot slots[TSCH_PROFILE_RING_LEN];
+  uint8_t buf[TSCH_PROFILE_RING_LEN * TSCH_PROFILE_RECORD_LEN];
+  uint32_t i;
+  int n;
+
+  UNIT_TEST_BEGIN();
+
+  tsch_profile_reset();
+  UNIT_TEST_ASSERT(tsch_profile_get_slots(slots, TSCH_PROFILE_RING_LEN) == 0);
+  UNIT_TEST_ASSERT(tsch_profile_dump(buf, sizeof(buf)) == 0);
+
+  for(i = 1; i <= TSCH_PROFILE_RING_LEN + 2; i++) {
+    tx_slot(i, 5);
+  }
+
+  /* The last slots, oldest first */
+  n = tsch_profile_get_slots(slots, TSCH_PROFILE_RING_LEN);
+  UNIT_TEST_ASSERT(n == TSCH_PROFILE_RING_LEN);
+  UNIT_TEST_ASSERT(slots[0].asn == 3);
+  UNIT_TEST_ASSERT(slots[n - 1].asn == TSCH_PROFILE_RING_LEN + 2);
+  UNIT_TEST_ASSERT(slots[0].is_tx && slots[0].channel == 26);
+  UNIT_TEST_ASSERT(slots[0].reached & (1 << TSCH_PROFILE_TX_START));
+  UNIT_TEST_ASSERT(!(slots[0].reached & (1 << TSCH_PROFILE_RX_START)));
+  UNIT_TEST_ASSERT(near(slots[0].offset[TSCH_PROFILE_TX_START], 5));
+
+  /* Fewer slots if they do not fit */
+  UNIT_TEST_ASSERT(tsch_profile_get_slots(slots, 2) == 2);
+  UNIT_TEST_ASSERT(slots[1].asn == 4);
+
+  /* Little-endian records */
+  n = tsch_profile_dump(buf, sizeof(buf));
+  UNIT_TEST_ASSERT(n == TSCH_PROFILE_RING_LEN * TSCH_PROFILE_RECORD_LEN);
+  UNIT_TEST_ASSERT(buf[0] == 3 && buf[1] == 0 && buf[2] == 0 && buf[3] == 0);
+  UNIT_TEST_ASSERT(buf[6] == 1 && buf[7] == 26);
+  UNIT_TEST_ASSERT(near(buf[8 + 2 * TSCH_PROFILE_TX_START], 5));
+  UNIT_TEST_ASSERT(buf[TSCH_PROFILE_RECORD_LEN] == 4);
+  UNIT_TEST_ASSERT(tsch_profile_dump(buf, TSCH_PROFILE_RECORD_LEN + 1) == TSCH_PROFILE_RECORD_LEN);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(stats);
+  UNIT_TEST_RUN(ring);
+
+  if(!UNIT_TEST_PASSED(stats)
+     || !UNIT_TEST_PASSED(ring)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
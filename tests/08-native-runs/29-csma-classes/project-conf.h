@@ -0,0 +1,11 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+/* Transmissions go to a radio of the test, which ACKs every frame */
+#define NETSTACK_CONF_RADIO test_radio_driver
+
+#define QUEUEBUF_CONF_NUM 16
+#define CSMA_CONF_MAX_PACKET_PER_NEIGHBOR 8
+#define CSMA_CONF_MAX_NEIGHBOR_QUEUES 4
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,430 @@
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/mac/mac.h"
+#include "net/mac/mac-backlog.h"
+#include "net/mac/framer/frame802154.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define NUM_ADDRS 3
+#define DATA_LEN 100
+#define CONTROL_LEN 30
+#define NO_STATUS 0xff
+
+PROCESS(test_process, "CSMA transmit classes test");
+AUTOSTART_PROCESSES(&test_process);
+
+static linkaddr_t addrs[NUM_ADDRS];
+
+/* The id of each frame transmitted, in order, and its length */
+static uint8_t tx_log[64];
+static uint16_t tx_len[64];
+static int tx_count;
+/* The status of the packet with each payload byte */
+static uint8_t status[256];
+static int outstanding;
+/* What packetbuf held when a packet was dropped to make room */
+static int dropped_id;
+static int dropped_to;
+
+static uint8_t frame[PACKETBUF_SIZE];
+static uint16_t frame_len;
+static int ack_pending;
+/*---------------------------------------------------------------------------*/
+/* A radio that ACKs every unicast frame */
+static int
+radio_init(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_prepare(const void *payload, unsigned short len)
+{
+  memcpy(frame, payload, len);
+  frame_len = len;
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_transmit(unsigned short len)
+{
+  if(tx_count < sizeof(tx_log)) {
+    /* The payload is the frame past the header */
+    tx_log[tx_count] = frame[frame_len - 1];
+    tx_len[tx_count] = frame_len;
+    tx_count++;
+  }
+  ack_pending = 1;
+  return RADIO_TX_OK;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_send(const void *payload, unsigned short len)
+{
+  radio_prepare(payload, len);
+  return radio_transmit(len);
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_read(void *buf, unsigned short len)
+{
+  uint8_t *ack = buf;
+
+  if(!ack_pending || len < 3) {
+    return 0;
+  }
+  ack_pending = 0;
+  ack[0] = FRAME802154_ACKFRAME;
+  ack[1] = 0;
+  ack[2] = frame[2];
+  return 3;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_channel_clear(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_receiving_packet(void)
+{
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_pending_packet(void)
+{
+  return ack_pending;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_on(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+radio_off(void)
+{
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_get_value(radio_param_t param, radio_value_t *value)
+{
+  if(param == RADIO_CONST_MAX_PAYLOAD_LEN) {
+    *value = 125;
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_set_value(radio_param_t param, radio_value_t value)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+static radio_result_t
+radio_set_object(radio_param_t param, const void *src, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+/*---------------------------------------------------------------------------*/
+const struct radio_driver test_radio_driver = {
+  radio_init,
+  radio_prepare,
+  radio_transmit,
+  radio_send,
+  radio_read,
+  radio_channel_clear,
+  radio_receiving_packet,
+  radio_pending_packet,
+  radio_on,
+  radio_off,
+  radio_get_value,
+  radio_set_value,
+  radio_get_object,
+  radio_set_object
+};
+/*---------------------------------------------------------------------------*/
+static void
+sent(void *ptr, int s, int transmissions)
+{
+  int id = (int)(uintptr_t)ptr;
+
+  status[id] = s;
+  outstanding--;
+  if(s == MAC_TX_QUEUE_FULL) {
+    int i;
+    dropped_id = ((uint8_t *)packetbuf_dataptr())[0];
+    for(i = 0; i < NUM_ADDRS; i++) {
+      if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &addrs[i])) {
+        dropped_to = i;
+      }
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Queue a packet whose payload bytes are all its id */
+static void
+send_to(int nbr, uint8_t tx_class, uint8_t id, uint32_t lifetime_ms)
+{
+  uint16_t len = tx_class == MAC_TX_CLASS_CONTROL ? CONTROL_LEN : DATA_LEN;
+
+  packetbuf_clear();
+  memset(packetbuf_dataptr(), id, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_addr(PACKETBUF_ADDR_RECEIVER, &addrs[nbr]);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TX_CLASS, tx_class);
+  packetbuf_set_attr(PACKETBUF_ATTR_MAC_TX_LIFETIME, lifetime_ms);
+  outstanding++;
+  NETSTACK_MAC.send(sent, (void *)(uintptr_t)id);
+}
+/*---------------------------------------------------------------------------*/
+static void
+reset_log(void)
+{
+  tx_count = 0;
+  memset(status, NO_STATUS, sizeof(status));
+  dropped_id = -1;
+  dropped_to = -1;
+}
+/*---------------------------------------------------------------------------*/
+static int
+tx_index(uint8_t id)
+{
+  int i;
+
+  for(i = 0; i < tx_count; i++) {
+    if(tx_log[i] == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_classes(void)
+{
+  int i;
+
+  reset_log();
+  /* Best effort first, then expedited, then control */
+  send_to(0, MAC_TX_CLASS_BEST_EFFORT, 10, 0);
+  send_to(0, MAC_TX_CLASS_BEST_EFFORT, 11, 0);
+  for(i = 0; i < 5; i++) {
+    send_to(0, MAC_TX_CLASS_EXPEDITED, 20 + i, 0);
+  }
+  send_to(0, MAC_TX_CLASS_CONTROL, 30, 0);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(classes, "Control first, then 3:1 shares");
+UNIT_TEST(classes)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  printf("tx order:");
+  for(i = 0; i < tx_count; i++) {
+    printf(" %u", tx_log[i]);
+  }
+  printf("\n");
+
+  UNIT_TEST_ASSERT(tx_count == 8);
+  /* The control packet goes first, queued last */
+  UNIT_TEST_ASSERT(tx_log[0] == 30);
+  UNIT_TEST_ASSERT(tx_len[0] < tx_len[1]);
+  /* Three expedited packets for one best effort packet, each class in
+   * its order */
+  UNIT_TEST_ASSERT(tx_log[1] == 20 && tx_log[2] == 21 && tx_log[3] == 22);
+  UNIT_TEST_ASSERT(tx_log[4] == 10);
+  UNIT_TEST_ASSERT(tx_log[5] == 23 && tx_log[6] == 24);
+  UNIT_TEST_ASSERT(tx_log[7] == 11);
+  for(i = 0; i < 256; i++) {
+    UNIT_TEST_ASSERT(status[i] == NO_STATUS || status[i] == MAC_TX_OK);
+  }
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_lifetime(void)
+{
+  clock_time_t start;
+
+  reset_log();
+  send_to(0, MAC_TX_CLASS_EXPEDITED, 40, 0);
+  send_to(0, MAC_TX_CLASS_EXPEDITED, 41, 1);
+  send_to(0, MAC_TX_CLASS_BEST_EFFORT, 42, 0);
+  /* Outlive the 1 ms lifetime before the queue is served */
+  start = clock_time();
+  while(clock_time() - start < 5);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(lifetime, "Lifetime expiry");
+UNIT_TEST(lifetime)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(status[40] == MAC_TX_OK);
+  UNIT_TEST_ASSERT(status[41] == MAC_TX_ERR);
+  UNIT_TEST_ASSERT(status[42] == MAC_TX_OK);
+  UNIT_TEST_ASSERT(tx_index(41) == -1);
+  UNIT_TEST_ASSERT(tx_count == 2);
+  UNIT_TEST_ASSERT(mac_backlog_expired_count() == 1);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+/* Whether packetbuf still holds the control packet with the given id */
+static int control_intact;
+
+static void
+check_control(uint8_t id)
+{
+  control_intact = packetbuf_datalen() == CONTROL_LEN
+    && ((uint8_t *)packetbuf_dataptr())[0] == id
+    && ((uint8_t *)packetbuf_dataptr())[CONTROL_LEN - 1] == id
+    && packetbuf_attr(PACKETBUF_ATTR_MAC_TX_CLASS) == MAC_TX_CLASS_CONTROL
+    && linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &addrs[0]);
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_full_neighbor(void)
+{
+  int i;
+
+  reset_log();
+  for(i = 0; i < 4; i++) {
+    send_to(0, MAC_TX_CLASS_EXPEDITED, 50 + i, 0);
+    send_to(0, MAC_TX_CLASS_BEST_EFFORT, 60 + i, 0);
+  }
+  send_to(0, MAC_TX_CLASS_CONTROL, 70, 0);
+  check_control(70);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(full_neighbor, "Room in a full neighbor queue");
+UNIT_TEST(full_neighbor)
+{
+  UNIT_TEST_BEGIN();
+
+  /* The youngest best effort packet made room, with packetbuf holding it
+   * for its sent callback and the control packet afterwards */
+  UNIT_TEST_ASSERT(dropped_id == 63 && dropped_to == 0);
+  UNIT_TEST_ASSERT(status[63] == MAC_TX_QUEUE_FULL);
+  UNIT_TEST_ASSERT(control_intact);
+  UNIT_TEST_ASSERT(status[70] == MAC_TX_OK);
+  UNIT_TEST_ASSERT(tx_log[0] == 70);
+  UNIT_TEST_ASSERT(tx_count == 8);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+static void
+queue_full_pool(void)
+{
+  int i;
+
+  reset_log();
+  /* 16 packets fill the pool: 8 to the first neighbor, 7 to the second,
+   * one expedited packet to the third */
+  for(i = 0; i < 4; i++) {
+    send_to(0, MAC_TX_CLASS_EXPEDITED, 80 + i, 0);
+    send_to(0, MAC_TX_CLASS_BEST_EFFORT, 90 + i, 0);
+  }
+  for(i = 0; i < 7; i++) {
+    send_to(1, MAC_TX_CLASS_BEST_EFFORT, 100 + i, 0);
+  }
+  send_to(2, MAC_TX_CLASS_EXPEDITED, 110, 0);
+  send_to(2, MAC_TX_CLASS_CONTROL, 111, 0);
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(full_pool, "Room in an exhausted pool");
+UNIT_TEST(full_pool)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* The third queue has no data packet to spare: the youngest best
+   * effort packet of the longest queue made room. No queuebuf was left
+   * to set the control packet aside, so the sent callback of the dropped
+   * packet saw the control packet, addressed to the first neighbor */
+  UNIT_TEST_ASSERT(dropped_id == 111 && dropped_to == 0);
+  UNIT_TEST_ASSERT(status[93] == MAC_TX_QUEUE_FULL);
+  UNIT_TEST_ASSERT(status[111] == MAC_TX_OK);
+  UNIT_TEST_ASSERT(status[110] == MAC_TX_OK);
+  for(i = 0; i < 7; i++) {
+    UNIT_TEST_ASSERT(status[100 + i] == MAC_TX_OK);
+  }
+  UNIT_TEST_ASSERT(tx_count == 16);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  static struct etimer et;
+  int i;
+
+  PROCESS_BEGIN();
+
+  for(i = 0; i < NUM_ADDRS; i++) {
+    memset(&addrs[i], 0, sizeof(addrs[i]));
+    addrs[i].u8[0] = 0x02;
+    addrs[i].u8[LINKADDR_SIZE - 1] = i + 1;
+  }
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+/* Let CSMA send everything queued */
+#define WAIT_ALL_SENT() \
+  while(outstanding > 0) { \
+    etimer_set(&et, CLOCK_SECOND / 100); \
+    PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&et)); \
+  }
+
+  queue_classes();
+  WAIT_ALL_SENT();
+  UNIT_TEST_RUN(classes);
+
+  queue_lifetime();
+  WAIT_ALL_SENT();
+  UNIT_TEST_RUN(lifetime);
+
+  queue_full_neighbor();
+  WAIT_ALL_SENT();
+  UNIT_TEST_RUN(full_neighbor);
+
+  queue_full_pool();
+  WAIT_ALL_SENT();
+  UNIT_TEST_RUN(full_pool);
+
+  if(!UNIT_TEST_PASSED(classes)
+     || !UNIT_TEST_PASSED(lifetime)
+     || !UNIT_TEST_PASSED(full_neighbor)
+     || !UNIT_TEST_PASSED(full_pool)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,6 @@
+#ifndef PROJECT_CONF_H_
+#define PROJECT_CONF_H_
+
+#define RPL_CONF_OF_OCP RPL_OCP_BRPL
+
+#endif /* PROJECT_CONF_H_ */
@@ -0,0 +1,210 @@
+#include "contiki.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/mac/mac-backlog.h"
+#include "net/routing/rpl-classic/rpl.h"
+#include "net/routing/rpl-classic/rpl-private.h"
+#include "net/routing/brpl-queue.h"
+#include "net/routing/brpl-weight.h"
+#include "unit-test/unit-test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define INSTANCE_ID    0x1e
+#define CAPACITY       16
+
+PROCESS(test_process, "BRPL queue record test");
+AUTOSTART_PROCESSES(&test_process);
+
+extern rpl_of_t rpl_brpl;
+extern rpl_of_t rpl_mrhof;
+
+static rpl_dag_t *dag;
+static rpl_parent_t *parent;
+static const linkaddr_t child_addr = { { 0x02, 0, 0, 0, 0, 0, 0, 0x42 } };
+/*---------------------------------------------------------------------------*/
+static int
+setup_dag(void)
+{
+  uip_ipaddr_t dag_id;
+  uip_ipaddr_t ipaddr;
+  uip_lladdr_t lladdr;
+  rpl_dio_t dio;
+
+  uip_ip6addr(&dag_id, 0xfd00, 0, 0, 0, 0, 0, 0, 1);
+  dag = rpl_alloc_dag(INSTANCE_ID, &dag_id);
+  if(dag == NULL) {
+    return 0;
+  }
+  dag->instance->of = &rpl_brpl;
+  dag->instance->min_hoprankinc = RPL_MIN_HOPRANKINC;
+  dag->instance->max_rankinc = RPL_MAX_RANKINC;
+  dag->rank = 4 * RPL_MIN_HOPRANKINC;
+  rpl_brpl.reset(dag);
+
+  memset(&dio, 0, sizeof(dio));
+  dio.rank = 8 * RPL_MIN_HOPRANKINC;
+  memset(&lladdr, 0, sizeof(lladdr));
+  lladdr.addr[0] = 0x02;
+  lladdr.addr[sizeof(lladdr.addr) - 1] = 1;
+  uip_ip6addr(&ipaddr, 0xfe80, 0, 0, 0, 0, 0, 0, 0);
+  uip_ds6_set_addr_iid(&ipaddr, &lladdr);
+  if(uip_ds6_nbr_add(&ipaddr, &lladdr, 1, NBR_REACHABLE,
+                     NBR_TABLE_REASON_UNDEFINED, NULL) == NULL) {
+    return 0;
+  }
+  parent = rpl_add_parent(dag, &dio, &ipaddr);
+  return parent != NULL;
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_queue(uint16_t packets)
+{
+  mac_backlog_init(CAPACITY);
+  while(packets-- > 0) {
+    mac_backlog_enqueued(&child_addr, 50);
+  }
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(encode_decode, "Record encoding");
+UNIT_TEST(encode_decode)
+{
+  static const uint8_t wire[BRPL_QUEUE_RECORD_LEN] = {
+    0x05, 0xdc, 0x01, 0x02, 0x00, 0x20
+  };
+  uint8_t buf[BRPL_QUEUE_RECORD_LEN];
+  struct brpl_queue_record record;
+
+  UNIT_TEST_BEGIN();
+
+  /* Our queue, normalized against the MAC capacity, in network order */
+  set_queue(5);
+  memset(buf, 0xff, sizeof(buf));
+  brpl_queue_record_write(buf);
+  UNIT_TEST_ASSERT(buf[0] == 0 && buf[1] == 0);
+  UNIT_TEST_ASSERT(buf[2] == 0 && buf[3] == 5);
+  UNIT_TEST_ASSERT(buf[4] == 0 && buf[5] == CAPACITY);
+
+  brpl_queue_record_read(buf, &record);
+  UNIT_TEST_ASSERT(record.queue == 5);
+  UNIT_TEST_ASSERT(record.queue_max == CAPACITY);
+  UNIT_TEST_ASSERT(record.age == 0);
+
+  /* The age is in milliseconds */
+  brpl_queue_record_read(wire, &record);
+  UNIT_TEST_ASSERT(record.queue == 0x0102);
+  UNIT_TEST_ASSERT(record.queue_max == 0x20);
+  UNIT_TEST_ASSERT(record.age == (clock_time_t)(1500UL * CLOCK_SECOND / 1000));
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(blend, "Freshness blend");
+UNIT_TEST(blend)
+{
+  const clock_time_t max_age = (clock_time_t)BRPL_CONF_QUEUE_MAX_AGE * CLOCK_SECOND;
+  struct brpl_queue_record record = { 40, CAPACITY, 0 };
+  uint16_t estimate;
+  uint16_t q;
+
+  UNIT_TEST_BEGIN();
+
+  /* Without a record, the queue of the parent is estimated from ours,
+   * scaled by rank: 5 * 8 / 4 */
+  parent->brpl_queue.valid = 0;
+  estimate = brpl_nbr_queue_length(&parent->brpl_queue, parent->rank,
+                                   dag->rank, 5, CAPACITY);
+  UNIT_TEST_ASSERT(estimate == 10);
+
+  /* A fresh record is taken as is */
+  brpl_queue_record_input(parent, &record);
+  UNIT_TEST_ASSERT(parent->brpl_queue.valid);
+  UNIT_TEST_ASSERT(parent->brpl_queue.queue_max == CAPACITY);
+  q = brpl_nbr_queue_length(&parent->brpl_queue, parent->rank,
+                            dag->rank, 5, CAPACITY);
+  printf("fresh: %u\n", q);
+  UNIT_TEST_ASSERT(q == 40);
+
+  /* Half way to the maximum age, half way to the estimate */
+  record.age = max_age / 2;
+  brpl_queue_record_input(parent, &record);
+  q = brpl_nbr_queue_length(&parent->brpl_queue, parent->rank,
+                            dag->rank, 5, CAPACITY);
+  printf("half aged: %u\n", q);
+  UNIT_TEST_ASSERT(q >= 24 && q <= 25);
+
+  /* Too old: the estimate */
+  record.age = max_age;
+  brpl_queue_record_input(parent, &record);
+  q = brpl_nbr_queue_length(&parent->brpl_queue, parent->rank,
+                            dag->rank, 5, CAPACITY);
+  UNIT_TEST_ASSERT(q == estimate);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(due, "Record gate");
+UNIT_TEST(due)
+{
+  UNIT_TEST_BEGIN();
+
+  set_queue(3);
+  parent->brpl_adv_at = 0;
+  /* Never sent one */
+  UNIT_TEST_ASSERT(brpl_queue_record_due(dag, parent));
+  UNIT_TEST_ASSERT(!brpl_queue_record_due(dag, parent));
+
+  /* Moved by less than BRPL_CONF_QUEUE_ADV_DELTA, then by as much */
+  mac_backlog_enqueued(&child_addr, 50);
+  UNIT_TEST_ASSERT(BRPL_CONF_QUEUE_ADV_DELTA > 1);
+  UNIT_TEST_ASSERT(!brpl_queue_record_due(dag, parent));
+  mac_backlog_enqueued(&child_addr, 50);
+  UNIT_TEST_ASSERT(brpl_queue_record_due(dag, parent));
+  UNIT_TEST_ASSERT(parent->brpl_adv_queue == 5);
+  UNIT_TEST_ASSERT(!brpl_queue_record_due(dag, parent));
+
+  /* Getting old */
+  parent->brpl_adv_at -= (clock_time_t)BRPL_CONF_QUEUE_ADV_REFRESH * CLOCK_SECOND;
+  UNIT_TEST_ASSERT(brpl_queue_record_due(dag, parent));
+  UNIT_TEST_ASSERT(!brpl_queue_record_due(dag, parent));
+
+  /* A child that is not in the parent table always gets one */
+  UNIT_TEST_ASSERT(brpl_queue_record_due(dag, NULL));
+  UNIT_TEST_ASSERT(brpl_queue_record_due(dag, NULL));
+
+  /* Not without BRPL */
+  dag->instance->of = &rpl_mrhof;
+  UNIT_TEST_ASSERT(!brpl_queue_record_due(dag, NULL));
+  dag->instance->of = &rpl_brpl;
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(test_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  if(!setup_dag()) {
+    printf("=check-me= FAILED: setup\n");
+  }
+
+  UNIT_TEST_RUN(encode_decode);
+  UNIT_TEST_RUN(blend);
+  UNIT_TEST_RUN(due);
+
+  if(!UNIT_TEST_PASSED(encode_decode)
+     || !UNIT_TEST_PASSED(blend)
+     || !UNIT_TEST_PASSED(due)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
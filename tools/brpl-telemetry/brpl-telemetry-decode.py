@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+"""Decode BRPL binary telemetry back into the CSV trace lines.
+
+Nodes built with CSV_VERBOSE_LOGGING print their trace events as
+"TLM,<node id>,<hex record>" lines (see
+os/net/routing/rpl-classic/brpl-telemetry.h). This script reads a node or
+Cooja log and replaces each such line with the CSV line(s) the event used
+to be printed as, keeping any prefix (e.g. the Cooja time and mote ID)
+in front of it.
+
+Usage: brpl-telemetry-decode.py [--all] [logfile ...]
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+TLM_RE = re.compile(r'TLM,(\d+),([0-9a-fA-F]+)\s*$')
+
+TRUST_SCALE = 1000
+DELAY_BUCKETS = 12
+
+
+def fmt_csv(name, self_id, fields):
+    return ','.join(['CSV', name, str(self_id)] + [str(f) for f in fields])
+
+
+def decode_dropped(self_id, ts, f):
+    return [fmt_csv('TLM_DROPPED', self_id, f)]
+
+
+def decode_params(self_id, ts, f):
+    lam, gamma, trust_min = f[:3]
+    return ['BRPL_PARAMS: lambda=%u gamma=%.3f trust_min=%u'
+            % (lam, gamma / 1000.0, trust_min)]
+
+
+def decode_state(self_id, ts, f):
+    return [fmt_csv('BRPL_STATE', self_id, f)]
+
+
+def decode_metric(self_id, ts, f):
+    return [fmt_csv('BRPL_METRIC', self_id, f)]
+
+
+def decode_weight(self_id, ts, f):
+    return [fmt_csv('BRPL_WEIGHT', self_id, f)]
+
+
+def decode_trust(self_id, ts, f):
+    node, trust, trust_min, gamma, lam, raw_weight, weight = f
+    return [fmt_csv('BRPL_TRUST', self_id,
+                    [node, trust, trust_min, gamma, weight]),
+            'PARENT_CANDIDATE: self=%u id=%u BP=%d T=%.3f gamma=%.3f '
+            'lambda=%u score=%d' % (self_id, node, raw_weight,
+                                    trust / TRUST_SCALE, gamma / 1000.0,
+                                    lam, weight)]
+
+
+def decode_switch_gate(self_id, ts, f):
+    (pref, pref_w, best, best_w, margin, dwell_blocked, margin_ok,
+     block, bypass, reason) = f
+    return [fmt_csv('BRPL_SWITCH_GATE', self_id,
+                    [pref, pref_w, best, best_w, margin, int(not block),
+                     dwell_blocked, ts, margin_ok, block, bypass, reason])]
+
+
+def decode_best(self_id, ts, f):
+    return [fmt_csv('BRPL_BEST', self_id, f)]
+
+
+def decode_dwell_gate(self_id, ts, f):
+    return [fmt_csv('BRPL_DWELL_GATE', self_id, [f[0], ts])]
+
+
+def decode_delay(self_id, ts, f):
+    return [fmt_csv('BRPL_DELAY', self_id, f)]
+
+
+def decode_rpl_parent(self_id, ts, f):
+    return [fmt_csv('RPL_PARENT', self_id, f)]
+
+
+def decode_dio(self_id, ts, f):
+    return [fmt_csv('BRPL_DIO', self_id, f)]
+
+
+def decode_trickle(self_id, ts, f):
+    return [fmt_csv('BRPL_TRICKLE', self_id, f + [ts])]
+
+
+def decode_switch(self_id, ts, f):
+    return [fmt_csv('BRPL_SWITCH', self_id, f + [ts])]
+
+
+def decode_energy(self_id, ts, f):
+    return [fmt_csv('BRPL_ENERGY', self_id, f + [ts])]
+
+
+# Indexed by event type, in the order of the enum in brpl-telemetry.h:
+# (decoder, number of fields)
+EVENTS = [
+    (decode_dropped, 1),
+    (decode_params, 3),
+    (decode_state, 6),
+    (decode_metric, 4),
+    (decode_weight, 9),
+    (decode_trust, 7),
+    (decode_switch_gate, 10),
+    (decode_best, 5),
+    (decode_dwell_gate, 1),
+    (decode_delay, 2 + DELAY_BUCKETS),
+    (decode_rpl_parent, 3),
+    (decode_dio, 5),
+    (decode_trickle, 7),
+    (decode_switch, 6),
+    (decode_energy, 4),
+]
+
+
+def decode_record(self_id, record):
+    """Return the trace lines of one record, raise ValueError if malformed"""
+    if len(record) < 6:
+        raise ValueError('short record')
+    event, nfields, ts = struct.unpack_from('<BBI', record)
+    if len(record) != 6 + 4 * nfields:
+        raise ValueError('record length does not match its field count')
+    fields = list(struct.unpack_from('<%di' % nfields, record, 6))
+    if event >= len(EVENTS):
+        raise ValueError('unknown event type %d' % event)
+    decoder, expected = EVENTS[event]
+    if nfields != expected:
+        raise ValueError('event type %d has %d fields, expected %d' %
+                         (event, nfields, expected))
+    return decoder(self_id, ts, fields)
+
+
+def decode_stream(lines, out, keep_all):
+    errors = 0
+    for line in lines:
+        match = TLM_RE.search(line)
+        if match is None:
+            if keep_all:
+                out.write(line)
+            continue
+        prefix = line[:match.start()]
+        try:
+            decoded = decode_record(int(match.group(1)),
+                                    bytes.fromhex(match.group(2)))
+        except ValueError as e:
+            errors += 1
+            sys.stderr.write('skipping line: %s: %s' % (e, line))
+            continue
+        for d in decoded:
+            out.write(prefix + d + '\n')
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode BRPL binary telemetry into CSV trace lines')
+    parser.add_argument('--all', action='store_true',
+                        help='also copy the lines that are not telemetry')
+    parser.add_argument('logs', nargs='*',
+                        help='log files to decode (default: stdin)')
+    args = parser.parse_args()
+
+    errors = 0
+    if not args.logs:
+        errors += decode_stream(sys.stdin, sys.stdout, args.all)
+    for name in args.logs:
+        with open(name, errors='replace') as f:
+            errors += decode_stream(f, sys.stdout, args.all)
+    return 1 if errors else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())